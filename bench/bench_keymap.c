@@ -0,0 +1,115 @@
+// NOTE: unity build root, sched_setaffinity() / CPU_SET() require GNU extensions
+#define _GNU_SOURCE
+#define CEX_IMPLEMENTATION
+#define CEX_BENCH
+#include "cex.h"
+#include "src/KeyMap.c"
+#include "src/KeyMapBench.c"
+#include "src/KeyMapControl.c"
+#include "src/KeyMapHandoff.c"
+#include "src/KeyMapUring.c"
+
+// Event path of the daemon without devices: frames go through KeyMap.handle_key(), output
+// frames are written to /dev/null (one write() per frame, like uinput)
+static KeyMap_c keymap;
+
+/// Fresh generic-like config (mod layer + direct map), optionally with in-daemon repeat
+static Exception
+keymap_reset(bool repeat)
+{
+    int output_fd = keymap.output.fd;
+    if (keymap.repeat.timer_fd > 0) { close(keymap.repeat.timer_fd); }
+    keymap = (KeyMap_c){
+        .output.fd = output_fd,
+        .repeat.enabled = repeat,
+        .mod_key_code = KEY_LEFTALT,
+        .mod_map = {
+            [KEY_I] = KEY_UP,
+            [KEY_K] = KEY_DOWN,
+            [KEY_J] = KEY_LEFT,
+            [KEY_L] = KEY_RIGHT,
+        },
+        .direct_map = {
+            [KEY_CAPSLOCK] = KEY_ESC,
+        },
+    };
+    e$ret(KeyMap.repeat_setup(&keymap));
+    KeyMap.pipeline_setup(&keymap);
+    return EOK;
+}
+
+bench$setup_suite()
+{
+    e$except_errno (keymap.output.fd = open("/dev/null", O_WRONLY | O_CLOEXEC)) {
+        return Error.io;
+    }
+    return EOK;
+}
+
+bench$teardown_suite()
+{
+    if (keymap.output.fd > 0) { close(keymap.output.fd); }
+    if (keymap.repeat.timer_fd > 0) { close(keymap.repeat.timer_fd); }
+    return EOK;
+}
+
+/// One op = one frame (MSC_SCAN + EV_KEY + SYN_REPORT) of canned typing + mod layer trace
+static Exception
+keymap_replay_frames(u64 n_frames)
+{
+    struct input_event frame[3];
+    for (u64 i = 0; i < n_frames; i++) {
+        bench_trace_frame(i, KEY_LEFTALT, frame);
+        for (u32 j = 0; j < arr$len(frame); j++) { e$ret(KeyMap.handle_key(&keymap, &frame[j])); }
+    }
+    return EOK;
+}
+
+bench$case(keymap_trace_frame)
+{
+    e$ret(keymap_reset(false));
+    return keymap_replay_frames(bench$iters);
+}
+
+bench$case(keymap_trace_frame_repeat)
+{
+    e$ret(keymap_reset(true));
+    return keymap_replay_frames(bench$iters);
+}
+
+/// Held key hardware repeats, dropped by normalize stage (no output frame)
+bench$case(keymap_hw_repeat_drop)
+{
+    e$ret(keymap_reset(true));
+
+    struct input_event press = { .type = EV_KEY, .code = KEY_A, .value = 1 };
+    struct input_event syn = { .type = EV_SYN, .code = SYN_REPORT };
+    e$ret(KeyMap.handle_key(&keymap, &press));
+    e$ret(KeyMap.handle_key(&keymap, &syn));
+    for (u64 i = 0; i < bench$iters; i++) {
+        struct input_event frame[] = {
+            { .type = EV_KEY, .code = KEY_A, .value = 2 },
+            { .type = EV_SYN, .code = SYN_REPORT },
+        };
+        for (u32 j = 0; j < arr$len(frame); j++) { e$ret(KeyMap.handle_key(&keymap, &frame[j])); }
+    }
+    struct input_event release = { .type = EV_KEY, .code = KEY_A, .value = 0 };
+    e$ret(KeyMap.handle_key(&keymap, &release));
+    e$ret(KeyMap.handle_key(&keymap, &syn));
+    return EOK;
+}
+
+/// Key press/release through layer and action stages, frame is never sent (no syscalls)
+bench$case(keymap_key_no_frame)
+{
+    e$ret(keymap_reset(false));
+    for (u64 i = 0; i < bench$iters; i++) {
+        struct input_event ev = { .type = EV_KEY, .code = KEY_I, .value = (i32)(i & 1) };
+        e$ret(KeyMap.handle_key(&keymap, &ev));
+        keymap.output.len = 0; // NOTE: no SYN_REPORT, frame is dropped before write()
+    }
+    bench$keep(keymap.output.keys_down[KEY_I / 8]);
+    return EOK;
+}
+
+bench$main();
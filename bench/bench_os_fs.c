@@ -0,0 +1,124 @@
+#define CEX_IMPLEMENTATION
+#define CEX_BENCH
+#include "cex.h"
+
+// Tree copy: os.fs.copy_tree() (reflink / copy_file_range / sendfile) vs plain read()/write()
+// loop with the same directory walk. Source tree: 8 dirs x 8 files x 512KB of random data, plus
+// one 64MB sparse file with 1MB of data in the middle.
+#define BENCH_FS_DIR "build/bench/os_fs_tree"
+#define BENCH_FS_SRC BENCH_FS_DIR "/src"
+#define BENCH_FS_DST BENCH_FS_DIR "/dst"
+#define BENCH_FS_FILE_SIZE (512 * 1024)
+
+static Exception
+bench_fs_write(char* path, char* buf, usize len, off_t offset, off_t size)
+{
+    int fd;
+    e$except_errno (fd = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644)) { return Error.io; }
+    Exc result = EOK;
+    if (pwrite(fd, buf, len, offset) != (isize)len || ftruncate(fd, size) < 0) {
+        result = Error.io;
+    }
+    close(fd);
+    return result;
+}
+
+bench$setup_suite()
+{
+    if (os.path.exists(BENCH_FS_DIR)) { e$ret(os.fs.remove_tree(BENCH_FS_DIR)); }
+    char* buf = mem$malloc(mem$, 1024 * 1024);
+    if (buf == NULL) { return Error.memory; }
+    u64 rnd = 0x9E3779B97F4A7C15ULL;
+    for (u32 i = 0; i < 1024 * 1024 / sizeof(u64); i++) {
+        rnd ^= rnd << 13;
+        rnd ^= rnd >> 7;
+        rnd ^= rnd << 17;
+        ((u64*)buf)[i] = rnd;
+    }
+
+    Exc result = EOK;
+    mem$scope(tmem$, _)
+    {
+        for (u32 d = 0; d < 8 && !result; d++) {
+            for (u32 f = 0; f < 8 && !result; f++) {
+                char* path = str.fmt(_, BENCH_FS_SRC "/dir%02d/file%02d.bin", d, f);
+                if ((result = os.fs.mkpath(path))) { break; }
+                // NOTE: different content per file, reflink/dedup can't share blocks
+                ((u32*)buf)[d * 8 + f] ^= 0xA5A5A5A5;
+                result = bench_fs_write(path, buf, BENCH_FS_FILE_SIZE, 0, BENCH_FS_FILE_SIZE);
+            }
+        }
+        if (!result) {
+            result = bench_fs_write(
+                BENCH_FS_SRC "/sparse.bin",
+                buf,
+                1024 * 1024,
+                32 * 1024 * 1024,
+                64 * 1024 * 1024
+            );
+        }
+    }
+    mem$free(mem$, buf);
+    return result;
+}
+
+bench$teardown_suite()
+{
+    if (os.path.exists(BENCH_FS_DIR)) { e$ret(os.fs.remove_tree(BENCH_FS_DIR)); }
+    return EOK;
+}
+
+/// Reference: buffered read()/write() copy of each file (os.fs.copy() fallback path)
+static Exception
+bench_fs_buffered_walker(char* path, os_fs_stat_s ftype, void* user_ctx)
+{
+    (void)user_ctx;
+    static char buf[32 * 1024];
+    mem$scope(tmem$, _)
+    {
+        char* out_file = str.fmt(_, BENCH_FS_DST "%s", path + strlen(BENCH_FS_SRC));
+        if (!ftype.is_file) { return os.fs.mkpath(str.fmt(_, "%s/", out_file)); }
+        e$ret(os.fs.mkpath(out_file));
+
+        int src_fd, dst_fd;
+        e$except_errno (src_fd = open(path, O_RDONLY)) { return Error.io; }
+        e$except_errno (dst_fd = open(out_file, O_CREAT | O_TRUNC | O_WRONLY, 0644)) {
+            close(src_fd);
+            return Error.io;
+        }
+        Exc result = EOK;
+        isize n;
+        while ((n = read(src_fd, buf, sizeof(buf))) > 0) {
+            if (write(dst_fd, buf, n) != n) {
+                result = Error.io;
+                break;
+            }
+        }
+        if (n < 0) { result = Error.io; }
+        close(src_fd);
+        close(dst_fd);
+        return result;
+    }
+    return EOK;
+}
+
+/// One op = copy of the whole tree (+ removal of the copy)
+bench$case(os_fs_copy_tree)
+{
+    for (u64 i = 0; i < bench$iters; i++) {
+        e$ret(os.fs.copy_tree(BENCH_FS_SRC, BENCH_FS_DST));
+        e$ret(os.fs.remove_tree(BENCH_FS_DST));
+    }
+    return EOK;
+}
+
+bench$case(buffered_copy_tree)
+{
+    for (u64 i = 0; i < bench$iters; i++) {
+        e$ret(os.fs.dir_walk(BENCH_FS_SRC, true, bench_fs_buffered_walker, NULL));
+        e$ret(os.fs.remove_tree(BENCH_FS_DST));
+    }
+    return EOK;
+}
+
+bench$main();
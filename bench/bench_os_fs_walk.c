@@ -0,0 +1,140 @@
+#define CEX_IMPLEMENTATION
+#define CEX_BENCH
+#include "cex.h"
+
+// Directory walk of a 100k-file tree (100 dirs x 1000 empty files, half of them *.c):
+// os.fs.dir_walk() (getdents64 + d_type), os.fs.dir_walk_mt(), os.fs.find() vs reference
+// opendir()/readdir() walk with stat() + str.match() per entry.
+#define BENCH_WALK_DIR "build/bench/os_fs_walk_tree"
+#define BENCH_WALK_N_DIRS 100
+#define BENCH_WALK_N_FILES 1000
+
+static u64 n_entries;
+
+bench$setup_suite()
+{
+    if (os.path.exists(BENCH_WALK_DIR)) { e$ret(os.fs.remove_tree(BENCH_WALK_DIR)); }
+    mem$scope(tmem$, _)
+    {
+        for (u32 d = 0; d < BENCH_WALK_N_DIRS; d++) {
+            char* dir = str.fmt(_, BENCH_WALK_DIR "/dir%03d/", d);
+            e$ret(os.fs.mkpath(dir));
+            char path[PATH_MAX];
+            for (u32 f = 0; f < BENCH_WALK_N_FILES; f++) {
+                snprintf(path, sizeof(path), "%sfile%04d.%c", dir, f, (f & 1) ? 'h' : 'c');
+                int fd;
+                e$except_errno (fd = open(path, O_CREAT | O_WRONLY, 0644)) { return Error.io; }
+                close(fd);
+            }
+        }
+    }
+    return EOK;
+}
+
+bench$teardown_suite()
+{
+    if (os.path.exists(BENCH_WALK_DIR)) { e$ret(os.fs.remove_tree(BENCH_WALK_DIR)); }
+    return EOK;
+}
+
+/// Reference: os.fs.dir_walk() before getdents64 backend, stat() of each entry
+static Exception
+bench_walk_readdir(char* path, char* pattern)
+{
+    DIR* dp = opendir(path);
+    if (dp == NULL) { return os.get_last_error(); }
+    Exc result = EOK;
+    char path_buf[PATH_MAX];
+    struct dirent* ep;
+    while ((ep = readdir(dp)) != NULL && result == EOK) {
+        if (str.eq(ep->d_name, ".") || str.eq(ep->d_name, "..")) { continue; }
+        snprintf(path_buf, sizeof(path_buf), "%s/%s", path, ep->d_name);
+        os_fs_stat_s ftype = os.fs.stat(path_buf);
+        if (!ftype.is_valid) {
+            result = ftype.error;
+            break;
+        }
+        if (ftype.is_directory && !ftype.is_symlink) {
+            result = bench_walk_readdir(path_buf, pattern);
+        } else if (pattern == NULL || str.match(ep->d_name, pattern)) {
+            n_entries++;
+        }
+    }
+    closedir(dp);
+    return result;
+}
+
+static Exception
+bench_walk_count(char* path, os_fs_stat_s ftype, void* user_ctx)
+{
+    (void)path;
+    (void)user_ctx;
+    if (!ftype.is_directory) { __atomic_add_fetch(&n_entries, 1, __ATOMIC_RELAXED); }
+    return EOK;
+}
+
+static Exception
+bench_walk_check(u64 n_expected)
+{
+    if (n_entries != n_expected) {
+        return e$raise(Error.integrity, "entries: %lu expected: %lu", n_entries, n_expected);
+    }
+    return EOK;
+}
+
+/// One op = walk of the whole tree
+bench$case(readdir_stat_walk)
+{
+    for (u64 i = 0; i < bench$iters; i++) {
+        n_entries = 0;
+        e$ret(bench_walk_readdir(BENCH_WALK_DIR, NULL));
+        e$ret(bench_walk_check(BENCH_WALK_N_DIRS * BENCH_WALK_N_FILES));
+    }
+    return EOK;
+}
+
+bench$case(os_fs_dir_walk)
+{
+    for (u64 i = 0; i < bench$iters; i++) {
+        n_entries = 0;
+        e$ret(os.fs.dir_walk(BENCH_WALK_DIR, true, bench_walk_count, NULL));
+        e$ret(bench_walk_check(BENCH_WALK_N_DIRS * BENCH_WALK_N_FILES));
+    }
+    return EOK;
+}
+
+bench$case(os_fs_dir_walk_mt)
+{
+    for (u64 i = 0; i < bench$iters; i++) {
+        n_entries = 0;
+        e$ret(os.fs.dir_walk_mt(BENCH_WALK_DIR, 0, bench_walk_count, NULL));
+        e$ret(bench_walk_check(BENCH_WALK_N_DIRS * BENCH_WALK_N_FILES));
+    }
+    return EOK;
+}
+
+/// One op = recursive search of *.c files
+bench$case(readdir_stat_match_c)
+{
+    for (u64 i = 0; i < bench$iters; i++) {
+        n_entries = 0;
+        e$ret(bench_walk_readdir(BENCH_WALK_DIR, "*.c"));
+        e$ret(bench_walk_check(BENCH_WALK_N_DIRS * BENCH_WALK_N_FILES / 2));
+    }
+    return EOK;
+}
+
+bench$case(os_fs_find_c)
+{
+    for (u64 i = 0; i < bench$iters; i++) {
+        mem$scope(tmem$, _)
+        {
+            arr$(char*) files = os.fs.find(BENCH_WALK_DIR "/*.c", true, _);
+            n_entries = (files) ? arr$len(files) : 0;
+        }
+        e$ret(bench_walk_check(BENCH_WALK_N_DIRS * BENCH_WALK_N_FILES / 2));
+    }
+    return EOK;
+}
+
+bench$main();
@@ -0,0 +1,118 @@
+#define CEX_IMPLEMENTATION
+#define CEX_BENCH
+#include "cex.h"
+
+// str.match() (compiled patterns cached), str.pattern.match() (compiled once) vs the pattern
+// interpreter str.match() used before (_cex_str_match(), still a fallback for too big patterns)
+static char* file_names[] = {
+    "cex.c",        "cex.h",         "KeyMap.c",          "KeyMap.h",     "KeyMapBench.c",
+    "README.md",    "uberkb.c",      "bench_keymap.c",    "Makefile",     "KeyMapUring.c",
+    "compile.json", "uberkb.service", "KeyMapHandoff.c", "bench.json",   "KeyMapControl.c",
+    ".gitignore",
+};
+static char* commands[] = { "run", "build", "create", "clean", "debug", "help", "test", "install" };
+
+/// One op = match of one string
+#define BENCH_MATCH_LOOP(names, match_expr)                                                        \
+    for (u64 i = 0; i < bench$iters; i++) {                                                        \
+        char* s = names[i % arr$len(names)];                                                       \
+        bench$keep(match_expr);                                                                    \
+    }
+
+bench$case(suffix_interp)
+{
+    BENCH_MATCH_LOOP(file_names, _cex_str_match(s, strlen(s), "*.c"));
+    return EOK;
+}
+
+bench$case(suffix_str_match)
+{
+    BENCH_MATCH_LOOP(file_names, str.match(s, "*.c"));
+    return EOK;
+}
+
+bench$case(suffix_compiled)
+{
+    str_pattern_c p;
+    e$ret(str.pattern.compile(&p, "*.c"));
+    BENCH_MATCH_LOOP(file_names, str.pattern.match(&p, s));
+    return EOK;
+}
+
+bench$case(class_interp)
+{
+    BENCH_MATCH_LOOP(file_names, _cex_str_match(s, strlen(s), "KeyMap*.[ch]"));
+    return EOK;
+}
+
+bench$case(class_str_match)
+{
+    BENCH_MATCH_LOOP(file_names, str.match(s, "KeyMap*.[ch]"));
+    return EOK;
+}
+
+bench$case(class_compiled)
+{
+    str_pattern_c p;
+    e$ret(str.pattern.compile(&p, "KeyMap*.[ch]"));
+    BENCH_MATCH_LOOP(file_names, str.pattern.match(&p, s));
+    return EOK;
+}
+
+bench$case(group_interp)
+{
+    char* pattern = "(run|build|create|clean|debug)";
+    BENCH_MATCH_LOOP(commands, _cex_str_match(s, strlen(s), pattern));
+    return EOK;
+}
+
+bench$case(group_str_match)
+{
+    BENCH_MATCH_LOOP(commands, str.match(s, "(run|build|create|clean|debug)"));
+    return EOK;
+}
+
+bench$case(group_compiled)
+{
+    str_pattern_c p;
+    e$ret(str.pattern.compile(&p, "(run|build|create|clean|debug)"));
+    BENCH_MATCH_LOOP(commands, str.pattern.match(&p, s));
+    return EOK;
+}
+
+/// Two patterns in turn (`a || b` filter), str.match() cache must keep both
+bench$case(alternate_interp)
+{
+    BENCH_MATCH_LOOP(
+        file_names,
+        _cex_str_match(s, strlen(s), "*.[ch]") || _cex_str_match(s, strlen(s), "(README|LICENSE)*")
+    );
+    return EOK;
+}
+
+bench$case(alternate_str_match)
+{
+    BENCH_MATCH_LOOP(file_names, str.match(s, "*.[ch]") || str.match(s, "(README|LICENSE)*"));
+    return EOK;
+}
+
+/// Backtracking case: every '*' of the interpreter tries all positions, no match in the end
+static char* long_names[] = {
+    "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa",
+};
+
+bench$case(backtrack_interp)
+{
+    BENCH_MATCH_LOOP(long_names, _cex_str_match(s, strlen(s), "*a*a*a*a*[bc]"));
+    return EOK;
+}
+
+bench$case(backtrack_compiled)
+{
+    str_pattern_c p;
+    e$ret(str.pattern.compile(&p, "*a*a*a*a*[bc]"));
+    BENCH_MATCH_LOOP(long_names, str.pattern.match(&p, s));
+    return EOK;
+}
+
+bench$main();
@@ -0,0 +1,204 @@
+#define CEX_IMPLEMENTATION
+#define CEX_BENCH
+#include "cex.h"
+
+// Search/split of a 4MB text (source-like lines, needle at the very end): str.findr(),
+// str.slice.index_of(), str.split_lines(), str.slice.iter_split() vs the byte at a time loops they
+// used before (SSE2 by default on x86_64, AVX2 with -mavx2 / -march=native). str.find() is libc
+// strstr(), which is already vectorized, for reference.
+#define BENCH_TEXT_SIZE (4 * 1024 * 1024)
+#define BENCH_NEEDLE "cexy$pkgconf_libs"
+#define BENCH_HEADER "#pragma once"
+
+static char* text;
+static usize text_len;
+static usize text_lines;
+static usize text_tokens; // split by "\n,"
+
+bench$setup_suite()
+{
+    static char* words[] = { "static", "char*", "return", "if", "(", ")", "{", "}", "for", "i++",
+                             "usize", "mem$", "str.fmt", "0;", "==", "NULL", "e$ret", "arr$" };
+    text = mem$malloc(mem$, BENCH_TEXT_SIZE + 1);
+    if (text == NULL) { return Error.memory; }
+    u64 rnd = 0x9E3779B97F4A7C15ULL;
+    usize len = sizeof(BENCH_HEADER);
+    usize line_len = 0;
+    memcpy(text, BENCH_HEADER "\n", len);
+    text_lines++;
+    while (len < BENCH_TEXT_SIZE - sizeof(BENCH_NEEDLE) - 32) {
+        rnd ^= rnd << 13;
+        rnd ^= rnd >> 7;
+        rnd ^= rnd << 17;
+        char* w = words[rnd % arr$len(words)];
+        usize wlen = strlen(w);
+        memcpy(text + len, w, wlen);
+        len += wlen;
+        line_len += wlen + 1;
+        if (line_len > 40 + (rnd >> 32) % 40) {
+            text[len++] = '\n';
+            text_lines++;
+            line_len = 0;
+        } else {
+            text[len++] = (rnd & 0x100) ? ',' : ' ';
+        }
+    }
+    memcpy(text + len, BENCH_NEEDLE "\n", sizeof(BENCH_NEEDLE));
+    len += sizeof(BENCH_NEEDLE);
+    text_lines++;
+    text[len] = '\0';
+    text_len = len;
+    text_tokens = 1;
+    for (usize i = 0; i < len; i++) { text_tokens += (text[i] == '\n' || text[i] == ','); }
+    return EOK;
+}
+
+bench$teardown_suite()
+{
+    mem$free(mem$, text);
+    return EOK;
+}
+
+static Exception
+bench_search_check(isize idx)
+{
+    isize expected = text_len - sizeof(BENCH_NEEDLE);
+    if (idx != expected) {
+        return e$raise(Error.integrity, "idx: %ld expected: %ld", idx, expected);
+    }
+    return EOK;
+}
+
+/// One op = search of the whole text
+bench$case(find_str)
+{
+    for (u64 i = 0; i < bench$iters; i++) {
+        char* p = str.find(text, BENCH_NEEDLE);
+        bench$keep(p);
+        e$ret(bench_search_check(p - text));
+    }
+    return EOK;
+}
+
+bench$case(findr_bytewise)
+{
+    // NOTE: the old str.findr() loop, the needle is only at the start of the text
+    for (u64 i = 0; i < bench$iters; i++) {
+        char* needle = BENCH_HEADER;
+        usize needle_len = strlen(needle);
+        char* p = NULL;
+        for (char* ptr = text + strlen(text) - needle_len; ptr >= text; ptr--) {
+            if (strncmp(ptr, needle, needle_len) == 0) {
+                p = ptr;
+                break;
+            }
+        }
+        if (p != text) { return Error.integrity; }
+    }
+    return EOK;
+}
+
+bench$case(findr_str)
+{
+    for (u64 i = 0; i < bench$iters; i++) {
+        if (str.findr(text, BENCH_HEADER) != text) { return Error.integrity; }
+    }
+    return EOK;
+}
+
+bench$case(index_of_bytewise)
+{
+    str_s s = str.sbuf(text, text_len);
+    str_s needle = str$s(BENCH_NEEDLE);
+    for (u64 i = 0; i < bench$iters; i++) {
+        isize idx = -1;
+        for (usize j = 0; j <= s.len - needle.len; j++) {
+            if (memcmp(&s.buf[j], needle.buf, needle.len) == 0) {
+                idx = j;
+                break;
+            }
+        }
+        e$ret(bench_search_check(idx));
+    }
+    return EOK;
+}
+
+bench$case(index_of_slice)
+{
+    str_s s = str.sbuf(text, text_len);
+    for (u64 i = 0; i < bench$iters; i++) {
+        e$ret(bench_search_check(str.slice.index_of(s, str$s(BENCH_NEEDLE))));
+    }
+    return EOK;
+}
+
+/// One op = split of the whole text
+bench$case(split_lines_bytewise)
+{
+    for (u64 i = 0; i < bench$iters; i++) {
+        mem$scope(tmem$, _)
+        {
+            arr$(char*) lines = arr$new(lines, _);
+            char* line_start = text;
+            for (char* cur = text; *cur; cur++) {
+                if (*cur == '\n' || *cur == '\r' || *cur == '\v' || *cur == '\f') {
+                    arr$push(lines, str.slice.clone(str.sbuf(line_start, cur - line_start), _));
+                    line_start = cur + 1;
+                }
+            }
+            if (arr$len(lines) != text_lines) { return Error.integrity; }
+        }
+    }
+    return EOK;
+}
+
+bench$case(split_lines_str)
+{
+    for (u64 i = 0; i < bench$iters; i++) {
+        mem$scope(tmem$, _)
+        {
+            arr$(char*) lines = str.split_lines(text, _);
+            if (arr$len(lines) != text_lines) { return Error.integrity; }
+        }
+    }
+    return EOK;
+}
+
+/// The old str.slice.iter_split() token search: lookup table of split chars, byte at a time
+static isize
+bench_index_bytewise(str_s s, char* c, u8 clen)
+{
+    u8 split_by_idx[256] = { 0 };
+    for (u8 i = 0; i < clen; i++) { split_by_idx[(u8)c[i]] = 1; }
+    for (usize i = 0; i < s.len; i++) {
+        if (split_by_idx[(u8)s.buf[i]]) { return i; }
+    }
+    return -1;
+}
+
+bench$case(iter_split_bytewise)
+{
+    str_s s = str.sbuf(text, text_len);
+    for (u64 i = 0; i < bench$iters; i++) {
+        usize n_tokens = 0;
+        for (usize cursor = 0; cursor <= s.len; n_tokens++) {
+            isize idx = bench_index_bytewise(str.slice.sub(s, cursor, 0), "\n,", 2);
+            cursor += (idx < 0) ? s.len - cursor + 1 : (usize)idx + 1;
+        }
+        if (n_tokens != text_tokens) { return Error.integrity; }
+    }
+    return EOK;
+}
+
+bench$case(iter_split_slice)
+{
+    str_s s = str.sbuf(text, text_len);
+    for (u64 i = 0; i < bench$iters; i++) {
+        usize n_tokens = 0;
+        for$iter (str_s, it, str.slice.iter_split(s, "\n,", &it.iterator)) { n_tokens++; }
+        if (n_tokens != text_tokens) { return Error.integrity; }
+    }
+    return EOK;
+}
+
+bench$main();
@@ -14,12 +14,17 @@
 #endif
 
 #define cexy$pkgconf_libs "libevdev"
+#define cexy$ld_args "-lm"
+#define cexy$cc_cache_mb 256
 
 #define CEX_IMPLEMENTATION
 #define CEX_BUILD
 #include "cex.h"
 
 Exception cmd_install(int argc, char** argv, void* user_ctx);
+Exception cmd_alloc_check(int argc, char** argv, void* user_ctx);
+Exception cmd_static_build(int argc, char** argv, void* user_ctx);
+Exception cmd_pgo(int argc, char** argv, void* user_ctx);
 
 int
 main(int argc, char** argv)
@@ -34,8 +39,24 @@ main(int argc, char** argv)
             cexy$cmd_all,
             cexy$cmd_fuzz, /* feel free to make your own if needed */
             cexy$cmd_test, /* feel free to make your own if needed */
+            cexy$cmd_bench,
             cexy$cmd_app,  /* feel free to make your own if needed */
             { .name = "install", .func = cmd_install, .help = "Install as a service" },
+            {
+                .name = "alloc-check",
+                .func = cmd_alloc_check,
+                .help = "Check event loop is allocation free",
+            },
+            {
+                .name = "static-build",
+                .func = cmd_static_build,
+                .help = "Build uberkb with compiled-in profile maps",
+            },
+            {
+                .name = "pgo",
+                .func = cmd_pgo,
+                .help = "Build uberkb with profile-guided optimization",
+            },
         ),
     };
     if (argparse.parse(&args, argc, argv)) { return 1; }
@@ -52,12 +73,16 @@ cmd_install(int argc, char** argv, void* user_ctx)
     e$assert(getuid() == 0 && "Expected to run with sudo");
 
     (void)user_ctx;
+    bool upgrade = false;
 
     argparse_c cmd_args = {
         .program_name = "./cex",
-        .usage = "install 'keyboard_name'",
+        .usage = "install [--upgrade] 'keyboard_name'",
         .description = "Installs uberkb.service for a keyboard",
-        argparse$opt_list(argparse$opt_help(), ),
+        argparse$opt_list(
+            argparse$opt_help(),
+            argparse$opt(&upgrade, 'u', "upgrade", "hand devices off to new binary (no restart)"),
+        ),
     };
     e$ret(argparse.parse(&cmd_args, argc, argv));
     char* keyboard_name = argparse.next(&cmd_args);
@@ -102,9 +127,177 @@ cmd_install(int argc, char** argv, void* user_ctx)
         // Starting
         e$ret(os$cmd("systemctl", "daemon-reload"));
         e$ret(os$cmd("systemctl", "enable", "uberkb.service"));
-        e$ret(os$cmd("systemctl", "restart", "uberkb.service"));
+        if (upgrade && os$cmd("systemctl", "is-active", "--quiet", "uberkb.service") == EOK) {
+            // NOTE: SIGHUP via ExecReload, keeps keyboard grabbed and virtual devices alive
+            e$ret(os$cmd("systemctl", "reload", "uberkb.service"));
+        } else {
+            e$ret(os$cmd("systemctl", "restart", "uberkb.service"));
+        }
         e$ret(os$cmd("systemctl", "status", "uberkb.service"));
     }
 
     return EOK;
 }
+
+/// Builds src/uberkb.c into app_exec with cexy$cc_args plus extra flags
+static Exception
+uberkb_build(char* app_exec, char** flags, usize n_flags)
+{
+    mem$scope(tmem$, _)
+    {
+        arr$(char*) args = arr$new(args, _);
+        char* cc_args[] = { cexy$cc_args };
+        arr$push(args, cexy$cc);
+        arr$pusha(args, flags, n_flags);
+        arr$pusha(args, cc_args);
+        arr$pushm(args, cexy$cc_include);
+        e$ret(cexy$pkgconf(_, &args, "--cflags", cexy$pkgconf_libs));
+        arr$pushm(args, cexy$src_dir "/uberkb.c", cexy$ld_args);
+        e$ret(cexy$pkgconf(_, &args, "--libs", cexy$pkgconf_libs));
+        arr$pushm(args, cexy$cc_deps(_, app_exec), "-o", app_exec);
+        arr$push(args, NULL);
+        e$ret(cexy.cache.build(args));
+    }
+    return EOK;
+}
+
+/// Builds uberkb with allocator trap and runs the event loop on virtual source keyboard (root),
+/// fails if the loop allocates after it's ready
+Exception
+cmd_alloc_check(int argc, char** argv, void* user_ctx)
+{
+    (void)user_ctx;
+    u32 n_frames = 20000;
+
+    argparse_c cmd_args = {
+        .program_name = "./cex",
+        .usage = "alloc-check [options]",
+        .description = "Builds uberkb with -DKEYMAP_ALLOC_TRAP and runs --bench-loop (root)",
+        argparse$opt_list(
+            argparse$opt_help(),
+            argparse$opt(&n_frames, 'n', "frames", "number of key frames to type"),
+        ),
+    };
+    e$ret(argparse.parse(&cmd_args, argc, argv));
+
+    char* app_src = cexy$src_dir "/uberkb.c";
+    char* app_exec = cexy$build_dir "/uberkb_alloc_trap";
+
+    mem$scope(tmem$, _)
+    {
+        if (cexy.src_include_changed(app_exec, app_src, NULL)) {
+            char* flags[] = { "-DKEYMAP_ALLOC_TRAP" };
+            e$ret(uberkb_build(app_exec, flags, arr$len(flags)));
+        }
+        // NOTE: libevdev queue + SYN_DROPPED resync, io_uring raw reads, key repeat timer
+        char* frames = str.fmt(_, "%d", n_frames);
+        e$ret(os$cmd(app_exec, "--bench-loop", frames));
+        e$ret(os$cmd(app_exec, "--uring", "--bench-loop", frames));
+        e$ret(os$cmd(app_exec, "--repeat", "--bench-loop", frames));
+    }
+
+    return EOK;
+}
+
+/// Generates profile maps header by generic uberkb, builds specialized binary and compares them
+Exception
+cmd_static_build(int argc, char** argv, void* user_ctx)
+{
+    (void)user_ctx;
+    u32 n_frames = 100000;
+
+    argparse_c cmd_args = {
+        .program_name = "./cex",
+        .usage = "static-build [options] ['keyboard_name']",
+        .description = "Builds uberkb with -DKEYMAP_STATIC_CONFIG for the keyboard profile",
+        argparse$opt_list(
+            argparse$opt_help(),
+            argparse$opt(&n_frames, 'n', "frames", "number of key frames to replay"),
+        ),
+    };
+    e$ret(argparse.parse(&cmd_args, argc, argv));
+    char* keyboard_name = argparse.next(&cmd_args);
+    if (keyboard_name == NULL) { keyboard_name = ""; }
+
+    char* app_exec = cexy$build_dir "/uberkb";
+    char* static_exec = cexy$build_dir "/uberkb_static";
+    char* static_config = cexy$build_dir "/keymap_static.h";
+
+    mem$scope(tmem$, _)
+    {
+        // NOTE: profiles live in uberkb.c, the generic binary is the generator
+        e$ret(os$cmd("./cex", "app", "build", "uberkb"));
+        e$ret(os$cmd(app_exec, "--gen-static", static_config, keyboard_name));
+
+        char* flags[] = { str.fmt(_, "-DKEYMAP_STATIC_CONFIG=\"%s\"", static_config) };
+        e$ret(uberkb_build(static_exec, flags, arr$len(flags)));
+
+        char* frames = str.fmt(_, "%d", n_frames);
+        io.printf("Generic (runtime config): %s\n", app_exec);
+        e$ret(os$cmd(app_exec, "--bench-replay", frames, keyboard_name));
+        io.printf("Static (compiled-in config): %s\n", static_exec);
+        e$ret(os$cmd(static_exec, "--bench-replay", frames, keyboard_name));
+    }
+
+    return EOK;
+}
+
+/// Builds instrumented uberkb, trains it on replay traces, rebuilds with -fprofile-use (gcc)
+Exception
+cmd_pgo(int argc, char** argv, void* user_ctx)
+{
+    (void)user_ctx;
+    u32 n_frames = 100000;
+    bool lto = false;
+
+    argparse_c cmd_args = {
+        .program_name = "./cex",
+        .usage = "pgo [options]",
+        .description =
+            "Builds build/uberkb_pgo trained by --bench-replay, compares with build/uberkb",
+        argparse$opt_list(
+            argparse$opt_help(),
+            argparse$opt(&n_frames, 'n', "frames", "number of key frames to replay"),
+            argparse$opt(&lto, '\0', "lto", "add -flto to profile-use build"),
+        ),
+    };
+    e$ret(argparse.parse(&cmd_args, argc, argv));
+
+    char* app_exec = cexy$build_dir "/uberkb";
+    char* pgo_exec = cexy$build_dir "/uberkb_pgo";
+    char* pgo_dir = cexy$build_dir "/pgo";
+
+    mem$scope(tmem$, _)
+    {
+        char* frames = str.fmt(_, "%d", n_frames);
+        char* profile_dir = str.fmt(_, "-fprofile-dir=%s", pgo_dir);
+
+        e$ret(os$cmd("./cex", "app", "build", "uberkb"));
+        io.printf("Generic: %s\n", app_exec);
+        e$ret(os$cmd(app_exec, "--bench-replay", frames));
+
+        // NOTE: stale .gcda from previous source revision fail -fprofile-use build
+        if (os.path.exists(pgo_dir)) { e$ret(os.fs.remove_tree(pgo_dir)); }
+        e$ret(os.fs.mkpath(pgo_dir));
+
+        // NOTE: .gcda name is derived from -o, both builds must produce the same pgo_exec
+        log$info("Building instrumented %s\n", pgo_exec);
+        char* gen_flags[] = { "-fprofile-generate", "-fprofile-update=single", profile_dir };
+        e$ret(uberkb_build(pgo_exec, gen_flags, arr$len(gen_flags)));
+
+        // Training: both stage sets (with/without normalize stage), output goes to /dev/null
+        e$ret(os$cmd(pgo_exec, "--bench-replay", frames));
+        e$ret(os$cmd(pgo_exec, "--repeat", "--bench-replay", frames));
+
+        log$info("Building %s with -fprofile-use%s\n", pgo_exec, lto ? " -flto" : "");
+        arr$(char*) use_flags = arr$new(use_flags, _);
+        arr$pushm(use_flags, "-fprofile-use", "-fprofile-correction", profile_dir);
+        if (lto) { arr$push(use_flags, "-flto"); }
+        e$ret(uberkb_build(pgo_exec, use_flags, arr$len(use_flags)));
+
+        io.printf("PGO: %s\n", pgo_exec);
+        e$ret(os$cmd(pgo_exec, "--bench-replay", frames));
+    }
+
+    return EOK;
+}
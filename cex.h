@@ -70,6 +70,9 @@ Use `cex -D config` to reset all project config flags to defaults
 /// customize abort() behavior
 // #define __cex__abort()
 
+/// hook called on every cex allocator malloc/calloc/realloc (e.g. allocation traps or tracing)
+// #define __cex__alloc_hook(allocator, size)
+
 // customize uassert() behavior
 // #define __cex__assert()
 
@@ -85,6 +88,9 @@ Use `cex -D config` to reset all project config flags to defaults
 /// disables float printing for io.printf/et al functions (code size reduction)
 // #define CEX_SPRINTF_NOFLOAT
 
+/// disables SSE2/AVX2/NEON code of str.find()/str.split()/et al (scalar fallback)
+// #define CEX_STR_NOSIMD
+
 #include <errno.h>
 #include <stdalign.h>
 #include <stdarg.h>
@@ -705,6 +711,10 @@ __attribute__((noinline)) void __cex__panic(void);
 #define CEX_ALLOCATOR_ARENA_MAGIC 0xFeedF001
 #define CEX_ALLOCATOR_TEMP_PAGE_SIZE 1024 * 256
 
+#ifndef __cex__alloc_hook
+#    define __cex__alloc_hook(allocator, size) ((void)0)
+#endif
+
 // clang-format off
 #define IAllocator const struct Allocator_i* 
 typedef struct Allocator_i
@@ -1026,7 +1036,7 @@ void* __asan_region_is_poisoned(void* beg, size_t size);
 typedef struct
 {
     alignas(64) const Allocator_i alloc;
-    // below goes sanity check stuff
+    // below goes sanity check stuff, atomic counters (mem$ is used from many threads)
     struct
     {
         u32 n_allocs;
@@ -2115,6 +2125,27 @@ typedef struct
 static_assert(alignof(str_s) == alignof(usize), "align");
 static_assert(sizeof(str_s) == sizeof(usize) * 2, "size");
 
+/// Precompiled str.match() pattern (see str.pattern.compile()), ~1.3KB, fine for a stack variable.
+/// Keeps pointers into the pattern string, which must outlive it.
+typedef struct str_pattern_c
+{
+    str_s prefix;    // literal head of pattern (before the 1st wildcard)
+    str_s suffix;    // literal tail of pattern after the last '*'
+    bool is_literal; // no wildcards, `prefix` is the whole pattern
+    bool is_simple;  // `prefix*suffix`, no state machine needed
+    u8 n_nodes;
+    u8 n_classes;
+    struct
+    {
+        u8 kind;
+        u8 arg;       // char, or class index
+        u8 next;      // state after the node consumed a char
+        i16 skip_chr; // `*` states: the only char which leaves the state (memchr skip), or -1
+    } nodes[63];
+    u64 eps[64];       // epsilon closure of state (bit per state, state `n_nodes` is accept)
+    u64 classes[8][4]; // [abc] char bitmaps
+} str_pattern_c;
+
 
 /**
  * @brief creates str_s, instance from string literals/constants: str$s("my string")
@@ -2276,6 +2307,12 @@ tassert(!str.match("D", "[a-cA-C0-9]"));
 tassert(str.match("1234567890abcdefABCDEF", "[0-9a-fA-F+]"));
 tassert(str.match("create", "(run|build|create|clean)"));
 
+// Compiled once, for matching in loops
+str_pattern_c pattern;
+e$ret(str.pattern.compile(&pattern, "*.[ch]"));
+tassert(str.pattern.match(&pattern, "cex.h"));
+tassert(!str.pattern.matchs(&pattern, str$s("cex.hpp")));
+
 
 // Works with slices
 str_s src = str$s("my_test __String.txt");
@@ -2371,6 +2408,17 @@ struct __cex_namespace__str
         Exception       (*to_u8s)(str_s s, u8* num);
     } convert;
 
+    struct {
+        /// Compiles str.match() pattern into reusable matcher (no allocations, `pattern` must outlive
+        /// `self`). Literal and `prefix*suffix` patterns are checked by memcmp(), others by a state
+        /// machine which is linear to string length (no backtracking).
+        Exception       (*compile)(str_pattern_c* self, char* pattern);
+        /// Checks if string matches compiled pattern (see str.pattern.compile())
+        bool            (*match)(str_pattern_c* self, char* s);
+        /// Checks if slice matches compiled pattern (see str.pattern.compile())
+        bool            (*matchs)(str_pattern_c* self, str_s s);
+    } pattern;
+
     struct {
         /// Clone slice into new char* allocated by `allc`, null tolerant, returns NULL on error.
         char*           (*clone)(str_s s, IAllocator allc);
@@ -2692,12 +2740,18 @@ struct __cex_namespace__io {
     struct {
         /// Load full contents of the file at `path`, using text mode. Returns NULL on error.
         char*           (*load)(char* path, IAllocator allc);
+        /// Maps file at `path` into memory read-only (mmap), `out_content` is not null-terminated. Pipes,
+        /// ttys and other non-regular files are read into anonymous read-only mapping. Release it by
+        /// io.file.unmap().
+        Exception       (*map)(char* path, str_s* out_content);
         /// Reads line from file, allocates result. Returns NULL on error.
         char*           (*readln)(FILE* file, IAllocator allc);
         /// Saves full `contents` in the file at `path`, using text mode.
         Exception       (*save)(char* path, char* contents);
         /// Return full file size, always 0 for NULL file or atty
         usize           (*size)(FILE* file);
+        /// Releases `content` of io.file.map(), `content` is zeroed (NULL tolerant)
+        void            (*unmap)(str_s* content);
         /// Writes new line to the file
         Exception       (*writeln)(FILE* file, char* line);
     } file;
@@ -3695,8 +3749,15 @@ struct __cex_namespace__os
         Exception       (*copy)(char* src_path, char* dst_path);
         /// Copy directory recursively
         Exception       (*copy_tree)(char* src_dir, char* dst_dir);
-        /// Iterates over directory (can be recursive) using callback function
+        /// Iterates over directory (can be recursive) using callback function. On Linux `ftype` comes
+        /// from directory entry type: size and mtime are not set for files and directories (use
+        /// os.fs.stat() in callback if needed).
         Exception       (*dir_walk)(char* path, bool is_recursive, os_fs_dir_walk_f callback_fn, void* user_ctx);
+        /// Recursive os.fs.dir_walk() on `n_threads` threads (0 - number of CPUs, up to 8), sub-directories
+        /// are handed to idle threads. `callback_fn` is called concurrently and must be thread safe, there
+        /// is no order of entries (a directory may come before its contents). Serial walk if threads are
+        /// not supported.
+        Exception       (*dir_walk_mt)(char* path, u32 n_threads, os_fs_dir_walk_f callback_fn, void* user_ctx);
         /// Finds files in `dir/pattern`, for example "./mydir/*.c" (all c files), if is_recursive=true, all
         /// *.c files found in sub-directories.
         arr$(char*)     (*find)(char* path_pattern, bool is_recursive, IAllocator allc);
@@ -5028,6 +5089,25 @@ void _cex__codegen_indent(_cex__codegen_s* cg);
 #        define cexy$cc_args_test cexy$cc_args, "-Wno-unused-function", "-Itests/"
 #    endif
 
+#    ifndef cexy$cc_args_bench
+/// Benchmark runner compiler flags, optimized and without sanitizers (may be overridden by user)
+#        define cexy$cc_args_bench                                                                 \
+            "-Wall", "-Wextra", "-Werror", "-g", "-O2", "-Wno-unused-function", "-Ibench/"
+#    endif
+
+#    ifndef cexy$cc_deps
+/// Compiler flags for writing `<target>.d` dependency file, used by cexy.src_include_changed()
+/// instead of scanning #include directives (may be overridden by user, e.g. empty for msvc)
+#        define cexy$cc_deps(allocator, target_path)                                               \
+            "-MMD", "-MF", str.fmt(allocator, "%s.d", target_path)
+#    endif
+
+#    ifndef cexy$cc_cache_mb
+/// Size limit of compile cache in `cexy$build_dir/.cache` (MB), 0 - disabled (may be overridden
+/// by user). Cache key is compiler version + flags + preprocessed source (see cexy.cache.key)
+#        define cexy$cc_cache_mb 0
+#    endif
+
 #    ifndef cexy$fuzzer
 /// Fuzzer compilation command (supports clang libfuzzer and afl++)
 #        define cexy$fuzzer "clang", "-O0", "-Wall", "-Wextra", "-Werror", "-g", "-Wno-unused-function", "-fsanitize=address,fuzzer,undefined", "-fsanitize-undefined-trap-on-error"
@@ -5148,6 +5228,12 @@ See `cex help str.match` for more information about patter syntax.
           .func = cexy.cmd.simple_test,                                                            \
           .help = "Generic unit test build/run/debug" }
 
+/// Simple micro-benchmark runner command
+#    define cexy$cmd_bench                                                                         \
+        { .name = "bench",                                                                         \
+          .func = cexy.cmd.simple_bench,                                                           \
+          .help = "Generic micro-benchmark build/run" }
+
 /// Simple fuzz tests runner command
 #    define cexy$cmd_fuzz                                                                          \
         { .name = "fuzz",                                                                          \
@@ -5231,13 +5317,68 @@ See `cex help str.match` for more information about patter syntax.
         "cex test build all                       - build all tests\n"\
         "cex test run all                         - build and run all tests\n"\
         "cex test run tests/test_file.c           - run test by path\n"\
+        "cex test -j 8 run all                    - build and run all tests with 8 parallel jobs\n"\
         "cex test debug tests/test_file.c         - run test via `cexy$debug_cmd` program\n"\
         "cex test clean all                       - delete all test executables in `cexy$build_dir`\n"\
         "cex test clean test/test_file.c          - delete specific test executable\n"\
         "cex test run tests/test_file.c [--help]  - run test with passing arguments to the test runner program\n"
 
 
+// clang-format off
+#define _cexy$cmd_bench_help (\
+        "CEX built-in simple micro-benchmark runner\n"\
+\
+        "\nEach benchmark file is a unity build (like tests), compiled with cexy$cc_args_bench\n"\
+        "(optimized, no sanitizers). All benchmarks have to be in bench/ folder, and start\n"\
+        "with `bench_` prefix.\n"\
+\
+        "\nBenchmark case:\n"\
+        "\nbench$case(my_bench_case_name) {\n"\
+        "    for (u64 i = 0; i < bench$iters; i++) {\n"\
+        "        bench$keep(my_func(i));\n"\
+        "    }\n"\
+        "    return EOK;\n"\
+        "}\n"\
+        "\nbench$main();\n"\
+        \
+        "\nIterations are calibrated to --time-ms per sample, reported value is the median\n"\
+        "of --samples. `cex help bench$case` for more info.\n")
+
+#define _cexy$cmd_bench_epilog \
+        "\nBenchmark running examples: \n"\
+        "cex bench create bench/bench_file.c               - creates new benchmark file from template\n"\
+        "cex bench build all                               - build all benchmarks\n"\
+        "cex bench run all                                 - build and run all benchmarks\n"\
+        "cex bench --json build/bench.json run all         - also save all results as JSON\n"\
+        "cex bench run bench/bench_file.c --perf           - run with cpu perf counters\n"\
+        "cex bench compare all                             - run 3 times, fail on regression vs baseline\n"\
+        "cex bench --save compare all                      - save results as baseline of git HEAD\n"\
+        "cex bench --baseline a1b2c3 --threshold 5 compare all - compare with baseline of commit\n"\
+        "cex bench clean all                               - delete all benchmark executables\n"
+
 // clang-format on
+
+/// Subprocess job of cexy.utils.jobs_run(), `args` is NULL terminated arr$
+typedef struct cexy_job_s
+{
+    char* name;          // job label (e.g. source file)
+    arr$(char*) args;    // command line, last item is NULL
+    Exc result;          // exit result of job
+    f64 elapsed_sec;     // job wall time
+    char* target;        // output file of job (optional)
+    bool cache;          // `target` is restored from or stored to compile cache (see cexy.cache)
+    os_cmd_c _cmd;       // private state below
+    sbuf_c _output;
+    f64 _started;
+    char* _cache_key;    // cexy.cache.key() of `args`, computed by `cc -E` step of the job
+    sbuf_c _cache_meta;
+    char* _pp_file;
+    bool _is_preprocessing;
+    bool _is_cache_hit;
+    bool _is_running;
+    bool _is_done;
+} cexy_job_s;
+
 struct __cex_namespace__cexy {
     // Autogenerated by CEX
     // clang-format off
@@ -5254,6 +5395,21 @@ struct __cex_namespace__cexy {
         Exception       (*run)(char* target, bool is_debug, int argc, char** argv);
     } app;
 
+    struct {
+        Exception       (*clean)(char* target);
+        Exception       (*compare)(char* target, char* baseline, f64 threshold_pct, u32 n_runs, bool save_baseline, int argc, char** argv);
+        Exception       (*create)(char* target);
+        Exception       (*make_target_pattern)(char** target);
+        Exception       (*run)(char* target, char* json_file, int argc, char** argv);
+    } bench;
+
+    struct {
+        Exception       (*build)(arr$(char*) args);
+        char*           (*key)(arr$(char*) args, IAllocator allc);
+        bool            (*restore)(char* key, char* target);
+        Exception       (*store)(char* key, char* target);
+    } cache;
+
     struct {
         Exception       (*config)(int argc, char** argv, void* user_ctx);
         Exception       (*help)(int argc, char** argv, void* user_ctx);
@@ -5261,6 +5417,7 @@ struct __cex_namespace__cexy {
         Exception       (*new)(int argc, char** argv, void* user_ctx);
         Exception       (*process)(int argc, char** argv, void* user_ctx);
         Exception       (*simple_app)(int argc, char** argv, void* user_ctx);
+        Exception       (*simple_bench)(int argc, char** argv, void* user_ctx);
         Exception       (*simple_fuzz)(int argc, char** argv, void* user_ctx);
         Exception       (*simple_test)(int argc, char** argv, void* user_ctx);
         Exception       (*stats)(int argc, char** argv, void* user_ctx);
@@ -5274,12 +5431,14 @@ struct __cex_namespace__cexy {
         Exception       (*clean)(char* target);
         Exception       (*create)(char* target, bool include_sample);
         Exception       (*make_target_pattern)(char** target);
-        Exception       (*run)(char* target, bool is_debug, int argc, char** argv);
+        Exception       (*run)(char* target, bool is_debug, u32 n_jobs, int argc, char** argv);
     } test;
 
     struct {
+        u32             (*cpu_count)(void);
         char*           (*git_hash)(IAllocator allc);
         Exception       (*git_lib_fetch)(char* git_url, char* git_label, char* out_dir, bool update_existing, bool preserve_dirs, char** repo_paths, usize repo_paths_len);
+        Exception       (*jobs_run)(arr$(cexy_job_s) jobs, u32 n_jobs_max, IAllocator allc);
         Exception       (*make_compile_flags)(char* flags_file, bool include_cexy_flags, arr$(char*) cc_flags_or_null);
         Exception       (*make_new_project)(char* proj_dir);
         Exception       (*pkgconf)(IAllocator allc, arr$(char*)* out_cc_args, char** pkgconf_args, usize pkgconf_args_len);
@@ -5617,1863 +5776,2453 @@ CEX_NAMESPACE struct __cex_namespace__fuzz fuzz;
 
 
 /*
-*                          src/cex_footer.h
+*                          src/bench.h
 */
 
+typedef Exception (*_cex_bench_case_f)(u64 n_iters);
+typedef Exception (*_cex_bench_suite_f)(void);
 
-/*
-*                   CEX IMPLEMENTATION 
-*/
+#define CEX_BENCH_SAMPLES_MAX 64
+#define CEX_BENCH_PERF_MAX 4
 
+struct _cex_bench_case_s
+{
+    _cex_bench_case_f bench_fn;
+    char* bench_name;
+    u32 bench_line;
+};
 
+/// Per case measurement, all values are per single iteration (op)
+struct _cex_bench_result_s
+{
+    u64 n_iters;         // iterations per sample (calibrated)
+    u32 n_samples;       // timed samples
+    f64 ns_op;           // median of samples
+    f64 ns_op_min;       // best sample
+    f64 ns_op_max;       // worst sample
+    f64 ops_s;           // 1e9 / ns_op
+    f64 allocs_op;       // mem$ heap allocations (all samples)
+    bool has_perf;       // perf counters below are valid
+    f64 cycles_op;       // cpu cycles
+    f64 instructions_op; // retired instructions
+    f64 cache_misses_op; // last level cache misses
+    f64 branch_misses_op;
+    f64 samples[CEX_BENCH_SAMPLES_MAX]; // ns/op of each sample, sorted (for compare)
+};
 
-#if defined(CEX_IMPLEMENTATION) || defined(CEX_NEW)
+struct _cex_bench_context_s
+{
+    arr$(struct _cex_bench_case_s) bench_cases;
+    _cex_bench_suite_f setup_suite_fn;
+    _cex_bench_suite_f teardown_suite_fn;
+    char* suite_file;
+    char* case_filter;
+    char* json_file;   // results as JSON (for tracking over time)
+    i32 time_ms;       // target time of single sample
+    i32 n_samples;     // timed samples per case
+    bool quiet_mode;   // one line per case (for run all)
+    bool perf;         // read hardware counters (linux perf_event_open)
+    bool has_ansi;
+    int perf_fds[CEX_BENCH_PERF_MAX]; // group leader first, -1 - not available
+};
 
-#include <ctype.h>
-#include <math.h>
+/**
 
-#ifdef _WIN32
-#    define WIN32_LEAN_AND_MEAN
-#    include "windows.h"
-#    include <direct.h>
-#else
-#    include <dirent.h>
-#    include <fcntl.h>
-#    include <limits.h>
-#    include <sys/stat.h>
-#    include <sys/types.h>
-#    include <unistd.h>
-#endif
+Micro-benchmark engine:
+
+- Running/building benchmarks
+```sh
+./cex bench create bench/bench_mybench.c
+./cex bench run bench/bench_mybench.c
+./cex bench run all
+./cex bench --json build/bench.json run all
+./cex bench run bench/bench_mybench.c --perf --filter str_
+./cex bench --help
+```
 
+- Benchmark structure
+```c
+bench$setup_suite() {
+    // Optional: runs once before all cases
+    return EOK;
+}
 
-#define _cex_main_boilerplate \
-"#if __has_include(\"cex_config.h\")\n"\
-"// Custom config file\n"\
-"#    include \"cex_config.h\"\n"\
-"#else\n"\
-"// Overriding config values\n"\
-"#    define cexy$cc_include \"-I.\", \"-I./lib\"\n"\
-"#    define CEX_LOG_LVL 4 /* 0 (mute all) - 5 (log$trace) */\n"\
-"#endif\n"\
-"\n"\
-"#define CEX_IMPLEMENTATION\n"\
-"#define CEX_BUILD\n"\
-"#include \"cex.h\"\n"\
-"\n"\
-"Exception cmd_build_lib(int argc, char** argv, void* user_ctx);\n"\
-"\n"\
-"int\n"\
-"main(int argc, char** argv)\n"\
-"{\n"\
-"\n"\
-"    cexy$initialize(); // cex self rebuild and init\n"\
-"    argparse_c args = {\n"\
-"        .description = cexy$description,\n"\
-"        .epilog = cexy$epilog,\n"\
-"        .usage = cexy$usage,\n"\
-"        argparse$cmd_list(\n"\
-"            cexy$cmd_all,\n"\
-"            cexy$cmd_fuzz, /* feel free to make your own if needed */\n"\
-"            cexy$cmd_test, /* feel free to make your own if needed */\n"\
-"            cexy$cmd_app,  /* feel free to make your own if needed */\n"\
-"            { .name = \"build-lib\", .func = cmd_build_lib, .help = \"Custom build command\" },\n"\
-"        ),\n"\
-"    };\n"\
-"    if (argparse.parse(&args, argc, argv)) { return 1; }\n"\
-"    void* my_user_ctx = NULL; // passed as `user_ctx` to command\n"\
-"    if (argparse.run_command(&args, my_user_ctx)) { return 1; }\n"\
-"    return 0;\n"\
-"}\n"\
-"\n"\
-"/// Custom build command for building static lib\n"\
-"Exception\n"\
-"cmd_build_lib(int argc, char** argv, void* user_ctx)\n"\
-"{\n"\
-"    (void)argc;\n"\
-"    (void)argv;\n"\
-"    (void)user_ctx;\n"\
-"    log$info(\"Launching custom command\\n\");\n"\
-"    return EOK;\n"\
-"}\n"\
-""
+bench$case(my_bench_case){
+    // body is called several times with growing bench$iters, until one call takes
+    // long enough (see --time-ms), then timed samples are taken
+    for (u64 i = 0; i < bench$iters; i++) {
+        bench$keep(my_func(i)); // result is used, the call can't be optimized away
+    }
+    return EOK;
+}
+
+bench$main(); // mandatory at the end of each benchmark file
+```
+
+- Reports: ns/op (median of samples, min/max), ops/s, allocations/op (mem$ heap allocator), and
+  with `--perf` cycles/op, instructions/op, cache-misses/op, branch-misses/op (Linux only,
+  requires perf_event_paranoid <= 2 or CAP_PERFMON)
 
-/*
-*                          src/cex_base.c
 */
+#define __bench$
 
+/// Number of iterations of the current bench$case() call, set by the runner (calibrated)
+#define bench$iters _cex_bench__n_iters
 
-const struct _CEX_Error_struct Error = {
-    .ok = EOK,                       // Success
-    .memory = "MemoryError",         // memory allocation error
-    .io = "IOError",                 // IO error
-    .overflow = "OverflowError",     // buffer overflow
-    .argument = "ArgumentError",     // function argument error
-    .integrity = "IntegrityError",   // data integrity error
-    .exists = "ExistsError",         // entity or key already exists
-    .not_found = "NotFoundError",    // entity or key already exists
-    .skip = "ShouldBeSkipped",       // NOT an error, function result must be skipped
-    .empty = "EmptyError",           // resource is empty
-    .eof = "EOF",                    // end of file reached
-    .argsparse = "ProgramArgsError", // program arguments empty or incorrect
-    .runtime = "RuntimeError",       // generic runtime error
-    .assert = "AssertError",         // generic runtime check
-    .os = "OSError",                 // generic OS check
-    .timeout = "TimeoutError",       // await interval timeout
-    .permission = "PermissionError", // Permission denied
-    .try_again = "TryAgainError",    // EAGAIN / EWOULDBLOCK errno analog for async operations
-};
+/// Makes value (or expression result) observable, measured code can't be eliminated as dead
+#define bench$keep(value)                                                                          \
+    ({                                                                                             \
+        __typeof__(value) cex$tmpname(bench_keep) = (value);                                       \
+        __asm__ volatile("" : : "g"(&cex$tmpname(bench_keep)) : "memory");                         \
+    })
 
-void
-__cex__panic(void)
-{
-    fflush(stdout);
-    fflush(stderr);
-    sanitizer_stack_trace();
+/// Compiler memory barrier, forces pending stores to memory (e.g. writes into measured buffer)
+#define bench$clobber() __asm__ volatile("" : : : "memory")
 
-#ifdef CEX_TEST
-    breakpoint();
+/// Benchmark case, body must run `bench$iters` iterations of measured code
+#define bench$case(NAME)                                                                           \
+    extern struct _cex_bench_context_s _cex_bench__mainfn_state;                                   \
+    static Exception cex_bench_##NAME(u64 bench$iters);                                            \
+    static void cex_bench_register_##NAME(void) __attribute__((constructor));                      \
+    static void cex_bench_register_##NAME(void)                                                    \
+    {                                                                                              \
+        if (_cex_bench__mainfn_state.bench_cases == NULL) {                                        \
+            _cex_bench__mainfn_state.bench_cases = arr$new(                                        \
+                _cex_bench__mainfn_state.bench_cases,                                              \
+                mem$                                                                               \
+            );                                                                                     \
+            uassert(_cex_bench__mainfn_state.bench_cases != NULL && "memory error");               \
+        };                                                                                         \
+        arr$push(                                                                                  \
+            _cex_bench__mainfn_state.bench_cases,                                                  \
+            (struct _cex_bench_case_s){ .bench_fn = &cex_bench_##NAME,                             \
+                                        .bench_name = #NAME,                                       \
+                                        .bench_line = __LINE__ }                                   \
+        );                                                                                         \
+    }                                                                                              \
+    Exception __attribute__((noinline)) cex_bench_##NAME(u64 bench$iters)
+
+/// Optional: runs once before all bench$case()
+#define bench$setup_suite()                                                                        \
+    extern struct _cex_bench_context_s _cex_bench__mainfn_state;                                   \
+    static Exception cex_bench__setup_suite_fn();                                                  \
+    static void cex_bench__register_setup_suite_fn(void) __attribute__((constructor));             \
+    static void cex_bench__register_setup_suite_fn(void)                                           \
+    {                                                                                              \
+        uassert(_cex_bench__mainfn_state.setup_suite_fn == NULL);                                  \
+        _cex_bench__mainfn_state.setup_suite_fn = &cex_bench__setup_suite_fn;                      \
+    }                                                                                              \
+    Exception cex_bench__setup_suite_fn(void)
+
+/// Optional: runs once after all bench$case()
+#define bench$teardown_suite()                                                                     \
+    extern struct _cex_bench_context_s _cex_bench__mainfn_state;                                   \
+    static Exception cex_bench__teardown_suite_fn();                                               \
+    static void cex_bench__register_teardown_suite_fn(void) __attribute__((constructor));          \
+    static void cex_bench__register_teardown_suite_fn(void)                                        \
+    {                                                                                              \
+        uassert(_cex_bench__mainfn_state.teardown_suite_fn == NULL);                               \
+        _cex_bench__mainfn_state.teardown_suite_fn = &cex_bench__teardown_suite_fn;                \
+    }                                                                                              \
+    Exception cex_bench__teardown_suite_fn(void)
+
+#ifndef CEX_BENCH
+#    define _bench$env_check()                                                                     \
+        fprintf(stderr, "CEX_BENCH was not defined, pass -DCEX_BENCH or #define CEX_BENCH");       \
+        exit(1);
 #else
-    abort();
+#    define _bench$env_check() (void)0
 #endif
-    return;
-}
+
+/// main() function for benchmark suite, you must place it into benchmark file at the end
+#define bench$main()                                                                               \
+    struct _cex_bench_context_s _cex_bench__mainfn_state = { .suite_file = __FILE__ };             \
+    int main(int argc, char** argv)                                                                \
+    {                                                                                              \
+        _bench$env_check();                                                                        \
+        argv[0] = __FILE__;                                                                        \
+        int ret_code = cex_bench_main_fn(argc, argv);                                              \
+        if (_cex_bench__mainfn_state.bench_cases) {                                                \
+            arr$free(_cex_bench__mainfn_state.bench_cases);                                        \
+        }                                                                                          \
+        return ret_code;                                                                           \
+    }
 
 
 
 /*
-*                          src/mem.c
+*                          src/bench.c
 */
+#ifdef CEX_BENCH
+#    include <time.h>
+#    if defined(__linux__)
+#        include <linux/perf_event.h>
+#        include <sys/ioctl.h>
+#        include <sys/syscall.h>
+#    endif
 
-void
-_cex_allocator_memscope_cleanup(IAllocator* allc)
+static u64
+cex_bench_now_ns(void)
 {
-    uassert(allc != NULL);
-    (*allc)->scope_exit(*allc);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
 }
 
-void
-_cex_allocator_arena_cleanup(IAllocator* allc)
+static void
+cex_bench_perf_open(struct _cex_bench_context_s* ctx)
+{
+    for (u32 i = 0; i < CEX_BENCH_PERF_MAX; i++) { ctx->perf_fds[i] = -1; }
+#    if defined(__linux__)
+    u64 configs[CEX_BENCH_PERF_MAX] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES,
+        PERF_COUNT_HW_BRANCH_MISSES,
+    };
+    for (u32 i = 0; i < CEX_BENCH_PERF_MAX; i++) {
+        struct perf_event_attr attr = {
+            .type = PERF_TYPE_HARDWARE,
+            .size = sizeof(struct perf_event_attr),
+            .config = configs[i],
+            .disabled = (i == 0),
+            .exclude_kernel = 1,
+            .exclude_hv = 1,
+            .read_format = PERF_FORMAT_GROUP,
+        };
+        int fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, ctx->perf_fds[0], 0);
+        if (fd < 0) {
+            if (i == 0) {
+                log$warn("perf counters are not available: %s\n", strerror(errno));
+                return;
+            }
+            continue; // e.g. cache misses are not supported in VMs, the rest is still valid
+        }
+        ctx->perf_fds[i] = fd;
+    }
+#    endif
+}
+
+static void
+cex_bench_perf_close(struct _cex_bench_context_s* ctx)
 {
-    uassert(allc != NULL);
-    AllocatorArena.destroy(*allc);
+    for (u32 i = 0; i < CEX_BENCH_PERF_MAX; i++) {
+        if (ctx->perf_fds[i] >= 0) { close(ctx->perf_fds[i]); }
+        ctx->perf_fds[i] = -1;
+    }
 }
 
-// NOTE: destructor(101) - 101 lowest priority for destructors
-__attribute__((destructor(101))) void
-_cex_global_allocators_destructor()
+/// Reads counters of perf group (enabled counters only, in perf_fds order), false on error
+static bool
+cex_bench_perf_read(struct _cex_bench_context_s* ctx, u64 out_values[CEX_BENCH_PERF_MAX])
 {
-    AllocatorArena_c* allc = (AllocatorArena_c*)tmem$;
-    allocator_arena_page_s* page = allc->last_page;
-    while (page) {
-        auto tpage = page->prev_page;
-        mem$free(mem$, page);
-        page = tpage;
+    memset(out_values, 0, sizeof(u64) * CEX_BENCH_PERF_MAX);
+#    if defined(__linux__)
+    if (ctx->perf_fds[0] < 0) { return false; }
+    u64 buf[1 + CEX_BENCH_PERF_MAX] = { 0 };
+    if (read(ctx->perf_fds[0], buf, sizeof(buf)) < (isize)sizeof(u64)) { return false; }
+    u32 j = 0;
+    for (u32 i = 0; i < CEX_BENCH_PERF_MAX && j < buf[0]; i++) {
+        if (ctx->perf_fds[i] >= 0) { out_values[i] = buf[1 + j++]; }
     }
+    return true;
+#    else
+    (void)ctx;
+    return false;
+#    endif
 }
 
+static void
+cex_bench_perf_enable(struct _cex_bench_context_s* ctx, bool enable)
+{
+#    if defined(__linux__)
+    if (ctx->perf_fds[0] < 0) { return; }
+    if (enable) {
+        ioctl(ctx->perf_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(ctx->perf_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    } else {
+        ioctl(ctx->perf_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+#    else
+    (void)ctx;
+    (void)enable;
+#    endif
+}
 
+static int
+cex_bench_cmp_f64(const void* a, const void* b)
+{
+    f64 va = *(const f64*)a;
+    f64 vb = *(const f64*)b;
+    return (va > vb) - (va < vb);
+}
 
-/*
-*                          src/AllocatorHeap.c
-*/
+/// Runs a case once with n_iters, returns elapsed ns (0 on error)
+static Exception
+cex_bench_run_once(struct _cex_bench_case_s* b, u64 n_iters, u64* out_ns)
+{
+    u64 t0 = cex_bench_now_ns();
+    Exc err = b->bench_fn(n_iters);
+    *out_ns = cex_bench_now_ns() - t0;
+    return err;
+}
 
-// clang-format off
-static void* _cex_allocator_heap__malloc(IAllocator self,usize size, usize alignment);
-static void* _cex_allocator_heap__calloc(IAllocator self,usize nmemb, usize size, usize alignment);
-static void* _cex_allocator_heap__realloc(IAllocator self,void* ptr, usize size, usize alignment);
-static void* _cex_allocator_heap__free(IAllocator self,void* ptr);
-static const struct Allocator_i*  _cex_allocator_heap__scope_enter(IAllocator self);
-static void _cex_allocator_heap__scope_exit(IAllocator self);
-static u32 _cex_allocator_heap__scope_depth(IAllocator self);
+/// Calibration: iterations grow until a call takes ~1/10 of target time, then scaled to target
+static Exception
+cex_bench_calibrate(struct _cex_bench_context_s* ctx, struct _cex_bench_case_s* b, u64* out_iters)
+{
+    u64 target_ns = (u64)ctx->time_ms * 1000000ULL;
+    u64 n = 1;
+    u64 elapsed = 0;
+    while (true) {
+        e$ret(cex_bench_run_once(b, n, &elapsed));
+        if (elapsed >= target_ns / 10 || n >= (1ULL << 40)) { break; }
+        // NOTE: predicting next n from the last run, with 10x cap (first runs are noisy)
+        u64 next = (elapsed > 0) ? (u64)((f64)n * (f64)(target_ns / 10) / (f64)elapsed * 1.2) : 0;
+        if (next <= n) { next = n * 2; }
+        if (next > n * 10) { next = n * 10; }
+        n = next;
+    }
+    f64 scaled = (elapsed > 0) ? (f64)n * (f64)target_ns / (f64)elapsed : (f64)n;
+    *out_iters = (scaled < 1) ? 1 : (u64)scaled;
+    return EOK;
+}
 
-AllocatorHeap_c _cex__default_global__allocator_heap = {
-    .alloc = {
-        .malloc = _cex_allocator_heap__malloc,
-        .realloc = _cex_allocator_heap__realloc,
-        .calloc = _cex_allocator_heap__calloc,
-        .free = _cex_allocator_heap__free,
-        .scope_enter = _cex_allocator_heap__scope_enter,
-        .scope_exit = _cex_allocator_heap__scope_exit,
-        .scope_depth = _cex_allocator_heap__scope_depth,
-        .meta = {
-            .magic_id =CEX_ALLOCATOR_HEAP_MAGIC,
-            .is_arena = false,
-            .is_temp = false, 
-        }
-    },
-};
-IAllocator const _cex__default_global__allocator_heap__allc = &_cex__default_global__allocator_heap.alloc;
-// clang-format on
-
-
-static void
-_cex_allocator_heap__validate(IAllocator self)
+static Exception
+cex_bench_measure(
+    struct _cex_bench_context_s* ctx,
+    struct _cex_bench_case_s* b,
+    struct _cex_bench_result_s* out
+)
 {
-    (void)self;
-#ifndef NDEBUG
-    uassert(self != NULL);
-    uassert(
-        self->meta.magic_id == CEX_ALLOCATOR_HEAP_MAGIC && "bad allocator pointer or mem corruption"
-    );
-#endif
-}
+    *out = (struct _cex_bench_result_s){ 0 };
+    e$ret(cex_bench_calibrate(ctx, b, &out->n_iters));
+
+    f64* samples = out->samples;
+    u64 perf_total[CEX_BENCH_PERF_MAX] = { 0 };
+    u64 n_allocs = 0;
+    AllocatorHeap_c* alloc_heap = (AllocatorHeap_c*)mem$;
+    out->has_perf = ctx->perf_fds[0] >= 0;
+
+    for (i32 s = 0; s < ctx->n_samples; s++) {
+        u64 elapsed = 0;
+        u32 allocs_before = alloc_heap->stats.n_allocs;
+        cex_bench_perf_enable(ctx, true);
+        Exc err = cex_bench_run_once(b, out->n_iters, &elapsed);
+        cex_bench_perf_enable(ctx, false);
+        if (err) { return err; }
+        n_allocs += alloc_heap->stats.n_allocs - allocs_before;
+
+        u64 perf_values[CEX_BENCH_PERF_MAX];
+        if (out->has_perf && cex_bench_perf_read(ctx, perf_values)) {
+            for (u32 i = 0; i < CEX_BENCH_PERF_MAX; i++) { perf_total[i] += perf_values[i]; }
+        } else {
+            out->has_perf = false;
+        }
+        samples[s] = (f64)elapsed / (f64)out->n_iters;
+        out->n_samples++;
+    }
 
-static inline u64
-_cex_allocator_heap__hdr_set(u64 size, u8 ptr_offset, u8 alignment)
-{
-    size &= 0xFFFFFFFFFFFFULL; // Mask to 48 bits
-    return size | ((u64)ptr_offset << 48) | ((u64)alignment << 56);
+    qsort(samples, out->n_samples, sizeof(samples[0]), cex_bench_cmp_f64);
+    u64 n_total = out->n_iters * out->n_samples;
+    out->ns_op = samples[out->n_samples / 2];
+    out->ns_op_min = samples[0];
+    out->ns_op_max = samples[out->n_samples - 1];
+    out->ops_s = (out->ns_op > 0) ? 1e9 / out->ns_op : 0;
+    out->allocs_op = (f64)n_allocs / (f64)n_total;
+    if (out->has_perf) {
+        out->cycles_op = (f64)perf_total[0] / (f64)n_total;
+        out->instructions_op = (f64)perf_total[1] / (f64)n_total;
+        out->cache_misses_op = (f64)perf_total[2] / (f64)n_total;
+        out->branch_misses_op = (f64)perf_total[3] / (f64)n_total;
+    }
+    return EOK;
 }
 
-static inline usize
-_cex_allocator_heap__hdr_get_size(u64 alloc_hdr)
-{
-    return alloc_hdr & 0xFFFFFFFFFFFFULL;
+static char*
+cex_bench_fmt_si(char* buf, usize buf_size, f64 value)
+{
+    char* units = "";
+    if (value >= 1e9) {
+        value /= 1e9;
+        units = "G";
+    } else if (value >= 1e6) {
+        value /= 1e6;
+        units = "M";
+    } else if (value >= 1e3) {
+        value /= 1e3;
+        units = "K";
+    }
+    if (str.sprintf(buf, buf_size, "%0.2f%s", value, units)) { buf[0] = '\0'; }
+    return buf;
 }
 
-static inline u8
-_cex_allocator_heap__hdr_get_offset(u64 alloc_hdr)
-{
-    return (u8)((alloc_hdr >> 48) & 0xFF);
+static Exception
+cex_bench_json_case(FILE* file, struct _cex_bench_case_s* b, struct _cex_bench_result_s* r, bool first)
+{
+    e$ret(io.fprintf(
+        file,
+        "%s\n    {\"name\": \"%s\", \"iters\": %lu, \"samples\": %u, \"ns_op\": %0.3f, "
+        "\"ns_op_min\": %0.3f, \"ns_op_max\": %0.3f, \"ops_s\": %0.1f, \"allocs_op\": %0.4f",
+        first ? "" : ",",
+        b->bench_name,
+        r->n_iters,
+        r->n_samples,
+        r->ns_op,
+        r->ns_op_min,
+        r->ns_op_max,
+        r->ops_s,
+        r->allocs_op
+    ));
+    if (r->has_perf) {
+        e$ret(io.fprintf(
+            file,
+            ", \"cycles_op\": %0.3f, \"instructions_op\": %0.3f, \"cache_misses_op\": %0.4f, "
+            "\"branch_misses_op\": %0.4f",
+            r->cycles_op,
+            r->instructions_op,
+            r->cache_misses_op,
+            r->branch_misses_op
+        ));
+    }
+    e$ret(io.fprintf(file, ", \"samples_ns\": ["));
+    for (u32 i = 0; i < r->n_samples; i++) {
+        e$ret(io.fprintf(file, "%s%0.3f", (i > 0) ? ", " : "", r->samples[i]));
+    }
+    e$ret(io.fprintf(file, "]}"));
+    return EOK;
 }
 
-static inline u8
-_cex_allocator_heap__hdr_get_alignment(u64 alloc_hdr)
+static int __attribute__((noinline))
+cex_bench_main_fn(int argc, char** argv)
 {
-    return (u8)(alloc_hdr >> 56);
-}
+    extern struct _cex_bench_context_s _cex_bench__mainfn_state;
 
-static u64
-_cex_allocator_heap__hdr_make(usize alloc_size, usize alignment)
-{
+    struct _cex_bench_context_s* ctx = &_cex_bench__mainfn_state;
+    if (ctx->bench_cases == NULL) {
+        fprintf(stderr, "No bench$case() in the benchmark file: %s\n", __FILE__);
+        return 1;
+    }
+    ctx->time_ms = 100;
+    ctx->n_samples = 5;
+    ctx->has_ansi = io.isatty(stdout);
 
-    usize size = alloc_size;
+    argparse_opt_s options[] = {
+        argparse$opt_help(),
+        argparse$opt(&ctx->case_filter, 'f', "filter", .help = "execute cases with filter"),
+        argparse$opt(&ctx->quiet_mode, 'q', "quiet", .help = "one line per case (for run all)"),
+        argparse$opt(&ctx->time_ms, 't', "time-ms", .help = "target time of one sample"),
+        argparse$opt(&ctx->n_samples, 's', "samples", .help = "timed samples per case"),
+        argparse$opt(&ctx->perf, 'p', "perf", .help = "read cpu perf counters (linux)"),
+        argparse$opt(&ctx->json_file, 'j', "json", .help = "write results as JSON file"),
+    };
+    argparse_c args = {
+        .options = options,
+        .options_len = arr$len(options),
+        .description = "Benchmark runner program",
+    };
+    e$except_silent (err, argparse.parse(&args, argc, argv)) { return 1; }
+    if (ctx->time_ms <= 0 || ctx->n_samples <= 0 || ctx->n_samples > CEX_BENCH_SAMPLES_MAX) {
+        fprintf(
+            stderr,
+            "Invalid --time-ms (> 0) or --samples (1-%d)\n",
+            CEX_BENCH_SAMPLES_MAX
+        );
+        return 1;
+    }
 
-    if (unlikely(alloc_size == 0 || alloc_size > PTRDIFF_MAX || alignment > 64)) {
-        uassert(alloc_size > 0 && "zero size");
-        uassert(alloc_size > PTRDIFF_MAX && "size is too high");
-        uassert(alignment <= 64);
-        return 0;
+    u32 max_name = 0;
+    for$each (b, ctx->bench_cases) {
+        if (max_name < strlen(b.bench_name) + 2) { max_name = strlen(b.bench_name) + 2; }
     }
+    max_name = (max_name < 40) ? 40 : max_name;
 
-#if UINTPTR_MAX > 0xFFFFFFFFU
-    // Only 64 bit
-    if (unlikely((u64)alloc_size > (u64)0xFFFFFFFFFFFFULL)) {
-        uassert(
-            (u64)alloc_size < (u64)0xFFFFFFFFFFFFULL && "size is too high, or negative overflow"
-        );
-        return 0;
+    mem$scope(tmem$, _)
+    {
+        void* data = mem$malloc(_, 120);
+        (void)data;
+        uassert(data != NULL && "priming temp allocator failed");
     }
-#endif
+    for (u32 i = 0; i < CEX_BENCH_PERF_MAX; i++) { ctx->perf_fds[i] = -1; }
+    if (ctx->perf) { cex_bench_perf_open(ctx); }
 
-    if (alignment < 8) {
-        static_assert(alignof(void*) <= 8, "unexpected ptr alignment");
-        alignment = 8;
-    } else {
-        uassert(mem$is_power_of2(alignment) && "must be pow2");
+    FILE* json = NULL;
+    if (ctx->json_file) {
+        e$except (err, io.fopen(&json, ctx->json_file, "w")) { return 1; }
+        if (io.fprintf(json, "{\"suite\": \"%s\", \"cases\": [", ctx->suite_file)) { return 1; }
+    }
 
-        if ((alloc_size & (alignment - 1)) != 0) {
-            uassert(alloc_size % alignment == 0 && "requested size is not aligned");
-            return 0;
+    if (!ctx->quiet_mode) {
+        fprintf(stderr, "-------------------------------------\n");
+        fprintf(stderr, "Running Benchmarks: %s\n", argv[0]);
+        fprintf(stderr, "-------------------------------------\n\n");
+    }
+    if (ctx->setup_suite_fn) {
+        e$except (err, ctx->setup_suite_fn()) {
+            fprintf(
+                stderr,
+                "[%s] bench$setup_suite() failed with %s (suite %s stopped)\n",
+                ctx->has_ansi ? io$ansi("FAIL", "31") : "FAIL",
+                err,
+                ctx->suite_file
+            );
+            return 1;
         }
     }
-    size += sizeof(u64);
 
-    // extra area for poisoning
-    size += sizeof(u64);
+    u32 n_run = 0;
+    u32 n_failed = 0;
+    for$each (b, ctx->bench_cases) {
+        if (ctx->case_filter && !str.find(b.bench_name, ctx->case_filter)) { continue; }
+        fprintf(stderr, "%s", b.bench_name);
+        for (u32 i = 0; i < max_name - strlen(b.bench_name) + 2; i++) { putc('.', stderr); }
+        fflush(stderr);
+
+        struct _cex_bench_result_s r;
+        Exc err = cex_bench_measure(ctx, &b, &r);
+        if (err) {
+            n_failed++;
+            fprintf(stderr, "[%s] %s\n", ctx->has_ansi ? io$ansi("FAIL", "31") : "FAIL", err);
+            continue;
+        }
 
-    size = mem$aligned_round(size, alignment);
+        char ops_buf[32];
+        fprintf(
+            stderr,
+            " %10.2f ns/op %10s ops/s %8.2f allocs/op",
+            r.ns_op,
+            cex_bench_fmt_si(ops_buf, sizeof(ops_buf), r.ops_s),
+            r.allocs_op
+        );
+        if (r.has_perf) {
+            fprintf(
+                stderr,
+                " %8.1f cycles/op %6.2f IPC",
+                r.cycles_op,
+                (r.cycles_op > 0) ? r.instructions_op / r.cycles_op : 0
+            );
+        }
+        putc('\n', stderr);
+        if (!ctx->quiet_mode) {
+            fprintf(
+                stderr,
+                "    iters: %lu x %u samples, min: %0.2f ns/op, max: %0.2f ns/op\n",
+                r.n_iters,
+                r.n_samples,
+                r.ns_op_min,
+                r.ns_op_max
+            );
+            if (r.has_perf) {
+                fprintf(
+                    stderr,
+                    "    instructions: %0.1f/op, cache-misses: %0.3f/op, branch-misses: %0.3f/op\n",
+                    r.instructions_op,
+                    r.cache_misses_op,
+                    r.branch_misses_op
+                );
+            }
+        }
+        if (json && cex_bench_json_case(json, &b, &r, n_run == 0)) { n_failed++; }
+        n_run++;
+    }
 
-    return _cex_allocator_heap__hdr_set(size, 0, alignment);
+    if (ctx->teardown_suite_fn) {
+        e$except (err, ctx->teardown_suite_fn()) {
+            fprintf(
+                stderr,
+                "[%s] bench$teardown_suite() failed with %s (suite %s stopped)\n",
+                ctx->has_ansi ? io$ansi("FAIL", "31") : "FAIL",
+                err,
+                ctx->suite_file
+            );
+            n_failed++;
+        }
+    }
+    cex_bench_perf_close(ctx);
+    if (json) {
+        if (io.fprintf(json, "\n]}\n")) { n_failed++; }
+        io.fclose(&json);
+    }
+
+    if (!ctx->quiet_mode) {
+        fprintf(stderr, "\n-------------------------------------\n");
+        fprintf(stderr, "Total: %d Failed: %d\n", n_run + n_failed, n_failed);
+        fprintf(stderr, "-------------------------------------\n");
+    }
+    return n_run == 0 || n_failed > 0;
 }
+#endif // ifdef CEX_BENCH
 
-static void*
-_cex_allocator_heap__alloc(IAllocator self, u8 fill_val, usize size, usize alignment)
-{
-    _cex_allocator_heap__validate(self);
-    AllocatorHeap_c* a = (AllocatorHeap_c*)self;
-    (void)a;
 
-    u64 hdr = _cex_allocator_heap__hdr_make(size, alignment);
-    if (hdr == 0) { return NULL; }
 
-    usize full_size = _cex_allocator_heap__hdr_get_size(hdr);
-    alignment = _cex_allocator_heap__hdr_get_alignment(hdr);
+/*
+*                          src/cex_footer.h
+*/
 
-    // Memory alignment
-    // |                 <hdr>|<poisn>|---<data>---
-    // ^---malloc()
-    u8* raw_result = NULL;
-    if (fill_val != 0) {
-        raw_result = malloc(full_size);
-    } else {
-        raw_result = calloc(1, full_size);
-    }
-    u8* result = raw_result;
 
-    if (raw_result) {
-        result = mem$aligned_pointer(raw_result + sizeof(u64) * 2, alignment);
-        uassert(mem$aligned_pointer(result, 8) == result);
-        uassert(mem$aligned_pointer(result, alignment) == result);
+/*
+*                   CEX IMPLEMENTATION 
+*/
 
-#ifdef CEX_TEST
-        a->stats.n_allocs++;
-        // intentionally set malloc to 0xf7 pattern to mark uninitialized data
-        if (fill_val != 0) { memset(result, 0xf7, size); }
-#endif
-        usize ptr_offset = result - raw_result;
-        uassert(ptr_offset >= sizeof(u64) * 2);
-        uassert(ptr_offset <= 64 + 16);
-        uassert(ptr_offset <= alignment + sizeof(u64) * 2);
-        // poison area after header and before allocated pointer
-        mem$asan_poison(result - sizeof(u64), sizeof(u64));
-        ((u64*)result)[-2] = _cex_allocator_heap__hdr_set(size, ptr_offset, alignment);
 
-        if (ptr_offset + size < full_size) {
-            // Adding padding poison for non 8-byte aligned data
-            mem$asan_poison(result + size, full_size - size - ptr_offset);
-        }
-    }
 
-    return result;
-}
+#if defined(CEX_IMPLEMENTATION) || defined(CEX_NEW)
 
-static void*
-_cex_allocator_heap__malloc(IAllocator self, usize size, usize alignment)
-{
-    return _cex_allocator_heap__alloc(self, 1, size, alignment);
-}
-static void*
-_cex_allocator_heap__calloc(IAllocator self, usize nmemb, usize size, usize alignment)
-{
-    if (unlikely(nmemb == 0 || nmemb >= PTRDIFF_MAX)) {
-        uassert(nmemb > 0 && "nmemb is zero");
-        uassert(nmemb < PTRDIFF_MAX && "nmemb is too high or negative overflow");
-        return NULL;
-    }
-    if (unlikely(size == 0 || size >= PTRDIFF_MAX)) {
-        uassert(size > 0 && "size is zero");
-        uassert(size < PTRDIFF_MAX && "size is too high or negative overflow");
-        return NULL;
-    }
+#include <ctype.h>
+#include <math.h>
 
-    return _cex_allocator_heap__alloc(self, 0, size * nmemb, alignment);
-}
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    include "windows.h"
+#    include <direct.h>
+#else
+#    include <dirent.h>
+#    include <fcntl.h>
+#    include <limits.h>
+#    include <sys/stat.h>
+#    include <sys/types.h>
+#    include <unistd.h>
+#endif
 
-static void*
-_cex_allocator_heap__realloc(IAllocator self, void* ptr, usize size, usize alignment)
-{
-    _cex_allocator_heap__validate(self);
-    if (unlikely(ptr == NULL)) {
-        uassert(ptr != NULL);
-        return NULL;
-    }
-    AllocatorHeap_c* a = (AllocatorHeap_c*)self;
-    (void)a;
 
-    // Memory alignment
-    // |                 <hdr>|<poisn>|---<data>---
-    // ^---realloc()
-    char* p = ptr;
-    uassert(
-        mem$asan_poison_check(p - sizeof(u64), sizeof(u64)) &&
-        "corrupted pointer or unallocated by mem$"
-    );
-    u64 old_hdr = *(u64*)(p - sizeof(u64) * 2);
-    uassert(old_hdr > 0 && "bad poitner or corrupted malloced header?");
-    u64 old_size = _cex_allocator_heap__hdr_get_size(old_hdr);
-    (void)old_size;
-    u8 old_offset = _cex_allocator_heap__hdr_get_offset(old_hdr);
-    u8 old_alignment = _cex_allocator_heap__hdr_get_alignment(old_hdr);
-    uassert((old_alignment >= 8 && old_alignment <= 64) && "corrupted header?");
-    uassert(old_offset <= 64 + sizeof(u64) * 2 && "corrupted header?");
-    if (unlikely(
-            (alignment <= 8 && old_alignment != 8) || (alignment > 8 && alignment != old_alignment)
-        )) {
-        uassert(alignment == old_alignment && "given alignment doesn't match to old one");
-        goto fail;
-    }
+#define _cex_main_boilerplate \
+"#if __has_include(\"cex_config.h\")\n"\
+"// Custom config file\n"\
+"#    include \"cex_config.h\"\n"\
+"#else\n"\
+"// Overriding config values\n"\
+"#    define cexy$cc_include \"-I.\", \"-I./lib\"\n"\
+"#    define CEX_LOG_LVL 4 /* 0 (mute all) - 5 (log$trace) */\n"\
+"#endif\n"\
+"\n"\
+"#define CEX_IMPLEMENTATION\n"\
+"#define CEX_BUILD\n"\
+"#include \"cex.h\"\n"\
+"\n"\
+"Exception cmd_build_lib(int argc, char** argv, void* user_ctx);\n"\
+"\n"\
+"int\n"\
+"main(int argc, char** argv)\n"\
+"{\n"\
+"\n"\
+"    cexy$initialize(); // cex self rebuild and init\n"\
+"    argparse_c args = {\n"\
+"        .description = cexy$description,\n"\
+"        .epilog = cexy$epilog,\n"\
+"        .usage = cexy$usage,\n"\
+"        argparse$cmd_list(\n"\
+"            cexy$cmd_all,\n"\
+"            cexy$cmd_fuzz, /* feel free to make your own if needed */\n"\
+"            cexy$cmd_test, /* feel free to make your own if needed */\n"\
+"            cexy$cmd_app,  /* feel free to make your own if needed */\n"\
+"            { .name = \"build-lib\", .func = cmd_build_lib, .help = \"Custom build command\" },\n"\
+"        ),\n"\
+"    };\n"\
+"    if (argparse.parse(&args, argc, argv)) { return 1; }\n"\
+"    void* my_user_ctx = NULL; // passed as `user_ctx` to command\n"\
+"    if (argparse.run_command(&args, my_user_ctx)) { return 1; }\n"\
+"    return 0;\n"\
+"}\n"\
+"\n"\
+"/// Custom build command for building static lib\n"\
+"Exception\n"\
+"cmd_build_lib(int argc, char** argv, void* user_ctx)\n"\
+"{\n"\
+"    (void)argc;\n"\
+"    (void)argv;\n"\
+"    (void)user_ctx;\n"\
+"    log$info(\"Launching custom command\\n\");\n"\
+"    return EOK;\n"\
+"}\n"\
+""
 
-    u64 new_hdr = _cex_allocator_heap__hdr_make(size, alignment);
-    if (unlikely(new_hdr == 0)) { goto fail; }
+/*
+*                          src/cex_base.c
+*/
 
-    u8* raw_result = NULL;
-    u8* result = NULL;
-    usize new_full_size = _cex_allocator_heap__hdr_get_size(new_hdr);
 
-    if (alignment <= _Alignof(max_align_t)) {
-        uassert(new_full_size > size);
-        raw_result = realloc(p - old_offset, new_full_size);
-        if (unlikely(raw_result == NULL)) { goto fail; }
-        result = mem$aligned_pointer(raw_result + sizeof(u64) * 2, old_alignment);
-    } else {
-        // fallback to malloc + memcpy because realloc doesn't guarantee alignment
-        raw_result = malloc(new_full_size);
-        if (unlikely(raw_result == NULL)) { goto fail; }
-        result = mem$aligned_pointer(raw_result + sizeof(u64) * 2, old_alignment);
-        memcpy(result, ptr, size > old_size ? old_size : size);
-        free(ptr - old_offset);
-    }
-    uassert(mem$aligned_pointer(result, 8) == result);
-    uassert(mem$aligned_pointer(result, old_alignment) == result);
+const struct _CEX_Error_struct Error = {
+    .ok = EOK,                       // Success
+    .memory = "MemoryError",         // memory allocation error
+    .io = "IOError",                 // IO error
+    .overflow = "OverflowError",     // buffer overflow
+    .argument = "ArgumentError",     // function argument error
+    .integrity = "IntegrityError",   // data integrity error
+    .exists = "ExistsError",         // entity or key already exists
+    .not_found = "NotFoundError",    // entity or key already exists
+    .skip = "ShouldBeSkipped",       // NOT an error, function result must be skipped
+    .empty = "EmptyError",           // resource is empty
+    .eof = "EOF",                    // end of file reached
+    .argsparse = "ProgramArgsError", // program arguments empty or incorrect
+    .runtime = "RuntimeError",       // generic runtime error
+    .assert = "AssertError",         // generic runtime check
+    .os = "OSError",                 // generic OS check
+    .timeout = "TimeoutError",       // await interval timeout
+    .permission = "PermissionError", // Permission denied
+    .try_again = "TryAgainError",    // EAGAIN / EWOULDBLOCK errno analog for async operations
+};
 
-    usize ptr_offset = result - raw_result;
-    uassert(ptr_offset <= 64 + 16);
-    uassert(ptr_offset <= old_alignment + sizeof(u64) * 2);
-    // uassert(ptr_offset + size <= new_full_size);
+void
+__cex__panic(void)
+{
+    fflush(stdout);
+    fflush(stderr);
+    sanitizer_stack_trace();
 
 #ifdef CEX_TEST
-    a->stats.n_reallocs++;
-    if (old_size < size) {
-        // intentionally set unallocated to 0xf7 pattern to mark uninitialized data
-        memset(result + old_size, 0xf7, size - old_size);
-    }
+    breakpoint();
+#else
+    abort();
 #endif
-    mem$asan_poison(result - sizeof(u64), sizeof(u64));
-    ((u64*)result)[-2] = _cex_allocator_heap__hdr_set(size, ptr_offset, old_alignment);
-
-    if (ptr_offset + size < new_full_size) {
-        // Adding padding poison for non 8-byte aligned data
-        mem$asan_poison(result + size, new_full_size - size - ptr_offset);
-    }
-
-    return result;
-
-fail:
-    _cex_allocator_heap__free(self, ptr);
-    return NULL;
+    return;
 }
 
-static void*
-_cex_allocator_heap__free(IAllocator self, void* ptr)
-{
-    _cex_allocator_heap__validate(self);
-    if (ptr != NULL) {
-        AllocatorHeap_c* a = (AllocatorHeap_c*)self;
-        (void)a;
-
-        char* p = ptr;
-        uassert(
-            mem$asan_poison_check(p - sizeof(u64), sizeof(u64)) &&
-            "corrupted pointer or unallocated by mem$"
-        );
-        u64 hdr = *(u64*)(p - sizeof(u64) * 2);
-        uassert(hdr > 0 && "bad poitner or corrupted malloced header?");
-        u8 offset = _cex_allocator_heap__hdr_get_offset(hdr);
-        u8 alignment = _cex_allocator_heap__hdr_get_alignment(hdr);
-        uassert(alignment >= 8 && "corrupted header?");
-        uassert(alignment <= 64 && "corrupted header?");
-        uassert(offset >= 16 && "corrupted header?");
-        uassert(offset <= 64 && "corrupted header?");
 
-#ifdef CEX_TEST
-        a->stats.n_free++;
-        u64 size = _cex_allocator_heap__hdr_get_size(hdr);
-        u32 padding = mem$aligned_round(size + offset, alignment) - size - offset;
-        if (padding > 0) {
-            uassert(
-                mem$asan_poison_check(p + size, padding) &&
-                "corrupted area after unallocated size by mem$"
-            );
-        }
-#endif
 
-        free(p - offset);
-    }
-    return NULL;
-}
+/*
+*                          src/mem.c
+*/
 
-static const struct Allocator_i*
-_cex_allocator_heap__scope_enter(IAllocator self)
+void
+_cex_allocator_memscope_cleanup(IAllocator* allc)
 {
-    _cex_allocator_heap__validate(self);
-    uassert(false && "this only supported by arenas");
-    abort();
+    uassert(allc != NULL);
+    (*allc)->scope_exit(*allc);
 }
 
-static void
-_cex_allocator_heap__scope_exit(IAllocator self)
+void
+_cex_allocator_arena_cleanup(IAllocator* allc)
 {
-    _cex_allocator_heap__validate(self);
-    uassert(false && "this only supported by arenas");
-    abort();
+    uassert(allc != NULL);
+    AllocatorArena.destroy(*allc);
 }
 
-static u32
-_cex_allocator_heap__scope_depth(IAllocator self)
+// NOTE: destructor(101) - 101 lowest priority for destructors
+__attribute__((destructor(101))) void
+_cex_global_allocators_destructor()
 {
-    _cex_allocator_heap__validate(self);
-    return 1; // always 1
+    AllocatorArena_c* allc = (AllocatorArena_c*)tmem$;
+    allocator_arena_page_s* page = allc->last_page;
+    while (page) {
+        auto tpage = page->prev_page;
+        mem$free(mem$, page);
+        page = tpage;
+    }
 }
 
 
 
 /*
-*                          src/AllocatorArena.c
+*                          src/AllocatorHeap.c
 */
 
-#define CEX_ARENA_MAX_ALLOC UINT32_MAX - 1000
-#define CEX_ARENA_MAX_ALIGN 64
+// clang-format off
+static void* _cex_allocator_heap__malloc(IAllocator self,usize size, usize alignment);
+static void* _cex_allocator_heap__calloc(IAllocator self,usize nmemb, usize size, usize alignment);
+static void* _cex_allocator_heap__realloc(IAllocator self,void* ptr, usize size, usize alignment);
+static void* _cex_allocator_heap__free(IAllocator self,void* ptr);
+static const struct Allocator_i*  _cex_allocator_heap__scope_enter(IAllocator self);
+static void _cex_allocator_heap__scope_exit(IAllocator self);
+static u32 _cex_allocator_heap__scope_depth(IAllocator self);
+
+AllocatorHeap_c _cex__default_global__allocator_heap = {
+    .alloc = {
+        .malloc = _cex_allocator_heap__malloc,
+        .realloc = _cex_allocator_heap__realloc,
+        .calloc = _cex_allocator_heap__calloc,
+        .free = _cex_allocator_heap__free,
+        .scope_enter = _cex_allocator_heap__scope_enter,
+        .scope_exit = _cex_allocator_heap__scope_exit,
+        .scope_depth = _cex_allocator_heap__scope_depth,
+        .meta = {
+            .magic_id =CEX_ALLOCATOR_HEAP_MAGIC,
+            .is_arena = false,
+            .is_temp = false, 
+        }
+    },
+};
+IAllocator const _cex__default_global__allocator_heap__allc = &_cex__default_global__allocator_heap.alloc;
+// clang-format on
 
 
 static void
-_cex_allocator_arena__validate(IAllocator self)
+_cex_allocator_heap__validate(IAllocator self)
 {
     (void)self;
 #ifndef NDEBUG
     uassert(self != NULL);
     uassert(
-        (self->meta.magic_id == CEX_ALLOCATOR_ARENA_MAGIC ||
-         self->meta.magic_id == CEX_ALLOCATOR_TEMP_MAGIC) &&
-        "bad allocator pointer or mem corruption"
+        self->meta.magic_id == CEX_ALLOCATOR_HEAP_MAGIC && "bad allocator pointer or mem corruption"
     );
 #endif
 }
 
+static inline u64
+_cex_allocator_heap__hdr_set(u64 size, u8 ptr_offset, u8 alignment)
+{
+    size &= 0xFFFFFFFFFFFFULL; // Mask to 48 bits
+    return size | ((u64)ptr_offset << 48) | ((u64)alignment << 56);
+}
 
 static inline usize
-_cex_alloc_estimate_page_size(usize page_size, usize alloc_size)
+_cex_allocator_heap__hdr_get_size(u64 alloc_hdr)
 {
-    uassert(alloc_size < CEX_ARENA_MAX_ALLOC && "allocation is to big");
-    usize base_page_size = mem$aligned_round(
-        page_size + sizeof(allocator_arena_page_s) + CEX_ARENA_MAX_ALIGN,
-        alignof(allocator_arena_page_s)
-    );
-    uassert(base_page_size % alignof(allocator_arena_page_s) == 0 && "expected to be 64 aligned");
+    return alloc_hdr & 0xFFFFFFFFFFFFULL;
+}
 
-    if (alloc_size > 0.7 * base_page_size) {
-        if (alloc_size > 1024 * 1024) {
-            alloc_size *= 1.1;
-            alloc_size += sizeof(allocator_arena_page_s) + CEX_ARENA_MAX_ALIGN;
-        } else {
-            alloc_size *= 2;
-        }
+static inline u8
+_cex_allocator_heap__hdr_get_offset(u64 alloc_hdr)
+{
+    return (u8)((alloc_hdr >> 48) & 0xFF);
+}
 
-        usize result = mem$aligned_round(
-            alloc_size + sizeof(allocator_arena_page_s) + CEX_ARENA_MAX_ALIGN,
-            alignof(allocator_arena_page_s)
-        );
-        uassert(result % alignof(allocator_arena_page_s) == 0 && "expected to be 64 aligned");
-        return result;
-    } else {
-        return base_page_size;
-    }
+static inline u8
+_cex_allocator_heap__hdr_get_alignment(u64 alloc_hdr)
+{
+    return (u8)(alloc_hdr >> 56);
 }
-static allocator_arena_rec_s
-_cex_alloc_estimate_alloc_size(usize alloc_size, usize alignment)
+
+static u64
+_cex_allocator_heap__hdr_make(usize alloc_size, usize alignment)
 {
-    if (alloc_size == 0 || alloc_size > CEX_ARENA_MAX_ALLOC || alignment > CEX_ARENA_MAX_ALIGN) {
-        uassert(alloc_size > 0);
-        uassert(alloc_size <= CEX_ARENA_MAX_ALLOC && "allocation size is too high");
-        uassert(alignment <= CEX_ARENA_MAX_ALIGN);
-        return (allocator_arena_rec_s){ 0 };
-    }
+
     usize size = alloc_size;
 
+    if (unlikely(alloc_size == 0 || alloc_size > PTRDIFF_MAX || alignment > 64)) {
+        uassert(alloc_size > 0 && "zero size");
+        uassert(alloc_size > PTRDIFF_MAX && "size is too high");
+        uassert(alignment <= 64);
+        return 0;
+    }
+
+#if UINTPTR_MAX > 0xFFFFFFFFU
+    // Only 64 bit
+    if (unlikely((u64)alloc_size > (u64)0xFFFFFFFFFFFFULL)) {
+        uassert(
+            (u64)alloc_size < (u64)0xFFFFFFFFFFFFULL && "size is too high, or negative overflow"
+        );
+        return 0;
+    }
+#endif
+
     if (alignment < 8) {
-        static_assert(sizeof(allocator_arena_rec_s) == 8, "unexpected size");
         static_assert(alignof(void*) <= 8, "unexpected ptr alignment");
         alignment = 8;
-        size = mem$aligned_round(alloc_size, 8);
     } else {
         uassert(mem$is_power_of2(alignment) && "must be pow2");
+
         if ((alloc_size & (alignment - 1)) != 0) {
             uassert(alloc_size % alignment == 0 && "requested size is not aligned");
-            return (allocator_arena_rec_s){ 0 };
+            return 0;
         }
     }
+    size += sizeof(u64);
 
-    size += sizeof(allocator_arena_rec_s);
+    // extra area for poisoning
+    size += sizeof(u64);
 
-    if (size - alloc_size == sizeof(allocator_arena_rec_s)) {
-        size += sizeof(allocator_arena_rec_s); // adding extra bytes for ASAN poison
-    }
-    uassert(size - alloc_size >= sizeof(allocator_arena_rec_s));
-    uassert(size - alloc_size <= 255 - sizeof(allocator_arena_rec_s) && "ptr_offset oveflow");
-    uassert(size < alloc_size + 128 && "weird overflow");
+    size = mem$aligned_round(size, alignment);
 
-    return (allocator_arena_rec_s){
-        .size = alloc_size, // original size of allocation
-        .ptr_offset = 0,    // offset from allocator_arena_rec_s to pointer (will be set later!)
-        .ptr_alignment = alignment, // expected pointer alignment
-        .ptr_padding = size - alloc_size - sizeof(allocator_arena_rec_s), // from last data to next
-    };
+    return _cex_allocator_heap__hdr_set(size, 0, alignment);
 }
 
-static inline allocator_arena_rec_s*
-_cex_alloc_arena__get_rec(void* alloc_pointer)
+static void*
+_cex_allocator_heap__alloc(IAllocator self, u8 fill_val, usize size, usize alignment)
 {
-    uassert(alloc_pointer != NULL);
-    u8 offset = *((u8*)alloc_pointer - 1);
-    uassert(offset <= CEX_ARENA_MAX_ALIGN);
-    return (allocator_arena_rec_s*)((char*)alloc_pointer - offset);
-}
+    _cex_allocator_heap__validate(self);
+    __cex__alloc_hook(self, size);
+    AllocatorHeap_c* a = (AllocatorHeap_c*)self;
+    (void)a;
 
-static bool
-_cex_allocator_arena__check_pointer_valid(AllocatorArena_c* self, void* old_ptr)
-{
-    uassert(self->scope_depth > 0);
-    allocator_arena_page_s* page = self->last_page;
-    allocator_arena_rec_s* rec = _cex_alloc_arena__get_rec(old_ptr);
-    while (page) {
-        auto tpage = page->prev_page;
-        if ((char*)rec > (char*)page &&
-            (char*)rec < (((char*)page) + sizeof(allocator_arena_page_s) + page->capacity)) {
-            uassert((char*)rec >= (char*)page + sizeof(allocator_arena_page_s));
+    u64 hdr = _cex_allocator_heap__hdr_make(size, alignment);
+    if (hdr == 0) { return NULL; }
 
-            u32 ptr_scope_mark =
-                (((char*)rec) - ((char*)page) - sizeof(allocator_arena_page_s) + page->used_start);
+    usize full_size = _cex_allocator_heap__hdr_get_size(hdr);
+    alignment = _cex_allocator_heap__hdr_get_alignment(hdr);
 
-            if (self->scope_depth < arr$len(self->scope_stack)) {
-                if (ptr_scope_mark < self->scope_stack[self->scope_depth - 1]) {
-                    uassert(
-                        ptr_scope_mark >= self->scope_stack[self->scope_depth - 1] &&
-                        "trying to operate on pointer from different mem$scope() it will lead to use-after-free / ASAN poison issues"
-                    );
-                    return false; // using pointer out of scope of previous page
-                }
-            }
-            return true;
-        }
-        page = tpage;
+    // Memory alignment
+    // |                 <hdr>|<poisn>|---<data>---
+    // ^---malloc()
+    u8* raw_result = NULL;
+    if (fill_val != 0) {
+        raw_result = malloc(full_size);
+    } else {
+        raw_result = calloc(1, full_size);
     }
-    return false;
-}
+    u8* result = raw_result;
 
-static allocator_arena_page_s*
-_cex_allocator_arena__request_page_size(
-    AllocatorArena_c* self,
-    allocator_arena_rec_s new_rec,
-    bool* out_is_allocated
-)
-{
-    usize req_size = new_rec.size + new_rec.ptr_alignment + new_rec.ptr_padding;
-    if (out_is_allocated) { *out_is_allocated = false; }
+    if (raw_result) {
+        result = mem$aligned_pointer(raw_result + sizeof(u64) * 2, alignment);
+        uassert(mem$aligned_pointer(result, 8) == result);
+        uassert(mem$aligned_pointer(result, alignment) == result);
 
-    if (self->last_page == NULL ||
-        // self->last_page->capacity < req_size + mem$aligned_round(self->last_page->cursor, 8)) {
-        self->last_page->capacity < req_size + self->last_page->cursor) {
-        usize page_size = _cex_alloc_estimate_page_size(self->page_size, req_size);
+#if defined(CEX_TEST) || defined(CEX_BENCH)
+        __atomic_fetch_add(&a->stats.n_allocs, 1, __ATOMIC_RELAXED);
+#endif
+#ifdef CEX_TEST
+        // intentionally set malloc to 0xf7 pattern to mark uninitialized data
+        if (fill_val != 0) { memset(result, 0xf7, size); }
+#endif
+        usize ptr_offset = result - raw_result;
+        uassert(ptr_offset >= sizeof(u64) * 2);
+        uassert(ptr_offset <= 64 + 16);
+        uassert(ptr_offset <= alignment + sizeof(u64) * 2);
+        // poison area after header and before allocated pointer
+        mem$asan_poison(result - sizeof(u64), sizeof(u64));
+        ((u64*)result)[-2] = _cex_allocator_heap__hdr_set(size, ptr_offset, alignment);
 
-        if (page_size == 0 || page_size > CEX_ARENA_MAX_ALLOC) {
-            uassert(page_size > 0 && "page_size is zero");
-            uassert(page_size <= CEX_ARENA_MAX_ALLOC && "page_size is to big");
-            return NULL;
-        }
-        allocator_arena_page_s*
-            page = mem$->calloc(mem$, 1, page_size, alignof(allocator_arena_page_s));
-        if (page == NULL) {
-            return NULL; // memory error
+        if (ptr_offset + size < full_size) {
+            // Adding padding poison for non 8-byte aligned data
+            mem$asan_poison(result + size, full_size - size - ptr_offset);
         }
-
-        uassert(mem$aligned_pointer(page, 64) == page);
-
-        page->prev_page = self->last_page;
-        page->used_start = self->used;
-        page->capacity = page_size - sizeof(allocator_arena_page_s);
-        mem$asan_poison(page->__poison_area, sizeof(page->__poison_area));
-        mem$asan_poison(&page->data, page->capacity);
-
-        self->last_page = page;
-        self->stats.pages_created++;
-
-        if (out_is_allocated) { *out_is_allocated = true; }
     }
 
-    return self->last_page;
+    return result;
 }
 
 static void*
-_cex_allocator_arena__malloc(IAllocator allc, usize size, usize alignment)
+_cex_allocator_heap__malloc(IAllocator self, usize size, usize alignment)
 {
-    _cex_allocator_arena__validate(allc);
-    AllocatorArena_c* self = (AllocatorArena_c*)allc;
-    uassert(self->scope_depth > 0 && "arena allocation must be performed in mem$scope() block!");
-
-    allocator_arena_rec_s rec = _cex_alloc_estimate_alloc_size(size, alignment);
-    if (rec.size == 0) { return NULL; }
-
-    allocator_arena_page_s* page = _cex_allocator_arena__request_page_size(self, rec, NULL);
-    if (page == NULL) { return NULL; }
-    uassert(page->capacity - page->cursor >= rec.size + rec.ptr_padding + rec.ptr_alignment);
-    uassert(page->cursor % 8 == 0);
-    uassert(rec.ptr_padding <= 8);
-    uassertf((usize)page->data % 8 == 0, "page.data offset: %zi\n", (page->data - (char*)page));
-
-    allocator_arena_rec_s* page_rec = (allocator_arena_rec_s*)&page->data[page->cursor];
-    uassert((((usize)(page_rec) & ((8) - 1)) == 0) && "unaligned pointer");
-    static_assert(sizeof(allocator_arena_rec_s) == 8, "unexpected size");
-    static_assert(alignof(allocator_arena_rec_s) <= 8, "unexpected alignment");
-
-    mem$asan_unpoison(page_rec, sizeof(allocator_arena_rec_s));
-    *page_rec = rec;
-
-    void* result = mem$aligned_pointer(
-        (char*)page_rec + sizeof(allocator_arena_rec_s),
-        rec.ptr_alignment
-    );
-
-    uassert((char*)result >= ((char*)page_rec) + sizeof(allocator_arena_rec_s));
-    rec.ptr_offset = (char*)result - (char*)page_rec;
-    uassert(rec.ptr_offset <= rec.ptr_alignment);
-
-    page_rec->ptr_offset = rec.ptr_offset;
-    uassert(rec.ptr_alignment <= CEX_ARENA_MAX_ALIGN);
-
-    mem$asan_unpoison(((char*)result) - 1, rec.size + 1);
-    *(((char*)result) - 1) = rec.ptr_offset;
-
-    usize bytes_alloc = rec.ptr_offset + rec.size + rec.ptr_padding;
-    self->used += bytes_alloc;
-    self->stats.bytes_alloc += bytes_alloc;
-    page->cursor += bytes_alloc;
-    page->last_alloc = result;
-    uassert(page->cursor % 8 == 0);
-    uassert(self->used % 8 == 0);
-    uassert(((usize)(result) & ((rec.ptr_alignment) - 1)) == 0);
-
-
-#ifdef CEX_TEST
-    // intentionally set malloc to 0xf7 pattern to mark uninitialized data
-    memset(result, 0xf7, rec.size);
-#endif
-
-    return result;
+    return _cex_allocator_heap__alloc(self, 1, size, alignment);
 }
 static void*
-_cex_allocator_arena__calloc(IAllocator allc, usize nmemb, usize size, usize alignment)
+_cex_allocator_heap__calloc(IAllocator self, usize nmemb, usize size, usize alignment)
 {
-    _cex_allocator_arena__validate(allc);
-    if (nmemb > CEX_ARENA_MAX_ALLOC) {
-        uassert(nmemb < CEX_ARENA_MAX_ALLOC);
+    if (unlikely(nmemb == 0 || nmemb >= PTRDIFF_MAX)) {
+        uassert(nmemb > 0 && "nmemb is zero");
+        uassert(nmemb < PTRDIFF_MAX && "nmemb is too high or negative overflow");
         return NULL;
     }
-    if (size > CEX_ARENA_MAX_ALLOC) {
-        uassert(size < CEX_ARENA_MAX_ALLOC);
+    if (unlikely(size == 0 || size >= PTRDIFF_MAX)) {
+        uassert(size > 0 && "size is zero");
+        uassert(size < PTRDIFF_MAX && "size is too high or negative overflow");
         return NULL;
     }
-    usize alloc_size = nmemb * size;
-    void* result = _cex_allocator_arena__malloc(allc, alloc_size, alignment);
-    if (result != NULL) { memset(result, 0, alloc_size); }
 
-    return result;
+    return _cex_allocator_heap__alloc(self, 0, size * nmemb, alignment);
 }
 
 static void*
-_cex_allocator_arena__free(IAllocator allc, void* ptr)
+_cex_allocator_heap__realloc(IAllocator self, void* ptr, usize size, usize alignment)
 {
-    (void)ptr;
-    // NOTE: this intentionally does nothing, all memory releasing in scope_exit()
-    _cex_allocator_arena__validate(allc);
-
-    if (ptr == NULL) { return NULL; }
+    _cex_allocator_heap__validate(self);
+    if (unlikely(ptr == NULL)) {
+        uassert(ptr != NULL);
+        return NULL;
+    }
+    __cex__alloc_hook(self, size);
+    AllocatorHeap_c* a = (AllocatorHeap_c*)self;
+    (void)a;
 
-    AllocatorArena_c* self = (AllocatorArena_c*)allc;
-    (void)self;
+    // Memory alignment
+    // |                 <hdr>|<poisn>|---<data>---
+    // ^---realloc()
+    char* p = ptr;
     uassert(
-        _cex_allocator_arena__check_pointer_valid(self, ptr) && "pointer doesn't belong to arena"
+        mem$asan_poison_check(p - sizeof(u64), sizeof(u64)) &&
+        "corrupted pointer or unallocated by mem$"
     );
-    allocator_arena_rec_s* rec = _cex_alloc_arena__get_rec(ptr);
-    rec->is_free = true;
-    mem$asan_poison(ptr, rec->size);
-
-    return NULL;
-}
+    u64 old_hdr = *(u64*)(p - sizeof(u64) * 2);
+    uassert(old_hdr > 0 && "bad poitner or corrupted malloced header?");
+    u64 old_size = _cex_allocator_heap__hdr_get_size(old_hdr);
+    (void)old_size;
+    u8 old_offset = _cex_allocator_heap__hdr_get_offset(old_hdr);
+    u8 old_alignment = _cex_allocator_heap__hdr_get_alignment(old_hdr);
+    uassert((old_alignment >= 8 && old_alignment <= 64) && "corrupted header?");
+    uassert(old_offset <= 64 + sizeof(u64) * 2 && "corrupted header?");
+    if (unlikely(
+            (alignment <= 8 && old_alignment != 8) || (alignment > 8 && alignment != old_alignment)
+        )) {
+        uassert(alignment == old_alignment && "given alignment doesn't match to old one");
+        goto fail;
+    }
 
-static void*
-_cex_allocator_arena__realloc(IAllocator allc, void* old_ptr, usize size, usize alignment)
-{
-    _cex_allocator_arena__validate(allc);
-    uassert(old_ptr != NULL);
-    uassert(size > 0);
-    uassert(size < CEX_ARENA_MAX_ALLOC);
+    u64 new_hdr = _cex_allocator_heap__hdr_make(size, alignment);
+    if (unlikely(new_hdr == 0)) { goto fail; }
 
-    AllocatorArena_c* self = (AllocatorArena_c*)allc;
-    uassert(self->scope_depth > 0 && "arena allocation must be performed in mem$scope() block!");
+    u8* raw_result = NULL;
+    u8* result = NULL;
+    usize new_full_size = _cex_allocator_heap__hdr_get_size(new_hdr);
 
-    allocator_arena_rec_s* rec = _cex_alloc_arena__get_rec(old_ptr);
-    uassert(!rec->is_free && "trying to realloc() already freed pointer");
-    if (alignment < 8) {
-        uassert(rec->ptr_alignment == 8);
+    if (alignment <= _Alignof(max_align_t)) {
+        uassert(new_full_size > size);
+        raw_result = realloc(p - old_offset, new_full_size);
+        if (unlikely(raw_result == NULL)) { goto fail; }
+        result = mem$aligned_pointer(raw_result + sizeof(u64) * 2, old_alignment);
     } else {
-        uassert(alignment == rec->ptr_alignment && "realloc alignment mismatch with old_ptr");
-        uassert(((usize)(old_ptr) & ((alignment)-1)) == 0 && "weird old_ptr not aligned");
-        uassert(((usize)(size) & ((alignment)-1)) == 0 && "size is not aligned as expected");
+        // fallback to malloc + memcpy because realloc doesn't guarantee alignment
+        raw_result = malloc(new_full_size);
+        if (unlikely(raw_result == NULL)) { goto fail; }
+        result = mem$aligned_pointer(raw_result + sizeof(u64) * 2, old_alignment);
+        memcpy(result, ptr, size > old_size ? old_size : size);
+        free(ptr - old_offset);
     }
+    uassert(mem$aligned_pointer(result, 8) == result);
+    uassert(mem$aligned_pointer(result, old_alignment) == result);
 
-    uassert(
-        _cex_allocator_arena__check_pointer_valid(self, old_ptr) &&
-        "pointer doesn't belong to arena"
-    );
+    usize ptr_offset = result - raw_result;
+    uassert(ptr_offset <= 64 + 16);
+    uassert(ptr_offset <= old_alignment + sizeof(u64) * 2);
+    // uassert(ptr_offset + size <= new_full_size);
 
-    if (unlikely(size <= rec->size)) {
-        if (size == rec->size) { return old_ptr; }
-        // we can't change size/padding of this allocation, because this will break iterating
-        // ptr_padding is only u8 size, we cant store size, change, so we currently poison new size
-        mem$asan_poison((char*)old_ptr + size, rec->size - size);
-        return old_ptr;
+#if defined(CEX_TEST) || defined(CEX_BENCH)
+    __atomic_fetch_add(&a->stats.n_reallocs, 1, __ATOMIC_RELAXED);
+#endif
+#ifdef CEX_TEST
+    if (old_size < size) {
+        // intentionally set unallocated to 0xf7 pattern to mark uninitialized data
+        memset(result + old_size, 0xf7, size - old_size);
     }
+#endif
+    mem$asan_poison(result - sizeof(u64), sizeof(u64));
+    ((u64*)result)[-2] = _cex_allocator_heap__hdr_set(size, ptr_offset, old_alignment);
 
-    if (unlikely(self->last_page && self->last_page->last_alloc == old_ptr)) {
-        allocator_arena_rec_s nrec = _cex_alloc_estimate_alloc_size(size, alignment);
-        if (nrec.size == 0) { goto fail; }
-        bool is_created = false;
-        allocator_arena_page_s* page = _cex_allocator_arena__request_page_size(
-            self,
-            nrec,
-            &is_created
+    if (ptr_offset + size < new_full_size) {
+        // Adding padding poison for non 8-byte aligned data
+        mem$asan_poison(result + size, new_full_size - size - ptr_offset);
+    }
+
+    return result;
+
+fail:
+    _cex_allocator_heap__free(self, ptr);
+    return NULL;
+}
+
+static void*
+_cex_allocator_heap__free(IAllocator self, void* ptr)
+{
+    _cex_allocator_heap__validate(self);
+    if (ptr != NULL) {
+        AllocatorHeap_c* a = (AllocatorHeap_c*)self;
+        (void)a;
+
+        char* p = ptr;
+        uassert(
+            mem$asan_poison_check(p - sizeof(u64), sizeof(u64)) &&
+            "corrupted pointer or unallocated by mem$"
         );
-        if (page == NULL) { goto fail; }
-        if (!is_created) {
-            // If new page was created, fall back to malloc/copy/free method
-            //   but currently we have spare capacity for growth
-            u32 extra_bytes = size - rec->size;
-            mem$asan_unpoison((char*)old_ptr + rec->size, extra_bytes);
-#ifdef CEX_TEST
-            memset((char*)old_ptr + rec->size, 0xf7, extra_bytes);
-#endif
-            extra_bytes += (nrec.ptr_padding - rec->ptr_padding);
-            page->cursor += extra_bytes;
-            self->used += extra_bytes;
-            self->stats.bytes_alloc += extra_bytes;
-            rec->size = size;
-            rec->ptr_padding = nrec.ptr_padding;
+        u64 hdr = *(u64*)(p - sizeof(u64) * 2);
+        uassert(hdr > 0 && "bad poitner or corrupted malloced header?");
+        u8 offset = _cex_allocator_heap__hdr_get_offset(hdr);
+        u8 alignment = _cex_allocator_heap__hdr_get_alignment(hdr);
+        uassert(alignment >= 8 && "corrupted header?");
+        uassert(alignment <= 64 && "corrupted header?");
+        uassert(offset >= 16 && "corrupted header?");
+        uassert(offset <= 64 && "corrupted header?");
 
+#if defined(CEX_TEST) || defined(CEX_BENCH)
+        __atomic_fetch_add(&a->stats.n_free, 1, __ATOMIC_RELAXED);
+#endif
+#ifdef CEX_TEST
+        u64 size = _cex_allocator_heap__hdr_get_size(hdr);
+        u32 padding = mem$aligned_round(size + offset, alignment) - size - offset;
+        if (padding > 0) {
             uassert(
-                (char*)rec + rec->size + rec->ptr_padding + rec->ptr_offset ==
-                &page->data[page->cursor]
+                mem$asan_poison_check(p + size, padding) &&
+                "corrupted area after unallocated size by mem$"
             );
-            uassert(page->cursor % 8 == 0);
-            uassert(self->used % 8 == 0);
-            mem$asan_poison((char*)old_ptr + size, rec->ptr_padding);
-            return old_ptr;
         }
-        // NOTE: fall through to default way
-    }
+#endif
 
-    void* new_ptr = _cex_allocator_arena__malloc(allc, size, alignment);
-    if (new_ptr == NULL) { goto fail; }
-    memcpy(new_ptr, old_ptr, rec->size);
-    _cex_allocator_arena__free(allc, old_ptr);
-    return new_ptr;
-fail:
-    _cex_allocator_arena__free(allc, old_ptr);
+        free(p - offset);
+    }
     return NULL;
 }
 
-
 static const struct Allocator_i*
-_cex_allocator_arena__scope_enter(IAllocator allc)
+_cex_allocator_heap__scope_enter(IAllocator self)
 {
-    _cex_allocator_arena__validate(allc);
-    AllocatorArena_c* self = (AllocatorArena_c*)allc;
-    // NOTE: If scope_depth is higher CEX_ALLOCATOR_MAX_SCOPE_STACK, we stop marking
-    //  all memory will be released after exiting scope_depth == CEX_ALLOCATOR_MAX_SCOPE_STACK
-    if (self->scope_depth < arr$len(self->scope_stack)) {
-        self->scope_stack[self->scope_depth] = self->used;
-    }
-    self->scope_depth++;
-    return allc;
+    _cex_allocator_heap__validate(self);
+    uassert(false && "this only supported by arenas");
+    abort();
 }
+
 static void
-_cex_allocator_arena__scope_exit(IAllocator allc)
+_cex_allocator_heap__scope_exit(IAllocator self)
 {
-    _cex_allocator_arena__validate(allc);
-    AllocatorArena_c* self = (AllocatorArena_c*)allc;
-    uassert(self->scope_depth > 0);
+    _cex_allocator_heap__validate(self);
+    uassert(false && "this only supported by arenas");
+    abort();
+}
 
-#ifdef CEX_TEST
-    bool AllocatorArena_sanitize(IAllocator allc);
-    uassert(AllocatorArena_sanitize(allc));
-#endif
-    self->scope_depth--;
-    if (self->scope_depth >= arr$len(self->scope_stack)) {
-        // Scope overflow, wait until we reach CEX_ALLOCATOR_MAX_SCOPE_STACK
-        return;
-    }
+static u32
+_cex_allocator_heap__scope_depth(IAllocator self)
+{
+    _cex_allocator_heap__validate(self);
+    return 1; // always 1
+}
 
-    usize used_mark = self->scope_stack[self->scope_depth];
 
-    allocator_arena_page_s* page = self->last_page;
-    while (page) {
-        auto tpage = page->prev_page;
-        if (page->used_start == 0 || page->used_start < used_mark) {
-            // last page, just set mark and poison
-            usize free_offset = (used_mark - page->used_start);
-            uassert(page->cursor >= free_offset);
 
-            usize free_len = page->cursor - free_offset;
-            page->cursor = free_offset;
-            mem$asan_poison(&page->data[free_offset], free_len);
+/*
+*                          src/AllocatorArena.c
+*/
 
-            uassert(self->used >= free_len);
-            self->used -= free_len;
-            self->stats.bytes_free += free_len;
-            break; // we are done
-        } else {
-            usize free_len = page->cursor;
-            uassert(self->used >= free_len);
+#define CEX_ARENA_MAX_ALLOC UINT32_MAX - 1000
+#define CEX_ARENA_MAX_ALIGN 64
 
-            self->used -= free_len;
-            self->stats.bytes_free += free_len;
-            self->last_page = page->prev_page;
-            self->stats.pages_free++;
-            mem$free(mem$, page);
-        }
-        page = tpage;
-    }
-}
-static u32
-_cex_allocator_arena__scope_depth(IAllocator allc)
-{
-    _cex_allocator_arena__validate(allc);
-    AllocatorArena_c* self = (AllocatorArena_c*)allc;
-    return self->scope_depth;
+
+static void
+_cex_allocator_arena__validate(IAllocator self)
+{
+    (void)self;
+#ifndef NDEBUG
+    uassert(self != NULL);
+    uassert(
+        (self->meta.magic_id == CEX_ALLOCATOR_ARENA_MAGIC ||
+         self->meta.magic_id == CEX_ALLOCATOR_TEMP_MAGIC) &&
+        "bad allocator pointer or mem corruption"
+    );
+#endif
 }
 
-const Allocator_i*
-AllocatorArena_create(usize page_size)
+
+static inline usize
+_cex_alloc_estimate_page_size(usize page_size, usize alloc_size)
 {
-    if (page_size < 1024 || page_size >= UINT32_MAX) {
-        uassert(page_size >= 1024 && "page size is too small");
-        uassert(page_size < UINT32_MAX && "page size is too big");
-        return NULL;
-    }
+    uassert(alloc_size < CEX_ARENA_MAX_ALLOC && "allocation is to big");
+    usize base_page_size = mem$aligned_round(
+        page_size + sizeof(allocator_arena_page_s) + CEX_ARENA_MAX_ALIGN,
+        alignof(allocator_arena_page_s)
+    );
+    uassert(base_page_size % alignof(allocator_arena_page_s) == 0 && "expected to be 64 aligned");
 
-    AllocatorArena_c template = {
-        .alloc = {
-            .malloc = _cex_allocator_arena__malloc,
-            .realloc = _cex_allocator_arena__realloc,
-            .calloc = _cex_allocator_arena__calloc,
-            .free = _cex_allocator_arena__free,
-            .scope_enter = _cex_allocator_arena__scope_enter,
-            .scope_exit = _cex_allocator_arena__scope_exit,
-            .scope_depth = _cex_allocator_arena__scope_depth,
-            .meta = {
-                .magic_id = CEX_ALLOCATOR_ARENA_MAGIC,
-                .is_arena = true, 
-                .is_temp = false, 
-            }
-        },
-        .page_size = page_size,
-    };
+    if (alloc_size > 0.7 * base_page_size) {
+        if (alloc_size > 1024 * 1024) {
+            alloc_size *= 1.1;
+            alloc_size += sizeof(allocator_arena_page_s) + CEX_ARENA_MAX_ALIGN;
+        } else {
+            alloc_size *= 2;
+        }
 
-    AllocatorArena_c* self = mem$new(mem$, AllocatorArena_c);
-    if (self == NULL) {
-        return NULL; // memory error
+        usize result = mem$aligned_round(
+            alloc_size + sizeof(allocator_arena_page_s) + CEX_ARENA_MAX_ALIGN,
+            alignof(allocator_arena_page_s)
+        );
+        uassert(result % alignof(allocator_arena_page_s) == 0 && "expected to be 64 aligned");
+        return result;
+    } else {
+        return base_page_size;
+    }
+}
+static allocator_arena_rec_s
+_cex_alloc_estimate_alloc_size(usize alloc_size, usize alignment)
+{
+    if (alloc_size == 0 || alloc_size > CEX_ARENA_MAX_ALLOC || alignment > CEX_ARENA_MAX_ALIGN) {
+        uassert(alloc_size > 0);
+        uassert(alloc_size <= CEX_ARENA_MAX_ALLOC && "allocation size is too high");
+        uassert(alignment <= CEX_ARENA_MAX_ALIGN);
+        return (allocator_arena_rec_s){ 0 };
     }
+    usize size = alloc_size;
 
-    memcpy(self, &template, sizeof(AllocatorArena_c));
-    uassert(self->alloc.meta.magic_id == CEX_ALLOCATOR_ARENA_MAGIC);
-    uassert(self->alloc.malloc == _cex_allocator_arena__malloc);
+    if (alignment < 8) {
+        static_assert(sizeof(allocator_arena_rec_s) == 8, "unexpected size");
+        static_assert(alignof(void*) <= 8, "unexpected ptr alignment");
+        alignment = 8;
+        size = mem$aligned_round(alloc_size, 8);
+    } else {
+        uassert(mem$is_power_of2(alignment) && "must be pow2");
+        if ((alloc_size & (alignment - 1)) != 0) {
+            uassert(alloc_size % alignment == 0 && "requested size is not aligned");
+            return (allocator_arena_rec_s){ 0 };
+        }
+    }
 
-    _cex_allocator_arena__scope_enter(&self->alloc);
+    size += sizeof(allocator_arena_rec_s);
 
-    return &self->alloc;
+    if (size - alloc_size == sizeof(allocator_arena_rec_s)) {
+        size += sizeof(allocator_arena_rec_s); // adding extra bytes for ASAN poison
+    }
+    uassert(size - alloc_size >= sizeof(allocator_arena_rec_s));
+    uassert(size - alloc_size <= 255 - sizeof(allocator_arena_rec_s) && "ptr_offset oveflow");
+    uassert(size < alloc_size + 128 && "weird overflow");
+
+    return (allocator_arena_rec_s){
+        .size = alloc_size, // original size of allocation
+        .ptr_offset = 0,    // offset from allocator_arena_rec_s to pointer (will be set later!)
+        .ptr_alignment = alignment, // expected pointer alignment
+        .ptr_padding = size - alloc_size - sizeof(allocator_arena_rec_s), // from last data to next
+    };
 }
 
-bool
-AllocatorArena_sanitize(IAllocator allc)
+static inline allocator_arena_rec_s*
+_cex_alloc_arena__get_rec(void* alloc_pointer)
 {
-    (void)allc;
-    _cex_allocator_arena__validate(allc);
-    AllocatorArena_c* self = (AllocatorArena_c*)allc;
-    if (self->scope_depth == 0) {
-        uassert(self->stats.bytes_alloc == self->stats.bytes_free && "memory leaks?");
-    }
+    uassert(alloc_pointer != NULL);
+    u8 offset = *((u8*)alloc_pointer - 1);
+    uassert(offset <= CEX_ARENA_MAX_ALIGN);
+    return (allocator_arena_rec_s*)((char*)alloc_pointer - offset);
+}
+
+static bool
+_cex_allocator_arena__check_pointer_valid(AllocatorArena_c* self, void* old_ptr)
+{
+    uassert(self->scope_depth > 0);
     allocator_arena_page_s* page = self->last_page;
+    allocator_arena_rec_s* rec = _cex_alloc_arena__get_rec(old_ptr);
     while (page) {
-        uassert(page->cursor <= page->capacity);
-        uassert(mem$asan_poison_check(page->__poison_area, sizeof(page->__poison_area)));
-
-        u32 i = 0;
-        while (i < page->cursor) {
-            allocator_arena_rec_s* rec = (allocator_arena_rec_s*)&page->data[i];
-            uassert(rec->size <= page->capacity);
-            uassert(rec->size <= page->cursor);
-            uassert(rec->ptr_offset <= CEX_ARENA_MAX_ALIGN);
-            uassert(rec->ptr_padding <= 16);
-            uassert(rec->ptr_alignment <= CEX_ARENA_MAX_ALIGN);
-            uassert(rec->is_free <= 1);
-            uassert(mem$is_power_of2(rec->ptr_alignment));
+        auto tpage = page->prev_page;
+        if ((char*)rec > (char*)page &&
+            (char*)rec < (((char*)page) + sizeof(allocator_arena_page_s) + page->capacity)) {
+            uassert((char*)rec >= (char*)page + sizeof(allocator_arena_page_s));
 
-            char* alloc_p = ((char*)rec) + rec->ptr_offset;
-            u8 poffset = alloc_p[-1];
-            (void)poffset;
-            uassert(poffset == rec->ptr_offset && "near pointer offset mismatch to rec.ptr_offset");
+            u32 ptr_scope_mark =
+                (((char*)rec) - ((char*)page) - sizeof(allocator_arena_page_s) + page->used_start);
 
-            if (rec->ptr_padding) {
-                uassert(
-                    mem$asan_poison_check(alloc_p + rec->size, rec->ptr_padding) &&
-                    "poison data overwrite past allocated item"
-                );
+            if (self->scope_depth < arr$len(self->scope_stack)) {
+                if (ptr_scope_mark < self->scope_stack[self->scope_depth - 1]) {
+                    uassert(
+                        ptr_scope_mark >= self->scope_stack[self->scope_depth - 1] &&
+                        "trying to operate on pointer from different mem$scope() it will lead to use-after-free / ASAN poison issues"
+                    );
+                    return false; // using pointer out of scope of previous page
+                }
             }
+            return true;
+        }
+        page = tpage;
+    }
+    return false;
+}
 
-            if (rec->is_free) {
-                uassert(
-                    mem$asan_poison_check(alloc_p, rec->size) &&
-                    "poison data corruction in freed item area"
-                );
-            }
-            i += rec->ptr_padding + rec->ptr_offset + rec->size;
+static allocator_arena_page_s*
+_cex_allocator_arena__request_page_size(
+    AllocatorArena_c* self,
+    allocator_arena_rec_s new_rec,
+    bool* out_is_allocated
+)
+{
+    usize req_size = new_rec.size + new_rec.ptr_alignment + new_rec.ptr_padding;
+    if (out_is_allocated) { *out_is_allocated = false; }
+
+    if (self->last_page == NULL ||
+        // self->last_page->capacity < req_size + mem$aligned_round(self->last_page->cursor, 8)) {
+        self->last_page->capacity < req_size + self->last_page->cursor) {
+        usize page_size = _cex_alloc_estimate_page_size(self->page_size, req_size);
+
+        if (page_size == 0 || page_size > CEX_ARENA_MAX_ALLOC) {
+            uassert(page_size > 0 && "page_size is zero");
+            uassert(page_size <= CEX_ARENA_MAX_ALLOC && "page_size is to big");
+            return NULL;
         }
-        if (page->cursor < page->capacity) {
-            // unallocated page must be poisoned
-            uassert(
-                mem$asan_poison_check(&page->data[page->cursor], page->capacity - page->cursor) &&
-                "poison data overwrite in unallocated area"
-            );
+        allocator_arena_page_s*
+            page = mem$->calloc(mem$, 1, page_size, alignof(allocator_arena_page_s));
+        if (page == NULL) {
+            return NULL; // memory error
         }
 
-        page = page->prev_page;
+        uassert(mem$aligned_pointer(page, 64) == page);
+
+        page->prev_page = self->last_page;
+        page->used_start = self->used;
+        page->capacity = page_size - sizeof(allocator_arena_page_s);
+        mem$asan_poison(page->__poison_area, sizeof(page->__poison_area));
+        mem$asan_poison(&page->data, page->capacity);
+
+        self->last_page = page;
+        self->stats.pages_created++;
+
+        if (out_is_allocated) { *out_is_allocated = true; }
     }
 
-    return true;
+    return self->last_page;
 }
 
-void
-AllocatorArena_destroy(IAllocator self)
+static void*
+_cex_allocator_arena__malloc(IAllocator allc, usize size, usize alignment)
 {
-    _cex_allocator_arena__validate(self);
-    AllocatorArena_c* allc = (AllocatorArena_c*)self;
-
-    uassert(allc->scope_depth == 1 && "trying to destroy in mem$scope?");
-    _cex_allocator_arena__scope_exit(self);
+    _cex_allocator_arena__validate(allc);
+    AllocatorArena_c* self = (AllocatorArena_c*)allc;
+    uassert(self->scope_depth > 0 && "arena allocation must be performed in mem$scope() block!");
+    __cex__alloc_hook(allc, size);
 
-#ifdef CEX_TEST
-    uassert(AllocatorArena_sanitize(self));
-#endif
+    allocator_arena_rec_s rec = _cex_alloc_estimate_alloc_size(size, alignment);
+    if (rec.size == 0) { return NULL; }
 
-    allocator_arena_page_s* page = allc->last_page;
-    while (page) {
-        auto tpage = page->prev_page;
-        mem$free(mem$, page);
-        page = tpage;
-    }
-    mem$free(mem$, allc);
-}
+    allocator_arena_page_s* page = _cex_allocator_arena__request_page_size(self, rec, NULL);
+    if (page == NULL) { return NULL; }
+    uassert(page->capacity - page->cursor >= rec.size + rec.ptr_padding + rec.ptr_alignment);
+    uassert(page->cursor % 8 == 0);
+    uassert(rec.ptr_padding <= 8);
+    uassertf((usize)page->data % 8 == 0, "page.data offset: %zi\n", (page->data - (char*)page));
 
-_Thread_local AllocatorArena_c _cex__default_global__allocator_temp = {
-    .alloc = {
-        .malloc = _cex_allocator_arena__malloc,
-        .realloc = _cex_allocator_arena__realloc,
-        .calloc = _cex_allocator_arena__calloc,
-        .free = _cex_allocator_arena__free,
-        .scope_enter = _cex_allocator_arena__scope_enter,
-        .scope_exit = _cex_allocator_arena__scope_exit,
-        .scope_depth = _cex_allocator_arena__scope_depth,
-        .meta = {
-            .magic_id = CEX_ALLOCATOR_TEMP_MAGIC,
-            .is_arena = true,  // coming... soon
-            .is_temp = true, 
-        }, 
-    },
-    .page_size = CEX_ALLOCATOR_TEMP_PAGE_SIZE,
-};
+    allocator_arena_rec_s* page_rec = (allocator_arena_rec_s*)&page->data[page->cursor];
+    uassert((((usize)(page_rec) & ((8) - 1)) == 0) && "unaligned pointer");
+    static_assert(sizeof(allocator_arena_rec_s) == 8, "unexpected size");
+    static_assert(alignof(allocator_arena_rec_s) <= 8, "unexpected alignment");
 
-const struct __cex_namespace__AllocatorArena AllocatorArena = {
-    // Autogenerated by CEX
-    // clang-format off
+    mem$asan_unpoison(page_rec, sizeof(allocator_arena_rec_s));
+    *page_rec = rec;
 
-    .create = AllocatorArena_create,
-    .destroy = AllocatorArena_destroy,
-    .sanitize = AllocatorArena_sanitize,
+    void* result = mem$aligned_pointer(
+        (char*)page_rec + sizeof(allocator_arena_rec_s),
+        rec.ptr_alignment
+    );
 
-    // clang-format on
-};
+    uassert((char*)result >= ((char*)page_rec) + sizeof(allocator_arena_rec_s));
+    rec.ptr_offset = (char*)result - (char*)page_rec;
+    uassert(rec.ptr_offset <= rec.ptr_alignment);
 
+    page_rec->ptr_offset = rec.ptr_offset;
+    uassert(rec.ptr_alignment <= CEX_ARENA_MAX_ALIGN);
 
+    mem$asan_unpoison(((char*)result) - 1, rec.size + 1);
+    *(((char*)result) - 1) = rec.ptr_offset;
 
-/*
-*                          src/ds.c
-*/
+    usize bytes_alloc = rec.ptr_offset + rec.size + rec.ptr_padding;
+    self->used += bytes_alloc;
+    self->stats.bytes_alloc += bytes_alloc;
+    page->cursor += bytes_alloc;
+    page->last_alloc = result;
+    uassert(page->cursor % 8 == 0);
+    uassert(self->used % 8 == 0);
+    uassert(((usize)(result) & ((rec.ptr_alignment) - 1)) == 0);
 
 
-#ifdef _CEXDS_STATISTICS
-#    define _CEXDS_STATS(x) x
-usize _cexds__array_grow;
-usize _cexds__hash_grow;
-usize _cexds__hash_shrink;
-usize _cexds__hash_rebuild;
-usize _cexds__hash_probes;
-usize _cexds__hash_alloc;
-usize _cexds__rehash_probes;
-usize _cexds__rehash_items;
-#else
-#    define _CEXDS_STATS(x)
+#ifdef CEX_TEST
+    // intentionally set malloc to 0xf7 pattern to mark uninitialized data
+    memset(result, 0xf7, rec.size);
 #endif
 
-//
-// _cexds__arr implementation
-//
+    return result;
+}
+static void*
+_cex_allocator_arena__calloc(IAllocator allc, usize nmemb, usize size, usize alignment)
+{
+    _cex_allocator_arena__validate(allc);
+    if (nmemb > CEX_ARENA_MAX_ALLOC) {
+        uassert(nmemb < CEX_ARENA_MAX_ALLOC);
+        return NULL;
+    }
+    if (size > CEX_ARENA_MAX_ALLOC) {
+        uassert(size < CEX_ARENA_MAX_ALLOC);
+        return NULL;
+    }
+    usize alloc_size = nmemb * size;
+    void* result = _cex_allocator_arena__malloc(allc, alloc_size, alignment);
+    if (result != NULL) { memset(result, 0, alloc_size); }
 
-#define _cexds__item_ptr(t, i, elemsize) ((char*)a + elemsize * i)
+    return result;
+}
 
-static inline void*
-_cexds__base(_cexds__array_header* hdr)
+static void*
+_cex_allocator_arena__free(IAllocator allc, void* ptr)
 {
-    if (hdr->el_align <= sizeof(_cexds__array_header)) {
-        return hdr;
-    } else {
-        char* arr_ptr = (char*)hdr + sizeof(_cexds__array_header);
-        return arr_ptr - hdr->el_align;
-    }
+    (void)ptr;
+    // NOTE: this intentionally does nothing, all memory releasing in scope_exit()
+    _cex_allocator_arena__validate(allc);
+
+    if (ptr == NULL) { return NULL; }
+
+    AllocatorArena_c* self = (AllocatorArena_c*)allc;
+    (void)self;
+    uassert(
+        _cex_allocator_arena__check_pointer_valid(self, ptr) && "pointer doesn't belong to arena"
+    );
+    allocator_arena_rec_s* rec = _cex_alloc_arena__get_rec(ptr);
+    rec->is_free = true;
+    mem$asan_poison(ptr, rec->size);
+
+    return NULL;
 }
 
-bool
-_cexds__arr_integrity(const void* arr, usize magic_num)
+static void*
+_cex_allocator_arena__realloc(IAllocator allc, void* old_ptr, usize size, usize alignment)
 {
-    (void)magic_num;
-    (void)arr;
+    _cex_allocator_arena__validate(allc);
+    uassert(old_ptr != NULL);
+    uassert(size > 0);
+    uassert(size < CEX_ARENA_MAX_ALLOC);
 
-#ifndef NDEBUG
-    _cexds__array_header* hdr = _cexds__header(arr);
-    (void)hdr;
+    AllocatorArena_c* self = (AllocatorArena_c*)allc;
+    uassert(self->scope_depth > 0 && "arena allocation must be performed in mem$scope() block!");
+    __cex__alloc_hook(allc, size);
 
-    uassert(arr != NULL && "array uninitialized or out-of-mem");
-    // WARNING: next can trigger sanitizer with "stack/heap-buffer-underflow on address"
-    //          when arr pointer is invalid arr$ / hm$ type pointer
-    if (magic_num == 0) {
-        uassert(((hdr->magic_num == _CEXDS_ARR_MAGIC) || hdr->magic_num == _CEXDS_HM_MAGIC));
+    allocator_arena_rec_s* rec = _cex_alloc_arena__get_rec(old_ptr);
+    uassert(!rec->is_free && "trying to realloc() already freed pointer");
+    if (alignment < 8) {
+        uassert(rec->ptr_alignment == 8);
     } else {
-        uassert(hdr->magic_num == magic_num);
+        uassert(alignment == rec->ptr_alignment && "realloc alignment mismatch with old_ptr");
+        uassert(((usize)(old_ptr) & ((alignment)-1)) == 0 && "weird old_ptr not aligned");
+        uassert(((usize)(size) & ((alignment)-1)) == 0 && "size is not aligned as expected");
     }
 
-    uassert(mem$asan_poison_check(hdr->__poison_area, sizeof(hdr->__poison_area)));
+    uassert(
+        _cex_allocator_arena__check_pointer_valid(self, old_ptr) &&
+        "pointer doesn't belong to arena"
+    );
+
+    if (unlikely(size <= rec->size)) {
+        if (size == rec->size) { return old_ptr; }
+        // we can't change size/padding of this allocation, because this will break iterating
+        // ptr_padding is only u8 size, we cant store size, change, so we currently poison new size
+        mem$asan_poison((char*)old_ptr + size, rec->size - size);
+        return old_ptr;
+    }
 
+    if (unlikely(self->last_page && self->last_page->last_alloc == old_ptr)) {
+        allocator_arena_rec_s nrec = _cex_alloc_estimate_alloc_size(size, alignment);
+        if (nrec.size == 0) { goto fail; }
+        bool is_created = false;
+        allocator_arena_page_s* page = _cex_allocator_arena__request_page_size(
+            self,
+            nrec,
+            &is_created
+        );
+        if (page == NULL) { goto fail; }
+        if (!is_created) {
+            // If new page was created, fall back to malloc/copy/free method
+            //   but currently we have spare capacity for growth
+            u32 extra_bytes = size - rec->size;
+            mem$asan_unpoison((char*)old_ptr + rec->size, extra_bytes);
+#ifdef CEX_TEST
+            memset((char*)old_ptr + rec->size, 0xf7, extra_bytes);
 #endif
+            extra_bytes += (nrec.ptr_padding - rec->ptr_padding);
+            page->cursor += extra_bytes;
+            self->used += extra_bytes;
+            self->stats.bytes_alloc += extra_bytes;
+            rec->size = size;
+            rec->ptr_padding = nrec.ptr_padding;
 
+            uassert(
+                (char*)rec + rec->size + rec->ptr_padding + rec->ptr_offset ==
+                &page->data[page->cursor]
+            );
+            uassert(page->cursor % 8 == 0);
+            uassert(self->used % 8 == 0);
+            mem$asan_poison((char*)old_ptr + size, rec->ptr_padding);
+            return old_ptr;
+        }
+        // NOTE: fall through to default way
+    }
 
-    return true;
+    void* new_ptr = _cex_allocator_arena__malloc(allc, size, alignment);
+    if (new_ptr == NULL) { goto fail; }
+    memcpy(new_ptr, old_ptr, rec->size);
+    _cex_allocator_arena__free(allc, old_ptr);
+    return new_ptr;
+fail:
+    _cex_allocator_arena__free(allc, old_ptr);
+    return NULL;
 }
 
-inline usize
-_cexds__arr_len(const void* arr)
+
+static const struct Allocator_i*
+_cex_allocator_arena__scope_enter(IAllocator allc)
 {
-    return (arr) ? _cexds__header(arr)->length : 0;
+    _cex_allocator_arena__validate(allc);
+    AllocatorArena_c* self = (AllocatorArena_c*)allc;
+    // NOTE: If scope_depth is higher CEX_ALLOCATOR_MAX_SCOPE_STACK, we stop marking
+    //  all memory will be released after exiting scope_depth == CEX_ALLOCATOR_MAX_SCOPE_STACK
+    if (self->scope_depth < arr$len(self->scope_stack)) {
+        self->scope_stack[self->scope_depth] = self->used;
+    }
+    self->scope_depth++;
+    return allc;
 }
-
-void*
-_cexds__arrgrowf(
-    void* arr,
-    usize elemsize,
-    usize addlen,
-    usize min_cap,
-    u16 el_align,
-    IAllocator allc
-)
+static void
+_cex_allocator_arena__scope_exit(IAllocator allc)
 {
-    uassert(addlen < PTRDIFF_MAX && "negative or overflow");
-    uassert(min_cap < PTRDIFF_MAX && "negative or overflow");
-    uassert(el_align <= 64 && "alignment is too high");
+    _cex_allocator_arena__validate(allc);
+    AllocatorArena_c* self = (AllocatorArena_c*)allc;
+    uassert(self->scope_depth > 0);
 
-    if (arr == NULL) {
-        if (allc == NULL) {
-            uassert(allc != NULL && "using uninitialized arr/hm or out-of-mem error");
-            // unconditionally abort even in production
-            abort();
-        }
-    } else {
-        _cexds__arr_integrity(arr, 0);
+#ifdef CEX_TEST
+    bool AllocatorArena_sanitize(IAllocator allc);
+    uassert(AllocatorArena_sanitize(allc));
+#endif
+    self->scope_depth--;
+    if (self->scope_depth >= arr$len(self->scope_stack)) {
+        // Scope overflow, wait until we reach CEX_ALLOCATOR_MAX_SCOPE_STACK
+        return;
     }
-    _cexds__array_header temp = { 0 }; // force debugging
-    usize min_len = (arr ? _cexds__header(arr)->length : 0) + addlen;
-    (void)sizeof(temp);
 
-    // compute the minimum capacity needed
-    if (min_len > min_cap) { min_cap = min_len; }
+    usize used_mark = self->scope_stack[self->scope_depth];
 
-    // increase needed capacity to guarantee O(1) amortized
-    if (min_cap < 2 * arr$cap(arr)) {
-        min_cap = 2 * arr$cap(arr);
-    } else if (min_cap < 16) {
-        min_cap = 16;
-    }
-    uassert(min_cap < PTRDIFF_MAX && "negative or overflow after processing");
-    uassert(addlen > 0 || min_cap > 0);
+    allocator_arena_page_s* page = self->last_page;
+    while (page) {
+        auto tpage = page->prev_page;
+        if (page->used_start == 0 || page->used_start < used_mark) {
+            // last page, just set mark and poison
+            usize free_offset = (used_mark - page->used_start);
+            uassert(page->cursor >= free_offset);
 
-    if (min_cap <= arr$cap(arr)) { return arr; }
+            usize free_len = page->cursor - free_offset;
+            page->cursor = free_offset;
+            mem$asan_poison(&page->data[free_offset], free_len);
 
-    // General types with alignment <= usize use generic realloc (less mem overhead + realloc faster)
-    el_align = (el_align <= alignof(_cexds__array_header)) ? alignof(_cexds__array_header) : 64;
+            uassert(self->used >= free_len);
+            self->used -= free_len;
+            self->stats.bytes_free += free_len;
+            break; // we are done
+        } else {
+            usize free_len = page->cursor;
+            uassert(self->used >= free_len);
 
-    void* new_arr;
-    if (arr == NULL) {
-        new_arr = mem$malloc(
-            allc,
-            mem$aligned_round(elemsize * min_cap + sizeof(_cexds__array_header), el_align),
-            el_align
-        );
-    } else {
-        _cexds__array_header* hdr = _cexds__header(arr);
-        (void)hdr;
-        uassert(
-            hdr->allocator->scope_depth(hdr->allocator) == hdr->allocator_scope_depth &&
-            "passing object between different mem$scope() will lead to use-after-free / ASAN poison issues"
-        );
-        // NOTE: we must unpoison to prevent false ASAN use-after-poison check if data is copied
-        mem$asan_unpoison(hdr->__poison_area, sizeof(hdr->__poison_area));
-        new_arr = mem$realloc(
-            _cexds__header(arr)->allocator,
-            _cexds__base(hdr),
-            mem$aligned_round(elemsize * min_cap + sizeof(_cexds__array_header), el_align),
-            el_align
-        );
+            self->used -= free_len;
+            self->stats.bytes_free += free_len;
+            self->last_page = page->prev_page;
+            self->stats.pages_free++;
+            mem$free(mem$, page);
+        }
+        page = tpage;
     }
+}
+static u32
+_cex_allocator_arena__scope_depth(IAllocator allc)
+{
+    _cex_allocator_arena__validate(allc);
+    AllocatorArena_c* self = (AllocatorArena_c*)allc;
+    return self->scope_depth;
+}
 
-    if (new_arr == NULL) {
-        // oops memory error
+const Allocator_i*
+AllocatorArena_create(usize page_size)
+{
+    if (page_size < 1024 || page_size >= UINT32_MAX) {
+        uassert(page_size >= 1024 && "page size is too small");
+        uassert(page_size < UINT32_MAX && "page size is too big");
         return NULL;
     }
 
-    new_arr = mem$aligned_pointer(new_arr + sizeof(_cexds__array_header), el_align);
-    _cexds__array_header* hdr = _cexds__header(new_arr);
-    if (arr == NULL) {
-        hdr->length = 0;
-        hdr->_hash_table = NULL;
-        hdr->allocator = allc;
-        hdr->magic_num = _CEXDS_ARR_MAGIC;
-        hdr->allocator_scope_depth = allc->scope_depth(allc);
-        hdr->el_align = el_align;
-        mem$asan_poison(hdr->__poison_area, sizeof(hdr->__poison_area));
-    } else {
-        uassert(
-            (hdr->magic_num == _CEXDS_ARR_MAGIC || hdr->magic_num == _CEXDS_HM_MAGIC) &&
-            "bad magic after realloc"
-        );
-        mem$asan_poison(hdr->__poison_area, sizeof(hdr->__poison_area));
-        _CEXDS_STATS(++_cexds__array_grow);
+    AllocatorArena_c template = {
+        .alloc = {
+            .malloc = _cex_allocator_arena__malloc,
+            .realloc = _cex_allocator_arena__realloc,
+            .calloc = _cex_allocator_arena__calloc,
+            .free = _cex_allocator_arena__free,
+            .scope_enter = _cex_allocator_arena__scope_enter,
+            .scope_exit = _cex_allocator_arena__scope_exit,
+            .scope_depth = _cex_allocator_arena__scope_depth,
+            .meta = {
+                .magic_id = CEX_ALLOCATOR_ARENA_MAGIC,
+                .is_arena = true, 
+                .is_temp = false, 
+            }
+        },
+        .page_size = page_size,
+    };
+
+    AllocatorArena_c* self = mem$new(mem$, AllocatorArena_c);
+    if (self == NULL) {
+        return NULL; // memory error
     }
-    hdr->capacity = min_cap;
 
-    return new_arr;
+    memcpy(self, &template, sizeof(AllocatorArena_c));
+    uassert(self->alloc.meta.magic_id == CEX_ALLOCATOR_ARENA_MAGIC);
+    uassert(self->alloc.malloc == _cex_allocator_arena__malloc);
+
+    _cex_allocator_arena__scope_enter(&self->alloc);
+
+    return &self->alloc;
 }
 
-void
-_cexds__arrfreef(void* a)
+bool
+AllocatorArena_sanitize(IAllocator allc)
 {
-    if (a != NULL) {
-        uassert(_cexds__header(a)->allocator != NULL);
-        _cexds__array_header* h = _cexds__header(a);
-        h->allocator->free(h->allocator, _cexds__base(h));
+    (void)allc;
+    _cex_allocator_arena__validate(allc);
+    AllocatorArena_c* self = (AllocatorArena_c*)allc;
+    if (self->scope_depth == 0) {
+        uassert(self->stats.bytes_alloc == self->stats.bytes_free && "memory leaks?");
     }
-}
-
-//
-// _cexds__hm hash table implementation
-//
-
-#define _CEXDS_BUCKET_LENGTH 8
-#define _CEXDS_BUCKET_SHIFT (_CEXDS_BUCKET_LENGTH == 8 ? 3 : 2)
-#define _CEXDS_BUCKET_MASK (_CEXDS_BUCKET_LENGTH - 1)
-#define _CEXDS_CACHE_LINE_SIZE 64
+    allocator_arena_page_s* page = self->last_page;
+    while (page) {
+        uassert(page->cursor <= page->capacity);
+        uassert(mem$asan_poison_check(page->__poison_area, sizeof(page->__poison_area)));
 
-#define _cexds__hash_table(a) ((_cexds__hash_index*)_cexds__header(a)->_hash_table)
+        u32 i = 0;
+        while (i < page->cursor) {
+            allocator_arena_rec_s* rec = (allocator_arena_rec_s*)&page->data[i];
+            uassert(rec->size <= page->capacity);
+            uassert(rec->size <= page->cursor);
+            uassert(rec->ptr_offset <= CEX_ARENA_MAX_ALIGN);
+            uassert(rec->ptr_padding <= 16);
+            uassert(rec->ptr_alignment <= CEX_ARENA_MAX_ALIGN);
+            uassert(rec->is_free <= 1);
+            uassert(mem$is_power_of2(rec->ptr_alignment));
 
+            char* alloc_p = ((char*)rec) + rec->ptr_offset;
+            u8 poffset = alloc_p[-1];
+            (void)poffset;
+            uassert(poffset == rec->ptr_offset && "near pointer offset mismatch to rec.ptr_offset");
 
-typedef struct
-{
-    usize hash[_CEXDS_BUCKET_LENGTH];
-    ptrdiff_t index[_CEXDS_BUCKET_LENGTH];
-} _cexds__hash_bucket;
-static_assert(sizeof(_cexds__hash_bucket) % 64 == 0, "cacheline aligned");
+            if (rec->ptr_padding) {
+                uassert(
+                    mem$asan_poison_check(alloc_p + rec->size, rec->ptr_padding) &&
+                    "poison data overwrite past allocated item"
+                );
+            }
 
-typedef struct _cexds__hash_index
-{
-    usize slot_count;
-    usize used_count;
-    usize used_count_threshold;
-    usize used_count_shrink_threshold;
-    usize tombstone_count;
-    usize tombstone_count_threshold;
-    usize seed;
-    usize slot_count_log2;
-    enum _CexDsKeyType_e key_type;
-    IAllocator key_arena;
-    bool copy_keys;
+            if (rec->is_free) {
+                uassert(
+                    mem$asan_poison_check(alloc_p, rec->size) &&
+                    "poison data corruction in freed item area"
+                );
+            }
+            i += rec->ptr_padding + rec->ptr_offset + rec->size;
+        }
+        if (page->cursor < page->capacity) {
+            // unallocated page must be poisoned
+            uassert(
+                mem$asan_poison_check(&page->data[page->cursor], page->capacity - page->cursor) &&
+                "poison data overwrite in unallocated area"
+            );
+        }
 
-    // not a separate allocation, just 64-byte aligned storage after this struct
-    _cexds__hash_bucket* storage;
-} _cexds__hash_index;
+        page = page->prev_page;
+    }
 
-#define _CEXDS_INDEX_EMPTY -1
-#define _CEXDS_INDEX_DELETED -2
-#define _CEXDS_INDEX_IN_USE(x) ((x) >= 0)
+    return true;
+}
 
-#define _CEXDS_HASH_EMPTY 0
-#define _CEXDS_HASH_DELETED 1
+void
+AllocatorArena_destroy(IAllocator self)
+{
+    _cex_allocator_arena__validate(self);
+    AllocatorArena_c* allc = (AllocatorArena_c*)self;
 
-#define _CEXDS_usize_BITS ((sizeof(usize)) * 8)
+    uassert(allc->scope_depth == 1 && "trying to destroy in mem$scope?");
+    _cex_allocator_arena__scope_exit(self);
 
-static inline usize
-_cexds__probe_position(usize hash, usize slot_count, usize slot_log2)
-{
-    usize pos;
-    (void)(slot_log2);
-    pos = hash & (slot_count - 1);
-#ifdef _CEXDS_INTERNAL_BUCKET_START
-    pos &= ~_CEXDS_BUCKET_MASK;
+#ifdef CEX_TEST
+    uassert(AllocatorArena_sanitize(self));
 #endif
-    return pos;
-}
 
-static inline usize
-_cexds__log2(usize slot_count)
-{
-    usize n = 0;
-    while (slot_count > 1) {
-        slot_count >>= 1;
-        ++n;
+    allocator_arena_page_s* page = allc->last_page;
+    while (page) {
+        auto tpage = page->prev_page;
+        mem$free(mem$, page);
+        page = tpage;
     }
-    return n;
+    mem$free(mem$, allc);
 }
 
-void
-_cexds__hmclear_func(struct _cexds__hash_index* t, _cexds__hash_index* old_table)
-{
-    if (t == NULL) {
-        // typically external call of uninitialized table
-        return;
-    }
-
-    uassert(t->slot_count > 0);
-    t->tombstone_count = 0;
-    t->used_count = 0;
+_Thread_local AllocatorArena_c _cex__default_global__allocator_temp = {
+    .alloc = {
+        .malloc = _cex_allocator_arena__malloc,
+        .realloc = _cex_allocator_arena__realloc,
+        .calloc = _cex_allocator_arena__calloc,
+        .free = _cex_allocator_arena__free,
+        .scope_enter = _cex_allocator_arena__scope_enter,
+        .scope_exit = _cex_allocator_arena__scope_exit,
+        .scope_depth = _cex_allocator_arena__scope_depth,
+        .meta = {
+            .magic_id = CEX_ALLOCATOR_TEMP_MAGIC,
+            .is_arena = true,  // coming... soon
+            .is_temp = true, 
+        }, 
+    },
+    .page_size = CEX_ALLOCATOR_TEMP_PAGE_SIZE,
+};
 
-    if (old_table) {
-        t->key_arena = old_table->key_arena;
-        t->seed = old_table->seed;
-        t->key_arena = old_table->key_arena;
-        t->copy_keys = old_table->copy_keys;
-    } else {
-        uassert(t->seed != 0);
-    }
+const struct __cex_namespace__AllocatorArena AllocatorArena = {
+    // Autogenerated by CEX
+    // clang-format off
 
-    usize i, j;
-    for (i = 0; i < t->slot_count >> _CEXDS_BUCKET_SHIFT; ++i) {
-        _cexds__hash_bucket* b = &t->storage[i];
-        for (j = 0; j < _CEXDS_BUCKET_LENGTH; ++j) { b->hash[j] = _CEXDS_HASH_EMPTY; }
-        for (j = 0; j < _CEXDS_BUCKET_LENGTH; ++j) { b->index[j] = _CEXDS_INDEX_EMPTY; }
-    }
-}
+    .create = AllocatorArena_create,
+    .destroy = AllocatorArena_destroy,
+    .sanitize = AllocatorArena_sanitize,
 
-static _cexds__hash_index*
-_cexds__make_hash_index(
-    usize slot_count,
-    _cexds__hash_index* old_table,
-    IAllocator allc,
-    usize hash_seed,
-    enum _CexDsKeyType_e key_type
-)
-{
-    _cexds__hash_index* t = mem$calloc(
-        allc,
-        1,
-        (slot_count >> _CEXDS_BUCKET_SHIFT) * sizeof(_cexds__hash_bucket) +
-            sizeof(_cexds__hash_index) + _CEXDS_CACHE_LINE_SIZE - 1
-    );
-    if (t == NULL) {
-        return NULL; // memory error
-    }
-    t->storage = (_cexds__hash_bucket*)mem$aligned_pointer((usize)(t + 1), _CEXDS_CACHE_LINE_SIZE);
-    t->slot_count = slot_count;
-    t->slot_count_log2 = _cexds__log2(slot_count);
-    t->tombstone_count = 0;
-    t->used_count = 0;
-    t->key_type = key_type;
-    t->seed = hash_seed;
+    // clang-format on
+};
 
-    // compute without overflowing
-    t->used_count_threshold = slot_count - (slot_count >> 2);
-    t->tombstone_count_threshold = (slot_count >> 3) + (slot_count >> 4);
-    t->used_count_shrink_threshold = slot_count >> 2;
 
-    if (slot_count <= _CEXDS_BUCKET_LENGTH) { t->used_count_shrink_threshold = 0; }
-    // to avoid infinite loop, we need to guarantee that at least one slot is empty and will
-    // terminate probes
-    uassert(t->used_count_threshold + t->tombstone_count_threshold < t->slot_count);
-    _CEXDS_STATS(++_cexds__hash_alloc);
 
-    _cexds__hmclear_func(t, old_table);
+/*
+*                          src/ds.c
+*/
 
-    // copy out the old data, if any
-    if (old_table) {
-        usize i, j;
-        t->used_count = old_table->used_count;
-        for (i = 0; i < old_table->slot_count >> _CEXDS_BUCKET_SHIFT; ++i) {
-            _cexds__hash_bucket* ob = &old_table->storage[i];
-            for (j = 0; j < _CEXDS_BUCKET_LENGTH; ++j) {
-                if (_CEXDS_INDEX_IN_USE(ob->index[j])) {
-                    usize hash = ob->hash[j];
-                    usize pos = _cexds__probe_position(hash, t->slot_count, t->slot_count_log2);
-                    usize step = _CEXDS_BUCKET_LENGTH;
-                    _CEXDS_STATS(++_cexds__rehash_items);
-                    for (;;) {
-                        usize limit, z;
-                        _cexds__hash_bucket* bucket;
-                        bucket = &t->storage[pos >> _CEXDS_BUCKET_SHIFT];
-                        _CEXDS_STATS(++_cexds__rehash_probes);
 
-                        for (z = pos & _CEXDS_BUCKET_MASK; z < _CEXDS_BUCKET_LENGTH; ++z) {
-                            if (bucket->hash[z] == 0) {
-                                bucket->hash[z] = hash;
-                                bucket->index[z] = ob->index[j];
-                                goto done;
-                            }
-                        }
+#ifdef _CEXDS_STATISTICS
+#    define _CEXDS_STATS(x) x
+usize _cexds__array_grow;
+usize _cexds__hash_grow;
+usize _cexds__hash_shrink;
+usize _cexds__hash_rebuild;
+usize _cexds__hash_probes;
+usize _cexds__hash_alloc;
+usize _cexds__rehash_probes;
+usize _cexds__rehash_items;
+#else
+#    define _CEXDS_STATS(x)
+#endif
 
-                        limit = pos & _CEXDS_BUCKET_MASK;
-                        for (z = 0; z < limit; ++z) {
-                            if (bucket->hash[z] == 0) {
-                                bucket->hash[z] = hash;
-                                bucket->index[z] = ob->index[j];
-                                goto done;
-                            }
-                        }
+//
+// _cexds__arr implementation
+//
 
-                        pos += step; // quadratic probing
-                        step += _CEXDS_BUCKET_LENGTH;
-                        pos &= (t->slot_count - 1);
-                    }
-                }
-            done:;
-            }
-        }
-    }
+#define _cexds__item_ptr(t, i, elemsize) ((char*)a + elemsize * i)
 
-    return t;
+static inline void*
+_cexds__base(_cexds__array_header* hdr)
+{
+    if (hdr->el_align <= sizeof(_cexds__array_header)) {
+        return hdr;
+    } else {
+        char* arr_ptr = (char*)hdr + sizeof(_cexds__array_header);
+        return arr_ptr - hdr->el_align;
+    }
 }
 
-#define _CEXDS_ROTATE_LEFT(val, n) (((val) << (n)) | ((val) >> (_CEXDS_usize_BITS - (n))))
-#define _CEXDS_ROTATE_RIGHT(val, n) (((val) >> (n)) | ((val) << (_CEXDS_usize_BITS - (n))))
+bool
+_cexds__arr_integrity(const void* arr, usize magic_num)
+{
+    (void)magic_num;
+    (void)arr;
 
+#ifndef NDEBUG
+    _cexds__array_header* hdr = _cexds__header(arr);
+    (void)hdr;
 
-#ifdef _CEXDS_SIPHASH_2_4
-#    define _CEXDS_SIPHASH_C_ROUNDS 2
-#    define _CEXDS_SIPHASH_D_ROUNDS 4
-typedef int _CEXDS_SIPHASH_2_4_can_only_be_used_in_64_bit_builds[sizeof(usize) == 8 ? 1 : -1];
-#endif
+    uassert(arr != NULL && "array uninitialized or out-of-mem");
+    // WARNING: next can trigger sanitizer with "stack/heap-buffer-underflow on address"
+    //          when arr pointer is invalid arr$ / hm$ type pointer
+    if (magic_num == 0) {
+        uassert(((hdr->magic_num == _CEXDS_ARR_MAGIC) || hdr->magic_num == _CEXDS_HM_MAGIC));
+    } else {
+        uassert(hdr->magic_num == magic_num);
+    }
+
+    uassert(mem$asan_poison_check(hdr->__poison_area, sizeof(hdr->__poison_area)));
 
-#ifndef _CEXDS_SIPHASH_C_ROUNDS
-#    define _CEXDS_SIPHASH_C_ROUNDS 1
-#endif
-#ifndef _CEXDS_SIPHASH_D_ROUNDS
-#    define _CEXDS_SIPHASH_D_ROUNDS 1
 #endif
 
-static inline usize
-_cexds__hash_string(const char* str, usize str_cap, usize seed)
-{
-    usize hash = seed;
-    // NOTE: using max buffer capacity capping, this allows using hash
-    //       on char buf[N] - without stack overflowing
-    for (usize i = 0; i < str_cap && *str; i++) {
-        hash = _CEXDS_ROTATE_LEFT(hash, 9) + (unsigned char)*str++;
-    }
 
-    // Thomas Wang 64-to-32 bit mix function, hopefully also works in 32 bits
-    hash ^= seed;
-    hash = (~hash) + (hash << 18);
-    hash ^= hash ^ _CEXDS_ROTATE_RIGHT(hash, 31);
-    hash = hash * 21;
-    hash ^= hash ^ _CEXDS_ROTATE_RIGHT(hash, 11);
-    hash += (hash << 6);
-    hash ^= _CEXDS_ROTATE_RIGHT(hash, 22);
-    return hash + seed;
+    return true;
 }
 
-static inline usize
-_cexds__siphash_bytes(const void* p, usize len, usize seed)
+inline usize
+_cexds__arr_len(const void* arr)
 {
-    // hash that works on 32- or 64-bit registers without knowing which we have
-    // (computes different results on 32-bit and 64-bit platform)
-    // derived from siphash, but on 32-bit platforms very different as it uses 4 32-bit state not 4
-    // 64-bit
-    usize v0 = ((((usize)0x736f6d65 << 16) << 16) + 0x70736575) ^ seed;
-    usize v1 = ((((usize)0x646f7261 << 16) << 16) + 0x6e646f6d) ^ ~seed;
-    usize v2 = ((((usize)0x6c796765 << 16) << 16) + 0x6e657261) ^ seed;
-    usize v3 = ((((usize)0x74656462 << 16) << 16) + 0x79746573) ^ ~seed;
-
-#ifdef _CEXDS_TEST_SIPHASH_2_4
-    // hardcoded with key material in the siphash test vectors
-    v0 ^= 0x0706050403020100ull ^ seed;
-    v1 ^= 0x0f0e0d0c0b0a0908ull ^ ~seed;
-    v2 ^= 0x0706050403020100ull ^ seed;
-    v3 ^= 0x0f0e0d0c0b0a0908ull ^ ~seed;
-#endif
-
-#define _CEXDS_SIPROUND()                                                                          \
-    do {                                                                                           \
-        v0 += v1;                                                                                  \
-        v1 = _CEXDS_ROTATE_LEFT(v1, 13);                                                           \
-        v1 ^= v0;                                                                                  \
-        v0 = _CEXDS_ROTATE_LEFT(v0, _CEXDS_usize_BITS / 2);                                        \
-        v2 += v3;                                                                                  \
-        v3 = _CEXDS_ROTATE_LEFT(v3, 16);                                                           \
-        v3 ^= v2;                                                                                  \
-        v2 += v1;                                                                                  \
-        v1 = _CEXDS_ROTATE_LEFT(v1, 17);                                                           \
-        v1 ^= v2;                                                                                  \
-        v2 = _CEXDS_ROTATE_LEFT(v2, _CEXDS_usize_BITS / 2);                                        \
-        v0 += v3;                                                                                  \
-        v3 = _CEXDS_ROTATE_LEFT(v3, 21);                                                           \
-        v3 ^= v0;                                                                                  \
-    } while (0)
+    return (arr) ? _cexds__header(arr)->length : 0;
+}
 
-    unsigned char* d = (unsigned char*)p;
-    usize data = 0;
-    usize i = 0;
-    usize j = 0;
-    for (i = 0; i + sizeof(usize) <= len; i += sizeof(usize), d += sizeof(usize)) {
-        data = (usize)d[0] | ((usize)d[1] << 8) | ((usize)d[2] << 16) | ((usize)d[3] << 24);
+void*
+_cexds__arrgrowf(
+    void* arr,
+    usize elemsize,
+    usize addlen,
+    usize min_cap,
+    u16 el_align,
+    IAllocator allc
+)
+{
+    uassert(addlen < PTRDIFF_MAX && "negative or overflow");
+    uassert(min_cap < PTRDIFF_MAX && "negative or overflow");
+    uassert(el_align <= 64 && "alignment is too high");
 
-#if UINTPTR_MAX > 0xFFFFFFFFU
-        // 64 bits only
-        data |= (usize)(d[4] | (d[5] << 8) | (d[6] << 16) | (d[7] << 24)) << 16 << 16;
-#endif
-
-        v3 ^= data;
-        for (j = 0; j < _CEXDS_SIPHASH_C_ROUNDS; ++j) { _CEXDS_SIPROUND(); }
-        v0 ^= data;
-    }
-    data = len << (_CEXDS_usize_BITS - 8);
-    switch (len - i) {
-        case 7:
-            data |= ((usize)d[6] << 24) << 24; // fall through
-        case 6:
-            data |= ((usize)d[5] << 20) << 20; // fall through
-        case 5:
-            data |= ((usize)d[4] << 16) << 16; // fall through
-        case 4:
-            data |= (d[3] << 24); // fall through
-        case 3:
-            data |= (d[2] << 16); // fall through
-        case 2:
-            data |= (d[1] << 8); // fall through
-        case 1:
-            data |= d[0]; // fall through
-        case 0:
-            break;
+    if (arr == NULL) {
+        if (allc == NULL) {
+            uassert(allc != NULL && "using uninitialized arr/hm or out-of-mem error");
+            // unconditionally abort even in production
+            abort();
+        }
+    } else {
+        _cexds__arr_integrity(arr, 0);
     }
-    v3 ^= data;
-    for (j = 0; j < _CEXDS_SIPHASH_C_ROUNDS; ++j) { _CEXDS_SIPROUND(); }
-    v0 ^= data;
-    v2 ^= 0xff;
-    for (j = 0; j < _CEXDS_SIPHASH_D_ROUNDS; ++j) { _CEXDS_SIPROUND(); }
+    _cexds__array_header temp = { 0 }; // force debugging
+    usize min_len = (arr ? _cexds__header(arr)->length : 0) + addlen;
+    (void)sizeof(temp);
 
-#ifdef _CEXDS_SIPHASH_2_4
-    return v0 ^ v1 ^ v2 ^ v3;
-#else
-    return v1 ^ v2 ^ v3;
-#endif
-}
+    // compute the minimum capacity needed
+    if (min_len > min_cap) { min_cap = min_len; }
 
-static inline usize
-_cexds__hash_bytes(const void* p, usize len, usize seed)
-{
-#ifdef _CEXDS_SIPHASH_2_4
-    return _cexds__siphash_bytes(p, len, seed);
-#else
-    unsigned char* d = (unsigned char*)p;
+    // increase needed capacity to guarantee O(1) amortized
+    if (min_cap < 2 * arr$cap(arr)) {
+        min_cap = 2 * arr$cap(arr);
+    } else if (min_cap < 16) {
+        min_cap = 16;
+    }
+    uassert(min_cap < PTRDIFF_MAX && "negative or overflow after processing");
+    uassert(addlen > 0 || min_cap > 0);
 
-    if (len == 4) {
-        u32 hash = (u32)d[0] | ((u32)d[1] << 8) | ((u32)d[2] << 16) | ((u32)d[3] << 24);
-        // HASH32-BB  Bob Jenkin's presumably-accidental version of Thomas Wang hash with rotates
-        // turned into shifts. Note that converting these back to rotates makes it run a lot slower,
-        // presumably due to collisions, so I'm not really sure what's going on.
-        hash ^= seed;
-        hash = (hash ^ 61) ^ (hash >> 16);
-        hash = hash + (hash << 3);
-        hash = hash ^ (hash >> 4);
-        hash = hash * 0x27d4eb2d;
-        hash ^= seed;
-        hash = hash ^ (hash >> 15);
-        return (((usize)hash << 16 << 16) | hash) ^ seed;
-    } else if (len == 8 && sizeof(usize) == 8) {
-        usize hash = (usize)d[0] | ((usize)d[1] << 8) | ((usize)d[2] << 16) | ((usize)d[3] << 24);
+    if (min_cap <= arr$cap(arr)) { return arr; }
 
-        hash |= (usize)((usize)d[4] | ((usize)d[5] << 8) | ((usize)d[6] << 16) | ((usize)d[7] << 24))
-             << 16 << 16;
-        hash ^= seed;
-        hash = (~hash) + (hash << 21);
-        hash ^= _CEXDS_ROTATE_RIGHT(hash, 24);
-        hash *= 265;
-        hash ^= _CEXDS_ROTATE_RIGHT(hash, 14);
-        hash ^= seed;
-        hash *= 21;
-        hash ^= _CEXDS_ROTATE_RIGHT(hash, 28);
-        hash += (hash << 31);
-        hash = (~hash) + (hash << 18);
-        return hash;
+    // General types with alignment <= usize use generic realloc (less mem overhead + realloc faster)
+    el_align = (el_align <= alignof(_cexds__array_header)) ? alignof(_cexds__array_header) : 64;
+
+    void* new_arr;
+    if (arr == NULL) {
+        new_arr = mem$malloc(
+            allc,
+            mem$aligned_round(elemsize * min_cap + sizeof(_cexds__array_header), el_align),
+            el_align
+        );
     } else {
-        return _cexds__siphash_bytes(p, len, seed);
+        _cexds__array_header* hdr = _cexds__header(arr);
+        (void)hdr;
+        uassert(
+            hdr->allocator->scope_depth(hdr->allocator) == hdr->allocator_scope_depth &&
+            "passing object between different mem$scope() will lead to use-after-free / ASAN poison issues"
+        );
+        // NOTE: we must unpoison to prevent false ASAN use-after-poison check if data is copied
+        mem$asan_unpoison(hdr->__poison_area, sizeof(hdr->__poison_area));
+        new_arr = mem$realloc(
+            _cexds__header(arr)->allocator,
+            _cexds__base(hdr),
+            mem$aligned_round(elemsize * min_cap + sizeof(_cexds__array_header), el_align),
+            el_align
+        );
     }
-#endif
-}
 
-static inline usize
-_cexds__hash(enum _CexDsKeyType_e key_type, const void* key, usize key_size, usize seed)
-{
-    switch (key_type) {
-        case _CexDsKeyType__generic:
-            return _cexds__hash_bytes(key, key_size, seed);
+    if (new_arr == NULL) {
+        // oops memory error
+        return NULL;
+    }
 
-        case _CexDsKeyType__charptr:
-            // NOTE: we can't know char* length without touching it,
-            // 65536 is a max key length in case of char was not null term
-            return _cexds__hash_string(*(char**)key, 65536, seed);
+    new_arr = mem$aligned_pointer(new_arr + sizeof(_cexds__array_header), el_align);
+    _cexds__array_header* hdr = _cexds__header(new_arr);
+    if (arr == NULL) {
+        hdr->length = 0;
+        hdr->_hash_table = NULL;
+        hdr->allocator = allc;
+        hdr->magic_num = _CEXDS_ARR_MAGIC;
+        hdr->allocator_scope_depth = allc->scope_depth(allc);
+        hdr->el_align = el_align;
+        mem$asan_poison(hdr->__poison_area, sizeof(hdr->__poison_area));
+    } else {
+        uassert(
+            (hdr->magic_num == _CEXDS_ARR_MAGIC || hdr->magic_num == _CEXDS_HM_MAGIC) &&
+            "bad magic after realloc"
+        );
+        mem$asan_poison(hdr->__poison_area, sizeof(hdr->__poison_area));
+        _CEXDS_STATS(++_cexds__array_grow);
+    }
+    hdr->capacity = min_cap;
 
-        case _CexDsKeyType__charbuf:
-            return _cexds__hash_string(key, key_size, seed);
+    return new_arr;
+}
 
-        case _CexDsKeyType__cexstr: {
-            str_s* s = (str_s*)key;
-            return _cexds__hash_string(s->buf, s->len, seed);
-        }
+void
+_cexds__arrfreef(void* a)
+{
+    if (a != NULL) {
+        uassert(_cexds__header(a)->allocator != NULL);
+        _cexds__array_header* h = _cexds__header(a);
+        h->allocator->free(h->allocator, _cexds__base(h));
     }
-    uassert(false && "unexpected key type");
-    abort();
 }
 
-static bool
-_cexds__is_key_equal(
-    void* a,
-    usize elemsize,
-    void* key,
-    usize keysize,
-    usize keyoffset,
-    enum _CexDsKeyType_e key_type,
-    usize i
-)
-{
-    void* hm_key = _cexds__item_ptr(a, i, elemsize) + keyoffset;
+//
+// _cexds__hm hash table implementation
+//
 
-    switch (key_type) {
-        case _CexDsKeyType__generic:
-            return 0 == memcmp(key, hm_key, keysize);
+#define _CEXDS_BUCKET_LENGTH 8
+#define _CEXDS_BUCKET_SHIFT (_CEXDS_BUCKET_LENGTH == 8 ? 3 : 2)
+#define _CEXDS_BUCKET_MASK (_CEXDS_BUCKET_LENGTH - 1)
+#define _CEXDS_CACHE_LINE_SIZE 64
 
-        case _CexDsKeyType__charptr:
-            return 0 == strcmp(*(char**)key, *(char**)hm_key);
-        case _CexDsKeyType__charbuf:
-            return 0 == strcmp((char*)key, (char*)hm_key);
+#define _cexds__hash_table(a) ((_cexds__hash_index*)_cexds__header(a)->_hash_table)
 
-        case _CexDsKeyType__cexstr: {
-            str_s* _k = (str_s*)key;
-            str_s* _hm = (str_s*)hm_key;
-            if (_k->len != _hm->len) { return false; }
-            return 0 == memcmp(_k->buf, _hm->buf, _k->len);
-        }
-    }
-    uassert(false && "unexpected key type");
-    abort();
-}
 
-static inline void*
-_cexds__hmkey_ptr(void* a, usize elemsize, usize index, usize keyoffset)
+typedef struct
 {
-    _cexds__hash_index* table = (_cexds__hash_index*)_cexds__header(a)->_hash_table;
-    void* key_data_p = NULL;
-    switch (table->key_type) {
-        case _CexDsKeyType__generic:
-            key_data_p = (char*)a + elemsize * index + keyoffset;
-            break;
+    usize hash[_CEXDS_BUCKET_LENGTH];
+    ptrdiff_t index[_CEXDS_BUCKET_LENGTH];
+} _cexds__hash_bucket;
+static_assert(sizeof(_cexds__hash_bucket) % 64 == 0, "cacheline aligned");
 
-        case _CexDsKeyType__charbuf:
-            key_data_p = (char*)((char*)a + elemsize * index + keyoffset);
-            break;
+typedef struct _cexds__hash_index
+{
+    usize slot_count;
+    usize used_count;
+    usize used_count_threshold;
+    usize used_count_shrink_threshold;
+    usize tombstone_count;
+    usize tombstone_count_threshold;
+    usize seed;
+    usize slot_count_log2;
+    enum _CexDsKeyType_e key_type;
+    IAllocator key_arena;
+    bool copy_keys;
 
-        case _CexDsKeyType__charptr:
-            key_data_p = *(char**)((char*)a + elemsize * index + keyoffset);
-            break;
+    // not a separate allocation, just 64-byte aligned storage after this struct
+    _cexds__hash_bucket* storage;
+} _cexds__hash_index;
 
-        case _CexDsKeyType__cexstr: {
-            str_s* s = (str_s*)((char*)a + elemsize * index + keyoffset);
-            key_data_p = s;
-            break;
-        }
-        default:
-            unreachable();
-    }
-    return key_data_p;
-}
+#define _CEXDS_INDEX_EMPTY -1
+#define _CEXDS_INDEX_DELETED -2
+#define _CEXDS_INDEX_IN_USE(x) ((x) >= 0)
 
-void
-_cexds__hmfree_keys_func(void* a, usize elemsize, usize keyoffset)
-{
-    _cexds__array_header* h = _cexds__header(a);
-    uassert(h->allocator != NULL);
-    _cexds__hash_index* table = h->_hash_table;
+#define _CEXDS_HASH_EMPTY 0
+#define _CEXDS_HASH_DELETED 1
 
-    if (table != NULL) {
-        if (table->copy_keys) {
-            if (table->key_arena == NULL) {
-                for (usize i = 0; i < h->length; ++i) {
-                    h->allocator->free(h->allocator, *(char**)((char*)a + elemsize * i + keyoffset));
-                }
-            } else {
-                uassert(table->key_arena->scope_depth(table->key_arena) > 0);
-                // Exit + enter for arena is equivalent of cleaning up and poisoning
-                table->key_arena->scope_exit(table->key_arena);
-                table->key_arena->scope_enter(table->key_arena);
-            }
-        }
-    }
-}
-void
-_cexds__hmfree_func(void* a, usize elemsize, usize keyoffset)
-{
-    if (a == NULL) { return; }
-    _cexds__arr_integrity(a, _CEXDS_HM_MAGIC);
+#define _CEXDS_usize_BITS ((sizeof(usize)) * 8)
 
-    _cexds__array_header* h = _cexds__header(a);
-    _cexds__hmfree_keys_func(a, elemsize, keyoffset);
-    if (h->_hash_table->key_arena) { AllocatorArena.destroy(h->_hash_table->key_arena); }
-    h->allocator->free(h->allocator, h->_hash_table);
-    h->allocator->free(h->allocator, _cexds__base(h));
+static inline usize
+_cexds__probe_position(usize hash, usize slot_count, usize slot_log2)
+{
+    usize pos;
+    (void)(slot_log2);
+    pos = hash & (slot_count - 1);
+#ifdef _CEXDS_INTERNAL_BUCKET_START
+    pos &= ~_CEXDS_BUCKET_MASK;
+#endif
+    return pos;
 }
 
-static ptrdiff_t
-_cexds__hm_find_slot(void* a, usize elemsize, void* key, usize keysize, usize keyoffset)
+static inline usize
+_cexds__log2(usize slot_count)
 {
-    _cexds__arr_integrity(a, _CEXDS_HM_MAGIC);
-    _cexds__hash_index* table = _cexds__hash_table(a);
-    enum _CexDsKeyType_e key_type = table->key_type;
-    usize hash = _cexds__hash(key_type, key, keysize, table->seed);
-    usize step = _CEXDS_BUCKET_LENGTH;
-
-    if (hash < 2) {
-        hash += 2; // stored hash values are forbidden from being 0, so we can detect empty slots
+    usize n = 0;
+    while (slot_count > 1) {
+        slot_count >>= 1;
+        ++n;
     }
+    return n;
+}
 
-    usize pos = _cexds__probe_position(hash, table->slot_count, table->slot_count_log2);
-
-    // TODO: check when this could be infinite loop (due to overflow or something)?
-    for (;;) {
-        _CEXDS_STATS(++_cexds__hash_probes);
-        _cexds__hash_bucket* bucket = &table->storage[pos >> _CEXDS_BUCKET_SHIFT];
-
-        // start searching from pos to end of bucket, this should help performance on small hash
-        // tables that fit in cache
-        for (usize i = pos & _CEXDS_BUCKET_MASK; i < _CEXDS_BUCKET_LENGTH; ++i) {
-            if (bucket->hash[i] == hash) {
-                if (_cexds__is_key_equal(
-                        a,
-                        elemsize,
-                        key,
-                        keysize,
-                        keyoffset,
-                        key_type,
-                        bucket->index[i]
-                    )) {
-                    return (pos & ~_CEXDS_BUCKET_MASK) + i;
-                }
-            } else if (bucket->hash[i] == _CEXDS_HASH_EMPTY) {
-                return -1;
-            }
-        }
+void
+_cexds__hmclear_func(struct _cexds__hash_index* t, _cexds__hash_index* old_table)
+{
+    if (t == NULL) {
+        // typically external call of uninitialized table
+        return;
+    }
 
-        // search from beginning of bucket to pos
-        usize limit = pos & _CEXDS_BUCKET_MASK;
-        for (usize i = 0; i < limit; ++i) {
-            if (bucket->hash[i] == hash) {
-                if (_cexds__is_key_equal(
-                        a,
-                        elemsize,
-                        key,
-                        keysize,
-                        keyoffset,
-                        key_type,
-                        bucket->index[i]
-                    )) {
-                    return (pos & ~_CEXDS_BUCKET_MASK) + i;
-                }
-            } else if (bucket->hash[i] == _CEXDS_HASH_EMPTY) {
-                return -1;
-            }
-        }
+    uassert(t->slot_count > 0);
+    t->tombstone_count = 0;
+    t->used_count = 0;
 
-        // quadratic probing
-        pos += step;
-        step += _CEXDS_BUCKET_LENGTH;
-        pos &= (table->slot_count - 1);
+    if (old_table) {
+        t->key_arena = old_table->key_arena;
+        t->seed = old_table->seed;
+        t->key_arena = old_table->key_arena;
+        t->copy_keys = old_table->copy_keys;
+    } else {
+        uassert(t->seed != 0);
     }
-}
-
-void*
-_cexds__hmget_key(void* a, usize elemsize, void* key, usize keysize, usize keyoffset)
-{
-    _cexds__arr_integrity(a, _CEXDS_HM_MAGIC);
 
-    _cexds__hash_index* table = (_cexds__hash_index*)_cexds__header(a)->_hash_table;
-    if (table != NULL) {
-        ptrdiff_t slot = _cexds__hm_find_slot(a, elemsize, key, keysize, keyoffset);
-        if (slot >= 0) {
-            _cexds__hash_bucket* b = &table->storage[slot >> _CEXDS_BUCKET_SHIFT];
-            usize idx = b->index[slot & _CEXDS_BUCKET_MASK];
-            return ((char*)a + elemsize * idx);
-        }
+    usize i, j;
+    for (i = 0; i < t->slot_count >> _CEXDS_BUCKET_SHIFT; ++i) {
+        _cexds__hash_bucket* b = &t->storage[i];
+        for (j = 0; j < _CEXDS_BUCKET_LENGTH; ++j) { b->hash[j] = _CEXDS_HASH_EMPTY; }
+        for (j = 0; j < _CEXDS_BUCKET_LENGTH; ++j) { b->index[j] = _CEXDS_INDEX_EMPTY; }
     }
-    return NULL;
 }
 
-void*
-_cexds__hminit(
-    usize elemsize,
+static _cexds__hash_index*
+_cexds__make_hash_index(
+    usize slot_count,
+    _cexds__hash_index* old_table,
     IAllocator allc,
-    enum _CexDsKeyType_e key_type,
-    u16 el_align,
-    struct _cexds__hm_new_kwargs_s* kwargs
+    usize hash_seed,
+    enum _CexDsKeyType_e key_type
 )
 {
-    usize capacity = 0;
-    usize hm_seed = 0xBadB0dee;
-    bool copy_keys = false;
-
-    if (kwargs) {
-        capacity = kwargs->capacity;
-        hm_seed = kwargs->seed ? kwargs->seed : hm_seed;
-        copy_keys = kwargs->copy_keys;
-    }
-    void* a = _cexds__arrgrowf(NULL, elemsize, 0, capacity, el_align, allc);
-    if (a == NULL) {
+    _cexds__hash_index* t = mem$calloc(
+        allc,
+        1,
+        (slot_count >> _CEXDS_BUCKET_SHIFT) * sizeof(_cexds__hash_bucket) +
+            sizeof(_cexds__hash_index) + _CEXDS_CACHE_LINE_SIZE - 1
+    );
+    if (t == NULL) {
         return NULL; // memory error
     }
+    t->storage = (_cexds__hash_bucket*)mem$aligned_pointer((usize)(t + 1), _CEXDS_CACHE_LINE_SIZE);
+    t->slot_count = slot_count;
+    t->slot_count_log2 = _cexds__log2(slot_count);
+    t->tombstone_count = 0;
+    t->used_count = 0;
+    t->key_type = key_type;
+    t->seed = hash_seed;
 
-    uassert(_cexds__header(a)->magic_num == _CEXDS_ARR_MAGIC);
-    uassert(_cexds__header(a)->_hash_table == NULL);
-
-    _cexds__header(a)->magic_num = _CEXDS_HM_MAGIC;
+    // compute without overflowing
+    t->used_count_threshold = slot_count - (slot_count >> 2);
+    t->tombstone_count_threshold = (slot_count >> 3) + (slot_count >> 4);
+    t->used_count_shrink_threshold = slot_count >> 2;
 
-    _cexds__hash_index* table = _cexds__header(a)->_hash_table;
+    if (slot_count <= _CEXDS_BUCKET_LENGTH) { t->used_count_shrink_threshold = 0; }
+    // to avoid infinite loop, we need to guarantee that at least one slot is empty and will
+    // terminate probes
+    uassert(t->used_count_threshold + t->tombstone_count_threshold < t->slot_count);
+    _CEXDS_STATS(++_cexds__hash_alloc);
 
-    // ensure slot counts must be pow of 2
-    uassert(mem$is_power_of2(arr$cap(a)));
-    table = _cexds__header(a)->_hash_table = _cexds__make_hash_index(
-        arr$cap(a),
-        NULL,
-        _cexds__header(a)->allocator,
-        hm_seed,
-        key_type
-    );
+    _cexds__hmclear_func(t, old_table);
 
-    if (table) {
-        // NEW Table initialization here
-        if (copy_keys) {
-            uassert(table->key_type == _CexDsKeyType__charptr && "Only char* keys supported");
-        }
-        table->copy_keys = copy_keys;
-        if (kwargs->copy_keys_arena_pgsize > 0) {
-            table->key_arena = AllocatorArena.create(kwargs->copy_keys_arena_pgsize);
-        }
-    }
+    // copy out the old data, if any
+    if (old_table) {
+        usize i, j;
+        t->used_count = old_table->used_count;
+        for (i = 0; i < old_table->slot_count >> _CEXDS_BUCKET_SHIFT; ++i) {
+            _cexds__hash_bucket* ob = &old_table->storage[i];
+            for (j = 0; j < _CEXDS_BUCKET_LENGTH; ++j) {
+                if (_CEXDS_INDEX_IN_USE(ob->index[j])) {
+                    usize hash = ob->hash[j];
+                    usize pos = _cexds__probe_position(hash, t->slot_count, t->slot_count_log2);
+                    usize step = _CEXDS_BUCKET_LENGTH;
+                    _CEXDS_STATS(++_cexds__rehash_items);
+                    for (;;) {
+                        usize limit, z;
+                        _cexds__hash_bucket* bucket;
+                        bucket = &t->storage[pos >> _CEXDS_BUCKET_SHIFT];
+                        _CEXDS_STATS(++_cexds__rehash_probes);
 
-    return a;
-}
+                        for (z = pos & _CEXDS_BUCKET_MASK; z < _CEXDS_BUCKET_LENGTH; ++z) {
+                            if (bucket->hash[z] == 0) {
+                                bucket->hash[z] = hash;
+                                bucket->index[z] = ob->index[j];
+                                goto done;
+                            }
+                        }
 
+                        limit = pos & _CEXDS_BUCKET_MASK;
+                        for (z = 0; z < limit; ++z) {
+                            if (bucket->hash[z] == 0) {
+                                bucket->hash[z] = hash;
+                                bucket->index[z] = ob->index[j];
+                                goto done;
+                            }
+                        }
 
-void*
-_cexds__hmput_key(
-    void* a,
+                        pos += step; // quadratic probing
+                        step += _CEXDS_BUCKET_LENGTH;
+                        pos &= (t->slot_count - 1);
+                    }
+                }
+            done:;
+            }
+        }
+    }
+
+    return t;
+}
+
+#define _CEXDS_ROTATE_LEFT(val, n) (((val) << (n)) | ((val) >> (_CEXDS_usize_BITS - (n))))
+#define _CEXDS_ROTATE_RIGHT(val, n) (((val) >> (n)) | ((val) << (_CEXDS_usize_BITS - (n))))
+
+
+#ifdef _CEXDS_SIPHASH_2_4
+#    define _CEXDS_SIPHASH_C_ROUNDS 2
+#    define _CEXDS_SIPHASH_D_ROUNDS 4
+typedef int _CEXDS_SIPHASH_2_4_can_only_be_used_in_64_bit_builds[sizeof(usize) == 8 ? 1 : -1];
+#endif
+
+#ifndef _CEXDS_SIPHASH_C_ROUNDS
+#    define _CEXDS_SIPHASH_C_ROUNDS 1
+#endif
+#ifndef _CEXDS_SIPHASH_D_ROUNDS
+#    define _CEXDS_SIPHASH_D_ROUNDS 1
+#endif
+
+static inline usize
+_cexds__hash_string(const char* str, usize str_cap, usize seed)
+{
+    usize hash = seed;
+    // NOTE: using max buffer capacity capping, this allows using hash
+    //       on char buf[N] - without stack overflowing
+    for (usize i = 0; i < str_cap && *str; i++) {
+        hash = _CEXDS_ROTATE_LEFT(hash, 9) + (unsigned char)*str++;
+    }
+
+    // Thomas Wang 64-to-32 bit mix function, hopefully also works in 32 bits
+    hash ^= seed;
+    hash = (~hash) + (hash << 18);
+    hash ^= hash ^ _CEXDS_ROTATE_RIGHT(hash, 31);
+    hash = hash * 21;
+    hash ^= hash ^ _CEXDS_ROTATE_RIGHT(hash, 11);
+    hash += (hash << 6);
+    hash ^= _CEXDS_ROTATE_RIGHT(hash, 22);
+    return hash + seed;
+}
+
+static inline usize
+_cexds__siphash_bytes(const void* p, usize len, usize seed)
+{
+    // hash that works on 32- or 64-bit registers without knowing which we have
+    // (computes different results on 32-bit and 64-bit platform)
+    // derived from siphash, but on 32-bit platforms very different as it uses 4 32-bit state not 4
+    // 64-bit
+    usize v0 = ((((usize)0x736f6d65 << 16) << 16) + 0x70736575) ^ seed;
+    usize v1 = ((((usize)0x646f7261 << 16) << 16) + 0x6e646f6d) ^ ~seed;
+    usize v2 = ((((usize)0x6c796765 << 16) << 16) + 0x6e657261) ^ seed;
+    usize v3 = ((((usize)0x74656462 << 16) << 16) + 0x79746573) ^ ~seed;
+
+#ifdef _CEXDS_TEST_SIPHASH_2_4
+    // hardcoded with key material in the siphash test vectors
+    v0 ^= 0x0706050403020100ull ^ seed;
+    v1 ^= 0x0f0e0d0c0b0a0908ull ^ ~seed;
+    v2 ^= 0x0706050403020100ull ^ seed;
+    v3 ^= 0x0f0e0d0c0b0a0908ull ^ ~seed;
+#endif
+
+#define _CEXDS_SIPROUND()                                                                          \
+    do {                                                                                           \
+        v0 += v1;                                                                                  \
+        v1 = _CEXDS_ROTATE_LEFT(v1, 13);                                                           \
+        v1 ^= v0;                                                                                  \
+        v0 = _CEXDS_ROTATE_LEFT(v0, _CEXDS_usize_BITS / 2);                                        \
+        v2 += v3;                                                                                  \
+        v3 = _CEXDS_ROTATE_LEFT(v3, 16);                                                           \
+        v3 ^= v2;                                                                                  \
+        v2 += v1;                                                                                  \
+        v1 = _CEXDS_ROTATE_LEFT(v1, 17);                                                           \
+        v1 ^= v2;                                                                                  \
+        v2 = _CEXDS_ROTATE_LEFT(v2, _CEXDS_usize_BITS / 2);                                        \
+        v0 += v3;                                                                                  \
+        v3 = _CEXDS_ROTATE_LEFT(v3, 21);                                                           \
+        v3 ^= v0;                                                                                  \
+    } while (0)
+
+    unsigned char* d = (unsigned char*)p;
+    usize data = 0;
+    usize i = 0;
+    usize j = 0;
+    for (i = 0; i + sizeof(usize) <= len; i += sizeof(usize), d += sizeof(usize)) {
+        data = (usize)d[0] | ((usize)d[1] << 8) | ((usize)d[2] << 16) | ((usize)d[3] << 24);
+
+#if UINTPTR_MAX > 0xFFFFFFFFU
+        // 64 bits only
+        data |= (usize)(d[4] | (d[5] << 8) | (d[6] << 16) | (d[7] << 24)) << 16 << 16;
+#endif
+
+        v3 ^= data;
+        for (j = 0; j < _CEXDS_SIPHASH_C_ROUNDS; ++j) { _CEXDS_SIPROUND(); }
+        v0 ^= data;
+    }
+    data = len << (_CEXDS_usize_BITS - 8);
+    switch (len - i) {
+        case 7:
+            data |= ((usize)d[6] << 24) << 24; // fall through
+        case 6:
+            data |= ((usize)d[5] << 20) << 20; // fall through
+        case 5:
+            data |= ((usize)d[4] << 16) << 16; // fall through
+        case 4:
+            data |= (d[3] << 24); // fall through
+        case 3:
+            data |= (d[2] << 16); // fall through
+        case 2:
+            data |= (d[1] << 8); // fall through
+        case 1:
+            data |= d[0]; // fall through
+        case 0:
+            break;
+    }
+    v3 ^= data;
+    for (j = 0; j < _CEXDS_SIPHASH_C_ROUNDS; ++j) { _CEXDS_SIPROUND(); }
+    v0 ^= data;
+    v2 ^= 0xff;
+    for (j = 0; j < _CEXDS_SIPHASH_D_ROUNDS; ++j) { _CEXDS_SIPROUND(); }
+
+#ifdef _CEXDS_SIPHASH_2_4
+    return v0 ^ v1 ^ v2 ^ v3;
+#else
+    return v1 ^ v2 ^ v3;
+#endif
+}
+
+static inline usize
+_cexds__hash_bytes(const void* p, usize len, usize seed)
+{
+#ifdef _CEXDS_SIPHASH_2_4
+    return _cexds__siphash_bytes(p, len, seed);
+#else
+    unsigned char* d = (unsigned char*)p;
+
+    if (len == 4) {
+        u32 hash = (u32)d[0] | ((u32)d[1] << 8) | ((u32)d[2] << 16) | ((u32)d[3] << 24);
+        // HASH32-BB  Bob Jenkin's presumably-accidental version of Thomas Wang hash with rotates
+        // turned into shifts. Note that converting these back to rotates makes it run a lot slower,
+        // presumably due to collisions, so I'm not really sure what's going on.
+        hash ^= seed;
+        hash = (hash ^ 61) ^ (hash >> 16);
+        hash = hash + (hash << 3);
+        hash = hash ^ (hash >> 4);
+        hash = hash * 0x27d4eb2d;
+        hash ^= seed;
+        hash = hash ^ (hash >> 15);
+        return (((usize)hash << 16 << 16) | hash) ^ seed;
+    } else if (len == 8 && sizeof(usize) == 8) {
+        usize hash = (usize)d[0] | ((usize)d[1] << 8) | ((usize)d[2] << 16) | ((usize)d[3] << 24);
+
+        hash |= (usize)((usize)d[4] | ((usize)d[5] << 8) | ((usize)d[6] << 16) | ((usize)d[7] << 24))
+             << 16 << 16;
+        hash ^= seed;
+        hash = (~hash) + (hash << 21);
+        hash ^= _CEXDS_ROTATE_RIGHT(hash, 24);
+        hash *= 265;
+        hash ^= _CEXDS_ROTATE_RIGHT(hash, 14);
+        hash ^= seed;
+        hash *= 21;
+        hash ^= _CEXDS_ROTATE_RIGHT(hash, 28);
+        hash += (hash << 31);
+        hash = (~hash) + (hash << 18);
+        return hash;
+    } else {
+        return _cexds__siphash_bytes(p, len, seed);
+    }
+#endif
+}
+
+static inline usize
+_cexds__hash(enum _CexDsKeyType_e key_type, const void* key, usize key_size, usize seed)
+{
+    switch (key_type) {
+        case _CexDsKeyType__generic:
+            return _cexds__hash_bytes(key, key_size, seed);
+
+        case _CexDsKeyType__charptr:
+            // NOTE: we can't know char* length without touching it,
+            // 65536 is a max key length in case of char was not null term
+            return _cexds__hash_string(*(char**)key, 65536, seed);
+
+        case _CexDsKeyType__charbuf:
+            return _cexds__hash_string(key, key_size, seed);
+
+        case _CexDsKeyType__cexstr: {
+            str_s* s = (str_s*)key;
+            return _cexds__hash_string(s->buf, s->len, seed);
+        }
+    }
+    uassert(false && "unexpected key type");
+    abort();
+}
+
+static bool
+_cexds__is_key_equal(
+    void* a,
+    usize elemsize,
+    void* key,
+    usize keysize,
+    usize keyoffset,
+    enum _CexDsKeyType_e key_type,
+    usize i
+)
+{
+    void* hm_key = _cexds__item_ptr(a, i, elemsize) + keyoffset;
+
+    switch (key_type) {
+        case _CexDsKeyType__generic:
+            return 0 == memcmp(key, hm_key, keysize);
+
+        case _CexDsKeyType__charptr:
+            return 0 == strcmp(*(char**)key, *(char**)hm_key);
+        case _CexDsKeyType__charbuf:
+            return 0 == strcmp((char*)key, (char*)hm_key);
+
+        case _CexDsKeyType__cexstr: {
+            str_s* _k = (str_s*)key;
+            str_s* _hm = (str_s*)hm_key;
+            if (_k->len != _hm->len) { return false; }
+            return 0 == memcmp(_k->buf, _hm->buf, _k->len);
+        }
+    }
+    uassert(false && "unexpected key type");
+    abort();
+}
+
+static inline void*
+_cexds__hmkey_ptr(void* a, usize elemsize, usize index, usize keyoffset)
+{
+    _cexds__hash_index* table = (_cexds__hash_index*)_cexds__header(a)->_hash_table;
+    void* key_data_p = NULL;
+    switch (table->key_type) {
+        case _CexDsKeyType__generic:
+            key_data_p = (char*)a + elemsize * index + keyoffset;
+            break;
+
+        case _CexDsKeyType__charbuf:
+            key_data_p = (char*)((char*)a + elemsize * index + keyoffset);
+            break;
+
+        case _CexDsKeyType__charptr:
+            key_data_p = *(char**)((char*)a + elemsize * index + keyoffset);
+            break;
+
+        case _CexDsKeyType__cexstr: {
+            str_s* s = (str_s*)((char*)a + elemsize * index + keyoffset);
+            key_data_p = s;
+            break;
+        }
+        default:
+            unreachable();
+    }
+    return key_data_p;
+}
+
+void
+_cexds__hmfree_keys_func(void* a, usize elemsize, usize keyoffset)
+{
+    _cexds__array_header* h = _cexds__header(a);
+    uassert(h->allocator != NULL);
+    _cexds__hash_index* table = h->_hash_table;
+
+    if (table != NULL) {
+        if (table->copy_keys) {
+            if (table->key_arena == NULL) {
+                for (usize i = 0; i < h->length; ++i) {
+                    h->allocator->free(h->allocator, *(char**)((char*)a + elemsize * i + keyoffset));
+                }
+            } else {
+                uassert(table->key_arena->scope_depth(table->key_arena) > 0);
+                // Exit + enter for arena is equivalent of cleaning up and poisoning
+                table->key_arena->scope_exit(table->key_arena);
+                table->key_arena->scope_enter(table->key_arena);
+            }
+        }
+    }
+}
+void
+_cexds__hmfree_func(void* a, usize elemsize, usize keyoffset)
+{
+    if (a == NULL) { return; }
+    _cexds__arr_integrity(a, _CEXDS_HM_MAGIC);
+
+    _cexds__array_header* h = _cexds__header(a);
+    _cexds__hmfree_keys_func(a, elemsize, keyoffset);
+    if (h->_hash_table->key_arena) { AllocatorArena.destroy(h->_hash_table->key_arena); }
+    h->allocator->free(h->allocator, h->_hash_table);
+    h->allocator->free(h->allocator, _cexds__base(h));
+}
+
+static ptrdiff_t
+_cexds__hm_find_slot(void* a, usize elemsize, void* key, usize keysize, usize keyoffset)
+{
+    _cexds__arr_integrity(a, _CEXDS_HM_MAGIC);
+    _cexds__hash_index* table = _cexds__hash_table(a);
+    enum _CexDsKeyType_e key_type = table->key_type;
+    usize hash = _cexds__hash(key_type, key, keysize, table->seed);
+    usize step = _CEXDS_BUCKET_LENGTH;
+
+    if (hash < 2) {
+        hash += 2; // stored hash values are forbidden from being 0, so we can detect empty slots
+    }
+
+    usize pos = _cexds__probe_position(hash, table->slot_count, table->slot_count_log2);
+
+    // TODO: check when this could be infinite loop (due to overflow or something)?
+    for (;;) {
+        _CEXDS_STATS(++_cexds__hash_probes);
+        _cexds__hash_bucket* bucket = &table->storage[pos >> _CEXDS_BUCKET_SHIFT];
+
+        // start searching from pos to end of bucket, this should help performance on small hash
+        // tables that fit in cache
+        for (usize i = pos & _CEXDS_BUCKET_MASK; i < _CEXDS_BUCKET_LENGTH; ++i) {
+            if (bucket->hash[i] == hash) {
+                if (_cexds__is_key_equal(
+                        a,
+                        elemsize,
+                        key,
+                        keysize,
+                        keyoffset,
+                        key_type,
+                        bucket->index[i]
+                    )) {
+                    return (pos & ~_CEXDS_BUCKET_MASK) + i;
+                }
+            } else if (bucket->hash[i] == _CEXDS_HASH_EMPTY) {
+                return -1;
+            }
+        }
+
+        // search from beginning of bucket to pos
+        usize limit = pos & _CEXDS_BUCKET_MASK;
+        for (usize i = 0; i < limit; ++i) {
+            if (bucket->hash[i] == hash) {
+                if (_cexds__is_key_equal(
+                        a,
+                        elemsize,
+                        key,
+                        keysize,
+                        keyoffset,
+                        key_type,
+                        bucket->index[i]
+                    )) {
+                    return (pos & ~_CEXDS_BUCKET_MASK) + i;
+                }
+            } else if (bucket->hash[i] == _CEXDS_HASH_EMPTY) {
+                return -1;
+            }
+        }
+
+        // quadratic probing
+        pos += step;
+        step += _CEXDS_BUCKET_LENGTH;
+        pos &= (table->slot_count - 1);
+    }
+}
+
+void*
+_cexds__hmget_key(void* a, usize elemsize, void* key, usize keysize, usize keyoffset)
+{
+    _cexds__arr_integrity(a, _CEXDS_HM_MAGIC);
+
+    _cexds__hash_index* table = (_cexds__hash_index*)_cexds__header(a)->_hash_table;
+    if (table != NULL) {
+        ptrdiff_t slot = _cexds__hm_find_slot(a, elemsize, key, keysize, keyoffset);
+        if (slot >= 0) {
+            _cexds__hash_bucket* b = &table->storage[slot >> _CEXDS_BUCKET_SHIFT];
+            usize idx = b->index[slot & _CEXDS_BUCKET_MASK];
+            return ((char*)a + elemsize * idx);
+        }
+    }
+    return NULL;
+}
+
+void*
+_cexds__hminit(
+    usize elemsize,
+    IAllocator allc,
+    enum _CexDsKeyType_e key_type,
+    u16 el_align,
+    struct _cexds__hm_new_kwargs_s* kwargs
+)
+{
+    usize capacity = 0;
+    usize hm_seed = 0xBadB0dee;
+    bool copy_keys = false;
+
+    if (kwargs) {
+        capacity = kwargs->capacity;
+        hm_seed = kwargs->seed ? kwargs->seed : hm_seed;
+        copy_keys = kwargs->copy_keys;
+    }
+    void* a = _cexds__arrgrowf(NULL, elemsize, 0, capacity, el_align, allc);
+    if (a == NULL) {
+        return NULL; // memory error
+    }
+
+    uassert(_cexds__header(a)->magic_num == _CEXDS_ARR_MAGIC);
+    uassert(_cexds__header(a)->_hash_table == NULL);
+
+    _cexds__header(a)->magic_num = _CEXDS_HM_MAGIC;
+
+    _cexds__hash_index* table = _cexds__header(a)->_hash_table;
+
+    // ensure slot counts must be pow of 2
+    uassert(mem$is_power_of2(arr$cap(a)));
+    table = _cexds__header(a)->_hash_table = _cexds__make_hash_index(
+        arr$cap(a),
+        NULL,
+        _cexds__header(a)->allocator,
+        hm_seed,
+        key_type
+    );
+
+    if (table) {
+        // NEW Table initialization here
+        if (copy_keys) {
+            uassert(table->key_type == _CexDsKeyType__charptr && "Only char* keys supported");
+        }
+        table->copy_keys = copy_keys;
+        if (kwargs->copy_keys_arena_pgsize > 0) {
+            table->key_arena = AllocatorArena.create(kwargs->copy_keys_arena_pgsize);
+        }
+    }
+
+    return a;
+}
+
+
+void*
+_cexds__hmput_key(
+    void* a,
     usize elemsize,
     void* key,
     usize keysize,
@@ -9338,24 +10087,166 @@ _cex_str__isvalid(str_s* s)
     return s->buf != NULL;
 }
 
+// NOTE: SIMD is selected at compile time (e.g. -mavx2 or -march=native for AVX2, x86_64 always
+// has SSE2). _cex_str__vmask() returns bitmask of matching bytes, _CEX_STR_VSHIFT bits per byte.
+#if !defined(CEX_STR_NOSIMD) && defined(__AVX2__)
+#    include <immintrin.h>
+#    define _CEX_STR_VLEN 32
+#    define _CEX_STR_VSHIFT 0
+typedef __m256i _cex_str_vec_t;
+#    define _cex_str__vsplat(c) _mm256_set1_epi8(c)
+#    define _cex_str__vload(p) _mm256_loadu_si256((const __m256i*)(p))
+#    define _cex_str__veq(a, b) _mm256_cmpeq_epi8(a, b)
+#    define _cex_str__vand(a, b) _mm256_and_si256(a, b)
+#    define _cex_str__vor(a, b) _mm256_or_si256(a, b)
+#    define _cex_str__vmask(v) ((u64)(u32)_mm256_movemask_epi8(v))
+#elif !defined(CEX_STR_NOSIMD) && defined(__SSE2__)
+#    include <emmintrin.h>
+#    define _CEX_STR_VLEN 16
+#    define _CEX_STR_VSHIFT 0
+typedef __m128i _cex_str_vec_t;
+#    define _cex_str__vsplat(c) _mm_set1_epi8(c)
+#    define _cex_str__vload(p) _mm_loadu_si128((const __m128i*)(p))
+#    define _cex_str__veq(a, b) _mm_cmpeq_epi8(a, b)
+#    define _cex_str__vand(a, b) _mm_and_si128(a, b)
+#    define _cex_str__vor(a, b) _mm_or_si128(a, b)
+#    define _cex_str__vmask(v) ((u64)(u32)_mm_movemask_epi8(v))
+#elif !defined(CEX_STR_NOSIMD) && defined(__ARM_NEON)
+#    include <arm_neon.h>
+#    define _CEX_STR_VLEN 16
+#    define _CEX_STR_VSHIFT 2
+typedef uint8x16_t _cex_str_vec_t;
+#    define _cex_str__vsplat(c) vdupq_n_u8((u8)(c))
+#    define _cex_str__vload(p) vld1q_u8((const u8*)(p))
+#    define _cex_str__veq(a, b) vceqq_u8(a, b)
+#    define _cex_str__vand(a, b) vandq_u8(a, b)
+#    define _cex_str__vor(a, b) vorrq_u8(a, b)
+// NOTE: no movemask on NEON, narrowing shift gives 4 bits per byte, one of them is kept
+#    define _cex_str__vmask(v)                                                                     \
+        (vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0) &         \
+         0x8888888888888888ULL)
+#endif
+
+/// Index of the first char of `s` which is one of `c` (`clen` chars), or -1
 static inline isize
 _cex_str__index(str_s* s, char* c, u8 clen)
 {
-    isize result = -1;
+    if (!_cex_str__isvalid(s) || clen == 0) { return -1; }
+    if (clen == 1) {
+        char* p = memchr(s->buf, c[0], s->len);
+        return (p) ? p - s->buf : -1;
+    }
+
+    usize i = 0;
+#ifdef _CEX_STR_VLEN
+    if (clen <= 8) {
+        _cex_str_vec_t split_by[8];
+        for (u8 k = 0; k < clen; k++) { split_by[k] = _cex_str__vsplat(c[k]); }
+        for (; i + _CEX_STR_VLEN <= s->len; i += _CEX_STR_VLEN) {
+            _cex_str_vec_t v = _cex_str__vload(s->buf + i);
+            _cex_str_vec_t hits = _cex_str__veq(v, split_by[0]);
+            for (u8 k = 1; k < clen; k++) { hits = _cex_str__vor(hits, _cex_str__veq(v, split_by[k])); }
+            u64 mask = _cex_str__vmask(hits);
+            if (mask) { return i + (__builtin_ctzll(mask) >> _CEX_STR_VSHIFT); }
+        }
+    }
+#endif
+    u64 split_by_bits[4] = { 0 };
+    for (u8 k = 0; k < clen; k++) { split_by_bits[(u8)c[k] >> 6] |= 1ULL << ((u8)c[k] & 63); }
+    for (; i < s->len; i++) {
+        u8 ch = s->buf[i];
+        if ((split_by_bits[ch >> 6] >> (ch & 63)) & 1) { return i; }
+    }
+    return -1;
+}
 
-    if (!_cex_str__isvalid(s)) { return -1; }
+#ifdef _CEX_STR_VLEN
+/// Vector of candidate positions `p[0.._CEX_STR_VLEN)` for needle search, where both first and last
+/// bytes of the needle match
+#    define _cex_str__vcandidates(p, first, last, nlen)                                            \
+        _cex_str__vand(                                                                            \
+            _cex_str__veq(first, _cex_str__vload(p)),                                              \
+            _cex_str__veq(last, _cex_str__vload((p) + (nlen) - 1))                                 \
+        )
+#endif
 
-    u8 split_by_idx[UINT8_MAX] = { 0 };
-    for (u8 i = 0; i < clen; i++) { split_by_idx[(u8)c[i]] = 1; }
+/// memmem() analog, index of the first `needle` in `s` or -1. Only candidate positions (first and
+/// last bytes match, 2 vectors per step) are compared with needle.
+static isize
+_cex_str__memmem(char* s, usize slen, char* needle, usize nlen)
+{
+    if (nlen == 0 || nlen > slen) { return -1; }
+    if (nlen == 1) {
+        char* p = memchr(s, needle[0], slen);
+        return (p) ? p - s : -1;
+    }
 
-    for (usize i = 0; i < s->len; i++) {
-        if (split_by_idx[(u8)s->buf[i]]) {
-            result = i;
-            break;
+    usize i = 0;
+    usize n_cand = slen - nlen + 1;
+#ifdef _CEX_STR_VLEN
+    _cex_str_vec_t first = _cex_str__vsplat(needle[0]);
+    _cex_str_vec_t last = _cex_str__vsplat(needle[nlen - 1]);
+    for (; i + 2 * _CEX_STR_VLEN <= n_cand; i += 2 * _CEX_STR_VLEN) {
+        _cex_str_vec_t hits[2] = {
+            _cex_str__vcandidates(s + i, first, last, nlen),
+            _cex_str__vcandidates(s + i + _CEX_STR_VLEN, first, last, nlen),
+        };
+        if (likely(!_cex_str__vmask(_cex_str__vor(hits[0], hits[1])))) { continue; }
+        for (u32 k = 0; k < 2; k++) {
+            for (u64 mask = _cex_str__vmask(hits[k]); mask; mask &= mask - 1) {
+                usize j = i + k * _CEX_STR_VLEN + (__builtin_ctzll(mask) >> _CEX_STR_VSHIFT);
+                if (memcmp(s + j + 1, needle + 1, nlen - 2) == 0) { return j; }
+            }
+        }
+    }
+#endif
+    while (i < n_cand) {
+        char* p = memchr(s + i, needle[0], n_cand - i);
+        if (p == NULL) { break; }
+        usize j = p - s;
+        if (s[j + nlen - 1] == needle[nlen - 1] && memcmp(p + 1, needle + 1, nlen - 2) == 0) {
+            return j;
         }
+        i = j + 1;
     }
+    return -1;
+}
 
-    return result;
+/// Index of the last `needle` in `s` or -1, same as _cex_str__memmem() scanning backwards.
+static isize
+_cex_str__memrmem(char* s, usize slen, char* needle, usize nlen)
+{
+    if (nlen == 0 || nlen > slen) { return -1; }
+
+    usize n_cand = slen - nlen + 1; // candidates left, [0, n_cand)
+#ifdef _CEX_STR_VLEN
+    _cex_str_vec_t first = _cex_str__vsplat(needle[0]);
+    _cex_str_vec_t last = _cex_str__vsplat(needle[nlen - 1]);
+    for (; n_cand >= 2 * _CEX_STR_VLEN; n_cand -= 2 * _CEX_STR_VLEN) {
+        usize i = n_cand - 2 * _CEX_STR_VLEN;
+        _cex_str_vec_t hits[2] = {
+            _cex_str__vcandidates(s + i, first, last, nlen),
+            _cex_str__vcandidates(s + i + _CEX_STR_VLEN, first, last, nlen),
+        };
+        if (likely(!_cex_str__vmask(_cex_str__vor(hits[0], hits[1])))) { continue; }
+        for (u32 k = 2; k-- > 0;) {
+            for (u64 mask = _cex_str__vmask(hits[k]); mask;) {
+                u32 bit = 63 - __builtin_clzll(mask);
+                usize j = i + k * _CEX_STR_VLEN + (bit >> _CEX_STR_VSHIFT);
+                if (nlen == 1 || memcmp(s + j + 1, needle + 1, nlen - 2) == 0) { return j; }
+                mask &= ~(1ULL << bit);
+            }
+        }
+    }
+#endif
+    while (n_cand-- > 0) {
+        char* p = s + n_cand;
+        if (p[0] == needle[0] && p[nlen - 1] == needle[nlen - 1] &&
+            (nlen == 1 || memcmp(p + 1, needle + 1, nlen - 2) == 0)) {
+            return n_cand;
+        }
+    }
+    return -1;
 }
 
 /// Creates string slice of input C string (NULL tolerant, (str_s){0} on error)
@@ -9590,17 +10481,8 @@ char*
 cex_str_findr(char* haystack, char* needle)
 {
     if (unlikely(haystack == NULL || needle == NULL || needle[0] == '\0')) { return NULL; }
-    usize haystack_len = strlen(haystack);
-    usize needle_len = strlen(needle);
-    if (unlikely(needle_len > haystack_len)) { return NULL; }
-    for (char* ptr = haystack + haystack_len - needle_len; ptr >= haystack; ptr--) {
-        if (unlikely(strncmp(ptr, needle, needle_len) == 0)) {
-            uassert(ptr >= haystack);
-            uassert(ptr <= haystack + haystack_len);
-            return (char*)ptr;
-        }
-    }
-    return NULL;
+    isize idx = _cex_str__memrmem(haystack, strlen(haystack), needle, strlen(needle));
+    return (idx < 0) ? NULL : haystack + idx;
 }
 
 /// Get index of first occurrence of `needle`, returns -1 on error.
@@ -9608,17 +10490,7 @@ static isize
 cex_str__slice__index_of(str_s s, str_s needle)
 {
     if (unlikely(!s.buf || !needle.buf || needle.len == 0 || needle.len > s.len)) { return -1; }
-    if (unlikely(needle.len == 1)) {
-        char n = needle.buf[0];
-        for (usize i = 0; i < s.len; i++) {
-            if (s.buf[i] == n) { return i; }
-        }
-    } else {
-        for (usize i = 0; i <= s.len - needle.len; i++) {
-            if (memcmp(&s.buf[i], needle.buf, needle.len) == 0) { return i; }
-        }
-    }
-    return -1;
+    return _cex_str__memmem(s.buf, s.len, needle.buf, needle.len);
 }
 
 /// Checks if slice starts with prefix, returns (str_s){0} on error, NULL tolerant
@@ -10583,28 +11455,20 @@ static arr$(char*) cex_str_split_lines(char* s, IAllocator allc)
     if (s == NULL) { return NULL; }
     arr$(char*) result = arr$new(result, allc);
     if (result == NULL) { return NULL; }
-    char c;
     char* line_start = s;
-    char* cur = s;
-    while ((c = *cur)) {
-        switch (c) {
-            case '\r':
-                if (cur[1] == '\n') { goto default_next; }
-                fallthrough();
-            case '\n':
-            case '\v':
-            case '\f': {
-                str_s line = { .buf = (char*)line_start, .len = cur - line_start };
-                if (line.len > 0 && line.buf[line.len - 1] == '\r') { line.len--; }
-                char* tok = cex_str__slice__clone(line, allc);
-                arr$push(result, tok);
-                line_start = cur + 1;
-            }
-                fallthrough();
-            default:
-            default_next:
-                cur++;
-        }
+    str_s rest = { .buf = s, .len = strlen(s) };
+    isize idx;
+    while ((idx = _cex_str__index(&rest, "\n\r\v\f", 4)) >= 0) {
+        char* cur = rest.buf + idx;
+        rest.buf = cur + 1;
+        rest.len -= idx + 1;
+        if (*cur == '\r' && cur[1] == '\n') { continue; } // NOTE: \r\n, line ends at \n
+
+        str_s line = { .buf = line_start, .len = cur - line_start };
+        if (line.len > 0 && line.buf[line.len - 1] == '\r') { line.len--; }
+        char* tok = cex_str__slice__clone(line, allc);
+        arr$push(result, tok);
+        line_start = cur + 1;
     }
     return result;
 }
@@ -10814,44 +11678,409 @@ _cex_str_match(char* str, isize str_len, char* pattern)
                         }
                     }
                 }
-
-                if (str_len == 0) {
-                    // str end reached, pattern also must be at end (null-term)
-                    return *pattern == '\0';
+
+                if (str_len == 0) {
+                    // str end reached, pattern also must be at end (null-term)
+                    return *pattern == '\0';
+                }
+                break;
+            }
+
+            case '\\':
+                // Escape next character
+                pattern++;
+                if (*pattern == '\0') { return false; }
+                fallthrough();
+
+            default:
+                if (*pattern && str_len == 0) { return false; }
+                if (*pattern != *str) { return false; }
+                str++;
+                str_len--;
+                pattern++;
+        }
+    }
+
+    return str_len == 0;
+}
+
+enum _cex_str_pattern_kind_e
+{
+    _CexStrPattern__literal,
+    _CexStrPattern__any,        // ?
+    _CexStrPattern__class,      // [abc]
+    _CexStrPattern__any_star,   // * (self loop)
+    _CexStrPattern__class_star, // [abc+] after the 1st char (self loop)
+};
+
+static bool
+_cex_str__pattern__node(str_pattern_c* self, u8 kind, u8 arg)
+{
+    if (unlikely(self->n_nodes >= arr$len(self->nodes))) { return false; }
+    u8 i = self->n_nodes++;
+    bool is_loop = kind == _CexStrPattern__any_star || kind == _CexStrPattern__class_star;
+    self->nodes[i] = (typeof(self->nodes[0])){
+        .kind = kind,
+        .arg = arg,
+        .next = is_loop ? i : i + 1,
+        .skip_chr = -1,
+    };
+    return true;
+}
+
+static Exception
+_cex_str__pattern__class(str_pattern_c* self, char** pattern, u64* eps_edges)
+{
+    char* p = *pattern + 1; // skip '['
+    if (unlikely(self->n_classes >= arr$len(self->classes))) { return Error.overflow; }
+    u8 cls = self->n_classes++;
+    u64* bits = self->classes[cls];
+    memset(bits, 0, sizeof(self->classes[0]));
+
+    bool negate = false;
+    bool repeating = false;
+    if (*p == '!') {
+        negate = true;
+        p++;
+        if (unlikely(*p == ']')) { return Error.argument; } // expected some chars after [!..]
+    }
+    while (*p != ']' && *p != '\0') {
+        if (p[1] == '-' && p[2] != ']' && p[2] != '\0') {
+            // Character ranges like a-zA-Z0-9
+            u8 lo = p[0];
+            u8 hi = p[2];
+            if (unlikely(lo > hi)) { return Error.argument; }
+            for (u32 c = lo; c <= hi; c++) { bits[c >> 6] |= 1ULL << (c & 63); }
+            p += 3;
+        } else if (*p == '\\') {
+            p++;
+            if (*p != '\0') {
+                bits[(u8)*p >> 6] |= 1ULL << ((u8)*p & 63);
+                p++;
+            }
+        } else if (*p == '+' && p[1] == ']') {
+            repeating = true; // [a-z+] one or more chars
+            p++;
+        } else {
+            bits[(u8)*p >> 6] |= 1ULL << ((u8)*p & 63);
+            p++;
+        }
+    }
+    if (unlikely(*p != ']')) { return Error.argument; } // no closing ']'
+    if (negate) {
+        for (u32 i = 0; i < arr$len(self->classes[0]); i++) { bits[i] = ~bits[i]; }
+    }
+
+    if (!_cex_str__pattern__node(self, _CexStrPattern__class, cls)) { return Error.overflow; }
+    if (repeating) {
+        if (!_cex_str__pattern__node(self, _CexStrPattern__class_star, cls)) {
+            return Error.overflow;
+        }
+        eps_edges[self->n_nodes - 1] |= 1ULL << self->n_nodes;
+    }
+    *pattern = p + 1;
+    return EOK;
+}
+
+static Exception
+_cex_str__pattern__group(str_pattern_c* self, char** pattern, u64* eps_edges)
+{
+    char* p = *pattern + 1; // skip '('
+    if (unlikely(*p == ')')) { return Error.argument; } // empty '()' group
+
+    // NOTE: group entry state is the 1st node of the 1st alternative, it has epsilon edges to
+    // the other alternatives, last node of each alternative goes to the group end
+    u8 entry = self->n_nodes;
+    u8 alt_last[sizeof(self->nodes) / sizeof(self->nodes[0])];
+    u32 n_alts = 0;
+    bool has_empty = false;
+    for (;;) {
+        u8 alt_start = self->n_nodes;
+        while (*p != '|' && *p != ')' && *p != '\0') {
+            if (*p == '\\') {
+                p++;
+                if (unlikely(*p == '\0')) { return Error.argument; }
+            }
+            if (!_cex_str__pattern__node(self, _CexStrPattern__literal, *p)) {
+                return Error.overflow;
+            }
+            p++;
+        }
+        if (unlikely(*p == '\0')) { return Error.argument; } // no closing ')'
+        if (self->n_nodes == alt_start) {
+            has_empty = true;
+        } else {
+            eps_edges[entry] |= 1ULL << alt_start;
+            alt_last[n_alts++] = self->n_nodes - 1;
+        }
+        if (*p++ == ')') { break; }
+    }
+    u8 end = self->n_nodes;
+    if (unlikely(end == entry)) { return Error.argument; }
+    for (u32 i = 0; i < n_alts; i++) { self->nodes[alt_last[i]].next = end; }
+    if (has_empty) { eps_edges[entry] |= 1ULL << end; }
+    eps_edges[entry] &= ~(1ULL << entry);
+
+    *pattern = p;
+    return EOK;
+}
+
+/// Compiles str.match() pattern into reusable matcher (no allocations, `pattern` must outlive
+/// `self`). Literal and `prefix*suffix` patterns are checked by memcmp(), others by a state
+/// machine which is linear to string length (no backtracking).
+static Exception
+cex_str__pattern__compile(str_pattern_c* self, char* pattern)
+{
+    uassert(self != NULL);
+    if (pattern == NULL) { return Error.argument; }
+
+    // NOTE: one pass instead of strcspn() and friends, compile is a part of every str.match()
+    char* first = NULL;     // 1st wildcard
+    char* last_star = NULL; // last '*'
+    char* last_special = NULL;
+    char* p = pattern;
+    for (; *p != '\0'; p++) {
+        switch (*p) {
+            case '*':
+                last_star = p;
+                fallthrough();
+            case '?':
+            case '[':
+            case '(':
+            case '\\':
+                if (first == NULL) { first = p; }
+                fallthrough();
+            case ']':
+            case ')':
+            case '|':
+                last_special = p;
+                break;
+            default:
+                break;
+        }
+    }
+    self->prefix = (str_s){ .buf = pattern, .len = (first ? first : p) - pattern };
+    self->suffix = (str_s){ .buf = p, .len = 0 };
+    self->is_literal = first == NULL;
+    self->is_simple = false;
+    self->n_nodes = 0;
+    self->n_classes = 0;
+    if (self->is_literal) { return EOK; }
+
+    // NOTE: the last '*' may be inside [] or (), tail must have no closing brackets too
+    if (last_star != NULL && last_special == last_star) {
+        self->suffix = (str_s){ .buf = last_star + 1, .len = p - last_star - 1 };
+        // NOTE: `prefix*suffix` (or `prefix**suffix`)
+        self->is_simple = true;
+        for (char* c = first; c < last_star; c++) {
+            if (*c != '*') {
+                self->is_simple = false;
+                break;
+            }
+        }
+        if (self->is_simple) { return EOK; }
+    }
+
+    // NOTE: one node per pattern char at most, + accept state
+    u64 eps_edges[sizeof(self->eps) / sizeof(self->eps[0])];
+    usize n_edges = (usize)(p - pattern) + 1;
+    if (n_edges > arr$len(eps_edges)) { n_edges = arr$len(eps_edges); }
+    memset(eps_edges, 0, sizeof(eps_edges[0]) * n_edges);
+
+    p = pattern;
+    while (*p != '\0') {
+        switch (*p) {
+            case '*':
+                while (*p == '*' || *p == '?') {
+                    if (*p == '?' && !_cex_str__pattern__node(self, _CexStrPattern__any, 0)) {
+                        return Error.overflow;
+                    }
+                    p++;
+                }
+                if (!_cex_str__pattern__node(self, _CexStrPattern__any_star, 0)) {
+                    return Error.overflow;
+                }
+                eps_edges[self->n_nodes - 1] |= 1ULL << self->n_nodes;
+                break;
+            case '?':
+                if (!_cex_str__pattern__node(self, _CexStrPattern__any, 0)) {
+                    return Error.overflow;
+                }
+                p++;
+                break;
+            case '[':
+                e$except_silent (err, _cex_str__pattern__class(self, &p, eps_edges)) {
+                    return err;
+                }
+                break;
+            case '(':
+                e$except_silent (err, _cex_str__pattern__group(self, &p, eps_edges)) {
+                    return err;
                 }
                 break;
-            }
-
             case '\\':
-                // Escape next character
-                pattern++;
-                if (*pattern == '\0') { return false; }
+                p++;
+                if (unlikely(*p == '\0')) { return Error.argument; }
                 fallthrough();
-
             default:
-                if (*pattern && str_len == 0) { return false; }
-                if (*pattern != *str) { return false; }
-                str++;
-                str_len--;
-                pattern++;
+                if (!_cex_str__pattern__node(self, _CexStrPattern__literal, *p)) {
+                    return Error.overflow;
+                }
+                p++;
         }
     }
 
-    return str_len == 0;
+    // Epsilon closures, all epsilon edges go forward
+    u32 n = self->n_nodes;
+    for (i32 i = n; i >= 0; i--) {
+        u64 closure = 1ULL << i;
+        for (u64 e = eps_edges[i]; e; e &= e - 1) { closure |= self->eps[__builtin_ctzll(e)]; }
+        self->eps[i] = closure;
+    }
+
+    // `*` states which can be left only by one literal char are skipped by memchr()
+    for (u32 i = 0; i < n; i++) {
+        if (self->nodes[i].kind != _CexStrPattern__any_star) { continue; }
+        u64 rest = self->eps[i] & ~(1ULL << i) & ~(1ULL << n);
+        i16 skip_chr = 256; // NOTE: nothing leaves the state, the rest of string doesn't matter
+        for (; rest; rest &= rest - 1) {
+            u32 j = __builtin_ctzll(rest);
+            if (self->nodes[j].kind != _CexStrPattern__literal ||
+                (skip_chr != 256 && skip_chr != self->nodes[j].arg)) {
+                skip_chr = -1;
+                break;
+            }
+            skip_chr = self->nodes[j].arg;
+        }
+        self->nodes[i].skip_chr = skip_chr;
+    }
+    return EOK;
+}
+
+/// Checks if slice matches compiled pattern (see str.pattern.compile())
+static bool
+cex_str__pattern__matchs(str_pattern_c* self, str_s s)
+{
+    uassert(self != NULL);
+    if (unlikely(s.buf == NULL || s.len == 0)) { return false; }
+    if (s.len < self->prefix.len + self->suffix.len) { return false; }
+    if (memcmp(s.buf, self->prefix.buf, self->prefix.len) != 0) { return false; }
+    if (self->is_literal) { return s.len == self->prefix.len; }
+    char* end = s.buf + s.len;
+    if (memcmp(end - self->suffix.len, self->suffix.buf, self->suffix.len) != 0) { return false; }
+    if (self->is_simple) { return true; }
+
+    // NOTE: literal prefix nodes are already matched
+    u64 accept = 1ULL << self->n_nodes;
+    u64 states = self->eps[self->prefix.len];
+    for (char* c = s.buf + self->prefix.len; c < end;) {
+        u32 lowest = __builtin_ctzll(states);
+        if (states == self->eps[lowest] && lowest < self->n_nodes &&
+            self->nodes[lowest].kind == _CexStrPattern__any_star) {
+            i16 skip_chr = self->nodes[lowest].skip_chr;
+            if (skip_chr == 256) { return states & accept; }
+            if (skip_chr >= 0) {
+                c = memchr(c, skip_chr, end - c);
+                if (c == NULL) { return states & accept; }
+            }
+        }
+
+        u8 ch = *c++;
+        u64 next = 0;
+        for (u64 active = states & ~accept; active; active &= active - 1) {
+            u32 i = __builtin_ctzll(active);
+            bool is_match;
+            switch (self->nodes[i].kind) {
+                case _CexStrPattern__literal:
+                    is_match = ch == self->nodes[i].arg;
+                    break;
+                case _CexStrPattern__class:
+                case _CexStrPattern__class_star:
+                    is_match = (self->classes[self->nodes[i].arg][ch >> 6] >> (ch & 63)) & 1;
+                    break;
+                default:
+                    is_match = true;
+            }
+            if (is_match) { next |= self->eps[self->nodes[i].next]; }
+        }
+        if (next == 0) { return false; }
+        states = next;
+    }
+    return states & accept;
+}
+
+/// Checks if string matches compiled pattern (see str.pattern.compile())
+static bool
+cex_str__pattern__match(str_pattern_c* self, char* s)
+{
+    return cex_str__pattern__matchs(self, str.sstr(s));
 }
 
 /// Slice pattern matching check (see ./cex help str$ for examples)
 static bool
 cex_str__slice__match(str_s s, char* pattern)
 {
-    return _cex_str_match(s.buf, s.len, pattern);
+    uassert(pattern && "null pattern");
+    if (unlikely(s.buf == NULL || s.len == 0)) { return false; }
+
+    // NOTE: str.match() is mostly called in a loop with a few patterns (e.g. `*.[ch]` || `README*`),
+    // compiled ones are cached per thread, the last hit is checked first. Cache entries keep a copy
+    // of the pattern, because caller's pattern buffer may be reused.
+    static _Thread_local struct
+    {
+        struct
+        {
+            str_pattern_c compiled;
+            char pattern[64];
+        } entries[4]; // ~5KB
+        u32 n_entries;
+        u32 last;  // last hit entry
+        u32 evict; // next entry to replace (round-robin)
+    } cache;
+    str_pattern_c tmp;
+    str_pattern_c* compiled = NULL;
+    Exc err = EOK;
+
+    if (likely(cache.n_entries > 0 && strcmp(cache.entries[cache.last].pattern, pattern) == 0)) {
+        compiled = &cache.entries[cache.last].compiled;
+    } else {
+        for (u32 i = 0; i < cache.n_entries; i++) {
+            if (strcmp(cache.entries[i].pattern, pattern) == 0) {
+                cache.last = i;
+                compiled = &cache.entries[i].compiled;
+                break;
+            }
+        }
+    }
+    if (compiled == NULL) {
+        compiled = &tmp;
+        err = cex_str__pattern__compile(compiled, pattern);
+        usize plen = strlen(pattern);
+        if (err == EOK && plen < sizeof(cache.entries[0].pattern)) {
+            u32 i = cache.n_entries < arr$len(cache.entries) ? cache.n_entries++ : cache.evict;
+            cache.evict = (i + 1) % arr$len(cache.entries);
+            cache.last = i;
+            memcpy(cache.entries[i].pattern, pattern, plen + 1);
+            compiled = &cache.entries[i].compiled;
+            *compiled = tmp;
+            // NOTE: prefix / suffix point into the pattern, rebased to the cached copy
+            compiled->prefix.buf = cache.entries[i].pattern + (tmp.prefix.buf - pattern);
+            compiled->suffix.buf = cache.entries[i].pattern + (tmp.suffix.buf - pattern);
+        }
+    }
+    if (likely(err == EOK)) { return cex_str__pattern__matchs(compiled, s); }
+
+    // NOTE: too many states or [] classes for compiled matcher, interpreting
+    if (err == Error.overflow) { return _cex_str_match(s.buf, s.len, pattern); }
+    uassertf(false, "Invalid pattern: '%s'", pattern);
+    return false;
 }
 
 /// String pattern matching check (see ./cex help str$ for examples)
 static bool
 cex_str_match(char* s, char* pattern)
 {
-    return _cex_str_match(s, str.len(s), pattern);
+    return cex_str__slice__match(str.sstr(s), pattern);
 }
 
 /// libc `qsort()` comparator functions, for arrays of `char*`, sorting alphabetical
@@ -10935,6 +12164,12 @@ const struct __cex_namespace__str str = {
         .to_u8s = cex_str__convert__to_u8s,
     },
 
+    .pattern = {
+        .compile = cex_str__pattern__compile,
+        .match = cex_str__pattern__match,
+        .matchs = cex_str__pattern__matchs,
+    },
+
     .slice = {
         .clone = cex_str__slice__clone,
         .copy = cex_str__slice__copy,
@@ -11374,6 +12609,8 @@ const struct __cex_namespace__sbuf sbuf = {
 #    include <sys/stat.h>
 #    include <windows.h>
 #else
+#    include <fcntl.h>
+#    include <sys/mman.h>
 #    include <sys/stat.h>
 #    include <unistd.h>
 #endif
@@ -11871,6 +13108,111 @@ end:
     return out_content.buf;
 }
 
+/// Maps file at `path` into memory read-only (mmap), `out_content` is not null-terminated. Pipes,
+/// ttys and other non-regular files are read into anonymous read-only mapping. Release it by
+/// io.file.unmap().
+Exception
+cex_io__file__map(char* path, str_s* out_content)
+{
+    if (out_content == NULL) { return Error.argument; }
+    *out_content = (str_s){ .buf = "", .len = 0 };
+    if (path == NULL) { return Error.argument; }
+
+#ifdef _WIN32
+    FILE* file;
+    e$ret(cex_io_fopen(&file, path, "rb"));
+    Exc result = cex_io_fread_all(file, out_content, mem$);
+    cex_io_fclose(&file);
+    if (result == Error.eof) { *out_content = (str_s){ .buf = "", .len = 0 }; }
+    return (result == Error.eof) ? EOK : result;
+#else
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { return os.get_last_error(); }
+
+    Exc result = EOK;
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        result = os.get_last_error();
+        goto end;
+    }
+
+    if (S_ISREG(st.st_mode)) {
+        if (st.st_size == 0) { goto end; }
+        void* buf = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (buf == MAP_FAILED) {
+            result = os.get_last_error();
+            goto end;
+        }
+        madvise(buf, st.st_size, MADV_SEQUENTIAL);
+        madvise(buf, st.st_size, MADV_WILLNEED);
+        *out_content = (str_s){ .buf = buf, .len = st.st_size };
+        goto end;
+    }
+
+    // NOTE: no size for pipes/ttys, reading into growing anonymous mapping
+    usize cap = 64 * 1024;
+    usize len = 0;
+    char* buf = mmap(NULL, cap, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf == MAP_FAILED) {
+        result = os.get_last_error();
+        goto end;
+    }
+    while (true) {
+        if (len == cap) {
+            int prot = PROT_READ | PROT_WRITE;
+            char* new_buf = mmap(NULL, cap * 2, prot, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (new_buf == MAP_FAILED) {
+                result = os.get_last_error();
+                munmap(buf, cap);
+                goto end;
+            }
+            memcpy(new_buf, buf, len);
+            munmap(buf, cap);
+            buf = new_buf;
+            cap *= 2;
+        }
+        isize n = read(fd, buf + len, cap - len);
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            result = os.get_last_error();
+            munmap(buf, cap);
+            goto end;
+        }
+        if (n == 0) { break; }
+        len += n;
+    }
+    if (len == 0) {
+        munmap(buf, cap);
+        goto end;
+    }
+    // NOTE: io.file.unmap() gets only `len`, so the tail pages are released now
+    usize page_size = sysconf(_SC_PAGESIZE);
+    usize len_pages = (len + page_size - 1) / page_size * page_size;
+    if (len_pages < cap) { munmap(buf + len_pages, cap - len_pages); }
+    mprotect(buf, len_pages, PROT_READ);
+    *out_content = (str_s){ .buf = buf, .len = len };
+
+end:
+    close(fd);
+    return result;
+#endif
+}
+
+/// Releases `content` of io.file.map(), `content` is zeroed (NULL tolerant)
+void
+cex_io__file__unmap(str_s* content)
+{
+    if (content == NULL) { return; }
+    if (content->len > 0) {
+#ifdef _WIN32
+        mem$free(mem$, content->buf);
+#else
+        munmap(content->buf, content->len);
+#endif
+    }
+    *content = (str_s){ 0 };
+}
+
 /// Reads line from file, allocates result. Returns NULL on error.
 char*
 cex_io__file__readln(FILE* file, IAllocator allc)
@@ -11913,9 +13255,11 @@ const struct __cex_namespace__io io = {
 
     .file = {
         .load = cex_io__file__load,
+        .map = cex_io__file__map,
         .readln = cex_io__file__readln,
         .save = cex_io__file__save,
         .size = cex_io__file__size,
+        .unmap = cex_io__file__unmap,
         .writeln = cex_io__file__writeln,
     },
 
@@ -13361,6 +14705,23 @@ int subprocess_alive(struct subprocess_s *const process) {
 
 #ifndef _WIN32
 #    include <dirent.h>
+#    ifdef __linux__
+#        include <fcntl.h>
+#        include <linux/fs.h>
+#        include <sys/ioctl.h>
+#        include <sys/sendfile.h>
+#        include <sys/syscall.h>
+#        if !defined(__GLIBC__) || __GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 34)
+// NOTE: pthread is a part of libc (musl, glibc 2.34+), os.fs.dir_walk_mt() needs no -lpthread
+#            include <pthread.h>
+#            define _CEX_OS_FS_WALK_MT
+#        endif
+#        ifndef SEEK_DATA
+// NOTE: glibc defines them only with _GNU_SOURCE
+#            define SEEK_DATA 3
+#            define SEEK_HOLE 4
+#        endif
+#    endif
 #else // _WIN32
 // minirent.h HEADER BEGIN
 // Copyright 2021 Alexey Kutepov <reximkut@gmail.com>
@@ -13754,14 +15115,150 @@ cex_os__fs__remove(char* path)
 #endif
 }
 
-/// Iterates over directory (can be recursive) using callback function
+#ifdef __linux__
+struct _os_fs_walk_mt_s;
+
+struct _os_fs_walk_s
+{
+    os_fs_dir_walk_f* callback_fn;
+    void* user_ctx;
+    bool is_recursive;
+    struct _os_fs_walk_mt_s* mt; // not NULL - sub-directories are queued for worker threads
+};
+
+// NOTE: glibc has struct dirent64 only with _LARGEFILE64_SOURCE, this is kernel layout
+struct _os_fs_dirent64_s
+{
+    u64 d_ino;
+    i64 d_off;
+    u16 d_reclen;
+    u8 d_type;
+    char d_name[];
+};
+
+#    ifdef _CEX_OS_FS_WALK_MT
+static Exception _cex_os__fs__walk_mt_push(struct _os_fs_walk_mt_s* mt, char* path);
+#    endif
+#    ifdef CEX_TEST
+// NOTE: test hook, walk as on filesystems without d_type (every entry is stat()-ed)
+static bool _cex_os__fs__dir_walk_dt_unknown = false;
+#    endif
+
+/// Linux backend of os.fs.dir_walk(): getdents64() + d_type, an entry is stat()-ed only when its
+/// type is unknown or it's a symlink. `dir_name` is relative to `parent_fd`, `path_buf` is a full
+/// path of the directory (`path_len`), entry names are appended to it.
+static Exception
+_cex_os__fs__dir_walk_fd(
+    struct _os_fs_walk_s* w,
+    int parent_fd,
+    char* dir_name,
+    char* path_buf,
+    u32 path_len
+)
+{
+    int dir_fd = openat(parent_fd, dir_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) { return os.get_last_error(); }
+
+    Exc result = EOK;
+    alignas(8) char buf[8192];
+    if (path_buf[path_len - 1] != '/') { path_buf[path_len++] = '/'; }
+
+    while (result == EOK) {
+        isize n = syscall(SYS_getdents64, dir_fd, buf, sizeof(buf));
+        if (n == 0) { break; }
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            result = os.get_last_error();
+            break;
+        }
+        for (isize pos = 0; pos < n && result == EOK;) {
+            struct _os_fs_dirent64_s* ep = (struct _os_fs_dirent64_s*)(buf + pos);
+            pos += ep->d_reclen;
+            char* name = ep->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            usize name_len = strlen(name);
+            if (path_len + name_len >= PATH_MAX - 1) {
+                result = Error.overflow;
+                break;
+            }
+            memcpy(path_buf + path_len, name, name_len + 1);
+
+            os_fs_stat_s ftype = { .is_valid = true, .error = EOK };
+            u8 d_type = ep->d_type;
+#    ifdef CEX_TEST
+            if (_cex_os__fs__dir_walk_dt_unknown) { d_type = DT_UNKNOWN; }
+#    endif
+            switch (d_type) {
+                case DT_REG:
+                    ftype.is_file = true;
+                    break;
+                case DT_DIR:
+                    ftype.is_directory = true;
+                    break;
+                case DT_LNK:
+                case DT_UNKNOWN:
+                    ftype = os.fs.stat(path_buf);
+                    break;
+                default:
+                    ftype.is_other = true;
+            }
+            if (!ftype.is_valid) {
+                result = ftype.error;
+                break;
+            }
+
+            if (w->is_recursive && ftype.is_directory && !ftype.is_symlink) {
+#    ifdef _CEX_OS_FS_WALK_MT
+                if (w->mt) {
+                    result = _cex_os__fs__walk_mt_push(w->mt, path_buf);
+                } else
+#    endif
+                {
+                    result = _cex_os__fs__dir_walk_fd(
+                        w,
+                        dir_fd,
+                        name,
+                        path_buf,
+                        path_len + name_len
+                    );
+                    path_buf[path_len + name_len] = '\0';
+                }
+                if (result != EOK) { break; }
+            }
+            // After recursive call make a callback on a directory itself
+            result = w->callback_fn(path_buf, ftype, w->user_ctx);
+        }
+    }
+
+    close(dir_fd);
+    return result;
+}
+#endif
+
+/// Iterates over directory (can be recursive) using callback function. On Linux `ftype` comes
+/// from directory entry type: size and mtime are not set for files and directories (use
+/// os.fs.stat() in callback if needed).
 Exception
 cex_os__fs__dir_walk(char* path, bool is_recursive, os_fs_dir_walk_f callback_fn, void* user_ctx)
 {
-    (void)user_ctx;
     if (path == NULL || path[0] == '\0') { return Error.argument; }
-    Exc result = Error.os;
     uassert(callback_fn != NULL && "you must provide callback_fn");
+#ifdef __linux__
+    u32 path_len = strlen(path);
+    if (path_len > PATH_MAX - 2) { return Error.overflow; }
+
+    char path_buf[PATH_MAX];
+    memcpy(path_buf, path, path_len + 1);
+    struct _os_fs_walk_s w = {
+        .callback_fn = callback_fn,
+        .user_ctx = user_ctx,
+        .is_recursive = is_recursive,
+    };
+    return _cex_os__fs__dir_walk_fd(&w, AT_FDCWD, path, path_buf, path_len);
+#else
+    Exc result = Error.os;
 
     DIR* dp = opendir(path);
 
@@ -13828,11 +15325,163 @@ cex_os__fs__dir_walk(char* path, bool is_recursive, os_fs_dir_walk_f callback_fn
 end:
     if (dp != NULL) { (void)closedir(dp); }
     return result;
+#endif
+}
+
+#ifdef _CEX_OS_FS_WALK_MT
+struct _os_fs_walk_mt_s
+{
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    char** dirs; // pending directories, malloc() (no mem$ stats from worker threads)
+    u32 n_dirs;
+    u32 cap_dirs;
+    u32 n_busy;  // threads walking a directory, may add more to `dirs`
+    Exc error;
+};
+
+static Exception
+_cex_os__fs__walk_mt_push(struct _os_fs_walk_mt_s* mt, char* path)
+{
+    char* dir = strdup(path);
+    if (dir == NULL) { return Error.memory; }
+
+    pthread_mutex_lock(&mt->lock);
+    if (mt->n_dirs == mt->cap_dirs) {
+        u32 cap = (mt->cap_dirs > 0) ? mt->cap_dirs * 2 : 64;
+        char** dirs = realloc(mt->dirs, sizeof(char*) * cap);
+        if (dirs != NULL) {
+            mt->dirs = dirs;
+            mt->cap_dirs = cap;
+        }
+    }
+    bool is_pushed = mt->n_dirs < mt->cap_dirs;
+    if (is_pushed) {
+        mt->dirs[mt->n_dirs++] = dir;
+        pthread_cond_signal(&mt->cond);
+    }
+    pthread_mutex_unlock(&mt->lock);
+
+    if (!is_pushed) {
+        free(dir);
+        return Error.memory;
+    }
+    return EOK;
+}
+
+static void*
+_cex_os__fs__walk_mt_worker(void* arg)
+{
+    struct _os_fs_walk_s* w = arg;
+    struct _os_fs_walk_mt_s* mt = w->mt;
+    char path_buf[PATH_MAX];
+
+    pthread_mutex_lock(&mt->lock);
+    for (;;) {
+        while (mt->n_dirs == 0 && mt->n_busy > 0 && mt->error == EOK) {
+            pthread_cond_wait(&mt->cond, &mt->lock);
+        }
+        if (mt->n_dirs == 0 || mt->error != EOK) { break; }
+
+        char* dir = mt->dirs[--mt->n_dirs];
+        mt->n_busy++;
+        pthread_mutex_unlock(&mt->lock);
+
+        usize dir_len = strlen(dir);
+        memcpy(path_buf, dir, dir_len + 1);
+        Exc err = _cex_os__fs__dir_walk_fd(w, AT_FDCWD, dir, path_buf, dir_len);
+        free(dir);
+
+        pthread_mutex_lock(&mt->lock);
+        mt->n_busy--;
+        if (err != EOK && mt->error == EOK) { mt->error = err; }
+        if (mt->n_busy == 0 || err != EOK) { pthread_cond_broadcast(&mt->cond); }
+    }
+    pthread_cond_broadcast(&mt->cond);
+    pthread_mutex_unlock(&mt->lock);
+    return NULL;
+}
+
+static void*
+_cex_os__fs__walk_mt_thread(void* arg)
+{
+    _cex_os__fs__walk_mt_worker(arg);
+
+    // NOTE: tmem$ is thread local, pages left by callbacks are released before thread exit
+    AllocatorArena_c* tmem = &_cex__default_global__allocator_temp;
+    if (tmem->scope_depth == 0) {
+        allocator_arena_page_s* page = tmem->last_page;
+        while (page) {
+            allocator_arena_page_s* prev_page = page->prev_page;
+            mem$free(mem$, page);
+            page = prev_page;
+        }
+        tmem->last_page = NULL;
+        tmem->used = 0;
+    }
+    return NULL;
+}
+#endif
+
+/// Recursive os.fs.dir_walk() on `n_threads` threads (0 - number of CPUs, up to 8), sub-directories
+/// are handed to idle threads. `callback_fn` is called concurrently and must be thread safe, there
+/// is no order of entries (a directory may come before its contents). Serial walk if threads are
+/// not supported.
+Exception
+cex_os__fs__dir_walk_mt(char* path, u32 n_threads, os_fs_dir_walk_f callback_fn, void* user_ctx)
+{
+    if (path == NULL || path[0] == '\0') { return Error.argument; }
+    uassert(callback_fn != NULL && "you must provide callback_fn");
+#ifdef _CEX_OS_FS_WALK_MT
+    if (n_threads == 0) {
+        long n_cpu = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = (n_cpu > 8) ? 8 : (n_cpu < 1) ? 1 : n_cpu;
+    }
+    if (n_threads <= 1) { return cex_os__fs__dir_walk(path, true, callback_fn, user_ctx); }
+
+    os_fs_stat_s root = os.fs.stat(path);
+    if (!root.is_valid) { return root.error; }
+    if (!root.is_directory) { return Error.argument; }
+
+    struct _os_fs_walk_mt_s mt = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+        .cond = PTHREAD_COND_INITIALIZER,
+    };
+    struct _os_fs_walk_s w = {
+        .callback_fn = callback_fn,
+        .user_ctx = user_ctx,
+        .is_recursive = true,
+        .mt = &mt,
+    };
+    e$except_silent (err, _cex_os__fs__walk_mt_push(&mt, path)) {
+        free(mt.dirs);
+        return err;
+    }
+
+    pthread_t threads[8];
+    u32 n_started = 0;
+    for (u32 i = 0; i < n_threads - 1 && i < arr$len(threads); i++) {
+        if (pthread_create(&threads[i], NULL, _cex_os__fs__walk_mt_thread, &w) != 0) { break; }
+        n_started++;
+    }
+    _cex_os__fs__walk_mt_worker(&w); // NOTE: current thread is a worker too
+    for (u32 i = 0; i < n_started; i++) { pthread_join(threads[i], NULL); }
+
+    for (u32 i = 0; i < mt.n_dirs; i++) { free(mt.dirs[i]); } // NOTE: left after error
+    free(mt.dirs);
+    pthread_mutex_destroy(&mt.lock);
+    pthread_cond_destroy(&mt.cond);
+    return mt.error;
+#else
+    (void)n_threads;
+    return cex_os__fs__dir_walk(path, true, callback_fn, user_ctx);
+#endif
 }
 
 struct _os_fs_find_ctx_s
 {
-    char* pattern;
+    str_pattern_c pattern; // compiled once per walk
+    char* raw_pattern;     // too big for compiled matcher (Error.overflow), interpreted
     arr$(char*) result;
     IAllocator allc;
 };
@@ -13933,7 +15582,10 @@ _os__fs__find_walker(char* path, os_fs_stat_s ftype, void* user_ctx)
     }
 
     str_s file_part = os.path.split(path, false);
-    if (!str.match(file_part.buf, ctx->pattern)) {
+    bool is_match = ctx->raw_pattern
+                      ? _cex_str_match(file_part.buf, file_part.len, ctx->raw_pattern)
+                      : str.pattern.matchs(&ctx->pattern, file_part);
+    if (!is_match) {
         return EOK; // just skip when patten not matched
     }
 
@@ -13957,7 +15609,7 @@ static arr$(char*) cex_os__fs__find(char* path_pattern, bool is_recursive, IAllo
     str_s dir_part = os.path.split(path_pattern, true);
     if (dir_part.buf == NULL) {
 #if defined(CEX_TEST) || defined(CEX_BUILD)
-        (void)e$raise(Error.argument, "Bad path: os.fn.find('%s')", path_pattern);
+        (void)e$raise(Error.argument, "Bad path: os.fs.find('%s')", path_pattern);
 #endif
         return NULL;
     }
@@ -13991,9 +15643,18 @@ static arr$(char*) cex_os__fs__find(char* path_pattern, bool is_recursive, IAllo
     if (*pattern == '/' || *pattern == '\\') { pattern++; }
     if (*pattern == '\0') { pattern = "*"; }
 
-    struct _os_fs_find_ctx_s ctx = { .result = arr$new(ctx.result, allc),
-                                     .pattern = pattern,
-                                     .allc = allc };
+    struct _os_fs_find_ctx_s ctx = { .allc = allc };
+    Exc compile_err = str.pattern.compile(&ctx.pattern, pattern);
+    if (compile_err == Error.overflow) {
+        // NOTE: valid pattern, too many states or [] classes for compiled matcher (see str.match())
+        ctx.raw_pattern = pattern;
+    } else if (compile_err != EOK) {
+#if defined(CEX_TEST) || defined(CEX_BUILD)
+        (void)e$raise(compile_err, "Bad pattern: os.fs.find('%s')", path_pattern);
+#endif
+        return NULL;
+    }
+    ctx.result = arr$new(ctx.result, allc);
     if (unlikely(ctx.result == NULL)) { return NULL; }
 
     e$except_silent (err, cex_os__fs__dir_walk(dir_name, is_recursive, _os__fs__find_walker, &ctx)) {
@@ -14044,12 +15705,85 @@ cex_os__fs__chdir(char* path)
             return strerror(errno);
         }
     }
-
+
+    return EOK;
+}
+
+
+#if defined(__linux__)
+/// Copies data segments of a regular file in kernel (copy_file_range(), or sendfile() if not
+/// supported), holes are skipped by SEEK_DATA/SEEK_HOLE so sparse files stay sparse. Returns
+/// Error.skip when nothing was copied and buffered copy must be used.
+static Exception
+_cex_os__fs__copy_kernel(int src_fd, int dst_fd, off_t size)
+{
+#    ifdef __NR_copy_file_range
+    bool use_copy_range = true;
+#    else
+    bool use_copy_range = false;
+#    endif
+    if (size == 0) { return Error.skip; } // NOTE: procfs and alike report zero size
+    bool is_copied = false;
+    off_t offset = 0;
+    while (offset < size) {
+        off_t data_start = lseek(src_fd, offset, SEEK_DATA);
+        if (data_start < 0) {
+            if (errno == ENXIO) {
+                // NOTE: hole till the end of file, or source is shorter than its stat() size
+                off_t end = lseek(src_fd, 0, SEEK_END);
+                if (end >= 0 && end < size) { size = end; }
+                break;
+            }
+            data_start = offset; // NOTE: no SEEK_DATA support, all is data
+        }
+        off_t data_end = lseek(src_fd, data_start, SEEK_HOLE);
+        if (data_end < 0 || data_end > size) { data_end = size; }
+
+        off_t in_off = data_start;
+        off_t out_off = data_start;
+        while (in_off < data_end) {
+            usize n_left = data_end - in_off;
+            isize n = -1;
+            if (use_copy_range) {
+#    ifdef __NR_copy_file_range
+                n = syscall(__NR_copy_file_range, src_fd, &in_off, dst_fd, &out_off, n_left, 0);
+                if (n < 0 && !is_copied &&
+                    (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+                    use_copy_range = false; // NOTE: old kernel or cross-filesystem copy
+                    continue;
+                }
+#    endif
+            } else {
+                if (lseek(dst_fd, out_off, SEEK_SET) < 0) { return os.get_last_error(); }
+                n = sendfile(dst_fd, src_fd, &in_off, n_left);
+                if (n < 0 && !is_copied && (errno == ENOSYS || errno == EINVAL)) { n = 0; }
+                if (n > 0) { out_off += n; }
+            }
+            if (n < 0) {
+                if (errno == EINTR) { continue; }
+                return os.get_last_error();
+            }
+            if (n == 0) {
+                if (!is_copied) {
+                    // NOTE: not supported or size is fake (sysfs), buffered copy from start
+                    if (lseek(dst_fd, 0, SEEK_SET) < 0) { return os.get_last_error(); }
+                    return Error.skip;
+                }
+                size = in_off; // NOTE: source is shorter than its stat() size
+                break;
+            }
+            is_copied = true;
+        }
+        offset = data_end;
+    }
+    // NOTE: trailing hole is not written by the loop
+    if (ftruncate(dst_fd, size) < 0) { return os.get_last_error(); }
     return EOK;
 }
+#endif
 
-
-/// Copy file
+/// Copy file. On Linux regular files are cloned (FICLONE, reflink on btrfs/xfs) or copied in kernel
+/// (copy_file_range/sendfile) keeping holes of sparse files, buffered read/write is a fallback.
 static Exception
 cex_os__fs__copy(char* src_path, char* dst_path)
 {
@@ -14067,8 +15801,7 @@ cex_os__fs__copy(char* src_path, char* dst_path)
     int src_fd = -1;
     int dst_fd = -1;
     size_t buf_size = 32 * 1024;
-    char* buf = mem$malloc(mem$, buf_size);
-    if (buf == NULL) { return Error.memory; }
+    char* buf = NULL;
     Exc result = Error.runtime;
 
     if ((src_fd = open(src_path, O_RDONLY)) == -1) {
@@ -14088,6 +15821,24 @@ cex_os__fs__copy(char* src_path, char* dst_path)
         goto defer;
     }
 
+#    ifdef __linux__
+    if (S_ISREG(src_stat.st_mode)) {
+#        ifdef FICLONE
+        if (ioctl(dst_fd, FICLONE, src_fd) == 0) {
+            result = EOK;
+            goto defer;
+        }
+#        endif
+        result = _cex_os__fs__copy_kernel(src_fd, dst_fd, src_stat.st_size);
+        if (result != Error.skip) { goto defer; }
+    }
+#    endif
+
+    buf = mem$malloc(mem$, buf_size);
+    if (buf == NULL) {
+        result = Error.memory;
+        goto defer;
+    }
     for (;;) {
         ssize_t n = read(src_fd, buf, buf_size);
         if (n == 0) { break; }
@@ -14109,7 +15860,7 @@ cex_os__fs__copy(char* src_path, char* dst_path)
     result = EOK;
 
 defer:
-    mem$free(mem$, buf);
+    if (buf) { mem$free(mem$, buf); }
     if (src_fd >= 0) { close(src_fd); }
     if (dst_fd >= 0) { close(dst_fd); }
     return result;
@@ -14333,1005 +16084,1834 @@ end:
     return result;
 }
 
-/// Get running command stdout stream
-static FILE*
-cex_os__cmd__fstdout(os_cmd_c* self)
+/// Get running command stdout stream
+static FILE*
+cex_os__cmd__fstdout(os_cmd_c* self)
+{
+    return self->_subpr.stdout_file;
+}
+
+/// Get running command stderr stream
+static FILE*
+cex_os__cmd__fstderr(os_cmd_c* self)
+{
+    return self->_subpr.stderr_file;
+}
+
+/// Get running command stdin stream
+static FILE*
+cex_os__cmd__fstdin(os_cmd_c* self)
+{
+    return self->_subpr.stdin_file;
+}
+
+/// Read all output from process stdout, NULL if stdout is not available
+static char*
+cex_os__cmd__read_all(os_cmd_c* self, IAllocator allc)
+{
+    uassert(self != NULL);
+    uassert(allc != NULL);
+    if (self->_subpr.stdout_file) {
+        str_s out = { 0 };
+        if (io.fread_all(self->_subpr.stdout_file, &out, allc)) { return NULL; }
+        return out.buf;
+    }
+    return NULL;
+}
+
+/// Read line from process stdout, NULL if stdout is not available
+static char*
+cex_os__cmd__read_line(os_cmd_c* self, IAllocator allc)
+{
+    uassert(self != NULL);
+    uassert(allc != NULL);
+    if (self->_subpr.stdout_file) {
+        str_s out = { 0 };
+        if (io.fread_line(self->_subpr.stdout_file, &out, allc)) { return NULL; }
+        return out.buf;
+    }
+    return NULL;
+}
+
+/// Writes line to the process stdin
+static Exception
+cex_os__cmd__write_line(os_cmd_c* self, char* line)
+{
+    uassert(self != NULL);
+    if (line == NULL) { return Error.argument; }
+
+    if (self->_subpr.stdin_file == NULL) { return Error.not_found; }
+
+    e$except_silent (err, io.file.writeln(self->_subpr.stdin_file, line)) { return err; }
+    fflush(self->_subpr.stdin_file);
+
+    return EOK;
+}
+
+/// Check if `cmd_exe` program name exists in PATH. cmd_exe can be absolute, or simple command name,
+/// e.g. `cat`
+static bool
+cex_os__cmd__exists(char* cmd_exe)
+{
+    if (cmd_exe == NULL || cmd_exe[0] == '\0') { return false; }
+    mem$scope(tmem$, _)
+    {
+#ifdef _WIN32
+        char* extensions[] = { ".exe", ".cmd", ".bat" };
+        bool has_ext = str.find(os.path.basename(cmd_exe, _), ".") != NULL;
+
+        if (str.find(cmd_exe, "/") != NULL || str.find(cmd_exe, "\\") != NULL) {
+            if (has_ext) {
+                return os.path.exists(cmd_exe);
+            } else {
+                for$each (ext, extensions) {
+                    char* exe = str.fmt(_, "%s%s", cmd_exe, ext);
+                    os_fs_stat_s stat = os.fs.stat(exe);
+                    if (stat.is_valid && stat.is_file) { return true; }
+                }
+                return false;
+            }
+        }
+
+        str_s path_env = str.sstr(os.env.get("PATH", NULL));
+        if (path_env.buf == NULL) { return false; }
+
+        for$iter (str_s, it, str.slice.iter_split(path_env, ";", &it.iterator)) {
+            if (has_ext) {
+                char* exe = str.fmt(_, "%S/%s", it.val, cmd_exe);
+                os_fs_stat_s stat = os.fs.stat(exe);
+                if (stat.is_valid && stat.is_file) { return true; }
+            } else {
+                for$each (ext, extensions) {
+                    char* exe = str.fmt(_, "%S/%s%s", it.val, cmd_exe, ext);
+                    os_fs_stat_s stat = os.fs.stat(exe);
+                    if (stat.is_valid && stat.is_file) { return true; }
+                }
+            }
+        }
+#else
+        if (str.find(cmd_exe, "/") != NULL) {
+            os_fs_stat_s stat = os.fs.stat(cmd_exe);
+            if (stat.is_valid && stat.is_file && access(cmd_exe, X_OK) == 0) {
+                return true; // check if executable
+            }
+            return false;
+        }
+
+        str_s path_env = str.sstr(os.env.get("PATH", NULL));
+        if (path_env.buf == NULL) { return false; }
+
+        for$iter (str_s, it, str.slice.iter_split(path_env, ":", &it.iterator)) {
+            char* exe = str.fmt(_, "%S/%s", it.val, cmd_exe);
+            os_fs_stat_s stat = os.fs.stat(exe);
+            if (stat.is_valid && stat.is_file && access(exe, X_OK) == 0) { return true; }
+        }
+#endif
+    }
+    return false;
+}
+
+/// Run command using arguments array and resulting os_cmd_c
+static Exception
+cex_os__cmd__run(char** args, usize args_len, os_cmd_c* out_cmd)
+{
+    uassert(out_cmd != NULL);
+    memset(out_cmd, 0, sizeof(os_cmd_c));
+
+    if (args == NULL || args_len == 0) {
+        return e$raise(Error.argument, "`args` argument is empty or null");
+    }
+    if (args_len == 1 || args[args_len - 1] != NULL) {
+        return e$raise(Error.argument, "`args` last item must be a NULL");
+    }
+
+    for (u32 i = 0; i < args_len - 1; i++) {
+        if (args[i] == NULL || args[i][0] == '\0') {
+            return e$raise(
+                Error.argument,
+                "`args` item[%d] is NULL/empty, which may indicate string operation failure",
+                i
+            );
+        }
+    }
+
+
+#ifdef _WIN32
+    Exc result = Error.runtime;
+
+    STARTUPINFO si = { 0 };
+    PROCESS_INFORMATION pi = { 0 };
+
+    si.cb = sizeof(STARTUPINFO);
+    si.dwFlags |= STARTF_USESTDHANDLES;
+    si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+
+    mem$scope(tmem$, _)
+    {
+        sbuf_c cmd = sbuf.create(1024, _);
+        for (u32 i = 0; i < args_len - 1; i++) {
+            if (str.find(args[i], " ") || str.find(args[i], "\"")) {
+                char* escaped_arg = str.replace(args[i], "\"", "\\\"", _);
+                e$except_silent (err, sbuf.appendf(&cmd, "\"%s\" ", escaped_arg)) {
+                    result = err;
+                    goto end;
+                }
+            } else {
+                e$except_silent (err, sbuf.appendf(&cmd, "%s ", args[i])) {
+                    result = err;
+                    goto end;
+                }
+            }
+        }
+
+        if (!CreateProcessA(
+                NULL, // Application name (use command line)
+                cmd,  // Command line
+                NULL, // Process security attributes
+                NULL, // Thread security attributes
+                TRUE, // Inherit handles
+                0,    // Creation flags
+                NULL, // Environment
+                NULL, // Current directory
+                &si,  // Startup info
+                &pi   // Process information
+            )) {
+            result = os.get_last_error();
+            goto end;
+        }
+    }
+
+    *out_cmd = (os_cmd_c){ ._is_subprocess = false,
+                           ._subpr = {
+                               .hProcess = pi.hProcess,
+                               .alive = 1,
+                           } };
+    CloseHandle(pi.hThread);
+    result = EOK;
+end:
+    return result;
+#else
+    pid_t cpid = fork();
+    if (cpid < 0) { return e$raise(Error.os, "Could not fork child process: %s", strerror(errno)); }
+
+    if (cpid == 0) {
+        if (execvp(args[0], (char* const*)args) < 0) {
+            log$error("Could not exec child process: %s\n", strerror(errno));
+            exit(1);
+        }
+        uassert(false && "unreachable");
+    }
+
+    *out_cmd = (os_cmd_c){ ._is_subprocess = false,
+                           ._subpr = {
+                               .child = cpid,
+                               .alive = 1,
+                           } };
+    return EOK;
+
+#endif
+}
+
+/// Returns current OS platform, returns enum of OSPlatform__*, e.g. OSPlatform__win,
+/// OSPlatform__linux, OSPlatform__macos, etc..
+static OSPlatform_e
+cex_os__platform__current(void)
+{
+#if defined(_WIN32)
+    return OSPlatform__win;
+#elif defined(__linux__)
+    return OSPlatform__linux;
+#elif defined(__APPLE__) || defined(__MACH__)
+    return OSPlatform__macos;
+#elif defined(__unix__)
+#    if defined(__FreeBSD__)
+    return OSPlatform__freebsd;
+#    elif defined(__NetBSD__)
+    return OSPlatform__netbsd;
+#    elif defined(__OpenBSD__)
+    return OSPlatform__openbsd;
+#    elif defined(__ANDROID__)
+    return OSPlatform__android;
+#    else
+#        error "Untested platform. Need more?"
+#    endif
+#elif defined(__wasm__)
+    return OSPlatform__wasm;
+#else
+#    error "Untested platform. Need more?"
+#endif
+}
+
+/// Returns string name of current platform
+static char*
+cex_os__platform__current_str(void)
 {
-    return self->_subpr.stdout_file;
+    return os.platform.to_str(os.platform.current());
 }
 
-/// Get running command stderr stream
-static FILE*
-cex_os__cmd__fstderr(os_cmd_c* self)
+/// Converts platform name to enum
+static OSPlatform_e
+cex_os__platform__from_str(char* name)
 {
-    return self->_subpr.stderr_file;
+    if (name == NULL || name[0] == '\0') { return OSPlatform__unknown; }
+    for (u32 i = 1; i < OSPlatform__count; i++) {
+        if (str.eq((char*)OSPlatform_str[i], name)) { return (OSPlatform_e)i; }
+    }
+    return OSPlatform__unknown;
+    ;
 }
 
-/// Get running command stdin stream
-static FILE*
-cex_os__cmd__fstdin(os_cmd_c* self)
+/// Converts platform enum to name
+static char*
+cex_os__platform__to_str(OSPlatform_e platform)
 {
-    return self->_subpr.stdin_file;
+    if (unlikely(platform <= OSPlatform__unknown || platform >= OSPlatform__count)) { return NULL; }
+    return (char*)OSPlatform_str[platform];
 }
 
-/// Read all output from process stdout, NULL if stdout is not available
-static char*
-cex_os__cmd__read_all(os_cmd_c* self, IAllocator allc)
+/// Returns OSArch from string
+static OSArch_e
+cex_os__platform__arch_from_str(char* name)
 {
-    uassert(self != NULL);
-    uassert(allc != NULL);
-    if (self->_subpr.stdout_file) {
-        str_s out = { 0 };
-        if (io.fread_all(self->_subpr.stdout_file, &out, allc)) { return NULL; }
-        return out.buf;
+    if (name == NULL || name[0] == '\0') { return OSArch__unknown; }
+    for (u32 i = 1; i < OSArch__count; i++) {
+        if (str.eq((char*)OSArch_str[i], name)) { return (OSArch_e)i; }
     }
-    return NULL;
+    return OSArch__unknown;
+    ;
 }
 
-/// Read line from process stdout, NULL if stdout is not available
+/// Converts arch to string
 static char*
-cex_os__cmd__read_line(os_cmd_c* self, IAllocator allc)
+cex_os__platform__arch_to_str(OSArch_e platform)
 {
-    uassert(self != NULL);
-    uassert(allc != NULL);
-    if (self->_subpr.stdout_file) {
-        str_s out = { 0 };
-        if (io.fread_line(self->_subpr.stdout_file, &out, allc)) { return NULL; }
-        return out.buf;
-    }
-    return NULL;
+    if (unlikely(platform <= OSArch__unknown || platform >= OSArch__count)) { return NULL; }
+    return (char*)OSArch_str[platform];
 }
 
-/// Writes line to the process stdin
-static Exception
-cex_os__cmd__write_line(os_cmd_c* self, char* line)
-{
-    uassert(self != NULL);
-    if (line == NULL) { return Error.argument; }
+const struct __cex_namespace__os os = {
+    // Autogenerated by CEX
+    // clang-format off
 
-    if (self->_subpr.stdin_file == NULL) { return Error.not_found; }
+    .get_last_error = cex_os_get_last_error,
+    .sleep = cex_os_sleep,
+    .timer = cex_os_timer,
 
-    e$except_silent (err, io.file.writeln(self->_subpr.stdin_file, line)) { return err; }
-    fflush(self->_subpr.stdin_file);
+    .cmd = {
+        .create = cex_os__cmd__create,
+        .exists = cex_os__cmd__exists,
+        .fstderr = cex_os__cmd__fstderr,
+        .fstdin = cex_os__cmd__fstdin,
+        .fstdout = cex_os__cmd__fstdout,
+        .is_alive = cex_os__cmd__is_alive,
+        .join = cex_os__cmd__join,
+        .kill = cex_os__cmd__kill,
+        .read_all = cex_os__cmd__read_all,
+        .read_line = cex_os__cmd__read_line,
+        .run = cex_os__cmd__run,
+        .write_line = cex_os__cmd__write_line,
+    },
 
-    return EOK;
+    .env = {
+        .get = cex_os__env__get,
+        .set = cex_os__env__set,
+    },
+
+    .fs = {
+        .chdir = cex_os__fs__chdir,
+        .copy = cex_os__fs__copy,
+        .copy_tree = cex_os__fs__copy_tree,
+        .dir_walk = cex_os__fs__dir_walk,
+        .dir_walk_mt = cex_os__fs__dir_walk_mt,
+        .find = cex_os__fs__find,
+        .getcwd = cex_os__fs__getcwd,
+        .mkdir = cex_os__fs__mkdir,
+        .mkpath = cex_os__fs__mkpath,
+        .remove = cex_os__fs__remove,
+        .remove_tree = cex_os__fs__remove_tree,
+        .rename = cex_os__fs__rename,
+        .stat = cex_os__fs__stat,
+    },
+
+    .path = {
+        .abs = cex_os__path__abs,
+        .basename = cex_os__path__basename,
+        .dirname = cex_os__path__dirname,
+        .exists = cex_os__path__exists,
+        .join = cex_os__path__join,
+        .split = cex_os__path__split,
+    },
+
+    .platform = {
+        .arch_from_str = cex_os__platform__arch_from_str,
+        .arch_to_str = cex_os__platform__arch_to_str,
+        .current = cex_os__platform__current,
+        .current_str = cex_os__platform__current_str,
+        .from_str = cex_os__platform__from_str,
+        .to_str = cex_os__platform__to_str,
+    },
+
+    // clang-format on
+};
+
+
+
+/*
+*                          src/cex_code_gen.c
+*/
+
+void
+_cex__codegen_indent(_cex__codegen_s* cg)
+{
+    if (unlikely(cg->error != EOK)) { return; }
+    for (u32 i = 0; i < cg->indent; i++) {
+        Exc err = sbuf.append(cg->buf, " ");
+        if (unlikely(err != EOK && cg->error != EOK)) { cg->error = err; }
+    }
 }
 
-/// Check if `cmd_exe` program name exists in PATH. cmd_exe can be absolute, or simple command name,
-/// e.g. `cat`
-static bool
-cex_os__cmd__exists(char* cmd_exe)
+#    define cg$printva(cg) /* temp macro! */                                                       \
+        do {                                                                                       \
+            va_list va;                                                                            \
+            va_start(va, format);                                                                  \
+            Exc err = sbuf.appendfva(cg->buf, format, va);                                         \
+            if (unlikely(err != EOK && cg->error != EOK)) { cg->error = err; }                     \
+            va_end(va);                                                                            \
+        } while (0)
+
+void
+_cex__codegen_print(_cex__codegen_s* cg, bool rep_new_line, char* format, ...)
 {
-    if (cmd_exe == NULL || cmd_exe[0] == '\0') { return false; }
-    mem$scope(tmem$, _)
-    {
-#ifdef _WIN32
-        char* extensions[] = { ".exe", ".cmd", ".bat" };
-        bool has_ext = str.find(os.path.basename(cmd_exe, _), ".") != NULL;
+    if (unlikely(cg->error != EOK)) { return; }
+    if (rep_new_line) {
+        usize slen = sbuf.len(cg->buf);
+        if (slen && cg->buf[0][slen - 1] == '\n') { sbuf.shrink(cg->buf, slen - 1); }
+    }
+    cg$printva(cg);
+}
 
-        if (str.find(cmd_exe, "/") != NULL || str.find(cmd_exe, "\\") != NULL) {
-            if (has_ext) {
-                return os.path.exists(cmd_exe);
-            } else {
-                for$each (ext, extensions) {
-                    char* exe = str.fmt(_, "%s%s", cmd_exe, ext);
-                    os_fs_stat_s stat = os.fs.stat(exe);
-                    if (stat.is_valid && stat.is_file) { return true; }
-                }
-                return false;
-            }
-        }
+void
+_cex__codegen_print_line(_cex__codegen_s* cg, char* format, ...)
+{
+    if (unlikely(cg->error != EOK)) { return; }
+    if (format[0] != '\n') { _cex__codegen_indent(cg); }
+    cg$printva(cg);
+}
 
-        str_s path_env = str.sstr(os.env.get("PATH", NULL));
-        if (path_env.buf == NULL) { return false; }
+_cex__codegen_s*
+_cex__codegen_print_scope_enter(_cex__codegen_s* cg, char* format, ...)
+{
+    usize slen = sbuf.len(cg->buf);
+    if (slen && cg->buf[0][slen - 1] == '\n') { _cex__codegen_indent(cg); }
+    cg$printva(cg);
+    _cex__codegen_print(cg, false, "%c\n", '{');
+    cg->indent += 4;
+    return cg;
+}
 
-        for$iter (str_s, it, str.slice.iter_split(path_env, ";", &it.iterator)) {
-            if (has_ext) {
-                char* exe = str.fmt(_, "%S/%s", it.val, cmd_exe);
-                os_fs_stat_s stat = os.fs.stat(exe);
-                if (stat.is_valid && stat.is_file) { return true; }
-            } else {
-                for$each (ext, extensions) {
-                    char* exe = str.fmt(_, "%S/%s%s", it.val, cmd_exe, ext);
-                    os_fs_stat_s stat = os.fs.stat(exe);
-                    if (stat.is_valid && stat.is_file) { return true; }
-                }
-            }
-        }
-#else
-        if (str.find(cmd_exe, "/") != NULL) {
-            os_fs_stat_s stat = os.fs.stat(cmd_exe);
-            if (stat.is_valid && stat.is_file && access(cmd_exe, X_OK) == 0) {
-                return true; // check if executable
-            }
-            return false;
-        }
+void
+_cex__codegen_print_scope_exit(_cex__codegen_s** cgptr)
+{
+    uassert(*cgptr != NULL);
+    _cex__codegen_s* cg = *cgptr;
 
-        str_s path_env = str.sstr(os.env.get("PATH", NULL));
-        if (path_env.buf == NULL) { return false; }
+    if (cg->indent >= 4) { cg->indent -= 4; }
+    _cex__codegen_indent(cg);
+    _cex__codegen_print(cg, false, "%c\n", '}');
+}
 
-        for$iter (str_s, it, str.slice.iter_split(path_env, ":", &it.iterator)) {
-            char* exe = str.fmt(_, "%S/%s", it.val, cmd_exe);
-            os_fs_stat_s stat = os.fs.stat(exe);
-            if (stat.is_valid && stat.is_file && access(exe, X_OK) == 0) { return true; }
-        }
-#endif
-    }
-    return false;
+
+_cex__codegen_s*
+_cex__codegen_print_case_enter(_cex__codegen_s* cg, char* format, ...)
+{
+    _cex__codegen_indent(cg);
+    cg$printva(cg);
+    _cex__codegen_print(cg, false, ": %c\n", '{');
+    cg->indent += 4;
+    return cg;
 }
 
-/// Run command using arguments array and resulting os_cmd_c
-static Exception
-cex_os__cmd__run(char** args, usize args_len, os_cmd_c* out_cmd)
+void
+_cex__codegen_print_case_exit(_cex__codegen_s** cgptr)
 {
-    uassert(out_cmd != NULL);
-    memset(out_cmd, 0, sizeof(os_cmd_c));
+    uassert(*cgptr != NULL);
+    _cex__codegen_s* cg = *cgptr;
 
-    if (args == NULL || args_len == 0) {
-        return e$raise(Error.argument, "`args` argument is empty or null");
-    }
-    if (args_len == 1 || args[args_len - 1] != NULL) {
-        return e$raise(Error.argument, "`args` last item must be a NULL");
-    }
+    if (cg->indent >= 4) { cg->indent -= 4; }
+    _cex__codegen_indent(cg);
+    _cex__codegen_print_line(cg, "break;\n", '}');
+    _cex__codegen_indent(cg);
+    _cex__codegen_print(cg, false, "%c\n", '}');
+}
 
-    for (u32 i = 0; i < args_len - 1; i++) {
-        if (args[i] == NULL || args[i][0] == '\0') {
-            return e$raise(
-                Error.argument,
-                "`args` item[%d] is NULL/empty, which may indicate string operation failure",
-                i
-            );
-        }
-    }
+#    undef cg$printva
 
 
-#ifdef _WIN32
-    Exc result = Error.runtime;
 
-    STARTUPINFO si = { 0 };
-    PROCESS_INFORMATION pi = { 0 };
+/*
+*                          src/cexy.c
+*/
+#include <stdbool.h>
+#include <stdio.h>
+#if defined(CEX_BUILD) || defined(CEX_NEW)
 
-    si.cb = sizeof(STARTUPINFO);
-    si.dwFlags |= STARTF_USESTDHANDLES;
-    si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
-    si.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
-    si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+#    include <ctype.h>
+#    include <time.h>
+#    ifndef _WIN32
+#        include <fcntl.h>
+#        include <poll.h>
+#        include <utime.h>
+#    endif
 
+static void
+cexy_build_self(int argc, char** argv, char* cex_source)
+{
     mem$scope(tmem$, _)
     {
-        sbuf_c cmd = sbuf.create(1024, _);
-        for (u32 i = 0; i < args_len - 1; i++) {
-            if (str.find(args[i], " ") || str.find(args[i], "\"")) {
-                char* escaped_arg = str.replace(args[i], "\"", "\\\"", _);
-                e$except_silent (err, sbuf.appendf(&cmd, "\"%s\" ", escaped_arg)) {
-                    result = err;
-                    goto end;
-                }
-            } else {
-                e$except_silent (err, sbuf.appendf(&cmd, "%s ", args[i])) {
-                    result = err;
-                    goto end;
-                }
-            }
+        uassert(str.ends_with(argv[0], "cex") || str.ends_with(argv[0], "cex.exe"));
+        char* bin_path = argv[0];
+        bool has_darg_before_cmd = (argc > 1 && str.starts_with(argv[1], "-D"));
+        (void)has_darg_before_cmd;
+
+#    ifndef cexy$no_compile_flags
+        if (os.path.exists("compile_flags.txt")) {
+            e$except (err, cexy.utils.make_compile_flags("compile_flags.txt", true, NULL)) {}
         }
+#    endif
 
-        if (!CreateProcessA(
-                NULL, // Application name (use command line)
-                cmd,  // Command line
-                NULL, // Process security attributes
-                NULL, // Thread security attributes
-                TRUE, // Inherit handles
-                0,    // Creation flags
-                NULL, // Environment
-                NULL, // Current directory
-                &si,  // Startup info
-                &pi   // Process information
-            )) {
-            result = os.get_last_error();
-            goto end;
+#    ifdef _CEX_SELF_BUILD
+        if (!has_darg_before_cmd) {
+            log$trace("Checking self build for executable: %s\n", bin_path);
+            if (!cexy.src_include_changed(bin_path, cex_source, NULL)) {
+                log$trace("%s unchanged, skipping self build\n", cex_source);
+                // cex.c/cex.h are up to date no rebuild needed
+                return;
+            }
+        } else {
+            log$trace("Passed extra -Dflags to cex command, build now\n");
         }
-    }
+#    endif
 
-    *out_cmd = (os_cmd_c){ ._is_subprocess = false,
-                           ._subpr = {
-                               .hProcess = pi.hProcess,
-                               .alive = 1,
-                           } };
-    CloseHandle(pi.hThread);
-    result = EOK;
-end:
-    return result;
-#else
-    pid_t cpid = fork();
-    if (cpid < 0) { return e$raise(Error.os, "Could not fork child process: %s", strerror(errno)); }
+        log$info("Rebuilding self: %s -> %s\n", cex_source, bin_path);
+        char* old_name = str.fmt(_, "%s.old", bin_path);
+        if (os.path.exists(bin_path)) {
+            if (os.fs.remove(old_name)) {}
+            e$except (err, os.fs.rename(bin_path, old_name)) { goto fail_recovery; }
+        }
+        arr$(char*) args = arr$new(args, _, .capacity = 64);
+        sbuf_c dargs_sbuf = sbuf.create(256, _);
+        arr$pushm(args, cexy$cex_self_cc, "-D_CEX_SELF_BUILD", "-g");
+        e$goto(sbuf.append(&dargs_sbuf, "-D_CEX_SELF_DARGS=\""), err);
 
-    if (cpid == 0) {
-        if (execvp(args[0], (char* const*)args) < 0) {
-            log$error("Could not exec child process: %s\n", strerror(errno));
-            exit(1);
+        i32 dflag_idx = 1;
+        for$each (darg, argv + 1, argc - 1) {
+            if (str.starts_with(darg, "-D")) {
+                if (!str.eq(darg, "-D")) {
+                    arr$push(args, darg);
+                    e$goto(sbuf.appendf(&dargs_sbuf, "%s ", darg), fail_recovery);
+                }
+                dflag_idx++;
+            } else {
+                break; // stop at first non -D<flag>
+            }
         }
-        uassert(false && "unreachable");
-    }
+        if (dflag_idx > 1 && (dflag_idx >= argc || !str.eq(argv[dflag_idx], "config"))) {
+            log$error("Expected config command after passing -D<ARG> to ./cex\n");
+            goto fail_recovery;
+        }
+#    ifdef _CEX_SELF_DARGS
+        if (dflag_idx == 1) {
+            // new compilation no flags (maybe due to source changes, we need to maintain old flags)
+            log$trace("Preserving CEX_SELF_DARGS: %s\n", _CEX_SELF_DARGS);
+            for$iter (
+                str_s,
+                it,
+                str.slice.iter_split(str.sstr(_CEX_SELF_DARGS), " ", &it.iterator)
+            ) {
+                str_s clean_it = str.slice.strip(it.val);
+                if (clean_it.len == 0) { continue; }
+                if (!str.slice.starts_with(clean_it, str$s("-D"))) { continue; }
+                if (str.slice.eq(clean_it, str$s("-D"))) { continue; }
+                auto _darg = str.fmt(_, "%S", clean_it);
+                arr$push(args, _darg);
+                e$goto(sbuf.appendf(&dargs_sbuf, "%s ", _darg), err);
+            }
+        }
+#    endif
+        e$goto(sbuf.append(&dargs_sbuf, "\""), err);
 
-    *out_cmd = (os_cmd_c){ ._is_subprocess = false,
-                           ._subpr = {
-                               .child = cpid,
-                               .alive = 1,
-                           } };
-    return EOK;
+        arr$push(args, dargs_sbuf);
 
-#endif
-}
+        char* custom_args[] = { cexy$cex_self_args };
+        arr$pusha(args, custom_args);
 
-/// Returns current OS platform, returns enum of OSPlatform__*, e.g. OSPlatform__win,
-/// OSPlatform__linux, OSPlatform__macos, etc..
-static OSPlatform_e
-cex_os__platform__current(void)
-{
-#if defined(_WIN32)
-    return OSPlatform__win;
-#elif defined(__linux__)
-    return OSPlatform__linux;
-#elif defined(__APPLE__) || defined(__MACH__)
-    return OSPlatform__macos;
-#elif defined(__unix__)
-#    if defined(__FreeBSD__)
-    return OSPlatform__freebsd;
-#    elif defined(__NetBSD__)
-    return OSPlatform__netbsd;
-#    elif defined(__OpenBSD__)
-    return OSPlatform__openbsd;
-#    elif defined(__ANDROID__)
-    return OSPlatform__android;
-#    else
-#        error "Untested platform. Need more?"
-#    endif
-#elif defined(__wasm__)
-    return OSPlatform__wasm;
-#else
-#    error "Untested platform. Need more?"
-#endif
-}
+        arr$pushm(args, "-o", bin_path, cex_source, NULL);
+        _os$args_print("CMD:", args, arr$len(args));
+        os_cmd_c _cmd = { 0 };
+        e$except (err, os.cmd.run(args, arr$len(args), &_cmd)) { goto fail_recovery; }
+        e$except (err, os.cmd.join(&_cmd, 0, NULL)) { goto fail_recovery; }
 
-/// Returns string name of current platform
-static char*
-cex_os__platform__current_str(void)
-{
-    return os.platform.to_str(os.platform.current());
-}
+        // All good new build successful, remove old binary
+        if (os.fs.remove(old_name)) {}
 
-/// Converts platform name to enum
-static OSPlatform_e
-cex_os__platform__from_str(char* name)
-{
-    if (name == NULL || name[0] == '\0') { return OSPlatform__unknown; }
-    for (u32 i = 1; i < OSPlatform__count; i++) {
-        if (str.eq((char*)OSPlatform_str[i], name)) { return (OSPlatform_e)i; }
+        // run rebuilt cex executable again
+        arr$clear(args);
+        arr$pushm(args, bin_path);
+        for$each (darg, argv + dflag_idx, argc - dflag_idx) { arr$push(args, darg); }
+        arr$pushm(args, NULL);
+        _os$args_print("CMD:", args, arr$len(args));
+        e$except (err, os.cmd.run(args, arr$len(args), &_cmd)) { goto err; }
+        if (os.cmd.join(&_cmd, 0, NULL)) { goto err; }
+        exit(0); // unconditionally exit after build was successful
+    fail_recovery:
+        if (os.path.exists(old_name)) {
+            e$except (err, os.fs.rename(old_name, bin_path)) { goto err; }
+        }
+        goto err;
+    err:
+        exit(1);
     }
-    return OSPlatform__unknown;
-    ;
 }
 
-/// Converts platform enum to name
-static char*
-cex_os__platform__to_str(OSPlatform_e platform)
+/// Checks compiler generated `<target_path>.d` (see cexy$cc_deps), returns 1 if any dependency
+/// is newer than target or missing, 0 if nothing changed, -1 if there is no usable deps file
+static int
+_cexy__deps_changed(char* target_path, time_t target_mtime)
 {
-    if (unlikely(platform <= OSPlatform__unknown || platform >= OSPlatform__count)) { return NULL; }
-    return (char*)OSPlatform_str[platform];
+    mem$scope(tmem$, _)
+    {
+        char* deps_file = str.fmt(_, "%s.d", target_path);
+        if (!os.path.exists(deps_file)) { return -1; }
+        char* deps = io.file.load(deps_file, _);
+        if (deps == NULL) { return -1; }
+
+        // NOTE: make rule format `target: dep1 dep2 \<newline> dep3`, spaces escaped as `\ `
+        char* p = deps;
+        while (*p && !(p[0] == ':' && (p[1] == ' ' || p[1] == '\n' || p[1] == '\r'))) { p++; }
+        if (*p == '\0') { return -1; }
+        p++;
+
+        char path[PATH_MAX];
+        u32 n_deps = 0;
+        while (*p) {
+            if (isspace((u8)*p) || (p[0] == '\\' && (p[1] == '\n' || p[1] == '\r'))) {
+                p++;
+                continue;
+            }
+            usize len = 0;
+            while (*p && !isspace((u8)*p)) {
+                if (p[0] == '\\' && p[1] == ' ') { p++; }
+                if (len >= sizeof(path) - 1) { return -1; }
+                path[len++] = *p++;
+            }
+            path[len] = '\0';
+            if (path[len - 1] == ':') { break; } // NOTE: next rule (e.g. -MP phony targets)
+
+            n_deps++;
+            os_fs_stat_s dep_meta = os.fs.stat(path);
+            if (!dep_meta.is_valid || dep_meta.mtime > target_mtime) {
+                log$debug("Dependency changed: %s\n", path);
+                return 1;
+            }
+        }
+        return (n_deps > 0) ? 0 : -1;
+    }
+    return -1;
 }
 
-/// Returns OSArch from string
-static OSArch_e
-cex_os__platform__arch_from_str(char* name)
+static bool
+cexy_src_include_changed(char* target_path, char* src_path, arr$(char*) alt_include_path)
 {
-    if (name == NULL || name[0] == '\0') { return OSArch__unknown; }
-    for (u32 i = 1; i < OSArch__count; i++) {
-        if (str.eq((char*)OSArch_str[i], name)) { return (OSArch_e)i; }
+    if (unlikely(target_path == NULL)) {
+        log$error("target_path is NULL\n");
+        return false;
+    }
+    if (unlikely(src_path == NULL)) {
+        log$error("src_path is NULL\n");
+        return false;
     }
-    return OSArch__unknown;
-    ;
-}
 
-/// Converts arch to string
-static char*
-cex_os__platform__arch_to_str(OSArch_e platform)
-{
-    if (unlikely(platform <= OSArch__unknown || platform >= OSArch__count)) { return NULL; }
-    return (char*)OSArch_str[platform];
-}
+    auto src_meta = os.fs.stat(src_path);
+    if (!src_meta.is_valid) {
+        (void)e$raise(src_meta.error, "Error src: %s", src_path);
+        return false;
+    } else if (!src_meta.is_file || src_meta.is_symlink) {
+        (void)e$raise("Bad type", "src is not a file: %s", src_path);
+        return false;
+    }
 
-const struct __cex_namespace__os os = {
-    // Autogenerated by CEX
-    // clang-format off
+    auto target_meta = os.fs.stat(target_path);
+    if (!target_meta.is_valid) {
+        if (target_meta.error == Error.not_found) {
+            return true;
+        } else {
+            (void)e$raise(target_meta.error, "target_path: '%s'", target_path);
+            return false;
+        }
+    } else if (!target_meta.is_file || target_meta.is_symlink) {
+        (void)e$raise("Bad type", "target_path is not a file: %s", target_path);
+        return false;
+    }
 
-    .get_last_error = cex_os_get_last_error,
-    .sleep = cex_os_sleep,
-    .timer = cex_os_timer,
+    if (src_meta.mtime > target_meta.mtime) {
+        // File itself changed
+        log$debug("Src changed: %s\n", src_path);
+        return true;
+    }
 
-    .cmd = {
-        .create = cex_os__cmd__create,
-        .exists = cex_os__cmd__exists,
-        .fstderr = cex_os__cmd__fstderr,
-        .fstdin = cex_os__cmd__fstdin,
-        .fstdout = cex_os__cmd__fstdout,
-        .is_alive = cex_os__cmd__is_alive,
-        .join = cex_os__cmd__join,
-        .kill = cex_os__cmd__kill,
-        .read_all = cex_os__cmd__read_all,
-        .read_line = cex_os__cmd__read_line,
-        .run = cex_os__cmd__run,
-        .write_line = cex_os__cmd__write_line,
-    },
+    // Compiler knows all (nested, pkg-config) headers better than include scanner below
+    int deps_changed = _cexy__deps_changed(target_path, target_meta.mtime);
+    if (deps_changed >= 0) { return deps_changed > 0; }
 
-    .env = {
-        .get = cex_os__env__get,
-        .set = cex_os__env__set,
-    },
+    if (!str.ends_with(src_path, ".c") && !str.ends_with(src_path, ".h")) {
+        // We only parse includes for appropriate .c/.h files
+        return false;
+    }
 
-    .fs = {
-        .chdir = cex_os__fs__chdir,
-        .copy = cex_os__fs__copy,
-        .copy_tree = cex_os__fs__copy_tree,
-        .dir_walk = cex_os__fs__dir_walk,
-        .find = cex_os__fs__find,
-        .getcwd = cex_os__fs__getcwd,
-        .mkdir = cex_os__fs__mkdir,
-        .mkpath = cex_os__fs__mkpath,
-        .remove = cex_os__fs__remove,
-        .remove_tree = cex_os__fs__remove_tree,
-        .rename = cex_os__fs__rename,
-        .stat = cex_os__fs__stat,
-    },
+    bool is_changed = false;
+    mem$scope(tmem$, _)
+    {
+        arr$(char*) incl_path = arr$new(incl_path, _);
+        if (arr$len(alt_include_path) > 0) {
+            for$each (p, alt_include_path) {
+                arr$push(incl_path, p);
+                if (!os.path.exists(p)) { log$warn("alt_include_path not exists: %s\n", p); }
+            }
+        } else {
+            char* def_incl_path[] = { cexy$cc_include };
+            for$each (p, def_incl_path) {
+                char* clean_path = p;
+                if (str.starts_with(p, "-I")) {
+                    clean_path = p + 2;
+                } else if (str.starts_with(p, "-iquote=")) {
+                    clean_path = p + strlen("-iquote=");
+                }
+                if (!os.path.exists(clean_path)) {
+                    log$trace("cexy$cc_include not exists: %s\n", clean_path);
+                    continue;
+                }
+                arr$push(incl_path, clean_path);
+            }
+            // Adding relative to src_path directory as a search target
+            arr$push(incl_path, os.path.dirname(src_path, _));
+        }
 
-    .path = {
-        .abs = cex_os__path__abs,
-        .basename = cex_os__path__basename,
-        .dirname = cex_os__path__dirname,
-        .exists = cex_os__path__exists,
-        .join = cex_os__path__join,
-        .split = cex_os__path__split,
-    },
+        str_s code = { 0 };
+        e$except_silent (err, io.file.map(src_path, &code)) {
+            (void)e$raise("IOError", "src is not a file: '%s'", src_path);
+            return false;
+        }
 
-    .platform = {
-        .arch_from_str = cex_os__platform__arch_from_str,
-        .arch_to_str = cex_os__platform__arch_to_str,
-        .current = cex_os__platform__current,
-        .current_str = cex_os__platform__current_str,
-        .from_str = cex_os__platform__from_str,
-        .to_str = cex_os__platform__to_str,
-    },
+        (void)CexTkn_str;
+        CexParser_c lx = CexParser.create(code.buf, code.len, true);
+        cex_token_s t;
+        while ((t = CexParser.next_token(&lx)).type) {
+            if (t.type != CexTkn__preproc) { continue; }
+            if (str.slice.starts_with(t.value, str$s("include"))) {
+                str_s incf = str.slice.sub(t.value, strlen("include"), 0);
+                incf = str.slice.strip(incf);
+                if (incf.len <= 4) { // <.h>
+                    log$warn(
+                        "Bad include in: %s (item: %S at line: %d)\n",
+                        src_path,
+                        t.value,
+                        lx.line
+                    );
+                    continue;
+                }
+                log$trace("Processing include: '%S'\n", incf);
+                if (!str.slice.match(incf, "\"*.[hc]\"*")) {
+                    // system includes skipped
+                    log$trace("Skipping include: '%S'\n", incf);
+                    continue;
+                }
+                incf = str.slice.sub(incf, 1, 0);
+                incf = str.slice.sub(incf, 0, str.slice.index_of(incf, str$s("\"")) - 1);
 
-    // clang-format on
-};
+                mem$scope(tmem$, _)
+                {
+                    char extensions[] = { 'c', 'h' };
+                    for$each (ext, extensions) {
+                        char* inc_fn = str.fmt(_, "%S%c", incf, ext);
+                        uassert(inc_fn != NULL);
+                        for$each (inc_dir, incl_path) {
+                            char* try_path = os$path_join(_, inc_dir, inc_fn);
+                            uassert(try_path != NULL);
+                            auto src_meta = os.fs.stat(try_path);
+                            log$trace("Probing include: %s\n", try_path);
+                            if (src_meta.is_valid && src_meta.mtime > target_meta.mtime) {
+                                is_changed = true;
+                                goto end;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    end:
+        io.file.unmap(&code);
+    }
+    return is_changed;
+}
 
+static bool
+cexy_src_changed(char* target_path, char** src_array, usize src_array_len)
+{
+    if (unlikely(src_array == NULL || src_array_len == 0)) {
+        if (src_array == NULL) {
+            log$error("src_array is NULL, which may indicate error\n");
+        } else {
+            log$error("src_array is empty\n");
+        }
+        return false;
+    }
+    if (unlikely(target_path == NULL)) {
+        log$error("target_path is NULL\n");
+        return false;
+    }
+    auto target_ftype = os.fs.stat(target_path);
+    if (!target_ftype.is_valid) {
+        if (target_ftype.error == Error.not_found) {
+            log$trace("Target '%s' not exists, needs build.\n", target_path);
+            return true;
+        } else {
+            (void)e$raise(target_ftype.error, "target_path: '%s'", target_path);
+            return false;
+        }
+    } else if (!target_ftype.is_file || target_ftype.is_symlink) {
+        (void)e$raise("Bad type", "target_path is not a file: %s", target_path);
+        return false;
+    }
 
+    bool has_error = false;
+    for$each (p, src_array, src_array_len) {
+        auto ftype = os.fs.stat(p);
+        if (!ftype.is_valid) {
+            (void)e$raise(ftype.error, "Error src: %s", p);
+            has_error = true;
+        } else if (!ftype.is_file || ftype.is_symlink) {
+            (void)e$raise("Bad type", "src is not a file: %s", p);
+            has_error = true;
+        } else {
+            if (has_error) { continue; }
+            if (ftype.mtime > target_ftype.mtime) {
+                log$trace("Source changed '%s'\n", p);
+                return true;
+            }
+        }
+    }
 
-/*
-*                          src/cex_code_gen.c
-*/
+    return false;
+}
 
-void
-_cex__codegen_indent(_cex__codegen_s* cg)
+static char*
+cexy_target_make(char* src_path, char* build_dir, char* name_or_extension, IAllocator allocator)
 {
-    if (unlikely(cg->error != EOK)) { return; }
-    for (u32 i = 0; i < cg->indent; i++) {
-        Exc err = sbuf.append(cg->buf, " ");
-        if (unlikely(err != EOK && cg->error != EOK)) { cg->error = err; }
-    }
-}
+    uassert(allocator != NULL);
 
-#    define cg$printva(cg) /* temp macro! */                                                       \
-        do {                                                                                       \
-            va_list va;                                                                            \
-            va_start(va, format);                                                                  \
-            Exc err = sbuf.appendfva(cg->buf, format, va);                                         \
-            if (unlikely(err != EOK && cg->error != EOK)) { cg->error = err; }                     \
-            va_end(va);                                                                            \
-        } while (0)
+    if (src_path == NULL || src_path[0] == '\0') {
+        log$error("src_path is NULL or empty\n");
+        return NULL;
+    }
+    if (build_dir == NULL) {
+        log$error("build_dir is NULL\n");
+        return NULL;
+    }
+    if (name_or_extension == NULL || name_or_extension[0] == '\0') {
+        log$error("name_or_extension is NULL or empty\n");
+        return NULL;
+    }
+    if (!os.path.exists(src_path)) {
+        log$error("src_path does not exist: '%s'\n", src_path);
+        return NULL;
+    }
 
-void
-_cex__codegen_print(_cex__codegen_s* cg, bool rep_new_line, char* format, ...)
-{
-    if (unlikely(cg->error != EOK)) { return; }
-    if (rep_new_line) {
-        usize slen = sbuf.len(cg->buf);
-        if (slen && cg->buf[0][slen - 1] == '\n') { sbuf.shrink(cg->buf, slen - 1); }
+    char* result = NULL;
+    if (name_or_extension[0] == '.') {
+        // starts_with .ext, make full path as following: build_dir/src_path/src_file.ext[.exe]
+        result = str.fmt(
+            allocator,
+            "%s%c%s%s%s",
+            build_dir,
+            os$PATH_SEP,
+            src_path,
+            name_or_extension,
+            cexy$build_ext_exe
+        );
+        uassert(result != NULL && "memory error");
+    } else {
+        // probably a program name, make full path: build_dir/name_or_extension[.exe]
+        result = str.fmt(
+            allocator,
+            "%s%c%s%s",
+            build_dir,
+            os$PATH_SEP,
+            name_or_extension,
+            cexy$build_ext_exe
+        );
+        uassert(result != NULL && "memory error");
     }
-    cg$printva(cg);
-}
+    e$except (err, os.fs.mkpath(result)) { mem$free(allocator, result); }
 
-void
-_cex__codegen_print_line(_cex__codegen_s* cg, char* format, ...)
-{
-    if (unlikely(cg->error != EOK)) { return; }
-    if (format[0] != '\n') { _cex__codegen_indent(cg); }
-    cg$printva(cg);
+    return result;
 }
 
-_cex__codegen_s*
-_cex__codegen_print_scope_enter(_cex__codegen_s* cg, char* format, ...)
+Exception
+cexy__fuzz__create(char* target)
 {
-    usize slen = sbuf.len(cg->buf);
-    if (slen && cg->buf[0][slen - 1] == '\n') { _cex__codegen_indent(cg); }
-    cg$printva(cg);
-    _cex__codegen_print(cg, false, "%c\n", '{');
-    cg->indent += 4;
-    return cg;
-}
+    if (!str.slice.starts_with(os.path.split(target, false), str$s("fuzz_"))) {
+        return e$raise(Error.argument, "Fuzz file must start with `fuzz_` prefix, got: %s", target);
+    }
+    if (os.path.exists(target)) {
+        return e$raise(Error.exists, "Fuzz file already exists: %s", target);
+    }
+    e$ret(os.fs.mkpath(target));
 
-void
-_cex__codegen_print_scope_exit(_cex__codegen_s** cgptr)
-{
-    uassert(*cgptr != NULL);
-    _cex__codegen_s* cg = *cgptr;
+    mem$scope(tmem$, _)
+    {
+        sbuf_c buf = sbuf.create(1024 * 10, _);
+        cg$init(&buf);
+        cg$pn("#define CEX_IMPLEMENTATION");
+        cg$pn("#include \"cex.h\"");
 
-    if (cg->indent >= 4) { cg->indent -= 4; }
-    _cex__codegen_indent(cg);
-    _cex__codegen_print(cg, false, "%c\n", '}');
-}
+        cg$pn("");
+        cg$pn("/*");
+        cg$func("fuzz$setup(void)", "")
+        {
+            cg$pn("// This function allows programmatically seed new corpus for fuzzer");
+            cg$pn("io.printf(\"CORPUS: %s\\n\", fuzz$corpus_dir);");
+            cg$scope("memcg$scope(tmem$, _)", "")
+            {
+                cg$pn("char* fn = str.fmt(_, \"%s/my_case\", fuzz$corpus_dir);");
+                cg$pn("(void)fn;");
+                cg$pn("// io.file.save(fn, \"my seed data\");");
+            }
+        }
+        cg$pn("*/");
 
+        cg$pn("");
+        cg$func("int\nfuzz$case(const u8* data, usize size)", "")
+        {
+            cg$pn("// TODO: do your stuff based on input data and size");
+            cg$if("size > 2 && data[0] == 'C' && data[1] == 'E' && data[2] == 'X'", "")
+            {
+                cg$pn("__builtin_trap();");
+            }
+            cg$pn("return 0;");
+        }
 
-_cex__codegen_s*
-_cex__codegen_print_case_enter(_cex__codegen_s* cg, char* format, ...)
-{
-    _cex__codegen_indent(cg);
-    cg$printva(cg);
-    _cex__codegen_print(cg, false, ": %c\n", '{');
-    cg->indent += 4;
-    return cg;
+        cg$pn("");
+        cg$pn("fuzz$main();");
+
+        e$ret(io.file.save(target, buf));
+    }
+    return EOK;
 }
 
-void
-_cex__codegen_print_case_exit(_cex__codegen_s** cgptr)
+Exception
+cexy__test__create(char* target, bool include_sample)
 {
-    uassert(*cgptr != NULL);
-    _cex__codegen_s* cg = *cgptr;
+    if (os.path.exists(target)) {
+        return e$raise(Error.exists, "Test file already exists: %s", target);
+    }
+    if (str.eq(target, "all") || str.find(target, "*")) {
+        return e$raise(
+            Error.argument,
+            "You must pass exact file path, not pattern, got: %s",
+            target
+        );
+    }
+    e$ret(os.fs.mkpath(target));
 
-    if (cg->indent >= 4) { cg->indent -= 4; }
-    _cex__codegen_indent(cg);
-    _cex__codegen_print_line(cg, "break;\n", '}');
-    _cex__codegen_indent(cg);
-    _cex__codegen_print(cg, false, "%c\n", '}');
-}
+    mem$scope(tmem$, _)
+    {
+        sbuf_c buf = sbuf.create(1024 * 10, _);
+        cg$init(&buf);
+        cg$pn("#define CEX_IMPLEMENTATION");
+        cg$pn("#define CEX_TEST");
+        cg$pn("#include \"cex.h\"");
+        if (include_sample) { cg$pn("#include \"lib/mylib.c\""); }
+        cg$pn("");
+        cg$pn("//test$setup_case() {return EOK;}");
+        cg$pn("//test$teardown_case() {return EOK;}");
+        cg$pn("//test$setup_suite() {return EOK;}");
+        cg$pn("//test$teardown_suite() {return EOK;}");
+        cg$pn("");
+        cg$scope("test$case(%s)", (include_sample) ? "mylib_test_case" : "my_test_case")
+        {
+            if (include_sample) {
+                cg$pn("tassert_eq(mylib_add(1, 2), 3);");
+                cg$pn("// Next will be available after calling `cex process lib/mylib.c`");
+                cg$pn("// tassert_eq(mylib.add(1, 2), 3);");
+            } else {
+                cg$pn("tassert_eq(1, 0);");
+            }
+            cg$pn("return EOK;");
+        }
+        cg$pn("");
+        cg$pn("test$main();");
 
-#    undef cg$printva
+        e$ret(io.file.save(target, buf));
+    }
+    return EOK;
+}
 
+Exception
+cexy__test__clean(char* target)
+{
 
+    if (str.eq(target, "all")) {
+        log$info("Cleaning all tests\n");
+        e$ret(os.fs.remove_tree(cexy$build_dir "/tests/"));
+    } else {
+        log$info("Cleaning target: %s\n", target);
+        if (!os.path.exists(target)) {
+            return e$raise(Error.exists, "Test target not exists: %s", target);
+        }
 
-/*
-*                          src/cexy.c
-*/
-#include <stdbool.h>
-#include <stdio.h>
-#if defined(CEX_BUILD) || defined(CEX_NEW)
+        mem$scope(tmem$, _)
+        {
+            char* test_target = cexy.target_make(target, cexy$build_dir, ".test", _);
+            e$ret(os.fs.remove(test_target));
+        }
+    }
+    return EOK;
+}
 
-#    include <ctype.h>
-#    include <time.h>
+Exception
+cexy__test__make_target_pattern(char** target)
+{
+    if (target == NULL) {
+        return e$raise(
+            Error.argsparse,
+            "Invalid target: '%s', expected all or tests/test_some_file.c",
+            *target
+        );
+    }
+    if (str.eq(*target, "all")) { *target = "tests/test_*.c"; }
 
-static void
-cexy_build_self(int argc, char** argv, char* cex_source)
+    if (!str.match(*target, "*test*.c")) {
+        return e$raise(
+            Error.argsparse,
+            "Invalid target: '%s', expected all or tests/test_some_file.c",
+            *target
+        );
+    }
+    return EOK;
+}
+
+/// Runs test executables, `run all` runs suites in parallel subprocesses (at most `n_jobs`, 0 -
+/// number of CPUs), each suite output is printed as a whole
+Exception
+cexy__test__run(char* target, bool is_debug, u32 n_jobs, int argc, char** argv)
 {
+    Exc result = EOK;
+    u32 n_tests = 0;
+    u32 n_failed = 0;
+    bool is_all = str.ends_with(target, "test_*.c");
     mem$scope(tmem$, _)
     {
-        uassert(str.ends_with(argv[0], "cex") || str.ends_with(argv[0], "cex.exe"));
-        char* bin_path = argv[0];
-        bool has_darg_before_cmd = (argc > 1 && str.starts_with(argv[1], "-D"));
-        (void)has_darg_before_cmd;
-
-#    ifndef cexy$no_compile_flags
-        if (os.path.exists("compile_flags.txt")) {
-            e$except (err, cexy.utils.make_compile_flags("compile_flags.txt", true, NULL)) {}
-        }
-#    endif
-
-#    ifdef _CEX_SELF_BUILD
-        if (!has_darg_before_cmd) {
-            log$trace("Checking self build for executable: %s\n", bin_path);
-            if (!cexy.src_include_changed(bin_path, cex_source, NULL)) {
-                log$trace("%s unchanged, skipping self build\n", cex_source);
-                // cex.c/cex.h are up to date no rebuild needed
-                return;
-            }
+        if (is_all) {
+            // quiet mode
+            io.printf("-------------------------------------\n");
+            io.printf("Running Tests: %s\n", target);
+            io.printf("-------------------------------------\n\n");
         } else {
-            log$trace("Passed extra -Dflags to cex command, build now\n");
-        }
-#    endif
-
-        log$info("Rebuilding self: %s -> %s\n", cex_source, bin_path);
-        char* old_name = str.fmt(_, "%s.old", bin_path);
-        if (os.path.exists(bin_path)) {
-            if (os.fs.remove(old_name)) {}
-            e$except (err, os.fs.rename(bin_path, old_name)) { goto fail_recovery; }
+            if (!os.path.exists(target)) {
+                return e$raise(Error.not_found, "Test file not found: %s", target);
+            }
         }
-        arr$(char*) args = arr$new(args, _, .capacity = 64);
-        sbuf_c dargs_sbuf = sbuf.create(256, _);
-        arr$pushm(args, cexy$cex_self_cc, "-D_CEX_SELF_BUILD", "-g");
-        e$goto(sbuf.append(&dargs_sbuf, "-D_CEX_SELF_DARGS=\""), err);
 
-        i32 dflag_idx = 1;
-        for$each (darg, argv + 1, argc - 1) {
-            if (str.starts_with(darg, "-D")) {
-                if (!str.eq(darg, "-D")) {
-                    arr$push(args, darg);
-                    e$goto(sbuf.appendf(&dargs_sbuf, "%s ", darg), fail_recovery);
-                }
-                dflag_idx++;
-            } else {
-                break; // stop at first non -D<flag>
+        arr$(cexy_job_s) jobs = arr$new(jobs, _);
+        for$each (test_src, os.fs.find(target, true, _)) {
+            n_tests++;
+            char* test_target = cexy.target_make(test_src, cexy$build_dir, ".test", _);
+            arr$(char*) args = arr$new(args, _);
+            if (is_debug) { arr$pushm(args, cexy$debug_cmd); }
+            arr$pushm(args, test_target, );
+            if (is_all) { arr$push(args, "--quiet"); }
+            arr$pusha(args, argv, argc);
+            arr$push(args, NULL);
+            if (is_all && !is_debug) {
+                arr$push(jobs, (cexy_job_s){ .name = test_target, .args = args });
+                continue;
             }
-        }
-        if (dflag_idx > 1 && (dflag_idx >= argc || !str.eq(argv[dflag_idx], "config"))) {
-            log$error("Expected config command after passing -D<ARG> to ./cex\n");
-            goto fail_recovery;
-        }
-#    ifdef _CEX_SELF_DARGS
-        if (dflag_idx == 1) {
-            // new compilation no flags (maybe due to source changes, we need to maintain old flags)
-            log$trace("Preserving CEX_SELF_DARGS: %s\n", _CEX_SELF_DARGS);
-            for$iter (
-                str_s,
-                it,
-                str.slice.iter_split(str.sstr(_CEX_SELF_DARGS), " ", &it.iterator)
-            ) {
-                str_s clean_it = str.slice.strip(it.val);
-                if (clean_it.len == 0) { continue; }
-                if (!str.slice.starts_with(clean_it, str$s("-D"))) { continue; }
-                if (str.slice.eq(clean_it, str$s("-D"))) { continue; }
-                auto _darg = str.fmt(_, "%S", clean_it);
-                arr$push(args, _darg);
-                e$goto(sbuf.appendf(&dargs_sbuf, "%s ", _darg), err);
+            if (os$cmda(args)) {
+                log$error("<<<<<<<<<<<<<<<<<< Test failed: %s\n", test_target);
+                n_failed++;
+                result = Error.runtime;
             }
         }
-#    endif
-        e$goto(sbuf.append(&dargs_sbuf, "\""), err);
-
-        arr$push(args, dargs_sbuf);
-
-        char* custom_args[] = { cexy$cex_self_args };
-        arr$pusha(args, custom_args);
-
-        arr$pushm(args, "-o", bin_path, cex_source, NULL);
-        _os$args_print("CMD:", args, arr$len(args));
-        os_cmd_c _cmd = { 0 };
-        e$except (err, os.cmd.run(args, arr$len(args), &_cmd)) { goto fail_recovery; }
-        e$except (err, os.cmd.join(&_cmd, 0, NULL)) { goto fail_recovery; }
-
-        // All good new build successful, remove old binary
-        if (os.fs.remove(old_name)) {}
 
-        // run rebuilt cex executable again
-        arr$clear(args);
-        arr$pushm(args, bin_path);
-        for$each (darg, argv + dflag_idx, argc - dflag_idx) { arr$push(args, darg); }
-        arr$pushm(args, NULL);
-        _os$args_print("CMD:", args, arr$len(args));
-        e$except (err, os.cmd.run(args, arr$len(args), &_cmd)) { goto err; }
-        if (os.cmd.join(&_cmd, 0, NULL)) { goto err; }
-        exit(0); // unconditionally exit after build was successful
-    fail_recovery:
-        if (os.path.exists(old_name)) {
-            e$except (err, os.fs.rename(old_name, bin_path)) { goto err; }
+        if (arr$len(jobs) > 0) {
+            result = cexy.utils.jobs_run(jobs, n_jobs, _);
+            for$eachp (job, jobs) { n_failed += (job->result != EOK); }
         }
-        goto err;
-    err:
-        exit(1);
     }
+    if (is_all) {
+        io.printf("\n-------------------------------------\n");
+        io.printf("Total: %d Passed: %d Failed: %d\n", n_tests, n_tests - n_failed, n_failed);
+        io.printf("-------------------------------------\n\n");
+    }
+    return result;
 }
 
-static bool
-cexy_src_include_changed(char* target_path, char* src_path, arr$(char*) alt_include_path)
+Exception
+cexy__bench__create(char* target)
 {
-    if (unlikely(target_path == NULL)) {
-        log$error("target_path is NULL\n");
-        return false;
+    if (os.path.exists(target)) {
+        return e$raise(Error.exists, "Benchmark file already exists: %s", target);
     }
-    if (unlikely(src_path == NULL)) {
-        log$error("src_path is NULL\n");
-        return false;
+    if (str.eq(target, "all") || str.find(target, "*")) {
+        return e$raise(
+            Error.argument,
+            "You must pass exact file path, not pattern, got: %s",
+            target
+        );
     }
+    e$ret(os.fs.mkpath(target));
 
-    auto src_meta = os.fs.stat(src_path);
-    if (!src_meta.is_valid) {
-        (void)e$raise(src_meta.error, "Error src: %s", src_path);
-        return false;
-    } else if (!src_meta.is_file || src_meta.is_symlink) {
-        (void)e$raise("Bad type", "src is not a file: %s", src_path);
-        return false;
+    mem$scope(tmem$, _)
+    {
+        sbuf_c buf = sbuf.create(1024 * 10, _);
+        cg$init(&buf);
+        cg$pn("#define CEX_IMPLEMENTATION");
+        cg$pn("#define CEX_BENCH");
+        cg$pn("#include \"cex.h\"");
+        cg$pn("");
+        cg$pn("//bench$setup_suite() {return EOK;}");
+        cg$pn("//bench$teardown_suite() {return EOK;}");
+        cg$pn("");
+        cg$scope("bench$case(%s)", "my_bench_case")
+        {
+            cg$scope("for (u64 i = 0; i < bench$iters; i++) ", "")
+            {
+                cg$pn("bench$keep(i * i);");
+            }
+            cg$pn("return EOK;");
+        }
+        cg$pn("");
+        cg$pn("bench$main();");
+
+        e$ret(io.file.save(target, buf));
     }
+    return EOK;
+}
 
-    auto target_meta = os.fs.stat(target_path);
-    if (!target_meta.is_valid) {
-        if (target_meta.error == Error.not_found) {
-            return true;
-        } else {
-            (void)e$raise(target_meta.error, "target_path: '%s'", target_path);
-            return false;
+Exception
+cexy__bench__clean(char* target)
+{
+    if (str.eq(target, "all")) {
+        log$info("Cleaning all benchmarks\n");
+        e$ret(os.fs.remove_tree(cexy$build_dir "/bench/"));
+    } else {
+        log$info("Cleaning target: %s\n", target);
+        if (!os.path.exists(target)) {
+            return e$raise(Error.exists, "Benchmark target not exists: %s", target);
+        }
+
+        mem$scope(tmem$, _)
+        {
+            char* bench_target = cexy.target_make(target, cexy$build_dir, ".bench", _);
+            e$ret(os.fs.remove(bench_target));
         }
-    } else if (!target_meta.is_file || target_meta.is_symlink) {
-        (void)e$raise("Bad type", "target_path is not a file: %s", target_path);
-        return false;
     }
+    return EOK;
+}
 
-    if (src_meta.mtime > target_meta.mtime) {
-        // File itself changed
-        log$debug("Src changed: %s\n", src_path);
-        return true;
+Exception
+cexy__bench__make_target_pattern(char** target)
+{
+    if (target == NULL) {
+        return e$raise(
+            Error.argsparse,
+            "Invalid target: '%s', expected all or bench/bench_some_file.c",
+            *target
+        );
     }
+    if (str.eq(*target, "all")) { *target = "bench/bench_*.c"; }
 
-    if (!str.ends_with(src_path, ".c") && !str.ends_with(src_path, ".h")) {
-        // We only parse includes for appropriate .c/.h files
-        return false;
+    if (!str.match(*target, "*bench*.c")) {
+        return e$raise(
+            Error.argsparse,
+            "Invalid target: '%s', expected all or bench/bench_some_file.c",
+            *target
+        );
     }
+    return EOK;
+}
 
+/// Runs benchmark executables, with `json_file` results of all suites are merged into one JSON
+/// document (git commit + timestamp) for tracking over time
+Exception
+cexy__bench__run(char* target, char* json_file, int argc, char** argv)
+{
+    Exc result = EOK;
+    u32 n_suites = 0;
+    u32 n_failed = 0;
+    bool is_all = str.ends_with(target, "bench_*.c");
     mem$scope(tmem$, _)
     {
-        arr$(char*) incl_path = arr$new(incl_path, _);
-        if (arr$len(alt_include_path) > 0) {
-            for$each (p, alt_include_path) {
-                arr$push(incl_path, p);
-                if (!os.path.exists(p)) { log$warn("alt_include_path not exists: %s\n", p); }
-            }
+        if (is_all) {
+            io.printf("-------------------------------------\n");
+            io.printf("Running Benchmarks: %s\n", target);
+            io.printf("-------------------------------------\n\n");
         } else {
-            char* def_incl_path[] = { cexy$cc_include };
-            for$each (p, def_incl_path) {
-                char* clean_path = p;
-                if (str.starts_with(p, "-I")) {
-                    clean_path = p + 2;
-                } else if (str.starts_with(p, "-iquote=")) {
-                    clean_path = p + strlen("-iquote=");
-                }
-                if (!os.path.exists(clean_path)) {
-                    log$trace("cexy$cc_include not exists: %s\n", clean_path);
-                    continue;
+            if (!os.path.exists(target)) {
+                return e$raise(Error.not_found, "Benchmark file not found: %s", target);
+            }
+        }
+
+        sbuf_c json = NULL;
+        if (json_file) {
+            json = sbuf.create(1024 * 16, _);
+            char* git_hash = os.path.exists(".git") ? cexy.utils.git_hash(_) : NULL;
+            e$ret(sbuf.appendf(
+                &json,
+                "{\"git\": \"%s\", \"timestamp\": %ld, \"suites\": [",
+                git_hash ? git_hash : "",
+                (long)time(NULL)
+            ));
+        }
+
+        for$each (bench_src, os.fs.find(target, true, _)) {
+            char* bench_target = cexy.target_make(bench_src, cexy$build_dir, ".bench", _);
+            char* suite_json = (json_file) ? str.fmt(_, "%s.json", bench_target) : NULL;
+            arr$(char*) args = arr$new(args, _);
+            arr$pushm(args, bench_target, );
+            if (is_all) { arr$push(args, "--quiet"); }
+            if (suite_json) { arr$pushm(args, "--json", suite_json); }
+            arr$pusha(args, argv, argc);
+            arr$push(args, NULL);
+            if (os$cmda(args)) {
+                log$error("<<<<<<<<<<<<<<<<<< Benchmark failed: %s\n", bench_target);
+                n_failed++;
+                result = Error.runtime;
+                continue;
+            }
+            if (suite_json) {
+                char* suite_result = io.file.load(suite_json, _);
+                if (suite_result == NULL) {
+                    return e$raise(Error.io, "Failed to load: %s", suite_json);
                 }
-                arr$push(incl_path, clean_path);
+                e$ret(sbuf.appendf(&json, "%s\n%s", (n_suites > 0) ? "," : "", suite_result));
             }
-            // Adding relative to src_path directory as a search target
-            arr$push(incl_path, os.path.dirname(src_path, _));
+            n_suites++;
         }
 
-        char* code = io.file.load(src_path, _);
-        if (code == NULL) {
-            (void)e$raise("IOError", "src is not a file: '%s'", src_path);
-            return false;
+        if (json_file) {
+            e$ret(sbuf.append(&json, "]}\n"));
+            e$ret(os.fs.mkpath(json_file));
+            e$ret(io.file.save(json_file, json));
+            log$info("Benchmark results: %s\n", json_file);
+        }
+    }
+    if (is_all) {
+        io.printf("\n-------------------------------------\n");
+        io.printf("Total: %d Passed: %d Failed: %d\n", n_suites + n_failed, n_suites, n_failed);
+        io.printf("-------------------------------------\n\n");
+    }
+    return result;
+}
+
+/// Samples (ns/op) of one benchmark case, `name` is "suite_file:case_name"
+typedef struct _cexy_bench_samples_s
+{
+    char* name;
+    arr$(f64) samples;
+} _cexy_bench_samples_s;
+
+static _cexy_bench_samples_s*
+_cexy__bench__samples_get(arr$(_cexy_bench_samples_s) * cases, char* name, IAllocator allc)
+{
+    for$eachp (it, *cases) {
+        if (str.eq(it->name, name)) { return it; }
+    }
+    _cexy_bench_samples_s c = { .name = str.clone(name, allc), .samples = arr$new(c.samples, allc) };
+    arr$push(*cases, c);
+    return &(*cases)[arr$len(*cases) - 1];
+}
+
+/// Appends `samples_ns` of all cases in suite JSON (bench$main() --json output) to `cases`
+static Exception
+_cexy__bench__samples_parse(arr$(_cexy_bench_samples_s) * cases, char* json, IAllocator allc)
+{
+    char* suite = NULL;
+    str_s suite_key = str$s("{\"suite\": \"");
+    str_s name_key = str$s("{\"name\": \"");
+    str_s samples_key = str$s("\"samples_ns\": [");
+    for$each (line, str.split_lines(json, allc)) {
+        str_s s = str.slice.strip(str.sstr(line));
+        isize i = str.slice.index_of(s, suite_key);
+        if (i >= 0) {
+            str_s tail = str.slice.sub(s, i + suite_key.len, 0);
+            suite = str.slice.clone(str.slice.sub(tail, 0, str.slice.index_of(tail, str$s("\""))), allc);
+            continue;
         }
+        i = str.slice.index_of(s, name_key);
+        isize j = str.slice.index_of(s, samples_key);
+        if (i < 0 || j < 0 || suite == NULL) { continue; }
 
-        (void)CexTkn_str;
-        CexParser_c lx = CexParser.create(code, 0, true);
-        cex_token_s t;
-        while ((t = CexParser.next_token(&lx)).type) {
-            if (t.type != CexTkn__preproc) { continue; }
-            if (str.slice.starts_with(t.value, str$s("include"))) {
-                str_s incf = str.slice.sub(t.value, strlen("include"), 0);
-                incf = str.slice.strip(incf);
-                if (incf.len <= 4) { // <.h>
-                    log$warn(
-                        "Bad include in: %s (item: %S at line: %d)\n",
-                        src_path,
-                        t.value,
-                        lx.line
-                    );
-                    continue;
-                }
-                log$trace("Processing include: '%S'\n", incf);
-                if (!str.slice.match(incf, "\"*.[hc]\"*")) {
-                    // system includes skipped
-                    log$trace("Skipping include: '%S'\n", incf);
-                    continue;
-                }
-                incf = str.slice.sub(incf, 1, 0);
-                incf = str.slice.sub(incf, 0, str.slice.index_of(incf, str$s("\"")) - 1);
+        str_s tail = str.slice.sub(s, i + name_key.len, 0);
+        str_s name = str.slice.sub(tail, 0, str.slice.index_of(tail, str$s("\"")));
+        tail = str.slice.sub(s, j + samples_key.len, 0);
+        isize end = str.slice.index_of(tail, str$s("]"));
+        if (name.len == 0 || end < 0) {
+            return e$raise(Error.integrity, "Malformed benchmark JSON line: %s", line);
+        }
 
-                mem$scope(tmem$, _)
-                {
-                    char extensions[] = { 'c', 'h' };
-                    for$each (ext, extensions) {
-                        char* inc_fn = str.fmt(_, "%S%c", incf, ext);
-                        uassert(inc_fn != NULL);
-                        for$each (inc_dir, incl_path) {
-                            char* try_path = os$path_join(_, inc_dir, inc_fn);
-                            uassert(try_path != NULL);
-                            auto src_meta = os.fs.stat(try_path);
-                            log$trace("Probing include: %s\n", try_path);
-                            if (src_meta.is_valid && src_meta.mtime > target_meta.mtime) {
-                                return true;
-                            }
-                        }
-                    }
-                }
-            }
+        char* case_name = str.fmt(allc, "%s:%S", suite, name);
+        _cexy_bench_samples_s* c = _cexy__bench__samples_get(cases, case_name, allc);
+        for$iter (str_s, it, str.slice.iter_split(str.slice.sub(tail, 0, end), ",", &it.iterator)) {
+            f64 value = 0;
+            e$ret(str.convert.to_f64s(str.slice.strip(it.val), &value));
+            arr$push(c->samples, value);
         }
     }
-    return false;
+    return EOK;
 }
 
-static bool
-cexy_src_changed(char* target_path, char** src_array, usize src_array_len)
+/// Baseline file format: one line per case `suite_file:case_name<TAB>ns1 ns2 ...`
+static Exception
+_cexy__bench__baseline_load(arr$(_cexy_bench_samples_s) * cases, char* path, IAllocator allc)
 {
-    if (unlikely(src_array == NULL || src_array_len == 0)) {
-        if (src_array == NULL) {
-            log$error("src_array is NULL, which may indicate error\n");
-        } else {
-            log$error("src_array is empty\n");
+    char* content = io.file.load(path, allc);
+    if (content == NULL) { return e$raise(Error.io, "Failed to load baseline: %s", path); }
+
+    for$each (line, str.split_lines(content, allc)) {
+        str_s s = str.slice.strip(str.sstr(line));
+        isize tab = str.slice.index_of(s, str$s("\t"));
+        if (tab <= 0) { continue; }
+        char* case_name = str.slice.clone(str.slice.sub(s, 0, tab), allc);
+        _cexy_bench_samples_s* c = _cexy__bench__samples_get(cases, case_name, allc);
+        for$iter (str_s, it, str.slice.iter_split(str.slice.sub(s, tab + 1, 0), " ", &it.iterator)) {
+            if (it.val.len == 0) { continue; }
+            f64 value = 0;
+            e$ret(str.convert.to_f64s(it.val, &value));
+            arr$push(c->samples, value);
         }
-        return false;
     }
-    if (unlikely(target_path == NULL)) {
-        log$error("target_path is NULL\n");
-        return false;
+    return EOK;
+}
+
+static Exception
+_cexy__bench__baseline_save(arr$(_cexy_bench_samples_s) cases, char* path, IAllocator allc)
+{
+    sbuf_c buf = sbuf.create(1024 * 16, allc);
+    for$eachp (c, cases) {
+        e$ret(sbuf.appendf(&buf, "%s\t", c->name));
+        for$each (value, c->samples) { e$ret(sbuf.appendf(&buf, " %0.3f", value)); }
+        e$ret(sbuf.append(&buf, "\n"));
     }
-    auto target_ftype = os.fs.stat(target_path);
-    if (!target_ftype.is_valid) {
-        if (target_ftype.error == Error.not_found) {
-            log$trace("Target '%s' not exists, needs build.\n", target_path);
-            return true;
-        } else {
-            (void)e$raise(target_ftype.error, "target_path: '%s'", target_path);
-            return false;
+    e$ret(os.fs.mkpath(path));
+    e$ret(io.file.save(path, buf));
+    log$info("Benchmark baseline saved: %s\n", path);
+    return EOK;
+}
+
+/// Baseline file of `baseline` (file path, git hash or hash prefix), or newest baseline when NULL,
+/// returns NULL if nothing found
+static char*
+_cexy__bench__baseline_find(char* baseline, char* baseline_dir, IAllocator allc)
+{
+    if (baseline && os.path.exists(baseline)) { return baseline; }
+    if (!os.path.exists(baseline_dir)) { return NULL; }
+
+    char* result = NULL;
+    time_t result_mtime = 0;
+    char* pattern = str.fmt(allc, "%s/%s*.tsv", baseline_dir, baseline ? baseline : "");
+    for$each (path, os.fs.find(pattern, false, allc)) {
+        os_fs_stat_s st = os.fs.stat(path);
+        if (!st.is_valid) { continue; }
+        if (result == NULL || st.mtime > result_mtime) {
+            result = path;
+            result_mtime = st.mtime;
         }
-    } else if (!target_ftype.is_file || target_ftype.is_symlink) {
-        (void)e$raise("Bad type", "target_path is not a file: %s", target_path);
-        return false;
     }
+    return result;
+}
 
-    bool has_error = false;
-    for$each (p, src_array, src_array_len) {
-        auto ftype = os.fs.stat(p);
-        if (!ftype.is_valid) {
-            (void)e$raise(ftype.error, "Error src: %s", p);
-            has_error = true;
-        } else if (!ftype.is_file || ftype.is_symlink) {
-            (void)e$raise("Bad type", "src is not a file: %s", p);
-            has_error = true;
-        } else {
-            if (has_error) { continue; }
-            if (ftype.mtime > target_ftype.mtime) {
-                log$trace("Source changed '%s'\n", p);
-                return true;
+static int
+_cexy__bench__ranked_cmp(const void* a, const void* b)
+{
+    f64 va = ((f64*)a)[0];
+    f64 vb = ((f64*)b)[0];
+    return (va > vb) - (va < vb);
+}
+
+static f64
+_cexy__bench__median(arr$(f64) samples)
+{
+    usize n = arr$len(samples);
+    qsort(samples, n, sizeof(samples[0]), _cexy__bench__ranked_cmp);
+    return (n % 2) ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+}
+
+/// Mann-Whitney U test of `current` against `base` (normal approximation with tie correction).
+/// Returns signed z^2: > 0 when `current` tends to be slower, < 0 when it tends to be faster.
+/// NOTE: z^2 is compared with critical value squared, cexy build has no -lm for sqrt()
+static f64
+_cexy__bench__mann_whitney_z2(arr$(f64) base, arr$(f64) current, IAllocator allc)
+{
+    usize na = arr$len(base);
+    usize nb = arr$len(current);
+    usize n = na + nb;
+    // NOTE: pairs of {value, is_current}
+    f64 (*ranked)[2] = mem$malloc(allc, sizeof(*ranked) * n);
+    if (ranked == NULL) { return 0; }
+    for (usize i = 0; i < na; i++) { ranked[i][0] = base[i], ranked[i][1] = 0; }
+    for (usize i = 0; i < nb; i++) { ranked[na + i][0] = current[i], ranked[na + i][1] = 1; }
+    qsort(ranked, n, sizeof(*ranked), _cexy__bench__ranked_cmp);
+
+    f64 rank_sum = 0; // ranks of current
+    f64 ties = 0;     // sum(t^3 - t) over tie groups
+    for (usize i = 0; i < n;) {
+        usize j = i;
+        while (j < n && ranked[j][0] == ranked[i][0]) { j++; }
+        f64 t = (f64)(j - i);
+        f64 rank = (f64)(i + j + 1) / 2; // average of 1-based ranks i+1..j
+        for (usize k = i; k < j; k++) { rank_sum += rank * ranked[k][1]; }
+        ties += t * t * t - t;
+        i = j;
+    }
+    mem$free(allc, ranked);
+
+    f64 u = rank_sum - (f64)nb * (f64)(nb + 1) / 2;
+    f64 mean = (f64)na * (f64)nb / 2;
+    f64 var = (f64)na * (f64)nb / 12 * ((f64)(n + 1) - ties / ((f64)n * (f64)(n - 1)));
+    if (var <= 0) { return 0; }
+    f64 d = u - mean;
+    return (d < 0 ? -1 : 1) * d * d / var;
+}
+
+/// Regression gate: runs all suites of `target` `n_runs` times (after one warmup run), compares
+/// samples with baseline by Mann-Whitney U test, fails if any case is slower by more than
+/// `threshold_pct` (median) and the difference is significant (p < 0.01). Baselines are stored
+/// per git hash in `cexy$build_dir/bench/baseline/`, with `save_baseline` (or when no baseline
+/// exists yet) current results become baseline of HEAD.
+Exception
+cexy__bench__compare(
+    char* target,
+    char* baseline,
+    f64 threshold_pct,
+    u32 n_runs,
+    bool save_baseline,
+    int argc,
+    char** argv
+)
+{
+    char* baseline_dir = cexy$build_dir "/bench/baseline";
+    f64 z_crit2 = 2.576 * 2.576; // two-sided p < 0.01
+    u32 n_regressed = 0;
+    if (n_runs == 0) { return e$raise(Error.argument, "--runs must be > 0"); }
+
+    mem$scope(tmem$, _)
+    {
+        char* git_hash = os.path.exists(".git") ? cexy.utils.git_hash(_) : NULL;
+        char* head_baseline = str.fmt(_, "%s/%s.tsv", baseline_dir, git_hash ? git_hash : "nogit");
+
+        arr$(_cexy_bench_samples_s) current = arr$new(current, _);
+        for (u32 run = 0; run <= n_runs; run++) {
+            log$info(
+                "Benchmark %s: %d/%d\n",
+                (run == 0) ? "warmup run" : "run",
+                (run == 0) ? 1 : run,
+                (run == 0) ? 1 : n_runs
+            );
+            for$each (bench_src, os.fs.find(target, true, _)) {
+                char* bench_target = cexy.target_make(bench_src, cexy$build_dir, ".bench", _);
+                char* suite_json = str.fmt(_, "%s.json", bench_target);
+                arr$(char*) args = arr$new(args, _);
+                arr$pushm(args, bench_target, "--quiet", "--json", suite_json);
+                arr$pusha(args, argv, argc);
+                arr$push(args, NULL);
+                if (os$cmda(args)) {
+                    return e$raise(Error.runtime, "Benchmark failed: %s", bench_target);
+                }
+                if (run == 0) { continue; } // NOTE: warmup (cpu frequency, page cache)
+
+                char* suite_result = io.file.load(suite_json, _);
+                if (suite_result == NULL) {
+                    return e$raise(Error.io, "Failed to load: %s", suite_json);
+                }
+                e$ret(_cexy__bench__samples_parse(&current, suite_result, _));
             }
         }
+
+        char* baseline_file = NULL;
+        if (!save_baseline) {
+            baseline_file = _cexy__bench__baseline_find(baseline, baseline_dir, _);
+            if (baseline_file == NULL && baseline != NULL) {
+                return e$raise(Error.not_found, "Benchmark baseline not found: %s", baseline);
+            }
+        }
+        if (baseline_file == NULL) {
+            log$info("No benchmark baseline to compare, saving current results\n");
+            e$ret(_cexy__bench__baseline_save(current, head_baseline, _));
+            return EOK;
+        }
+
+        arr$(_cexy_bench_samples_s) base = arr$new(base, _);
+        e$ret(_cexy__bench__baseline_load(&base, baseline_file, _));
+
+        io.printf("\nBaseline: %s (threshold: %0.1f%%, p < 0.01)\n", baseline_file, threshold_pct);
+        io.printf(
+            "%-48s %12s %12s %9s  %s\n",
+            "Benchmark",
+            "base ns/op",
+            "ns/op",
+            "change",
+            "verdict"
+        );
+        for$eachp (c, current) {
+            _cexy_bench_samples_s* b = NULL;
+            for$eachp (it, base) {
+                if (str.eq(it->name, c->name)) { b = it; }
+            }
+            f64 cur_median = _cexy__bench__median(c->samples);
+            if (b == NULL || arr$len(b->samples) == 0) {
+                io.printf("%-48s %12s %12.2f %9s  %s\n", c->name, "-", cur_median, "-", "new");
+                continue;
+            }
+            f64 base_median = _cexy__bench__median(b->samples);
+            f64 change = (base_median > 0) ? (cur_median - base_median) / base_median * 100 : 0;
+            f64 z2 = _cexy__bench__mann_whitney_z2(b->samples, c->samples, _);
+
+            char* verdict = "~";
+            if (arr$len(b->samples) < 3 || arr$len(c->samples) < 3) {
+                verdict = "few samples";
+            } else if (change > threshold_pct && z2 > z_crit2) {
+                verdict = "REGRESSION";
+                n_regressed++;
+            } else if (change < -threshold_pct && z2 < -z_crit2) {
+                verdict = "faster";
+            }
+            io.printf(
+                "%-48s %12.2f %12.2f %+8.1f%%  %s\n",
+                c->name,
+                base_median,
+                cur_median,
+                change,
+                verdict
+            );
+        }
+        io.printf("\n");
     }
 
-    return false;
+    if (n_regressed > 0) {
+        return e$raise(Error.runtime, "Benchmarks regressed: %d", n_regressed);
+    }
+    log$info("Benchmarks: no regressions\n");
+    return EOK;
 }
 
+/// Compiler version string (`cc --version`), cached for process lifetime, part of cache key
 static char*
-cexy_target_make(char* src_path, char* build_dir, char* name_or_extension, IAllocator allocator)
+_cexy__cache__cc_version(char* cc)
 {
-    uassert(allocator != NULL);
+    static char* version = NULL;
+    static char* version_cc = NULL;
+    if (version != NULL && str.eq(version_cc, cc)) { return version; }
 
-    if (src_path == NULL || src_path[0] == '\0') {
-        log$error("src_path is NULL or empty\n");
-        return NULL;
-    }
-    if (build_dir == NULL) {
-        log$error("build_dir is NULL\n");
-        return NULL;
-    }
-    if (name_or_extension == NULL || name_or_extension[0] == '\0') {
-        log$error("name_or_extension is NULL or empty\n");
+    char* args[] = { cc, "--version", NULL };
+    os_cmd_c c = { 0 };
+    e$except_silent (err, os.cmd.create(&c, args, arr$len(args), &(os_cmd_flags_s){ 0 })) {
         return NULL;
     }
-    if (!os.path.exists(src_path)) {
-        log$error("src_path does not exist: '%s'\n", src_path);
+    char* output = os.cmd.read_all(&c, mem$);
+    e$except_silent (err, os.cmd.join(&c, 0, NULL)) {
+        mem$free(mem$, output);
         return NULL;
     }
-
-    char* result = NULL;
-    if (name_or_extension[0] == '.') {
-        // starts_with .ext, make full path as following: build_dir/src_path/src_file.ext[.exe]
-        result = str.fmt(
-            allocator,
-            "%s%c%s%s%s",
-            build_dir,
-            os$PATH_SEP,
-            src_path,
-            name_or_extension,
-            cexy$build_ext_exe
-        );
-        uassert(result != NULL && "memory error");
-    } else {
-        // probably a program name, make full path: build_dir/name_or_extension[.exe]
-        result = str.fmt(
-            allocator,
-            "%s%c%s%s",
-            build_dir,
-            os$PATH_SEP,
-            name_or_extension,
-            cexy$build_ext_exe
-        );
-        uassert(result != NULL && "memory error");
-    }
-    e$except (err, os.fs.mkpath(result)) { mem$free(allocator, result); }
-
-    return result;
+    version = output;
+    version_cc = cc;
+    return version;
 }
 
-Exception
-cexy__fuzz__create(char* target)
+/// Resolves `-l<name>` (or `-l:<file>`) to library file in `lib_dirs` (-L) or compiler search
+/// path (`cc -print-file-name`), cached for process lifetime. Returns NULL if not found.
+static char*
+_cexy__cache__lib_path(char* cc, arr$(char*) lib_dirs, char* lib_arg, bool is_static)
 {
-    if (!str.slice.starts_with(os.path.split(target, false), str$s("fuzz_"))) {
-        return e$raise(Error.argument, "Fuzz file must start with `fuzz_` prefix, got: %s", target);
-    }
-    if (os.path.exists(target)) {
-        return e$raise(Error.exists, "Fuzz file already exists: %s", target);
-    }
-    e$ret(os.fs.mkpath(target));
+    static struct
+    {
+        char* key;
+        char* path;
+    } resolved[16];
+    static u32 n_resolved = 0;
 
+    char* result = NULL;
     mem$scope(tmem$, _)
     {
-        sbuf_c buf = sbuf.create(1024 * 10, _);
-        cg$init(&buf);
-        cg$pn("#define CEX_IMPLEMENTATION");
-        cg$pn("#include \"cex.h\"");
+        char* key = str.fmt(_, "%s %d %s", cc, is_static, lib_arg);
+        for (u32 i = 0; i < n_resolved; i++) {
+            if (str.eq(resolved[i].key, key)) { return resolved[i].path; }
+        }
 
-        cg$pn("");
-        cg$pn("/*");
-        cg$func("fuzz$setup(void)", "")
-        {
-            cg$pn("// This function allows programmatically seed new corpus for fuzzer");
-            cg$pn("io.printf(\"CORPUS: %s\\n\", fuzz$corpus_dir);");
-            cg$scope("memcg$scope(tmem$, _)", "")
-            {
-                cg$pn("char* fn = str.fmt(_, \"%s/my_case\", fuzz$corpus_dir);");
-                cg$pn("(void)fn;");
-                cg$pn("// io.file.save(fn, \"my seed data\");");
+        char* names[2] = { 0 };
+        if (lib_arg[2] == ':') {
+            names[0] = lib_arg + 3;
+        } else {
+            names[0] = str.fmt(_, is_static ? "lib%s.a" : "lib%s.so", lib_arg + 2);
+            names[1] = is_static ? NULL : str.fmt(_, "lib%s.a", lib_arg + 2);
+        }
+        for (u32 n = 0; n < arr$len(names) && names[n]; n++) {
+            for$each (dir, lib_dirs) {
+                char* path = str.fmt(_, "%s/%s", dir, names[n]);
+                if (os.path.exists(path)) {
+                    result = str.clone(path, mem$);
+                    break;
+                }
             }
+            if (result) { break; }
+
+            // NOTE: compiler prints the name back if library is not in its search path
+            char* args[] = { cc, str.fmt(_, "-print-file-name=%s", names[n]), NULL };
+            os_cmd_c c = { 0 };
+            if (os.cmd.create(&c, args, arr$len(args), &(os_cmd_flags_s){ 0 })) { continue; }
+            char* output = os.cmd.read_all(&c, _);
+            if (os.cmd.join(&c, 0, NULL) || output == NULL) { continue; }
+            str_s path = str.slice.strip(str.sstr(output));
+            if (str.slice.index_of(path, str$s("/")) >= 0) { result = str.slice.clone(path, mem$); }
         }
-        cg$pn("*/");
+        if (result && n_resolved < arr$len(resolved)) {
+            resolved[n_resolved].key = str.clone(key, mem$);
+            resolved[n_resolved].path = result;
+            n_resolved++;
+        }
+    }
+    return result;
+}
 
-        cg$pn("");
-        cg$func("int\nfuzz$case(const u8* data, usize size)", "")
-        {
-            cg$pn("// TODO: do your stuff based on input data and size");
-            cg$if("size > 2 && data[0] == 'C' && data[1] == 'E' && data[2] == 'X'", "")
-            {
-                cg$pn("__builtin_trap();");
+/// Cache key inputs of build command `args` (NULL terminated arr$): `meta` text (compiler
+/// version, arguments, size/mtime of linker inputs) and `cc -E` command writing `<target>.i` to
+/// `pp_file`. Returns false if cache is disabled or command is not cacheable.
+static bool
+_cexy__cache__key_prepare(
+    arr$(char*) args,
+    sbuf_c* meta,
+    arr$(char*) * pp_args,
+    char** pp_file,
+    IAllocator allc
+)
+{
+    if (cexy$cc_cache_mb <= 0) { return false; }
+    usize n_args = arr$len(args);
+    if (n_args > 0 && args[n_args - 1] == NULL) { n_args--; }
+    if (n_args == 0) { return false; }
+
+    char* cc_version = _cexy__cache__cc_version(args[0]);
+    if (cc_version == NULL) { return false; }
+
+    char* target = NULL;
+    bool is_static = false;
+    arr$(char*) lib_dirs = arr$new(lib_dirs, allc);
+    arr$(char*) libs = arr$new(libs, allc);
+    *meta = sbuf.create(4096, allc);
+    *pp_args = arr$new(*pp_args, allc);
+    if (sbuf.appendf(meta, "%s\n", cc_version)) { return false; }
+    for (usize i = 0; i < n_args; i++) {
+        char* a = args[i];
+        // NOTE: profile data is not in preprocessed source
+        if (str.starts_with(a, "-fprofile")) { return false; }
+        if (sbuf.appendf(meta, "%s\n", a)) { return false; }
+
+        if (str.eq(a, "-o") || str.eq(a, "-MF")) {
+            if (i + 1 >= n_args) { return false; }
+            if (str.eq(a, "-o")) { target = args[i + 1]; }
+            if (sbuf.appendf(meta, "%s\n", args[++i])) { return false; }
+            continue;
+        }
+        if (str.eq(a, "-MMD")) { continue; }
+        if (str.eq(a, "-static") || str.eq(a, "-Wl,-Bstatic")) { is_static = true; }
+        if (str.starts_with(a, "-L")) {
+            arr$push(lib_dirs, (a[2] == '\0' && i + 1 < n_args) ? args[i + 1] : a + 2);
+        }
+        if (str.starts_with(a, "-l")) {
+            arr$push(libs, a);
+            continue;
+        }
+        if (str.ends_with(a, ".o") || str.ends_with(a, ".a") || str.ends_with(a, ".so")) {
+            // NOTE: linker inputs are not used by -E, but they change the output
+            os_fs_stat_s st = os.fs.stat(a);
+            if (st.is_valid && sbuf.appendf(meta, "%lu %ld\n", (u64)st.size, (i64)st.mtime)) {
+                return false;
             }
-            cg$pn("return 0;");
+            continue;
         }
+        arr$push(*pp_args, a);
+    }
+    if (target == NULL) { return false; }
 
-        cg$pn("");
-        cg$pn("fuzz$main();");
-
-        e$ret(io.file.save(target, buf));
+    for$each (lib, libs) {
+        char* path = _cexy__cache__lib_path(args[0], lib_dirs, lib, is_static);
+        if (path == NULL) { return false; } // NOTE: linker will report the error
+        os_fs_stat_s st = os.fs.stat(path);
+        if (!st.is_valid) { return false; }
+        if (sbuf.appendf(meta, "%s %lu %ld\n", path, (u64)st.size, (i64)st.mtime)) {
+            return false;
+        }
     }
-    return EOK;
+
+    // NOTE: per target file, concurrent builds of other targets don't share it
+    *pp_file = str.fmt(allc, "%s.i", target);
+    if (*pp_file == NULL || os.fs.mkpath(*pp_file)) { return false; }
+    arr$pushm(*pp_args, "-E", "-o", *pp_file, NULL);
+    return true;
 }
 
-Exception
-cexy__test__create(char* target, bool include_sample)
+/// Cache key hash of `meta` and preprocessed source in `pp_file` (removed after reading)
+static bool
+_cexy__cache__key_hash(sbuf_c meta, char* pp_file, usize hash[2])
 {
-    if (os.path.exists(target)) {
-        return e$raise(Error.exists, "Test file already exists: %s", target);
-    }
-    if (str.eq(target, "all") || str.find(target, "*")) {
-        return e$raise(
-            Error.argument,
-            "You must pass exact file path, not pattern, got: %s",
-            target
-        );
-    }
-    e$ret(os.fs.mkpath(target));
+    str_s pp_source = { 0 };
+    Exc err = io.file.map(pp_file, &pp_source);
+    if (os.fs.remove(pp_file)) {}
+    if (err) { return false; }
+
+    usize meta_hash = _cexds__siphash_bytes(meta, sbuf.len(&meta), 0);
+    hash[0] = _cexds__siphash_bytes(pp_source.buf, pp_source.len, meta_hash);
+    hash[1] = _cexds__siphash_bytes(pp_source.buf, pp_source.len, ~meta_hash);
+    io.file.unmap(&pp_source);
+    return true;
+}
 
+/// Compile cache key of build command `args` (NULL terminated arr$): hash of compiler version,
+/// all arguments, size/mtime of linker inputs (resolved -l libraries too) and preprocessed source
+/// (`cc -E`). Returns NULL if cache is disabled (cexy$cc_cache_mb is 0) or command is not
+/// cacheable. NOTE: cexy.utils.jobs_run() computes keys of `cache` jobs in parallel.
+static char*
+cexy__cache__key(arr$(char*) args, IAllocator allc)
+{
+    usize hash[2] = { 0 };
     mem$scope(tmem$, _)
     {
-        sbuf_c buf = sbuf.create(1024 * 10, _);
-        cg$init(&buf);
-        cg$pn("#define CEX_IMPLEMENTATION");
-        cg$pn("#define CEX_TEST");
-        cg$pn("#include \"cex.h\"");
-        if (include_sample) { cg$pn("#include \"lib/mylib.c\""); }
-        cg$pn("");
-        cg$pn("//test$setup_case() {return EOK;}");
-        cg$pn("//test$teardown_case() {return EOK;}");
-        cg$pn("//test$setup_suite() {return EOK;}");
-        cg$pn("//test$teardown_suite() {return EOK;}");
-        cg$pn("");
-        cg$scope("test$case(%s)", (include_sample) ? "mylib_test_case" : "my_test_case")
-        {
-            if (include_sample) {
-                cg$pn("tassert_eq(mylib_add(1, 2), 3);");
-                cg$pn("// Next will be available after calling `cex process lib/mylib.c`");
-                cg$pn("// tassert_eq(mylib.add(1, 2), 3);");
-            } else {
-                cg$pn("tassert_eq(1, 0);");
-            }
-            cg$pn("return EOK;");
+        sbuf_c meta = NULL;
+        arr$(char*) pp_args = NULL;
+        char* pp_file = NULL;
+        if (!_cexy__cache__key_prepare(args, &meta, &pp_args, &pp_file, _)) { return NULL; }
+        if (os$cmda(pp_args)) { // NOTE: compiler will report the error
+            if (os.path.exists(pp_file) && os.fs.remove(pp_file)) {}
+            return NULL;
         }
-        cg$pn("");
-        cg$pn("test$main();");
-
-        e$ret(io.file.save(target, buf));
+        if (!_cexy__cache__key_hash(meta, pp_file, hash)) { return NULL; }
     }
-    return EOK;
+    // NOTE: `allc` may be tmem$ of the caller, it can't be used inside nested tmem$ scope
+    return str.fmt(allc, "%016zx%016zx", hash[0], hash[1]);
 }
 
-Exception
-cexy__test__clean(char* target)
+/// Copies cache entry, os.fs.copy() uses reflink (FICLONE) where filesystem supports it
+static Exception
+_cexy__cache__copy(char* src_path, char* dst_path)
 {
+    if (os.path.exists(dst_path)) { e$ret(os.fs.remove(dst_path)); }
+    return os.fs.copy(src_path, dst_path);
+}
 
-    if (str.eq(target, "all")) {
-        log$info("Cleaning all tests\n");
-        e$ret(os.fs.remove_tree(cexy$build_dir "/tests/"));
-    } else {
-        log$info("Cleaning target: %s\n", target);
-        if (!os.path.exists(target)) {
-            return e$raise(Error.exists, "Test target not exists: %s", target);
-        }
+/// Restores `target` (and `target`.d deps file) from compile cache, returns true on hit
+static bool
+cexy__cache__restore(char* key, char* target)
+{
+    if (key == NULL) { return false; }
+    mem$scope(tmem$, _)
+    {
+        char* entry = str.fmt(_, "%s/%s", cexy$build_dir "/.cache", key);
+        if (!os.path.exists(entry)) { return false; }
+        if (_cexy__cache__copy(entry, target)) { return false; }
 
-        mem$scope(tmem$, _)
-        {
-            char* test_target = cexy.target_make(target, cexy$build_dir, ".test", _);
-            e$ret(os.fs.remove(test_target));
+        char* entry_deps = str.fmt(_, "%s.d", entry);
+        if (os.path.exists(entry_deps)) {
+            if (_cexy__cache__copy(entry_deps, str.fmt(_, "%s.d", target))) { return false; }
         }
+#    ifndef _WIN32
+        utime(entry, NULL); // NOTE: mtime is LRU time for eviction
+#    endif
+        log$info("Compile cache hit: %s\n", target);
+        return true;
     }
-    return EOK;
+    return false;
 }
 
-Exception
-cexy__test__make_target_pattern(char** target)
+struct _cexy_cache_entry_s
 {
-    if (target == NULL) {
-        return e$raise(
-            Error.argsparse,
-            "Invalid target: '%s', expected all or tests/test_some_file.c",
-            *target
-        );
-    }
-    if (str.eq(*target, "all")) { *target = "tests/test_*.c"; }
+    char* path;
+    time_t mtime;
+    u64 size;
+};
 
-    if (!str.match(*target, "*test*.c")) {
-        return e$raise(
-            Error.argsparse,
-            "Invalid target: '%s', expected all or tests/test_some_file.c",
-            *target
-        );
-    }
-    return EOK;
+static int
+_cexy__cache__mtime_cmp(const void* a, const void* b)
+{
+    time_t ta = ((struct _cexy_cache_entry_s*)a)->mtime;
+    time_t tb = ((struct _cexy_cache_entry_s*)b)->mtime;
+    return (ta > tb) - (ta < tb);
 }
 
-Exception
-cexy__test__run(char* target, bool is_debug, int argc, char** argv)
+/// Stores built `target` (and `target`.d) in compile cache, evicts least recently used entries
+/// when cache is over cexy$cc_cache_mb
+static Exception
+cexy__cache__store(char* key, char* target)
 {
-    Exc result = EOK;
-    u32 n_tests = 0;
-    u32 n_failed = 0;
+    if (key == NULL) { return EOK; }
+    char* cache_dir = cexy$build_dir "/.cache";
     mem$scope(tmem$, _)
     {
-        if (str.ends_with(target, "test_*.c")) {
-            // quiet mode
-            io.printf("-------------------------------------\n");
-            io.printf("Running Tests: %s\n", target);
-            io.printf("-------------------------------------\n\n");
-        } else {
-            if (!os.path.exists(target)) {
-                return e$raise(Error.not_found, "Test file not found: %s", target);
-            }
+        char* entry = str.fmt(_, "%s/%s", cache_dir, key);
+        e$ret(os.fs.mkpath(entry));
+        e$ret(_cexy__cache__copy(target, entry));
+        char* target_deps = str.fmt(_, "%s.d", target);
+        if (os.path.exists(target_deps)) {
+            e$ret(_cexy__cache__copy(target_deps, str.fmt(_, "%s.d", entry)));
+        }
+
+        // NOTE: entries are pairs of <key> + <key>.d, evicted by <key> mtime (last hit)
+        arr$(struct _cexy_cache_entry_s) cached = arr$new(cached, _);
+        u64 total_size = 0;
+        for$each (path, os.fs.find(str.fmt(_, "%s/*", cache_dir), false, _)) {
+            if (str.ends_with(path, ".d") || str.ends_with(path, ".i")) { continue; }
+            os_fs_stat_s st = os.fs.stat(path);
+            os_fs_stat_s st_deps = os.fs.stat(str.fmt(_, "%s.d", path));
+            if (!st.is_valid) { continue; }
+            u64 size = st.size + (st_deps.is_valid ? st_deps.size : 0);
+            arr$push(cached, (struct _cexy_cache_entry_s){ path, st.mtime, size });
+            total_size += size;
+        }
+
+        u64 max_size = (u64)cexy$cc_cache_mb * 1024 * 1024;
+        if (total_size <= max_size) { return EOK; }
+
+        qsort(cached, arr$len(cached), sizeof(cached[0]), _cexy__cache__mtime_cmp);
+        for$eachp (it, cached) {
+            if (total_size <= max_size * 8 / 10) { break; }
+            char* path_deps = str.fmt(_, "%s.d", it->path);
+            e$ret(os.fs.remove(it->path));
+            if (os.path.exists(path_deps)) { e$ret(os.fs.remove(path_deps)); }
+            total_size -= it->size;
+            log$debug("Compile cache evicted: %s\n", it->path);
         }
+    }
+    return EOK;
+}
 
-        for$each (test_src, os.fs.find(target, true, _)) {
-            n_tests++;
-            char* test_target = cexy.target_make(test_src, cexy$build_dir, ".test", _);
-            arr$(char*) args = arr$new(args, _);
-            if (is_debug) { arr$pushm(args, cexy$debug_cmd); }
-            arr$pushm(args, test_target, );
-            if (str.ends_with(target, "test_*.c")) { arr$push(args, "--quiet"); }
-            arr$pusha(args, argv, argc);
-            arr$push(args, NULL);
-            if (os$cmda(args)) {
-                log$error("<<<<<<<<<<<<<<<<<< Test failed: %s\n", test_target);
-                n_failed++;
-                result = Error.runtime;
-            }
-        }
+/// Build command `args` with compile cache: restores `-o` target on hit, otherwise runs the
+/// command and stores the target
+static Exception
+cexy__cache__build(arr$(char*) args)
+{
+    char* target = NULL;
+    for (usize i = 0; i + 1 < arr$len(args); i++) {
+        if (str.eq(args[i], "-o")) { target = args[i + 1]; }
     }
-    if (str.ends_with(target, "test_*.c")) {
-        io.printf("\n-------------------------------------\n");
-        io.printf("Total: %d Passed: %d Failed: %d\n", n_tests, n_tests - n_failed, n_failed);
-        io.printf("-------------------------------------\n\n");
+    mem$scope(tmem$, _)
+    {
+        char* key = (target) ? cexy.cache.key(args, _) : NULL;
+        if (cexy.cache.restore(key, target)) { return EOK; }
+        e$ret(os$cmda(args));
+        e$ret(cexy.cache.store(key, target));
     }
-    return result;
+    return EOK;
 }
 
 static int
@@ -16718,6 +19298,7 @@ cexy__cmd__config(int argc, char** argv, void* user_ctx)
     "* cexy$cc_args_sanitizer    " cex$stringize(cexy$cc_args_sanitizer) "\n"                                \
     "* cexy$cc_args              " cex$stringize(cexy$cc_args) "\n"                                \
     "* cexy$cc_args_test         " cex$stringize(cexy$cc_args_test) "\n"                           \
+    "* cexy$cc_args_bench        " cex$stringize(cexy$cc_args_bench) "\n"                          \
     "* cexy$ld_args              " cex$stringize(cexy$ld_args) "\n"                                \
     "* cexy$fuzzer               " cex$stringize(cexy$fuzzer) "\n"                                \
     "* cexy$debug_cmd            " cex$stringize(cexy$debug_cmd) "\n"                              \
@@ -16903,12 +19484,16 @@ static Exception
 cexy__cmd__simple_test(int argc, char** argv, void* user_ctx)
 {
     (void)user_ctx;
+    u32 n_jobs = 0;
     argparse_c cmd_args = {
         .program_name = "./cex",
         .usage = "test [options] {run,build,create,clean,debug} all|tests/test_file.c [--test-options]",
         .description = _cexy$cmd_test_help,
         .epilog = _cexy$cmd_test_epilog,
-        argparse$opt_list(argparse$opt_help(), ),
+        argparse$opt_list(
+            argparse$opt_help(),
+            argparse$opt(&n_jobs, 'j', "jobs", .help = "parallel build/test jobs, 0 - number of CPUs"),
+        ),
     };
 
     e$ret(argparse.parse(&cmd_args, argc, argv));
@@ -16938,6 +19523,7 @@ cexy__cmd__simple_test(int argc, char** argv, void* user_ctx)
     (void)n_built;
     mem$scope(tmem$, _)
     {
+        arr$(cexy_job_s) jobs = arr$new(jobs, _);
         for$each (test_src, os.fs.find(target, true, _)) {
             char* test_target = cexy.target_make(test_src, cexy$build_dir, ".test", _);
             log$trace("Test src: %s -> %s\n", test_src, test_target);
@@ -16960,20 +19546,140 @@ cexy__cmd__simple_test(int argc, char** argv, void* user_ctx)
             if (arr$len(pkgconf_libargs)) {
                 e$ret(cexy$pkgconf(_, &args, "--cflags", "--libs", cexy$pkgconf_libs));
             }
+            arr$pushm(args, cexy$cc_deps(_, test_target));
             arr$pushm(args, "-o", test_target);
 
 
             arr$push(args, NULL);
-            e$ret(os$cmda(args));
+            arr$push(
+                jobs,
+                (cexy_job_s){
+                    .name = test_src,
+                    .args = args,
+                    .target = test_target,
+                    .cache = true,
+                }
+            );
             n_built++;
         }
+        if (arr$len(jobs) > 0) { e$ret(cexy.utils.jobs_run(jobs, n_jobs, _)); }
     }
 
     log$info("Tests building: %d tests processed, %d tests built\n", n_tests, n_built);
     fflush(stdout);
 
     if (str.match(cmd, "(run|debug)")) {
-        e$ret(cexy.test.run(target, str.eq(cmd, "debug"), cmd_args.argc, cmd_args.argv));
+        e$ret(cexy.test.run(target, str.eq(cmd, "debug"), n_jobs, cmd_args.argc, cmd_args.argv));
+    }
+    return EOK;
+}
+
+static Exception
+cexy__cmd__simple_bench(int argc, char** argv, void* user_ctx)
+{
+    (void)user_ctx;
+    char* json_file = NULL;
+    char* baseline = NULL;
+    f64 threshold_pct = 10;
+    u32 n_runs = 3;
+    bool save_baseline = false;
+    argparse_c cmd_args = {
+        .program_name = "./cex",
+        .usage = "bench [options] {run,build,compare,create,clean} all|bench/bench_file.c [--bench-options]",
+        .description = _cexy$cmd_bench_help,
+        .epilog = _cexy$cmd_bench_epilog,
+        argparse$opt_list(
+            argparse$opt_help(),
+            argparse$opt(&json_file, 'j', "json", .help = "save results of all suites as JSON"),
+            argparse$opt_group("Compare options"),
+            argparse$opt(&baseline, 'b', "baseline", .help = "baseline git hash (prefix) or file, default: HEAD or newest"),
+            argparse$opt(&threshold_pct, 't', "threshold", .help = "regression threshold, % of median ns/op"),
+            argparse$opt(&n_runs, 'r', "runs", .help = "number of suite runs (after one warmup run)"),
+            argparse$opt(&save_baseline, 's', "save", .help = "save results as baseline of HEAD, no compare"),
+        ),
+    };
+
+    e$ret(argparse.parse(&cmd_args, argc, argv));
+    char* cmd = argparse.next(&cmd_args);
+    char* target = argparse.next(&cmd_args);
+
+    if (!str.match(cmd, "(run|build|compare|create|clean)") || target == NULL) {
+        argparse.usage(&cmd_args);
+        return e$raise(Error.argsparse, "Invalid command: '%s' or target: '%s'", cmd, target);
+    }
+
+    if (str.eq(cmd, "create")) {
+        e$ret(cexy.bench.create(target));
+        return EOK;
+    } else if (str.eq(cmd, "clean")) {
+        e$ret(cexy.bench.clean(target));
+        return EOK;
+    }
+    bool single_bench = !str.eq(target, "all");
+    e$ret(cexy.bench.make_target_pattern(&target)); // validation + 'all' -> "bench/bench_*.c"
+
+    log$info("Benchmarks building: %s\n", target);
+    u32 n_benches = 0;
+    u32 n_built = 0;
+    mem$scope(tmem$, _)
+    {
+        arr$(cexy_job_s) jobs = arr$new(jobs, _);
+        for$each (bench_src, os.fs.find(target, true, _)) {
+            char* bench_target = cexy.target_make(bench_src, cexy$build_dir, ".bench", _);
+            log$trace("Benchmark src: %s -> %s\n", bench_src, bench_target);
+            fflush(stdout); // typically for CI
+            n_benches++;
+            if (!single_bench && !cexy.src_include_changed(bench_target, bench_src, NULL)) {
+                continue;
+            }
+            arr$(char*) args = arr$new(args, _);
+            arr$pushm(args, cexy$cc, );
+            // NOTE: reconstructing char*[] because some cexy$ variables might be empty
+            char* cc_args_bench[] = { cexy$cc_args_bench };
+            char* cc_include[] = { cexy$cc_include };
+            char* cc_ld_args[] = { cexy$ld_args };
+            arr$pusha(args, cc_args_bench);
+            arr$pusha(args, cc_include);
+            arr$push(args, bench_src);
+            arr$pusha(args, cc_ld_args);
+            char* pkgconf_libargs[] = { cexy$pkgconf_libs };
+            if (arr$len(pkgconf_libargs)) {
+                e$ret(cexy$pkgconf(_, &args, "--cflags", "--libs", cexy$pkgconf_libs));
+            }
+            arr$pushm(args, cexy$cc_deps(_, bench_target));
+            arr$pushm(args, "-o", bench_target);
+
+            arr$push(args, NULL);
+            arr$push(
+                jobs,
+                (cexy_job_s){
+                    .name = bench_src,
+                    .args = args,
+                    .target = bench_target,
+                    .cache = true,
+                }
+            );
+            n_built++;
+        }
+        // NOTE: only builds are parallel, benchmarks always run one by one
+        if (arr$len(jobs) > 0) { e$ret(cexy.utils.jobs_run(jobs, 0, _)); }
+    }
+
+    log$info("Benchmarks building: %d processed, %d built\n", n_benches, n_built);
+    fflush(stdout);
+
+    if (str.eq(cmd, "run")) {
+        e$ret(cexy.bench.run(target, json_file, cmd_args.argc, cmd_args.argv));
+    } else if (str.eq(cmd, "compare")) {
+        e$ret(cexy.bench.compare(
+            target,
+            baseline,
+            threshold_pct,
+            n_runs,
+            save_baseline,
+            cmd_args.argc,
+            cmd_args.argv
+        ));
     }
     return EOK;
 }
@@ -17323,11 +20029,12 @@ cexy__cmd__simple_app(int argc, char** argv, void* user_ctx)
         if (arr$len(pkgconf_libargs)) {
             e$ret(cexy$pkgconf(_, &args, "--libs", cexy$pkgconf_libs));
         }
+        arr$pushm(args, cexy$cc_deps(_, app_exec));
         arr$pushm(args, "-o", app_exec);
 
 
         arr$push(args, NULL);
-        e$ret(os$cmda(args));
+        e$ret(cexy.cache.build(args));
 
     run:
         if (str.match(cmd, "(run|debug)")) {
@@ -17440,6 +20147,7 @@ cexy__cmd__simple_fuzz(int argc, char** argv, void* user_ctx)
                 if (arr$len(pkgconf_libargs)) {
                     e$ret(cexy$pkgconf(_, &args, "--libs", cexy$pkgconf_libs));
                 }
+                arr$pushm(args, cexy$cc_deps(_, target_exe));
                 arr$pushm(args, "-o", target_exe);
                 arr$push(args, NULL);
 
@@ -17513,6 +20221,193 @@ cexy__cmd__simple_fuzz(int argc, char** argv, void* user_ctx)
     return EOK;
 }
 
+/// Number of online CPUs (default for parallel jobs)
+static u32
+cexy__utils__cpu_count(void)
+{
+#    ifdef _WIN32
+    u32 result = 0;
+    if (str.convert.to_u32(os.env.get("NUMBER_OF_PROCESSORS", "1"), &result)) { result = 1; }
+#    else
+    long result = sysconf(_SC_NPROCESSORS_ONLN);
+#    endif
+    return (result > 0) ? (u32)result : 1;
+}
+
+#    ifndef _WIN32
+/// Reads available output of running job (non-blocking pipe), returns false on EOF or error
+static bool
+_cexy__utils__job_read(cexy_job_s* job)
+{
+    char buf[4096];
+    int fd = fileno(os.cmd.fstdout(&job->_cmd));
+    while (true) {
+        isize n = read(fd, buf, sizeof(buf));
+        if (n > 0) {
+            if (sbuf.appendf(&job->_output, "%S", (str_s){ .buf = buf, .len = n })) { return false; }
+            continue;
+        }
+        return (n < 0 && (errno == EAGAIN || errno == EINTR));
+    }
+}
+#    endif
+
+/// Starts `args` subprocess of `job` (stdout + stderr captured via non-blocking pipe), on Windows
+/// runs it to completion with terminal output
+static void
+_cexy__utils__job_start(cexy_job_s* job, arr$(char*) args, u32* n_running)
+{
+#    ifdef _WIN32
+    (void)n_running;
+    job->result = os.cmd.run(args, arr$len(args), &job->_cmd);
+    if (job->result == EOK) { job->result = os.cmd.join(&job->_cmd, 0, NULL); }
+    job->elapsed_sec = os.timer() - job->_started;
+    job->_is_done = true;
+#    else
+    os_cmd_flags_s flags = { .combine_stdouterr = 1 };
+    job->result = os.cmd.create(&job->_cmd, args, arr$len(args), &flags);
+    if (job->result != EOK) {
+        job->_is_done = true;
+        return;
+    }
+    // NOTE: jobs are not interactive, stdin gets EOF
+    fclose(job->_cmd._subpr.stdin_file);
+    job->_cmd._subpr.stdin_file = NULL;
+    int fd = fileno(os.cmd.fstdout(&job->_cmd));
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    job->_is_running = true;
+    (*n_running)++;
+#    endif
+}
+
+/// Runs `jobs` as parallel subprocesses, at most `n_jobs_max` at once (0 - number of CPUs). Output
+/// (stdout + stderr) of each job is captured and printed as a whole, in the order of `jobs`.
+/// `cache` jobs preprocess first (cexy.cache.key() in parallel), target is restored on cache hit.
+/// Returns Error.runtime if any job failed, job.result has the exit result of each job.
+static Exception
+cexy__utils__jobs_run(arr$(cexy_job_s) jobs, u32 n_jobs_max, IAllocator allc)
+{
+    usize n_jobs = arr$len(jobs);
+    if (n_jobs_max == 0) { n_jobs_max = cexy__utils__cpu_count(); }
+#    ifdef _WIN32
+    n_jobs_max = 1; // NOTE: no non-blocking pipes, jobs run one by one with terminal output
+#    endif
+    usize n_started = 0;
+    usize n_printed = 0;
+    u32 n_running = 0;
+    u32 n_failed = 0;
+    f64 serial_sec = 0;
+    f64 wall_started = os.timer();
+
+    while (n_printed < n_jobs) {
+        while (n_running < n_jobs_max && n_started < n_jobs) {
+            cexy_job_s* job = &jobs[n_started++];
+            job->_output = sbuf.create(1024, allc);
+            job->_started = os.timer();
+            if (job->cache && job->target) {
+#    ifdef _WIN32
+                job->_cache_key = cexy.cache.key(job->args, allc);
+                if (cexy.cache.restore(job->_cache_key, job->target)) {
+                    job->_is_cache_hit = true;
+                    job->_is_done = true;
+                    continue;
+                }
+#    else
+                arr$(char*) pp_args = NULL;
+                if (_cexy__cache__key_prepare(
+                        job->args,
+                        &job->_cache_meta,
+                        &pp_args,
+                        &job->_pp_file,
+                        allc
+                    )) {
+                    job->_is_preprocessing = true;
+                    _cexy__utils__job_start(job, pp_args, &n_running);
+                    continue;
+                }
+#    endif
+            }
+            _cexy__utils__job_start(job, job->args, &n_running);
+        }
+
+#    ifndef _WIN32
+        // NOTE: waiting for output of any running job, exits are checked every 10ms
+        struct pollfd pfds[n_running + 1];
+        u32 n_pfds = 0;
+        for (usize i = n_printed; i < n_started; i++) {
+            if (!jobs[i]._is_running) { continue; }
+            pfds[n_pfds++] = (struct pollfd){
+                .fd = fileno(os.cmd.fstdout(&jobs[i]._cmd)),
+                .events = POLLIN,
+            };
+        }
+        if (n_pfds > 0) { poll(pfds, n_pfds, 10); }
+
+        for (usize i = n_printed; i < n_started; i++) {
+            cexy_job_s* job = &jobs[i];
+            if (!job->_is_running) { continue; }
+            _cexy__utils__job_read(job);
+            if (os.cmd.is_alive(&job->_cmd)) { continue; }
+
+            _cexy__utils__job_read(job); // NOTE: the rest of output after exit
+            job->result = os.cmd.join(&job->_cmd, 0, NULL);
+            job->_is_running = false;
+            n_running--;
+
+            if (job->_is_preprocessing) {
+                // NOTE: `cc -E` step done, errors are reported by compile step
+                job->_is_preprocessing = false;
+                usize hash[2] = { 0 };
+                if (job->result == EOK &&
+                    _cexy__cache__key_hash(job->_cache_meta, job->_pp_file, hash)) {
+                    job->_cache_key = str.fmt(allc, "%016zx%016zx", hash[0], hash[1]);
+                } else if (os.path.exists(job->_pp_file) && os.fs.remove(job->_pp_file)) {}
+
+                if (cexy.cache.restore(job->_cache_key, job->target)) {
+                    job->result = EOK;
+                    job->_is_cache_hit = true;
+                } else {
+                    sbuf.clear(&job->_output);
+                    _cexy__utils__job_start(job, job->args, &n_running);
+                    continue;
+                }
+            }
+            job->elapsed_sec = os.timer() - job->_started;
+            job->_is_done = true;
+        }
+#    endif
+
+        while (n_printed < n_started && jobs[n_printed]._is_done) {
+            cexy_job_s* job = &jobs[n_printed++];
+            if (!job->_is_cache_hit) { _os$args_print("CMD:", job->args, arr$len(job->args)); }
+            if (sbuf.len(&job->_output) > 0) {
+                io.printf("%s", job->_output);
+                fflush(stdout);
+            }
+            serial_sec += job->elapsed_sec;
+            if (job->result == EOK && job->_cache_key && !job->_is_cache_hit) {
+                job->result = cexy.cache.store(job->_cache_key, job->target);
+            }
+            if (job->result != EOK) {
+                log$error("Job failed: %s (%s)\n", job->name, job->result);
+                n_failed++;
+            }
+        }
+    }
+
+    f64 wall_sec = os.timer() - wall_started;
+    log$info(
+        "Jobs: %zu done, %d failed, jobs: %d, wall time: %0.2fs, serial (sum of jobs): %0.2fs (x%0.1f)\n",
+        n_jobs,
+        n_failed,
+        n_jobs_max,
+        wall_sec,
+        serial_sec,
+        (wall_sec > 0) ? serial_sec / wall_sec : 1.0
+    );
+    return (n_failed > 0) ? Error.runtime : EOK;
+}
+
 static char*
 cexy__utils__git_hash(IAllocator allc)
 {
@@ -17920,6 +20815,20 @@ const struct __cex_namespace__cexy cexy = {
         .run = cexy__app__run,
     },
 
+    .bench = {
+        .clean = cexy__bench__clean,
+        .compare = cexy__bench__compare,
+        .create = cexy__bench__create,
+        .make_target_pattern = cexy__bench__make_target_pattern,
+        .run = cexy__bench__run,
+    },
+    .cache = {
+        .build = cexy__cache__build,
+        .key = cexy__cache__key,
+        .restore = cexy__cache__restore,
+        .store = cexy__cache__store,
+    },
+
     .cmd = {
         .config = cexy__cmd__config,
         .help = cexy__cmd__help,
@@ -17927,6 +20836,7 @@ const struct __cex_namespace__cexy cexy = {
         .new = cexy__cmd__new,
         .process = cexy__cmd__process,
         .simple_app = cexy__cmd__simple_app,
+        .simple_bench = cexy__cmd__simple_bench,
         .simple_fuzz = cexy__cmd__simple_fuzz,
         .simple_test = cexy__cmd__simple_test,
         .stats = cexy__cmd__stats,
@@ -17944,8 +20854,10 @@ const struct __cex_namespace__cexy cexy = {
     },
 
     .utils = {
+        .cpu_count = cexy__utils__cpu_count,
         .git_hash = cexy__utils__git_hash,
         .git_lib_fetch = cexy__utils__git_lib_fetch,
+        .jobs_run = cexy__utils__jobs_run,
         .make_compile_flags = cexy__utils__make_compile_flags,
         .make_new_project = cexy__utils__make_new_project,
         .pkgconf = cexy__utils__pkgconf,
@@ -1,4 +1,7 @@
 #include "KeyMap.h"
+#include "KeyMapControl.h"
+#include "KeyMapHandoff.h"
+#include "KeyMapUring.h"
 #include "cex.h"
 #include "libevdev/libevdev.h"
 #include <asm-generic/errno-base.h>
@@ -6,10 +9,121 @@
 #include <libevdev/libevdev-uinput.h>
 #include <linux/input-event-codes.h>
 #include <linux/input.h>
+#include <malloc.h>
+#include <math.h>
 #include <poll.h>
+#include <sched.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#ifdef KEYMAP_STATIC_CONFIG
+// Generated by `./cex static-build`: maps and layer keys are compile-time constants
+#include KEYMAP_STATIC_CONFIG
+#define keymap$mod_key_code(self) ((u16)KEYMAP_STATIC_MOD_KEY_CODE)
+#define keymap$mouse_key_code(self) ((u16)KEYMAP_STATIC_MOUSE_KEY_CODE)
+#define keymap$direct_map(self) (keymap_static_direct_map)
+#define keymap$mod_map(self) (keymap_static_mod_map)
+#define keymap$mouse_map(self) (keymap_static_mouse_map)
+#define KEYMAP_STAGES_STATIC                                                                       \
+    ((1 << KeyMapStage__normalize) | (1 << KeyMapStage__action) | (1 << KeyMapStage__output) |   \
+     ((KEYMAP_STATIC_MOD_KEY_CODE || KEYMAP_STATIC_MOUSE_KEY_CODE) ? (1 << KeyMapStage__layer) : 0))
+#else
+#define keymap$mod_key_code(self) ((self)->mod_key_code)
+#define keymap$mouse_key_code(self) ((self)->mouse_key_code)
+#define keymap$direct_map(self) ((self)->direct_map)
+#define keymap$mod_map(self) ((self)->mod_map)
+#define keymap$mouse_map(self) ((self)->mouse_map)
+#define KEYMAP_STAGES_STATIC (~0u)
+#endif
+
+#ifdef KEYMAP_ALLOC_TRAP
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t nmemb, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* ptr);
+
+KeyMapAllocTrap_s _keymap__alloc_trap = { .abort_on_hit = true };
+
+void
+KeyMap__alloc_trap_hit(bool is_cex, usize size)
+{
+    (void)size;
+    if (likely(!_keymap__alloc_trap.armed)) { return; }
+
+    if (is_cex) {
+        _keymap__alloc_trap.n_cex++;
+    } else {
+        _keymap__alloc_trap.n_libc++;
+    }
+    if (_keymap__alloc_trap.abort_on_hit) {
+        // NOTE: no stdio here, it may allocate itself
+        char msg[] = "KEYMAP_ALLOC_TRAP: allocation in event loop\n";
+        if (write(STDERR_FILENO, msg, sizeof(msg) - 1)) {}
+        abort();
+    }
+}
+
+// NOTE: interposing libc allocator catches 3rd party allocations (libevdev) too
+__attribute__((externally_visible)) void*
+malloc(size_t size)
+{
+    KeyMap__alloc_trap_hit(false, size);
+    return __libc_malloc(size);
+}
+
+__attribute__((externally_visible)) void*
+calloc(size_t nmemb, size_t size)
+{
+    KeyMap__alloc_trap_hit(false, nmemb * size);
+    return __libc_calloc(nmemb, size);
+}
+
+__attribute__((externally_visible)) void*
+realloc(void* ptr, size_t size)
+{
+    KeyMap__alloc_trap_hit(false, size);
+    return __libc_realloc(ptr, size);
+}
+
+__attribute__((externally_visible)) void*
+memalign(size_t alignment, size_t size)
+{
+    KeyMap__alloc_trap_hit(false, size);
+    return __libc_memalign(alignment, size);
+}
+
+__attribute__((externally_visible)) void*
+aligned_alloc(size_t alignment, size_t size)
+{
+    KeyMap__alloc_trap_hit(false, size);
+    return __libc_memalign(alignment, size);
+}
+
+__attribute__((externally_visible)) int
+posix_memalign(void** memptr, size_t alignment, size_t size)
+{
+    KeyMap__alloc_trap_hit(false, size);
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) { return EINVAL; }
+    void* ptr = __libc_memalign(alignment, size);
+    if (ptr == NULL) { return ENOMEM; }
+    *memptr = ptr;
+    return 0;
+}
+
+__attribute__((externally_visible)) void
+free(void* ptr)
+{
+    __libc_free(ptr);
+}
+#endif
 
 Exception
 KeyMap_create(KeyMap_c* self, char* input_dev_or_name)
@@ -18,9 +132,21 @@ KeyMap_create(KeyMap_c* self, char* input_dev_or_name)
     uassert(!self->mod_pressed && "non ZII?");
 
     // NOTE: Setting up virtual keyboard for output
-    e$except_errno (self->output.fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK)) { goto err; }
+    e$except_errno (self->output.fd = open("/dev/uinput", O_WRONLY | O_NONBLOCK | O_CLOEXEC)) {
+        goto err;
+    }
     e$except_errno (ioctl(self->output.fd, UI_SET_EVBIT, EV_KEY)) { goto err; }
     e$except_errno (ioctl(self->output.fd, UI_SET_EVBIT, EV_SYN)) { goto err; }
+    if (self->unified_device && self->mouse_key_code) {
+        // NOTE: pointer on the same node, BTN_* are covered by UI_SET_KEYBIT loop below
+        e$except_errno (ioctl(self->output.fd, UI_SET_EVBIT, EV_REL)) { goto err; }
+        e$except_errno (ioctl(self->output.fd, UI_SET_RELBIT, REL_X)) { goto err; }
+        e$except_errno (ioctl(self->output.fd, UI_SET_RELBIT, REL_Y)) { goto err; }
+        e$except_errno (ioctl(self->output.fd, UI_SET_RELBIT, REL_WHEEL)) { goto err; }
+        e$except_errno (ioctl(self->output.fd, UI_SET_RELBIT, REL_HWHEEL)) { goto err; }
+        e$except_errno (ioctl(self->output.fd, UI_SET_RELBIT, REL_WHEEL_HI_RES)) { goto err; }
+        e$except_errno (ioctl(self->output.fd, UI_SET_RELBIT, REL_HWHEEL_HI_RES)) { goto err; }
+    }
 
     for (int key = 0; key < KEY_MAX; key++) {
         e$except_errno (ioctl(self->output.fd, UI_SET_KEYBIT, key)) {
@@ -38,7 +164,9 @@ KeyMap_create(KeyMap_c* self, char* input_dev_or_name)
 
     // Attaching for input keyboard
     if (str.starts_with(input_dev_or_name, "/dev/")) {
-        e$except_errno (self->input.fd = open(input_dev_or_name, O_RDONLY | O_NONBLOCK)) {
+        e$except_errno (
+            self->input.fd = open(input_dev_or_name, O_RDONLY | O_NONBLOCK | O_CLOEXEC)
+        ) {
             log$error("Error opening: %s\n", input_dev_or_name);
             goto err;
         }
@@ -69,71 +197,95 @@ KeyMap_create(KeyMap_c* self, char* input_dev_or_name)
     if (self->debug) {}
 
     e$except_errno (libevdev_grab(self->input.dev, LIBEVDEV_GRAB)) { goto err; }
+    e$ret(KeyMap.input_siblings_attach(self));
 
-    // Making mouse
-    if (self->mouse_key_code) {
-        struct libevdev* dev = NULL;
-
-        // Create a new evdev device
-        e$except_null (dev = libevdev_new()) { goto err; }
-
-        // Set device properties
-        libevdev_set_name(dev, "UberKeyboardMappperVirtualMouse");
-        libevdev_set_id_vendor(dev, 0x1234);
-        libevdev_set_id_product(dev, 0x0002);
-        libevdev_set_id_bustype(dev, BUS_USB);
-        libevdev_set_id_version(dev, 1);
-
-        // Enable relative axes (mouse movement)
-        libevdev_enable_event_type(dev, EV_REL);
-        libevdev_enable_event_code(dev, EV_REL, REL_X, NULL);
-        libevdev_enable_event_code(dev, EV_REL, REL_Y, NULL);
-        libevdev_enable_event_code(dev, EV_REL, REL_WHEEL, NULL);
-        libevdev_enable_event_code(dev, EV_REL, REL_HWHEEL, NULL);
-
-        // Enable buttons
-        libevdev_enable_event_type(dev, EV_KEY);
-        libevdev_enable_event_code(dev, EV_KEY, BTN_LEFT, NULL);
-        libevdev_enable_event_code(dev, EV_KEY, BTN_RIGHT, NULL);
-        libevdev_enable_event_code(dev, EV_KEY, BTN_MIDDLE, NULL);
-
-        // Enable synchronization events
-        libevdev_enable_event_type(dev, EV_SYN);
-
-        // Create uinput device
-        e$except_errno (
-            libevdev_uinput_create_from_device(dev, LIBEVDEV_UINPUT_OPEN_MANAGED, &self->mouse.dev)
-        ) {
-            goto err;
-        }
+    if (self->mouse_key_code && !self->unified_device) { e$ret(KeyMap.mouse_create(self)); }
+    if (self->mouse_key_code) { e$ret(KeyMap.mouse_accel_setup(self)); }
 
-        printf(
-            "Virtual mouse created successfully Device: %s\n",
-            libevdev_uinput_get_devnode(self->mouse.dev)
-        );
+    e$ret(KeyMap.repeat_setup(self));
+    KeyMap.pipeline_setup(self);
+    if (self->realtime.enabled) { e$ret(KeyMap.realtime_setup(self)); }
 
-        if (self->mouse_sensitivity <= 0) {
-            self->mouse_sensitivity = 1.0f;
-        } else {
-            uassertf(
-                self->mouse_sensitivity < 10 && self->mouse_sensitivity > 0.1,
-                "sensitivity expected in (0.1;10) got: %0.3f",
-                self->mouse_sensitivity
-            );
-        }
-        uassertf(
-            self->mouse_speedup_ms > 0 && self->mouse_speedup_ms < 10000,
-            "mouse_speedup_ms weird value: %lu",
-            self->mouse_speedup_ms
+    return EOK;
+
+err:
+    return Error.io;
+}
+
+static void __attribute__((noinline))
+prefault_stack(void)
+{
+    // NOTE: touching stack pages in advance, mlockall(MCL_FUTURE) keeps them resident
+    volatile u8 stack[KEYMAP_RT_STACK_PREFAULT];
+    for (usize i = 0; i < sizeof(stack); i += 4096) { stack[i] = 0; }
+}
+
+Exception
+KeyMap_realtime_setup(KeyMap_c* self)
+{
+    if (self->realtime.priority == 0) { self->realtime.priority = KEYMAP_RT_PRIORITY_DEFAULT; }
+    if (self->realtime.priority < 1 || self->realtime.priority > 99) {
+        return e$raise(
+            Error.argument,
+            "SCHED_FIFO priority expected in [1;99] got: %d",
+            self->realtime.priority
         );
+    }
 
-        libevdev_free(dev);
+    if (self->realtime.pin_cpu) {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(self->realtime.cpu, &cpus);
+        e$except_errno (sched_setaffinity(0, sizeof(cpus), &cpus)) { return Error.os; }
     }
 
+    // NOTE: never give heap memory back to the kernel, re-acquiring it means page faults
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+
+    e$except_errno (mlockall(MCL_CURRENT | MCL_FUTURE)) { return Error.os; }
+    prefault_stack();
+
+    struct sched_param sp = { .sched_priority = self->realtime.priority };
+    e$except_errno (sched_setscheduler(0, SCHED_FIFO, &sp)) { return Error.os; }
+
+    self->realtime.enabled = true;
+    self->realtime.checked = false;
+    self->realtime.verified = false;
+    self->realtime.heap_growth = 0;
+    self->realtime.heap_inuse = mallinfo2().uordblks;
+
+    log$info(
+        "Realtime profile: SCHED_FIFO prio: %d, cpu: %d, heap in use: %zu\n",
+        self->realtime.priority,
+        self->realtime.pin_cpu ? (i32)self->realtime.cpu : -1,
+        self->realtime.heap_inuse
+    );
     return EOK;
+}
 
-err:
-    return Error.io;
+static void
+realtime_verify_heap(KeyMap_c* self)
+{
+    // NOTE: runs only while idle, i.e. right before blocking wait, so it never delays a key
+    u64 n_events = self->stats.n_events - self->realtime.n_events_ready;
+    if (n_events < KEYMAP_RT_VERIFY_EVENTS) { return; }
+
+    usize heap_inuse = mallinfo2().uordblks;
+    self->realtime.checked = true;
+    self->realtime.heap_growth = (isize)heap_inuse - (isize)self->realtime.heap_inuse;
+    self->realtime.verified = self->realtime.heap_growth == 0;
+    if (!self->realtime.verified) {
+        // NOTE: the loop keeps running, the failure stays visible in `uberkb --ctl dump`
+        log$error(
+            "Realtime verification failed, heap usage changed in event loop: %zu -> %zu bytes "
+            "(allocations after ready)\n",
+            self->realtime.heap_inuse,
+            heap_inuse
+        );
+    } else {
+        log$info("No heap allocations in event loop after %lu events\n", n_events);
+    }
 }
 
 Exception
@@ -145,7 +297,7 @@ KeyMap_find_mapped_keyboard(KeyMap_c* self, char* keyboard_name)
     {
         io.printf("Looking for keyboard: '%s'\n", keyboard_name);
         for$each (it, os.fs.find("/dev/input/event*", false, _)) {
-            e$except_errno (self->input.fd = open(it, O_RDONLY | O_NONBLOCK)) {
+            e$except_errno (self->input.fd = open(it, O_RDONLY | O_NONBLOCK | O_CLOEXEC)) {
                 log$error("Error opening: %s\n", it);
                 goto err;
             }
@@ -212,13 +364,95 @@ KeyMap_is_qwerty_keyboard(struct libevdev* dev)
     if (!libevdev_has_event_code(dev, EV_KEY, KEY_ESC)) { return false; }
     if (!libevdev_has_event_code(dev, EV_KEY, KEY_CAPSLOCK)) { return false; }
 
-    // NOTE: some keyboards may have more than 1 inputs, with qwerty, usually input0 works
+    // NOTE: some keyboards have more than 1 inputs, usually qwerty is on input0, the rest of
+    // interfaces are grabbed along with it (see KeyMap.input_siblings_attach())
     char* phys_loc = (char*)libevdev_get_phys(dev);
     if (!str.ends_with(phys_loc, "/input0")) { return false; }
 
     return true;
 }
 
+/// Length of phys location without `/inputN` interface suffix, 0 - not an interface of a device
+static usize
+input_phys_prefix_len(char* phys)
+{
+    if (phys == NULL) { return 0; }
+    char* sep = strrchr(phys, '/');
+    if (sep == NULL || !str.starts_with(sep, "/input")) { return 0; }
+    return (usize)(sep - phys);
+}
+
+/// Other interfaces of the same physical device: same non-empty uniq (bluetooth shares phys of
+/// the host adapter), or same phys location up to `/inputN` (usb)
+static bool
+input_is_sibling(struct libevdev* dev, struct libevdev* other)
+{
+    char* uniq = (char*)libevdev_get_uniq(dev);
+    char* other_uniq = (char*)libevdev_get_uniq(other);
+    if (uniq && uniq[0] && other_uniq && other_uniq[0]) { return str.eq(uniq, other_uniq); }
+
+    char* phys = (char*)libevdev_get_phys(dev);
+    char* other_phys = (char*)libevdev_get_phys(other);
+    usize len = input_phys_prefix_len(phys);
+    if (len == 0 || len != input_phys_prefix_len(other_phys)) { return false; }
+    return memcmp(phys, other_phys, len) == 0;
+}
+
+/// Grabs the rest of HID interfaces of input keyboard (consumer control, system control, macro
+/// keys), their keys go through the same layers. Pointer interfaces are left alone.
+Exception
+KeyMap_input_siblings_attach(KeyMap_c* self)
+{
+    uassert(self->input.dev != NULL && "not initialized");
+    uassert(self->input.n_siblings == 0 && "already attached");
+
+    struct stat input_st;
+    e$except_errno (fstat(self->input.fd, &input_st)) { return Error.io; }
+
+    mem$scope(tmem$, _)
+    {
+        for$each (it, os.fs.find("/dev/input/event*", false, _)) {
+            if (self->input.n_siblings >= arr$len(self->input.siblings)) {
+                log$warn("Too many keyboard interfaces, ignoring: %s\n", it);
+                continue;
+            }
+            int fd = open(it, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+            if (fd < 0) { continue; }
+
+            struct stat st;
+            struct libevdev* dev = NULL;
+            bool is_sibling = fstat(fd, &st) == 0 && st.st_rdev != input_st.st_rdev &&
+                              libevdev_new_from_fd(fd, &dev) == 0 &&
+                              input_is_sibling(self->input.dev, dev) &&
+                              libevdev_has_event_type(dev, EV_KEY) &&
+                              !libevdev_has_event_code(dev, EV_KEY, BTN_LEFT);
+            if (is_sibling && ioctl(fd, EVIOCGRAB, 1) < 0) {
+                log$warn("Failed to grab keyboard interface %s: %s\n", it, strerror(errno));
+                is_sibling = false;
+            }
+            if (!is_sibling) {
+                if (dev) { libevdev_free(dev); }
+                close(fd);
+                continue;
+            }
+
+            KeyMapInputSibling_s* sib = &self->input.siblings[self->input.n_siblings++];
+            *sib = (KeyMapInputSibling_s){ .fd = fd };
+            if (ioctl(fd, EVIOCGKEY(sizeof(sib->keys_down)), sib->keys_down) < 0) {
+                memset(sib->keys_down, 0, sizeof(sib->keys_down));
+            }
+            log$info(
+                "Keyboard interface: %s '%s' phys: '%s'\n",
+                it,
+                libevdev_get_name(dev),
+                libevdev_get_phys(dev)
+            );
+            libevdev_free(dev);
+        }
+    }
+    return EOK;
+}
+
 static int
 print_event(struct input_event* ev)
 {
@@ -258,282 +492,1238 @@ get_monotonic_time_ms()
     return (u64)ts.tv_sec * 1000 + (u64)ts.tv_nsec / 1000000;
 }
 
+static inline Exception
+output_write(KeyMap_c* self, int fd, void* buf, usize size)
+{
+    // NOTE: io_uring backend sends it with the next io_uring_enter() (the loop wait)
+    if (self->uring.ring) { return KeyMapUring.write(self, fd, buf, size); }
+    e$except_errno (write(fd, buf, size)) { return Error.io; }
+    return EOK;
+}
+
+static Exception
+output_flush(KeyMap_c* self)
+{
+    if (self->output.len == 0) { return EOK; }
+
+    usize size = sizeof(self->output.frame[0]) * self->output.len;
+    self->output.len = 0;
+    return output_write(self, self->output.fd, self->output.frame, size);
+}
+
+static Exception
+output_emit(KeyMap_c* self, u16 type, u16 code, i32 value)
+{
+    if (unlikely(self->output.len == arr$len(self->output.frame))) { e$ret(output_flush(self)); }
+
+    self->output.frame[self->output.len++] = (struct input_event){
+        .type = type,
+        .code = code,
+        .value = value,
+    };
+    if (type == EV_KEY && code < KEY_CNT && value != 2) {
+        if (value) {
+            self->output.keys_down[code / 8] |= (u8)(1 << (code % 8));
+        } else {
+            self->output.keys_down[code / 8] &= (u8) ~(1 << (code % 8));
+        }
+    }
+    return EOK;
+}
+
+static inline void
+track_pressed(KeyMap_c* self, struct input_event* ev, u16 phys_code)
+{
+    // NOTE: physical -> emitted key, used for reconciliation after SYN_DROPPED
+    if (ev->type == EV_KEY && phys_code < KEY_CNT && ev->value != 2) {
+        self->pressed_map[phys_code] = ev->value ? ev->code : 0;
+    }
+}
+
+/// Validates repeat settings and creates repeat timer (no-op if repeat disabled)
 Exception
-KeyMap_mouse_movement(KeyMap_c* self, int rel_x, int rel_y)
+KeyMap_repeat_setup(KeyMap_c* self)
 {
-    uassert(self->mouse.dev);
+    if (!self->repeat.enabled) { return EOK; }
+
+    for (u32 layer = 0; layer < KeyMapLayer__count; layer++) {
+        u32* delay = &self->repeat.delay_ms[layer];
+        u32* rate = &self->repeat.rate_hz[layer];
+        if (*delay == 0) {
+            *delay = (layer == KeyMapLayer__direct) ? KEYMAP_REPEAT_DELAY_DEFAULT
+                                                    : self->repeat.delay_ms[KeyMapLayer__direct];
+        }
+        if (*rate == 0) {
+            *rate = (layer == KeyMapLayer__direct) ? KEYMAP_REPEAT_RATE_DEFAULT
+                                                   : self->repeat.rate_hz[KeyMapLayer__direct];
+        }
+        if (*delay < 10 || *delay > 5000 || *rate < 1 || *rate > 200) {
+            return e$raise(
+                Error.argument,
+                "repeat layer %d: delay expected in [10;5000]ms got %u, rate in [1;200]Hz got %u",
+                layer,
+                *delay,
+                *rate
+            );
+        }
+    }
+    e$except_errno (
+        self->repeat.timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)
+    ) {
+        return Error.os;
+    }
+    return EOK;
+}
 
-    if (rel_x) {
-        e$except_errno (libevdev_uinput_write_event(self->mouse.dev, EV_REL, REL_X, rel_x)) {
-            goto err;
+/// Sets repeated key, the timer itself is updated by repeat_apply() before the next loop wait
+static inline void
+repeat_arm(KeyMap_c* self, KeyMapLayer_e layer, u16 code, u16 phys_code)
+{
+    self->repeat.code = code;
+    self->repeat.phys_code = phys_code;
+    self->repeat.layer = layer;
+    self->repeat.pending = true;
+}
+
+/// Arms (or disarms) repeat timer for the key set by repeat_arm(), returns like timerfd_settime()
+static int
+repeat_apply(KeyMap_c* self)
+{
+    self->repeat.pending = false;
+    struct itimerspec its = { 0 };
+    if (self->repeat.code) {
+        u64 delay_ns = (u64)self->repeat.delay_ms[self->repeat.layer] * 1000000ULL;
+        u64 interval_ns = 1000000000ULL / self->repeat.rate_hz[self->repeat.layer];
+        its.it_value.tv_sec = delay_ns / 1000000000ULL;
+        its.it_value.tv_nsec = delay_ns % 1000000000ULL;
+        its.it_interval.tv_sec = interval_ns / 1000000000ULL;
+        its.it_interval.tv_nsec = interval_ns % 1000000000ULL;
+    }
+    return timerfd_settime(self->repeat.timer_fd, 0, &its, NULL);
+}
+
+/// Last pressed emitted key repeats (like kernel soft repeat), its release stops the timer
+static inline void
+repeat_track(KeyMap_c* self, struct input_event* ev, u16 phys_code, KeyMapLayer_e layer)
+{
+    if (!self->repeat.enabled || ev->type != EV_KEY) { return; }
+    if (ev->value == 1) {
+        repeat_arm(self, layer, ev->code, phys_code);
+    } else if (ev->value == 0 && self->repeat.code &&
+               (phys_code == self->repeat.phys_code || ev->code == self->repeat.code)) {
+        repeat_arm(self, layer, 0, 0);
+    }
+}
+
+/// Hardware repeat frame ([MSC_SCAN] KEY value 2, SYN_REPORT) never enters the mapping path
+static inline bool
+repeat_drop_hw(KeyMap_c* self, struct input_event* ev)
+{
+    if (ev->type == EV_KEY && ev->value == 2) {
+        // NOTE: MSC_SCAN of the same frame is still in output buffer (flushed only on SYN)
+        if (self->output.len > 0 && self->output.frame[self->output.len - 1].type == EV_MSC) {
+            self->output.len--;
         }
+        self->repeat.drop_syn = true;
+        return true;
     }
-    if (rel_y) {
-        e$except_errno (libevdev_uinput_write_event(self->mouse.dev, EV_REL, REL_Y, rel_y)) {
-            goto err;
+    if (self->repeat.drop_syn && ev->type == EV_SYN) {
+        self->repeat.drop_syn = false;
+        return true;
+    }
+    return false;
+}
+
+static Exception
+repeat_fire(KeyMap_c* self)
+{
+    u64 n_expired = 0;
+    if (read(self->repeat.timer_fd, &n_expired, sizeof(n_expired)) != sizeof(n_expired)) {
+        return EOK; // EAGAIN: disarmed after poll() returned
+    }
+    u16 code = self->repeat.code;
+    if (code == 0) { return EOK; }
+    if (!(self->output.keys_down[code / 8] & (1 << (code % 8)))) {
+        // Released by another path (mod layer release, SYN_DROPPED reconciliation)
+        repeat_arm(self, KeyMapLayer__direct, 0, 0);
+        return EOK;
+    }
+    if (n_expired > KEYMAP_REPEAT_BURST_MAX) { n_expired = KEYMAP_REPEAT_BURST_MAX; }
+    for (u32 i = 0; i < n_expired; i++) {
+        e$ret(output_emit(self, EV_KEY, code, 2));
+        e$ret(output_emit(self, EV_SYN, SYN_REPORT, 0));
+    }
+    return output_flush(self);
+}
+
+static Exception
+mouse_write(KeyMap_c* self, struct input_event* events, u32 n_events)
+{
+    if (self->unified_device) {
+        for (u32 i = 0; i < n_events; i++) {
+            e$ret(output_emit(self, events[i].type, events[i].code, events[i].value));
         }
+        return EOK; // flushed with keyboard frame (or at loop idle point)
     }
-    e$except_errno (libevdev_uinput_write_event(self->mouse.dev, EV_SYN, SYN_REPORT, 0)) {
-        goto err;
+    uassert(self->mouse.fd > 0 && "virtual mouse not initialized");
+    return output_write(self, self->mouse.fd, events, sizeof(*events) * n_events);
+}
+
+/// Validates mouse settings and precomputes acceleration curve (constant cost per tick)
+Exception
+KeyMap_mouse_accel_setup(KeyMap_c* self)
+{
+    if (self->mouse_sensitivity <= 0) {
+        self->mouse_sensitivity = 1.0f;
+    } else {
+        uassertf(
+            self->mouse_sensitivity < 10 && self->mouse_sensitivity > 0.1,
+            "sensitivity expected in (0.1;10) got: %0.3f",
+            self->mouse_sensitivity
+        );
     }
+    uassertf(
+        self->mouse_speedup_ms > 0 && self->mouse_speedup_ms < 10000,
+        "mouse_speedup_ms weird value: %lu",
+        self->mouse_speedup_ms
+    );
+    if (self->accel.step <= 0) { self->accel.step = KEYMAP_ACCEL_STEP_DEFAULT; }
+    if (self->accel.wheel_step <= 0) { self->accel.wheel_step = KEYMAP_WHEEL_STEP_DEFAULT; }
+    if (self->accel.min_speed <= 0) { self->accel.min_speed = KEYMAP_ACCEL_MIN_SPEED_DEFAULT; }
+    if (self->accel.step > 100 || self->accel.min_speed > 1) {
+        return e$raise(
+            Error.argument,
+            "accel step expected in (0;100] got: %0.2f, min_speed in (0;1] got: %0.2f",
+            self->accel.step,
+            self->accel.min_speed
+        );
+    }
+    if (self->accel.profile == KeyMapAccel__lut &&
+        (self->accel.user_lut == NULL || self->accel.user_lut_len < 2)) {
+        return e$raise(Error.argument, "accel LUT profile requires at least 2 points");
+    }
+
+    const u32 n = arr$len(self->accel.lut);
+    for (u32 i = 0; i < n; i++) {
+        f32 t = (f32)i / (f32)(n - 1);
+        f32 speed = t;
+        switch (self->accel.profile) {
+            case KeyMapAccel__linear:
+                speed = t;
+                break;
+            case KeyMapAccel__quadratic:
+                speed = t * t;
+                break;
+            case KeyMapAccel__exponential:
+                speed = (expf(4.0f * t) - 1.0f) / (expf(4.0f) - 1.0f);
+                break;
+            case KeyMapAccel__lut: {
+                f32 pos = t * (f32)(self->accel.user_lut_len - 1);
+                u32 idx = (u32)pos;
+                if (idx >= self->accel.user_lut_len - 1) { idx = self->accel.user_lut_len - 2; }
+                f32 frac = pos - (f32)idx;
+                speed = self->accel.user_lut[idx] +
+                        (self->accel.user_lut[idx + 1] - self->accel.user_lut[idx]) * frac;
+                break;
+            }
+            default:
+                return e$raise(Error.argument, "Unknown accel profile: %d", self->accel.profile);
+        }
+        if (speed < self->accel.min_speed) { speed = self->accel.min_speed; }
+        if (speed > 1.0f) { speed = 1.0f; }
+        self->accel.lut[i] = speed;
+    }
+    self->accel.rem_x = 0;
+    self->accel.rem_y = 0;
     return EOK;
+}
 
-err:
-    return Error.io;
+static inline f32
+accel_speed(KeyMap_c* self, u64 delta_ms)
+{
+    u32 idx = arr$len(self->accel.lut) - 1;
+    if (delta_ms < self->mouse_speedup_ms) {
+        idx = (u32)(delta_ms * (arr$len(self->accel.lut) - 1) / self->mouse_speedup_ms);
+    }
+    return self->accel.lut[idx];
+}
+
+/// Pointer frame: motion + hi-res wheel (with legacy notches every KEYMAP_WHEEL_NOTCH units)
+static Exception
+mouse_frame(KeyMap_c* self, int rel_x, int rel_y, int wheel, int hwheel)
+{
+    struct input_event events[7];
+    u32 n = 0;
+    if (rel_x) {
+        events[n++] = (struct input_event){ .type = EV_REL, .code = REL_X, .value = rel_x };
+    }
+    if (rel_y) {
+        events[n++] = (struct input_event){ .type = EV_REL, .code = REL_Y, .value = rel_y };
+    }
+    if (wheel) {
+        events[n++] =
+            (struct input_event){ .type = EV_REL, .code = REL_WHEEL_HI_RES, .value = wheel };
+        self->mouse.notch_v += wheel;
+        if (abs(self->mouse.notch_v) >= KEYMAP_WHEEL_NOTCH) {
+            events[n++] = (struct input_event){
+                .type = EV_REL,
+                .code = REL_WHEEL,
+                .value = self->mouse.notch_v / KEYMAP_WHEEL_NOTCH,
+            };
+            self->mouse.notch_v %= KEYMAP_WHEEL_NOTCH;
+        }
+    }
+    if (hwheel) {
+        events[n++] =
+            (struct input_event){ .type = EV_REL, .code = REL_HWHEEL_HI_RES, .value = hwheel };
+        self->mouse.notch_h += hwheel;
+        if (abs(self->mouse.notch_h) >= KEYMAP_WHEEL_NOTCH) {
+            events[n++] = (struct input_event){
+                .type = EV_REL,
+                .code = REL_HWHEEL,
+                .value = self->mouse.notch_h / KEYMAP_WHEEL_NOTCH,
+            };
+            self->mouse.notch_h %= KEYMAP_WHEEL_NOTCH;
+        }
+    }
+    if (n == 0) { return EOK; }
+    events[n++] = (struct input_event){ .type = EV_SYN, .code = SYN_REPORT, .value = 0 };
+    return mouse_write(self, events, n);
 }
 
 Exception
-KeyMap_mouse_click(KeyMap_c* self, int button, int pressed)
+KeyMap_mouse_movement(KeyMap_c* self, int rel_x, int rel_y)
 {
-    uassert(self->mouse.dev);
-    struct input_event ev = { 0 };
+    return mouse_frame(self, rel_x, rel_y, 0, 0);
+}
 
-    // Virtually unpress mouse mod key
-    ev.type = EV_MSC;
-    ev.code = MSC_SCAN;
-    ev.value = 0;
-    e$except_errno (write(self->output.fd, &ev, sizeof(ev))) { return Error.io; }
-
-    ev.type = EV_KEY;
-    ev.code = self->mouse_key_code;
-    ev.value = 0;
-    e$except_errno (write(self->output.fd, &ev, sizeof(ev))) { return Error.io; }
-
-    ev.type = EV_SYN;
-    ev.code = SYN_REPORT;
-    ev.value = 0;
-    e$except_errno (write(self->output.fd, &ev, sizeof(ev))) { return Error.io; }
-
-    // Send button event
-    e$except_errno (libevdev_uinput_write_event(self->mouse.dev, EV_KEY, button, pressed)) {
-        goto err;
+/// Creates separate virtual mouse node, mouse layer output when not --unified
+Exception
+KeyMap_mouse_create(KeyMap_c* self)
+{
+    uassert(self->mouse.fd == 0 && "already initialized");
+    struct libevdev* dev = NULL;
+
+    // Create a new evdev device
+    e$except_null (dev = libevdev_new()) { return Error.memory; }
+
+    // Set device properties
+    libevdev_set_name(dev, "UberKeyboardMappperVirtualMouse");
+    libevdev_set_id_vendor(dev, 0x1234);
+    libevdev_set_id_product(dev, 0x0002);
+    libevdev_set_id_bustype(dev, BUS_USB);
+    libevdev_set_id_version(dev, 1);
+
+    // Enable relative axes (mouse movement)
+    libevdev_enable_event_type(dev, EV_REL);
+    libevdev_enable_event_code(dev, EV_REL, REL_X, NULL);
+    libevdev_enable_event_code(dev, EV_REL, REL_Y, NULL);
+    libevdev_enable_event_code(dev, EV_REL, REL_WHEEL, NULL);
+    libevdev_enable_event_code(dev, EV_REL, REL_HWHEEL, NULL);
+    libevdev_enable_event_code(dev, EV_REL, REL_WHEEL_HI_RES, NULL);
+    libevdev_enable_event_code(dev, EV_REL, REL_HWHEEL_HI_RES, NULL);
+
+    // Enable buttons
+    libevdev_enable_event_type(dev, EV_KEY);
+    libevdev_enable_event_code(dev, EV_KEY, BTN_LEFT, NULL);
+    libevdev_enable_event_code(dev, EV_KEY, BTN_RIGHT, NULL);
+    libevdev_enable_event_code(dev, EV_KEY, BTN_MIDDLE, NULL);
+
+    // Enable synchronization events
+    libevdev_enable_event_type(dev, EV_SYN);
+
+    // Create uinput device
+    Exc result = Error.io;
+    e$except_errno (
+        libevdev_uinput_create_from_device(dev, LIBEVDEV_UINPUT_OPEN_MANAGED, &self->mouse.dev)
+    ) {
+        goto end;
     }
 
-    // Send synchronization event
-    e$except_errno (libevdev_uinput_write_event(self->mouse.dev, EV_SYN, SYN_REPORT, 0)) {
-        goto err;
+    self->mouse.fd = libevdev_uinput_get_fd(self->mouse.dev);
+    e$except_errno (fcntl(self->mouse.fd, F_SETFD, FD_CLOEXEC)) { goto end; }
+
+    printf(
+        "Virtual mouse created successfully Device: %s\n",
+        libevdev_uinput_get_devnode(self->mouse.dev)
+    );
+    result = EOK;
+
+end:
+    libevdev_free(dev);
+    return result;
+}
+
+Exception
+KeyMap_mouse_click(KeyMap_c* self, int button, int pressed)
+{
+    if (self->unified_device) {
+        // One node: mod key release and button are in the same frame and go with the same
+        // write(), evdev keeps the order, no need to wait until compositor sees mod release
+        e$ret(output_emit(self, EV_MSC, MSC_SCAN, 0));
+        e$ret(output_emit(self, EV_KEY, self->mouse_key_code, 0));
+        e$ret(output_emit(self, EV_KEY, button, pressed));
+        e$ret(output_emit(self, EV_SYN, SYN_REPORT, 0));
+        e$ret(output_emit(self, EV_MSC, MSC_SCAN, 0));
+        e$ret(output_emit(self, EV_KEY, self->mouse_key_code, 1));
+        e$ret(output_emit(self, EV_SYN, SYN_REPORT, 0));
+        e$ret(output_emit(self, EV_KEY, self->mouse_key_code, 2));
+        e$ret(output_emit(self, EV_SYN, SYN_REPORT, 0));
+
+        if (self->debug) { printf("Button %d %s\n", button, pressed ? "pressed" : "released"); }
+        return EOK;
     }
+
+    // Virtually unpress mouse mod key
+    e$ret(output_emit(self, EV_MSC, MSC_SCAN, 0));
+    e$ret(output_emit(self, EV_KEY, self->mouse_key_code, 0));
+    e$ret(output_emit(self, EV_SYN, SYN_REPORT, 0));
+    e$ret(output_flush(self));
+
+    // Send button event + synchronization event
+    struct input_event events[] = {
+        { .type = EV_KEY, .code = button, .value = pressed },
+        { .type = EV_SYN, .code = SYN_REPORT, .value = 0 },
+    };
+    e$ret(mouse_write(self, events, arr$len(events)));
     usleep(20000);
 
     // Virtually press mouse mod key
-    ev.type = EV_MSC;
-    ev.code = MSC_SCAN;
-    ev.value = 0;
-    e$except_errno (write(self->output.fd, &ev, sizeof(ev))) { return Error.io; }
-
-    ev.type = EV_KEY;
-    ev.code = self->mouse_key_code;
-    ev.value = 1;
-    e$except_errno (write(self->output.fd, &ev, sizeof(ev))) { return Error.io; }
-
-    ev.type = EV_SYN;
-    ev.code = SYN_REPORT;
-    ev.value = 0;
-    e$except_errno (write(self->output.fd, &ev, sizeof(ev))) { return Error.io; }
-
-    ev.type = EV_KEY;
-    ev.code = self->mouse_key_code;
-    ev.value = 2;
-    e$except_errno (write(self->output.fd, &ev, sizeof(ev))) { return Error.io; }
-
-    ev.type = EV_SYN;
-    ev.code = SYN_REPORT;
-    ev.value = 0;
-    e$except_errno (write(self->output.fd, &ev, sizeof(ev))) { return Error.io; }
+    e$ret(output_emit(self, EV_MSC, MSC_SCAN, 0));
+    e$ret(output_emit(self, EV_KEY, self->mouse_key_code, 1));
+    e$ret(output_emit(self, EV_SYN, SYN_REPORT, 0));
+    e$ret(output_emit(self, EV_KEY, self->mouse_key_code, 2));
+    e$ret(output_emit(self, EV_SYN, SYN_REPORT, 0));
+    e$ret(output_flush(self));
 
     if (self->debug) { printf("Button %d %s\n", button, pressed ? "pressed" : "released"); }
     return EOK;
-err:
-    return Error.io;
 }
 
 Exception
-KeyMap_mouse_wheel(KeyMap_c* self, int vertical)
+KeyMap_mouse_wheel(KeyMap_c* self, int vertical, int horizontal)
 {
-    uassert(self->mouse.dev);
+    // One notch per unit, hi-res consumers get the same distance as legacy ones
+    return mouse_frame(self, 0, 0, vertical * KEYMAP_WHEEL_NOTCH, horizontal * KEYMAP_WHEEL_NOTCH);
+}
 
-    if (vertical != 0) {
-        e$except_errno (libevdev_uinput_write_event(self->mouse.dev, EV_REL, REL_WHEEL, vertical)) {
-            goto err;
-        }
-        e$except_errno (libevdev_uinput_write_event(self->mouse.dev, EV_SYN, SYN_REPORT, 0)) {
-            goto err;
-        }
+/// Per-event state passed along KeyMap_handle_key() pipeline stages
+typedef struct KeyMapStageCtx_s
+{
+    u16 phys_code;       // ev is rewritten by mapping, keeping physical code
+    KeyMapLayer_e layer; // resolved layer of the event
+    bool is_frame_end;
+    bool is_consumed; // event is done, the rest of the stages are skipped
+} KeyMapStageCtx_s;
+
+/// Sets enabled pipeline stages from config, must be called again after config change
+void
+KeyMap_pipeline_setup(KeyMap_c* self)
+{
+    u32 enabled = (1 << KeyMapStage__action) | (1 << KeyMapStage__output);
+    if (self->repeat.enabled) { enabled |= (1 << KeyMapStage__normalize); }
+    if (keymap$mod_key_code(self) || keymap$mouse_key_code(self)) {
+        enabled |= (1 << KeyMapStage__layer);
     }
-    return EOK;
-err:
-    return Error.io;
+    self->pipeline.enabled = enabled;
 }
 
-Exception
-KeyMap_handle_key(KeyMap_c* self, struct input_event* ev)
+static inline u64
+pipeline_clock(void)
 {
-    uassert(ev->type == EV_KEY || ev->type == EV_MSC || ev->type == EV_SYN);
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+#endif
+}
 
-    if (self->debug) { print_event(ev); }
+static u64
+get_monotonic_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
 
-    if (ev->code < KEY_MAX) {
-        if (self->mouse_key_code && ev->code == self->mouse_key_code) {
-            self->mouse_pressed = ev->value > 0;
-            self->mouse.last_press_ts = 0;
+/// Event loop wait, poll() or io_uring backend, fds[0] is input. Within busy-poll window after
+/// the last input wakeup, fds are checked without blocking in a spin loop first (burns a core
+/// while typing, saves scheduler wakeup latency), returns like poll()
+int
+KeyMap_input_wait(KeyMap_c* self, struct pollfd* fds, u32 n_fds, int timeout_ms)
+{
+    u64 spin_until_ns = 0;
+    if (self->busy_poll.window_us) {
+        spin_until_ns = self->busy_poll.last_input_ns + (u64)self->busy_poll.window_us * 1000;
+    }
 
-            if (!self->mouse_pressed) {
-                self->mouse.left = false;
-                self->mouse.right = false;
-                self->mouse.up = false;
-                self->mouse.down = false;
-            }
+    // NOTE: repeat timer changes of handled frames, after their output is flushed (or queued)
+    if (self->repeat.pending && repeat_apply(self) < 0) { return -1; }
+
+    int rc = 0;
+    if (self->uring.ring) {
+        rc = KeyMapUring.wait(self, fds, n_fds, timeout_ms, spin_until_ns);
+    } else {
+        while (spin_until_ns && get_monotonic_time_ns() < spin_until_ns) {
+            rc = poll(fds, n_fds, 0);
+            if (rc != 0) { break; }
+            for (u32 i = 0; i < KEYMAP_BUSY_POLL_RELAX; i++) { keymap$cpu_relax(); }
         }
+        if (rc == 0) { rc = poll(fds, n_fds, timeout_ms); }
+    }
 
-        if (self->mod_key_code && ev->type == EV_KEY && ev->code == self->mod_key_code) {
-            self->mod_pressed = ev->value > 0;
-            log$trace("Mod state: %d\n", self->mod_pressed);
+    if (spin_until_ns && rc > 0 && fds[0].revents) {
+        u64 now = get_monotonic_time_ns();
+        self->busy_poll.n_wakeups++;
+        if (now < spin_until_ns) { self->busy_poll.n_spin_hits++; }
+        self->busy_poll.last_input_ns = now;
+    }
+    return rc;
+}
 
-            if (!self->mod_pressed && self->last_key_mod) {
-                // Special case (bug) when MOD key released before arrow key,
-                //   it was leading to infinite key loop
-                log$trace(
-                    "Unpress last mapped key: %s\n",
-                    libevdev_event_code_get_name(EV_KEY, self->last_key_mod)
-                );
+static Exception
+stage_normalize(KeyMap_c* self, struct input_event* ev, KeyMapStageCtx_s* ctx)
+{
+    // NOTE: hardware repeats are replaced by repeat timer
+    ctx->is_consumed = repeat_drop_hw(self, ev);
+    return EOK;
+}
 
-                ev->type = EV_SYN;
-                ev->code = SYN_REPORT;
-                ev->value = 0;
-                e$except_errno (write(self->output.fd, ev, sizeof(*ev))) { return Error.io; }
+static Exception
+stage_layer(KeyMap_c* self, struct input_event* ev, KeyMapStageCtx_s* ctx)
+{
+    if (ev->code >= KEY_MAX) { return EOK; }
 
-                ev->type = EV_MSC;
-                ev->code = MSC_SCAN;
-                ev->value = self->last_key_mod;
-                e$except_errno (write(self->output.fd, ev, sizeof(*ev))) { return Error.io; }
+    if (keymap$mouse_key_code(self) && ev->code == keymap$mouse_key_code(self)) {
+        self->mouse_pressed = ev->value > 0;
+        self->mouse.last_press_ts = 0;
 
-                ev->type = EV_KEY;
-                ev->code = self->last_key_mod;
-                ev->value = 0;
-                e$except_errno (write(self->output.fd, ev, sizeof(*ev))) { return Error.io; }
+        if (!self->mouse_pressed) {
+            self->mouse.left = false;
+            self->mouse.right = false;
+            self->mouse.up = false;
+            self->mouse.down = false;
+            self->mouse.wheel_v = 0;
+            self->mouse.wheel_h = 0;
+        }
+    }
 
-                self->last_key_mod = 0;
-            }
-        } else {
-            if (self->mod_pressed) {
+    if (keymap$mod_key_code(self) && ev->type == EV_KEY && ev->code == keymap$mod_key_code(self)) {
+        self->mod_pressed = ev->value > 0;
+        ctx->is_consumed = true;
+        log$trace("Mod state: %d\n", self->mod_pressed);
+
+        if (!self->mod_pressed && self->last_key_mod) {
+            // Special case (bug) when MOD key released before arrow key,
+            //   it was leading to infinite key loop
+            log$trace(
+                "Unpress last mapped key: %s\n",
+                libevdev_event_code_get_name(EV_KEY, self->last_key_mod)
+            );
 
-                log$trace(
-                    "Mod pressed + %s\n",
-                    libevdev_event_code_get_name(ev->type, ev->code)
-                );
+            e$ret(output_emit(self, EV_SYN, SYN_REPORT, 0));
+            e$ret(output_emit(self, EV_MSC, MSC_SCAN, self->last_key_mod));
+            e$ret(output_emit(self, EV_KEY, self->last_key_mod, 0));
 
-                if (self->mod_map[ev->code]) {
-                    ev->code = self->mod_map[ev->code];
+            self->last_key_mod = 0;
+        }
+        return EOK;
+    }
 
-                    if (ev->type == EV_KEY && ev->value > 0) {
-                        // NOTE: to be unpressed when mod released before key (using mod code!)
-                        self->last_key_mod = ev->code;
-                    }
-                    e$except_errno (write(self->output.fd, ev, sizeof(*ev))) { return Error.io; }
+    if (self->mod_pressed) {
+        ctx->layer = KeyMapLayer__mod;
+    } else if (self->mouse_pressed) {
+        ctx->layer = KeyMapLayer__mouse;
+    }
+    return EOK;
+}
 
-                    ev->type = EV_SYN;
-                    ev->code = SYN_REPORT;
-                    ev->value = 0;
-                    e$except_errno (write(self->output.fd, ev, sizeof(*ev))) { return Error.io; }
-                }
-            } else if (self->mouse_pressed) {
-                log$trace(
-                    "Mouse pressed + %s\n",
-                    libevdev_event_code_get_name(ev->type, ev->code)
-                );
-                if (self->mouse_map[ev->code]) {
-                    switch (self->mouse_map[ev->code]) {
-                        case BTN_LEFT:
-                            e$ret(KeyMap.mouse_click(self, BTN_LEFT, ev->value));
-                            break;
-                        case BTN_RIGHT:
-                            e$ret(KeyMap.mouse_click(self, BTN_RIGHT, ev->value));
-                            break;
-                        case BTN_GEAR_UP:
-                            e$ret(KeyMap.mouse_wheel(self, 1));
-                            break;
-                        case BTN_GEAR_DOWN:
-                            e$ret(KeyMap.mouse_wheel(self, -1));
-                            break;
-                        // NOTE: movements are handled in KeyMap_handle_events
-                        case KEY_RIGHT:
-                            self->mouse.right = ev->value > 0;
-                            break;
-                        case KEY_LEFT:
-                            self->mouse.left = ev->value > 0;
-                            break;
-                        case KEY_UP:
-                            self->mouse.up = ev->value > 0;
-                            break;
-                        case KEY_DOWN:
-                            self->mouse.down = ev->value > 0;
-                            break;
-                        default:
-                            unreachable();
-                    }
-                } else {
-                    e$except_errno (write(self->output.fd, ev, sizeof(*ev))) { return Error.io; }
-                }
-            } else {
-                log$trace("Direct %s\n", libevdev_event_code_get_name(ev->type, ev->code));
-                ev->code = self->direct_map[ev->code] ? self->direct_map[ev->code] : ev->code;
-                e$except_errno (write(self->output.fd, ev, sizeof(*ev))) { return Error.io; }
+static Exception
+stage_action_mouse(KeyMap_c* self, struct input_event* ev, KeyMapStageCtx_s* ctx)
+{
+    switch (keymap$mouse_map(self)[ev->code]) {
+        case BTN_LEFT:
+        case BTN_RIGHT: {
+            u16 button = keymap$mouse_map(self)[ev->code];
+            if (self->unified_device) {
+                // NOTE: button is in keys_down of the same node, keep it held
+                // on SYN_DROPPED reconciliation
+                struct input_event btn_ev = *ev;
+                btn_ev.code = button;
+                track_pressed(self, &btn_ev, ctx->phys_code);
             }
+            return KeyMap.mouse_click(self, button, ev->value);
         }
-    } else {
+        // NOTE: one notch on press, then timer driven scrolling while held
+        case BTN_GEAR_UP:
+        case BTN_GEAR_DOWN:
+        case KEYMAP_HWHEEL_LEFT:
+        case KEYMAP_HWHEEL_RIGHT: {
+            u16 code = keymap$mouse_map(self)[ev->code];
+            bool is_vertical = code == BTN_GEAR_UP || code == BTN_GEAR_DOWN;
+            i8 dir = (code == BTN_GEAR_UP || code == KEYMAP_HWHEEL_RIGHT) ? 1 : -1;
+            i8* wheel = is_vertical ? &self->mouse.wheel_v : &self->mouse.wheel_h;
+            if (ev->value == 1) {
+                *wheel = dir;
+                self->mouse.wheel_press_ts = get_monotonic_time_ms();
+                self->mouse.wheel_rem_v = 0;
+                self->mouse.wheel_rem_h = 0;
+                return KeyMap.mouse_wheel(self, is_vertical ? dir : 0, is_vertical ? 0 : dir);
+            } else if (ev->value == 0 && *wheel == dir) {
+                *wheel = 0;
+            }
+            return EOK;
+        }
+        // NOTE: movements are handled in KeyMap_handle_events
+        case KEY_RIGHT:
+            self->mouse.right = ev->value > 0;
+            return EOK;
+        case KEY_LEFT:
+            self->mouse.left = ev->value > 0;
+            return EOK;
+        case KEY_UP:
+            self->mouse.up = ev->value > 0;
+            return EOK;
+        case KEY_DOWN:
+            self->mouse.down = ev->value > 0;
+            return EOK;
+        default:
+            unreachable();
+    }
+    return EOK;
+}
+
+static Exception
+stage_action(KeyMap_c* self, struct input_event* ev, KeyMapStageCtx_s* ctx)
+{
+    if (ev->code >= KEY_MAX) {
         // Weird key code, but still fallback to the event propagation
-        e$except_errno (write(self->output.fd, ev, sizeof(*ev))) { return Error.io; }
+        return output_emit(self, ev->type, ev->code, ev->value);
     }
 
+    switch (ctx->layer) {
+        case KeyMapLayer__mod:
+            log$trace("Mod pressed + %s\n", libevdev_event_code_get_name(ev->type, ev->code));
+            if (keymap$mod_map(self)[ev->code]) {
+                ev->code = keymap$mod_map(self)[ev->code];
+
+                if (ev->type == EV_KEY && ev->value > 0) {
+                    // NOTE: to be unpressed when mod released before key (using mod code!)
+                    self->last_key_mod = ev->code;
+                }
+                track_pressed(self, ev, ctx->phys_code);
+                repeat_track(self, ev, ctx->phys_code, KeyMapLayer__mod);
+                e$ret(output_emit(self, ev->type, ev->code, ev->value));
+                e$ret(output_emit(self, EV_SYN, SYN_REPORT, 0));
+            }
+            return EOK;
+
+        case KeyMapLayer__mouse:
+            log$trace("Mouse pressed + %s\n", libevdev_event_code_get_name(ev->type, ev->code));
+            if (keymap$mouse_map(self)[ev->code]) { return stage_action_mouse(self, ev, ctx); }
+            track_pressed(self, ev, ctx->phys_code);
+            repeat_track(self, ev, ctx->phys_code, KeyMapLayer__mouse);
+            return output_emit(self, ev->type, ev->code, ev->value);
+
+        default:
+            log$trace("Direct %s\n", libevdev_event_code_get_name(ev->type, ev->code));
+            ev->code = keymap$direct_map(self)[ev->code] ? keymap$direct_map(self)[ev->code]
+                                                         : ev->code;
+            track_pressed(self, ev, ctx->phys_code);
+            repeat_track(self, ev, ctx->phys_code, KeyMapLayer__direct);
+            return output_emit(self, ev->type, ev->code, ev->value);
+    }
+}
+
+static Exception
+stage_output(KeyMap_c* self, struct input_event* ev, KeyMapStageCtx_s* ctx)
+{
+    (void)ev;
+    // NOTE: input frame is complete, sending whole output frame in one write()
+    if (ctx->is_frame_end) { return output_flush(self); }
     return EOK;
 }
 
+// Calls enabled stage, skips the rest when event is consumed, counting cycles if profiling
+#define keymap$stage(stage, stage_fn)                                                             \
+    if (self->pipeline.enabled & KEYMAP_STAGES_STATIC & (1 << (stage))) {                        \
+        if (unlikely(self->pipeline.profile)) {                                                   \
+            u64 _t_start = pipeline_clock();                                                      \
+            e$ret(stage_fn(self, ev, &ctx));                                                      \
+            self->pipeline.cycles[stage] += pipeline_clock() - _t_start;                          \
+            self->pipeline.n_calls[stage]++;                                                      \
+        } else {                                                                                  \
+            e$ret(stage_fn(self, ev, &ctx));                                                      \
+        }                                                                                         \
+        if (ctx.is_consumed) { return EOK; }                                                      \
+    }
+
+Exception
+KeyMap_handle_key(KeyMap_c* self, struct input_event* ev)
+{
+    uassert(ev->type == EV_KEY || ev->type == EV_MSC || ev->type == EV_SYN);
+
+    if (self->debug) { print_event(ev); }
+
+    KeyMapStageCtx_s ctx = {
+        .phys_code = ev->code,
+        .layer = KeyMapLayer__direct,
+        .is_frame_end = ev->type == EV_SYN && ev->code == SYN_REPORT,
+    };
+
+    keymap$stage(KeyMapStage__normalize, stage_normalize);
+    keymap$stage(KeyMapStage__layer, stage_layer);
+    keymap$stage(KeyMapStage__action, stage_action);
+    keymap$stage(KeyMapStage__output, stage_output);
+
+    return EOK;
+}
+
+#undef keymap$stage
+
 Exception
 KeyMap_handle_mouse_move(KeyMap_c* self)
 {
     // Initial direction
     int x = 0;
     int y = 0;
-    if (self->mouse.up) { y = -10; }
-    if (self->mouse.down) { y = 10; }
-    if (self->mouse.left) { x = -10; }
-    if (self->mouse.right) { x = 10; }
+    int wheel = 0;
+    int hwheel = 0;
+    if (self->mouse.up) { y = -1; }
+    if (self->mouse.down) { y = 1; }
+    if (self->mouse.left) { x = -1; }
+    if (self->mouse.right) { x = 1; }
+
+    if (x == 0 && y == 0) {
+        // No cursor button, help reset speed
+        self->mouse.last_press_ts = 0;
+        self->accel.rem_x = 0;
+        self->accel.rem_y = 0;
+    }
+    if (x == 0 && y == 0 && self->mouse.wheel_v == 0 && self->mouse.wheel_h == 0) { return EOK; }
 
+    u64 ts = get_monotonic_time_ms();
     if (x != 0 || y != 0) {
-        u64 ts = get_monotonic_time_ms();
         if (self->mouse.last_press_ts == 0) { self->mouse.last_press_ts = ts; }
 
-        f32 speed = self->mouse_sensitivity;
-        u64 speedup_interval_ms = self->mouse_speedup_ms;
-        u64 delta = ts - self->mouse.last_press_ts;
+        f32 step = accel_speed(self, ts - self->mouse.last_press_ts) * self->accel.step *
+                   self->mouse_sensitivity;
+        // Diagonal moves must have the same speed as straight
+        if (x != 0 && y != 0) { step *= (f32)M_SQRT1_2; }
+
+        // Keeping fractional part for the next tick, slow movements don't quantize to 0/1px
+        f32 fx = (f32)x * step + self->accel.rem_x;
+        f32 fy = (f32)y * step + self->accel.rem_y;
+        x = (int)fx;
+        y = (int)fy;
+        self->accel.rem_x = fx - (f32)x;
+        self->accel.rem_y = fy - (f32)y;
+    }
+    if (self->mouse.wheel_v != 0 || self->mouse.wheel_h != 0) {
+        f32 units = accel_speed(self, ts - self->mouse.wheel_press_ts) * self->accel.wheel_step;
+        f32 fv = (f32)self->mouse.wheel_v * units + self->mouse.wheel_rem_v;
+        f32 fh = (f32)self->mouse.wheel_h * units + self->mouse.wheel_rem_h;
+        wheel = (int)fv;
+        hwheel = (int)fh;
+        self->mouse.wheel_rem_v = fv - (f32)wheel;
+        self->mouse.wheel_rem_h = fh - (f32)hwheel;
+    }
 
-        if (delta < speedup_interval_ms) {
-            if (delta < speedup_interval_ms / 10) {
-                speed *= 0.1;
-            } else {
-                speed *= ((f64)delta / (f64)speedup_interval_ms);
+    if (self->debug) { printf("Mouse move x=%d y=%d wheel=%d/%d\n", x, y, wheel, hwheel); }
+    // NOTE: motion and scrolling share the tick and the frame (one write)
+    return mouse_frame(self, x, y, wheel, hwheel);
+}
+
+/// Physical key state of input0, libevdev one is stale when input is read raw (io_uring backend)
+static bool
+input_key_down(KeyMap_c* self, u16 code)
+{
+    u8 mask = (u8)(1 << (code % 8));
+    if (self->uring.ring) {
+        if (self->input.keys_down[code / 8] & mask) { return true; }
+    } else if (libevdev_get_event_value(self->input.dev, EV_KEY, code)) {
+        return true;
+    }
+    for (u32 i = 0; i < self->input.n_siblings; i++) {
+        if (self->input.siblings[i].keys_down[code / 8] & mask) { return true; }
+    }
+    return false;
+}
+
+/// SYN_DROPPED recovery tail: layer flags and held keys follow physical key state (all
+/// interfaces), emitted keys which physical source is not held anymore are released, everything
+/// is emitted as one frame
+static Exception
+resync_reconcile(KeyMap_c* self, u32 n_synced)
+{
+    u8 phys_down[KEY_CNT / 8] = { 0 };
+    for (u32 code = 0; code < KEY_CNT; code++) {
+        if (input_key_down(self, code)) { phys_down[code / 8] |= (u8)(1 << (code % 8)); }
+    }
+
+    // Layer flags must follow physical state, even if sync missed press/release pair
+    if (self->mod_key_code) {
+        self->mod_pressed = phys_down[self->mod_key_code / 8] & (1 << (self->mod_key_code % 8));
+        if (!self->mod_pressed) { self->last_key_mod = 0; }
+    }
+    if (self->mouse_key_code) {
+        self->mouse_pressed = phys_down[self->mouse_key_code / 8] &
+                              (1 << (self->mouse_key_code % 8));
+        if (!self->mouse_pressed) {
+            self->mouse.left = false;
+            self->mouse.right = false;
+            self->mouse.up = false;
+            self->mouse.down = false;
+            self->mouse.wheel_v = 0;
+            self->mouse.wheel_h = 0;
+        }
+    }
+
+    u8 expected_down[sizeof(self->output.keys_down)] = { 0 };
+    for (u32 code = 0; code < KEY_CNT; code++) {
+        u16 out_code = self->pressed_map[code];
+        if (!out_code) { continue; }
+        if (phys_down[code / 8] & (1 << (code % 8))) {
+            expected_down[out_code / 8] |= (u8)(1 << (out_code % 8));
+        } else {
+            self->pressed_map[code] = 0;
+        }
+    }
+
+    u32 n_released = 0;
+    for (u32 code = 0; code < KEY_CNT; code++) {
+        u8 mask = (u8)(1 << (code % 8));
+        if ((self->output.keys_down[code / 8] & mask) && !(expected_down[code / 8] & mask)) {
+            e$ret(output_emit(self, EV_KEY, code, 0));
+            n_released++;
+        }
+    }
+    e$ret(output_emit(self, EV_SYN, SYN_REPORT, 0));
+    e$ret(output_flush(self));
+    if (self->repeat.code) { repeat_arm(self, KeyMapLayer__direct, 0, 0); }
+
+    log$warn(
+        "SYN_DROPPED #%lu: re-synced %d key events, released %d stuck keys\n",
+        self->stats.n_syn_dropped,
+        n_synced,
+        n_released
+    );
+    return EOK;
+}
+
+/// SYN_DROPPED recovery: feeds libevdev sync events through mapping engine, then releases emitted
+/// keys which physical source is not held anymore, everything is emitted as one output frame
+static Exception
+handle_resync(KeyMap_c* self)
+{
+    self->stats.n_syn_dropped++;
+
+    struct input_event ev;
+    u32 n_synced = 0;
+    int rc = LIBEVDEV_READ_STATUS_SYNC;
+    while (rc == LIBEVDEV_READ_STATUS_SYNC) {
+        rc = libevdev_next_event(self->input.dev, LIBEVDEV_READ_FLAG_SYNC, &ev);
+        if (rc != LIBEVDEV_READ_STATUS_SYNC) { break; }
+        // NOTE: skipping SYN here, the whole correction goes out as a single frame below
+        if (ev.type != EV_KEY) { continue; }
+        n_synced++;
+        e$ret(KeyMap_handle_key(self, &ev));
+    }
+    if (rc != -EAGAIN) {
+        return e$raise(Error.io, "Failed to re-sync events: %s\n", strerror(-rc));
+    }
+    return resync_reconcile(self, n_synced);
+}
+
+/// SYN_DROPPED recovery of raw reads (io_uring backend, sibling interfaces): difference between
+/// tracked and EVIOCGKEY key state is fed through mapping engine, like libevdev sync events
+static Exception
+handle_resync_raw(KeyMap_c* self, int fd, u8* keys_down)
+{
+    self->stats.n_syn_dropped++;
+
+    u8 phys_down[KEY_CNT / 8] = { 0 };
+    e$except_errno (ioctl(fd, EVIOCGKEY(sizeof(phys_down)), phys_down)) { return Error.io; }
+    u32 n_synced = 0;
+    for (u32 code = 0; code < KEY_CNT; code++) {
+        u8 mask = (u8)(1 << (code % 8));
+        if (!((keys_down[code / 8] ^ phys_down[code / 8]) & mask)) { continue; }
+        struct input_event ev = {
+            .type = EV_KEY,
+            .code = code,
+            .value = (phys_down[code / 8] & mask) ? 1 : 0,
+        };
+        n_synced++;
+        e$ret(KeyMap_handle_key(self, &ev));
+    }
+    memcpy(keys_down, phys_down, sizeof(phys_down));
+    return resync_reconcile(self, n_synced);
+}
+
+/// Event of raw read() input: key state tracking and SYN_DROPPED recovery of the interface `fd`
+static Exception
+handle_event_raw(
+    KeyMap_c* self,
+    int fd,
+    u8* keys_down,
+    bool* is_dropped,
+    struct input_event* ev
+)
+{
+    if (unlikely(ev->type == EV_SYN && ev->code == SYN_DROPPED)) {
+        *is_dropped = true;
+        return EOK;
+    }
+    if (unlikely(*is_dropped)) {
+        if (ev->type == EV_SYN && ev->code == SYN_REPORT) {
+            *is_dropped = false;
+            e$ret(handle_resync_raw(self, fd, keys_down));
+        }
+        return EOK;
+    }
+    if (ev->type != EV_KEY && ev->type != EV_MSC && ev->type != EV_SYN) {
+        return EOK; // NOTE: e.g. AC Pan axis of consumer control interface
+    }
+    if (ev->type == EV_KEY && ev->code < KEY_CNT && ev->value != 2) {
+        if (ev->value) {
+            keys_down[ev->code / 8] |= (u8)(1 << (ev->code % 8));
+        } else {
+            keys_down[ev->code / 8] &= (u8) ~(1 << (ev->code % 8));
+        }
+    }
+    self->stats.n_events++;
+    e$ret(KeyMap_handle_key(self, ev));
+    if (self->mouse_pressed && ev->type == EV_KEY) { e$ret(KeyMap_handle_mouse_move(self)); }
+    return EOK;
+}
+
+/// Reads ready sibling interfaces into their buffers (`fds` - sibling poll slots), true if any
+/// events were buffered. Buffers are drained before every wait, so a read never overwrites.
+static Exception
+input_siblings_read(KeyMap_c* self, struct pollfd* fds, bool* has_events)
+{
+    *has_events = false;
+    for (u32 i = 0; i < self->input.n_siblings; i++) {
+        KeyMapInputSibling_s* sib = &self->input.siblings[i];
+        if (!fds[i].revents || sib->pos < sib->len) { continue; }
+        isize n = read(sib->fd, sib->buf, sizeof(sib->buf));
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR) { continue; }
+            return e$raise(Error.io, "Failed to read keyboard interface: %s\n", strerror(errno));
+        }
+        sib->pos = 0;
+        sib->len = (u32)(n / sizeof(sib->buf[0]));
+        self->input.n_buffered += sib->len;
+        if (sib->len) { *has_events = true; }
+    }
+    return EOK;
+}
+
+/// Sibling interfaces poll slots, unused ones are -1 (ignored by poll() and io_uring backend)
+static void
+input_siblings_poll_fds(KeyMap_c* self, struct pollfd* fds)
+{
+    for (u32 i = 0; i < KEYMAP_INPUT_SIBLINGS_MAX; i++) {
+        fds[i] = (struct pollfd){ -1, POLLIN, 0 };
+        if (i < self->input.n_siblings) { fds[i].fd = self->input.siblings[i].fd; }
+    }
+}
+
+static inline bool
+input_event_before(struct input_event* a, struct input_event* b)
+{
+    if (a->input_event_sec != b->input_event_sec) {
+        return a->input_event_sec < b->input_event_sec;
+    }
+    return a->input_event_usec <= b->input_event_usec;
+}
+
+/// Handles buffered sibling events in kernel timestamp order, up to `until` (input0 event about
+/// to be handled) or all of them if NULL. Frames share timestamp, so they are never interleaved.
+static Exception
+input_siblings_handle(KeyMap_c* self, struct input_event* until)
+{
+    while (self->input.n_buffered > 0) {
+        KeyMapInputSibling_s* next = NULL;
+        for (u32 i = 0; i < self->input.n_siblings; i++) {
+            KeyMapInputSibling_s* sib = &self->input.siblings[i];
+            if (sib->pos >= sib->len) { continue; }
+            if (next == NULL || !input_event_before(&next->buf[next->pos], &sib->buf[sib->pos])) {
+                next = sib;
             }
         }
-        if (speed < 0.1f) { speed = 0.1f; }
-        x *= speed;
-        y *= speed;
+        uassert(next != NULL && "n_buffered out of sync");
+        struct input_event* ev = &next->buf[next->pos];
+        if (until && !input_event_before(ev, until)) { break; }
 
-        if (self->debug) { printf("Mouse move x=%d y=%d\n", x, y); }
-        e$ret(KeyMap.mouse_movement(self, x, y));
-    } else {
-        // No cursor button, help reset speed
-        self->mouse.last_press_ts = 0;
+        next->pos++;
+        self->input.n_buffered--;
+        e$ret(handle_event_raw(self, next->fd, next->keys_down, &next->is_dropped, ev));
+    }
+    return EOK;
+}
+
+/// Releases every key and button sent to virtual devices (stuck keys), layer state is re-read
+/// from the physical keyboard
+Exception
+KeyMap_keys_release_all(KeyMap_c* self)
+{
+    u32 n_released = 0;
+    for (u32 code = 0; code < KEY_CNT; code++) {
+        if (self->output.keys_down[code / 8] & (1 << (code % 8))) {
+            e$ret(output_emit(self, EV_KEY, code, 0));
+            n_released++;
+        }
+    }
+    e$ret(output_emit(self, EV_SYN, SYN_REPORT, 0));
+    e$ret(output_flush(self));
+    if (self->mouse.fd > 0 && !self->unified_device) {
+        // NOTE: separate mouse node buttons are not tracked in keys_down
+        struct input_event events[] = {
+            { .type = EV_KEY, .code = BTN_LEFT, .value = 0 },
+            { .type = EV_KEY, .code = BTN_RIGHT, .value = 0 },
+            { .type = EV_SYN, .code = SYN_REPORT, .value = 0 },
+        };
+        e$ret(mouse_write(self, events, arr$len(events)));
     }
+    if (self->repeat.code) { repeat_arm(self, KeyMapLayer__direct, 0, 0); }
 
+    memset(self->pressed_map, 0, sizeof(self->pressed_map));
+    self->last_key_mod = 0;
+    self->mod_pressed = false;
+    self->mouse_pressed = false;
+    if (self->input.dev) {
+        if (self->mod_key_code) { self->mod_pressed = input_key_down(self, self->mod_key_code); }
+        if (self->mouse_key_code) {
+            self->mouse_pressed = input_key_down(self, self->mouse_key_code);
+        }
+    }
+    self->mouse.up = false;
+    self->mouse.down = false;
+    self->mouse.left = false;
+    self->mouse.right = false;
+    self->mouse.wheel_v = 0;
+    self->mouse.wheel_h = 0;
+
+    log$info("Released %u keys\n", n_released);
     return EOK;
 }
 
+/// Switches maps and mouse settings to profile config, when running releases all keys first
+Exception
+KeyMap_profile_apply(KeyMap_c* self, KeyMapProfile_s* profile)
+{
+    uassert(profile != NULL);
+    KeyMap_c* cfg = profile->config;
+#ifdef KEYMAP_STATIC_CONFIG
+    if (!str.eq(profile->name, KEYMAP_STATIC_PROFILE)) {
+        return e$raise(
+            Error.argument,
+            "Static config build, only '%s' profile is available",
+            KEYMAP_STATIC_PROFILE
+        );
+    }
+#endif
+    bool is_running = self->input.fd > 0;
+
+    if (is_running) {
+        bool has_mouse = self->mouse.fd > 0 || (self->unified_device && self->mouse_key_code);
+        if (cfg->mouse_key_code && !has_mouse) {
+            return e$raise(Error.argument, "Profile '%s' requires virtual mouse", profile->name);
+        }
+        e$ret(KeyMap.keys_release_all(self));
+    }
+
+    memcpy(self->direct_map, cfg->direct_map, sizeof(self->direct_map));
+    memcpy(self->mod_map, cfg->mod_map, sizeof(self->mod_map));
+    memcpy(self->mouse_map, cfg->mouse_map, sizeof(self->mouse_map));
+    self->mod_key_code = cfg->mod_key_code;
+    self->mouse_key_code = cfg->mouse_key_code;
+    self->mouse_sensitivity = cfg->mouse_sensitivity;
+    self->mouse_speedup_ms = cfg->mouse_speedup_ms;
+    self->control.profile = profile->name;
+
+    if (is_running && self->mouse_key_code) { e$ret(KeyMap.mouse_accel_setup(self)); }
+    KeyMap.pipeline_setup(self);
+    return EOK;
+}
+
+/// Writes current maps and layer keys as C header for KEYMAP_STATIC_CONFIG build
+Exception
+KeyMap_static_config_save(KeyMap_c* self, char* path)
+{
+    struct
+    {
+        char* name;
+        u16* map;
+    } maps[] = {
+        { "keymap_static_direct_map", self->direct_map },
+        { "keymap_static_mod_map", self->mod_map },
+        { "keymap_static_mouse_map", self->mouse_map },
+    };
+    FILE* file = NULL;
+    e$ret(io.fopen(&file, path, "w"));
+
+    Exc result = EOK;
+    e$goto(result = io.fprintf(file, "// Generated by `./cex static-build`, do not edit\n"), end);
+    e$goto(result = io.fprintf(file, "#pragma once\n"), end);
+    e$goto(
+        result = io.fprintf(file, "#define KEYMAP_STATIC_PROFILE \"%s\"\n", self->control.profile),
+        end
+    );
+    e$goto(
+        result = io.fprintf(file, "#define KEYMAP_STATIC_MOD_KEY_CODE %d\n", self->mod_key_code),
+        end
+    );
+    e$goto(
+        result = io.fprintf(
+            file,
+            "#define KEYMAP_STATIC_MOUSE_KEY_CODE %d\n",
+            self->mouse_key_code
+        ),
+        end
+    );
+    for (u32 i = 0; i < arr$len(maps); i++) {
+        e$goto(result = io.fprintf(file, "static const u16 %s[KEY_CNT] = {\n", maps[i].name), end);
+        for (u32 code = 0; code < KEY_CNT; code++) {
+            if (!maps[i].map[code]) { continue; }
+            const char* from = libevdev_event_code_get_name(EV_KEY, code);
+            const char* to = libevdev_event_code_get_name(EV_KEY, maps[i].map[code]);
+            e$goto(
+                result = io.fprintf(
+                    file,
+                    "    [%d] = %d, // %s -> %s\n",
+                    code,
+                    maps[i].map[code],
+                    from ? from : "?",
+                    to ? to : "?"
+                ),
+                end
+            );
+        }
+        e$goto(result = io.fprintf(file, "};\n"), end);
+    }
+    log$info("Static config of '%s' profile: %s\n", self->control.profile, path);
+
+end:
+    io.fclose(&file);
+    return result;
+}
+
+/// io_uring backend of handle_events(): one io_uring_enter() per wakeup submits pending output
+/// frames and waits, input is read raw (no libevdev queue) on the ring with the same enter
+static Exception
+handle_events_uring(KeyMap_c* self)
+{
+    bool is_dropped = false; // SYN_DROPPED: events up to SYN_REPORT are skipped, then re-sync
+    bool has_sibling_input = false;
+    struct pollfd poll_fds[5 + KEYMAP_INPUT_SIBLINGS_MAX] = {
+        { self->input.fd, POLLIN, 0 },
+        { -1, POLLIN, 0 }, // handoff socket (bridge process)
+        { (self->repeat.timer_fd > 0) ? self->repeat.timer_fd : -1, POLLIN, 0 },
+        { (self->control.listen_fd > 0) ? self->control.listen_fd : -1, POLLIN, 0 },
+        { -1, POLLIN, 0 }, // control client
+    };
+    input_siblings_poll_fds(self, &poll_fds[5]);
+
+    while (true) {
+        e$ret(input_siblings_handle(self, NULL));
+        e$ret(output_flush(self));
+        if (unlikely(self->realtime.enabled && !self->realtime.checked)) {
+            realtime_verify_heap(self);
+        }
+        if (unlikely(self->handoff.fd == 0 && KeyMapHandoff.is_requested())) {
+            // NOTE: the bridge is forked, it must not share the ring, it makes a new one
+            KeyMapUring.destroy(self);
+            self->handoff.requested = true;
+            return EOK;
+        }
+        poll_fds[1].fd = (self->handoff.fd > 0) ? self->handoff.fd : -1;
+        poll_fds[4].fd = (self->control.client_fd > 0) ? self->control.client_fd : -1;
+        int poll_rc = KeyMap_input_wait(
+            self,
+            poll_fds,
+            arr$len(poll_fds),
+            (self->mouse_pressed) ? 10 : -1
+        );
+        if (poll_rc < 0) {
+            if (errno != EINTR) { return e$raise(Error.io, "io_uring: %s", strerror(errno)); }
+            continue; // signal (SIGHUP upgrade request), re-check at the idle point
+        }
+        if (poll_rc == 0) {
+            if (self->mouse_pressed) { e$ret(KeyMap_handle_mouse_move(self)); }
+            continue;
+        }
+        if (poll_fds[2].revents) { e$ret(repeat_fire(self)); }
+        e$ret(input_siblings_read(self, &poll_fds[5], &has_sibling_input));
+
+        if (poll_fds[0].revents) {
+            struct input_event* evbuf = NULL;
+            isize n = KeyMapUring.read(self, &evbuf);
+            if (n < 0) {
+                if (errno == EAGAIN || errno == EINTR) { continue; }
+                return e$raise(Error.io, "Failed to handle events: %s\n", strerror(errno));
+            }
+            for (u32 i = 0; i < n / sizeof(evbuf[0]); i++) {
+                struct input_event* ev = &evbuf[i];
+                if (unlikely(self->input.n_buffered)) { e$ret(input_siblings_handle(self, ev)); }
+                e$ret(
+                    handle_event_raw(self, self->input.fd, self->input.keys_down, &is_dropped, ev)
+                );
+            }
+            // NOTE: full buffer, the rest comes with the next wait (the linked poll is ready)
+            continue; // control commands only when no keystrokes are waiting
+        }
+        if (has_sibling_input) { continue; }
+        if (poll_fds[3].revents || poll_fds[4].revents) {
+            e$ret(KeyMapControl.serve(self));
+            continue;
+        }
+        if (unlikely(poll_fds[1].revents)) { e$ret(KeyMapHandoff.serve(self)); }
+    }
+}
+
 Exception
 KeyMap_handle_events(KeyMap_c* self)
 {
     int rc = 0;
     int poll_rc = 1;
-    struct pollfd poll_input_fd = { self->input.fd, POLLIN, 0 };
+    bool has_sibling_input = false;
+    struct pollfd poll_fds[5 + KEYMAP_INPUT_SIBLINGS_MAX] = {
+        { self->input.fd, POLLIN, 0 },
+        { -1, POLLIN, 0 }, // handoff socket (bridge process)
+        { (self->repeat.timer_fd > 0) ? self->repeat.timer_fd : -1, POLLIN, 0 },
+        { (self->control.listen_fd > 0) ? self->control.listen_fd : -1, POLLIN, 0 },
+        { -1, POLLIN, 0 }, // control client
+    };
+    input_siblings_poll_fds(self, &poll_fds[5]);
+
+    if (self->uring.enabled && self->uring.ring == NULL) {
+        if (KeyMapUring.setup(self)) {
+            log$warn("io_uring is not available, using poll() backend\n");
+            self->uring.enabled = false;
+        } else {
+            // NOTE: raw reads bypass libevdev, key state is tracked from here on
+            usize keys_size = sizeof(self->input.keys_down);
+            e$except_errno (ioctl(self->input.fd, EVIOCGKEY(keys_size), self->input.keys_down)) {
+                return Error.io;
+            }
+        }
+    }
+
+    if (self->realtime.enabled) {
+        // NOTE: heap baseline of the ready loop, setup (takeover, control socket) allocates
+        self->realtime.checked = false;
+        self->realtime.heap_inuse = mallinfo2().uordblks;
+        self->realtime.n_events_ready = self->stats.n_events;
+    }
+#ifdef KEYMAP_ALLOC_TRAP
+    // NOTE: aborts on hit unless cleared by caller (see KeyMapBench.loop())
+    _keymap__alloc_trap.armed = true;
+#endif
+    if (self->uring.ring) { return handle_events_uring(self); }
 
     do {
         struct input_event ev;
@@ -541,11 +1731,48 @@ KeyMap_handle_events(KeyMap_c* self)
         e$except_errno (poll_rc = libevdev_has_event_pending(self->input.dev)) { return Error.io; };
 
         if (poll_rc == 0) {
+            e$ret(input_siblings_handle(self, NULL));
+            e$ret(output_flush(self));
+            if (unlikely(self->realtime.enabled && !self->realtime.checked)) {
+                realtime_verify_heap(self);
+            }
+            if (unlikely(self->handoff.fd == 0 && KeyMapHandoff.is_requested())) {
+                // Upgrade at frame boundary, the caller forks a bridge and exec()s new binary
+                self->handoff.requested = true;
+                return EOK;
+            }
             // No events in current que, blocking wait with timeout for mouse
-            e$except_errno (
-                poll_rc = poll(&poll_input_fd, 1, (self->mouse_pressed) ? 10 : -1 /*timeout*/)
-            ) {
-                return Error.io;
+            poll_fds[1].fd = (self->handoff.fd > 0) ? self->handoff.fd : -1;
+            poll_fds[4].fd = (self->control.client_fd > 0) ? self->control.client_fd : -1;
+            poll_rc = KeyMap_input_wait(
+                self,
+                poll_fds,
+                arr$len(poll_fds),
+                (self->mouse_pressed) ? 10 : -1
+            );
+            if (poll_rc < 0) {
+                if (errno != EINTR) { return e$raise(Error.io, "poll(): %s", strerror(errno)); }
+                rc = -EAGAIN; // signal (SIGHUP upgrade request), re-check at the idle point
+                continue;
+            }
+            e$ret(input_siblings_read(self, &poll_fds[5], &has_sibling_input));
+            if (poll_fds[2].revents || has_sibling_input) {
+                if (poll_fds[2].revents) { e$ret(repeat_fire(self)); }
+                if (!poll_fds[0].revents) {
+                    rc = -EAGAIN;
+                    continue;
+                }
+            }
+            if ((poll_fds[3].revents || poll_fds[4].revents) && !poll_fds[0].revents) {
+                // NOTE: control commands only when no keystrokes are waiting
+                e$ret(KeyMapControl.serve(self));
+                rc = -EAGAIN;
+                continue;
+            }
+            if (unlikely(poll_fds[1].revents && !poll_fds[0].revents)) {
+                e$ret(KeyMapHandoff.serve(self));
+                rc = -EAGAIN;
+                continue;
             }
         }
 
@@ -556,15 +1783,16 @@ KeyMap_handle_events(KeyMap_c* self)
                 &ev
             );
             if (rc == LIBEVDEV_READ_STATUS_SYNC) {
-                printf("::::::::::::::::::::: dropped ::::::::::::::::::::::\n");
-                while (rc == LIBEVDEV_READ_STATUS_SYNC) {
-                    rc = libevdev_next_event(self->input.dev, LIBEVDEV_READ_FLAG_SYNC, &ev);
-                }
-                printf("::::::::::::::::::::: re-synced ::::::::::::::::::::::\n");
+                e$ret(handle_resync(self));
+                rc = -EAGAIN;
             }
 
             // Do magic remapping here
-            if (rc == LIBEVDEV_READ_STATUS_SUCCESS) { e$ret(KeyMap_handle_key(self, &ev)); }
+            if (rc == LIBEVDEV_READ_STATUS_SUCCESS) {
+                if (unlikely(self->input.n_buffered)) { e$ret(input_siblings_handle(self, &ev)); }
+                self->stats.n_events++;
+                e$ret(KeyMap_handle_key(self, &ev));
+            }
             // printf("poll_rc = %d, rc = %d\n", poll_rc, rc);
         }
 
@@ -587,6 +1815,8 @@ KeyMap_handle_events(KeyMap_c* self)
 void
 KeyMap_destroy(KeyMap_c* self)
 {
+    // NOTE: sends queued output frames, before devices are released
+    KeyMapUring.destroy(self);
     if (self->input.dev) {
         libevdev_grab(self->input.dev, LIBEVDEV_UNGRAB);
         libevdev_free(self->input.dev);
@@ -596,12 +1826,23 @@ KeyMap_destroy(KeyMap_c* self)
         close(self->input.fd);
         self->input.fd = -1;
     }
+    for (u32 i = 0; i < self->input.n_siblings; i++) {
+        ioctl(self->input.siblings[i].fd, EVIOCGRAB, 0);
+        close(self->input.siblings[i].fd);
+    }
     if (self->output.fd > 0) {
         ioctl(self->output.fd, UI_DEV_DESTROY);
         close(self->output.fd);
         self->output.fd = -1;
     }
-    if (self->mouse.dev) { libevdev_uinput_destroy(self->mouse.dev); }
+    if (self->repeat.timer_fd > 0) { close(self->repeat.timer_fd); }
+    if (self->mouse.dev) {
+        libevdev_uinput_destroy(self->mouse.dev);
+    } else if (self->mouse.fd > 0) {
+        // NOTE: adopted via handoff, there is no libevdev_uinput wrapper for this fd
+        ioctl(self->mouse.fd, UI_DEV_DESTROY);
+        close(self->mouse.fd);
+    }
     memset(self, 0, sizeof(*self));
 }
 
@@ -615,10 +1856,20 @@ const struct __cex_namespace__KeyMap KeyMap = {
     .handle_events = KeyMap_handle_events,
     .handle_key = KeyMap_handle_key,
     .handle_mouse_move = KeyMap_handle_mouse_move,
+    .input_siblings_attach = KeyMap_input_siblings_attach,
+    .input_wait = KeyMap_input_wait,
     .is_qwerty_keyboard = KeyMap_is_qwerty_keyboard,
+    .keys_release_all = KeyMap_keys_release_all,
+    .mouse_accel_setup = KeyMap_mouse_accel_setup,
     .mouse_click = KeyMap_mouse_click,
+    .mouse_create = KeyMap_mouse_create,
     .mouse_movement = KeyMap_mouse_movement,
     .mouse_wheel = KeyMap_mouse_wheel,
+    .pipeline_setup = KeyMap_pipeline_setup,
+    .profile_apply = KeyMap_profile_apply,
+    .realtime_setup = KeyMap_realtime_setup,
+    .repeat_setup = KeyMap_repeat_setup,
+    .static_config_save = KeyMap_static_config_save,
 
     // clang-format on
 };
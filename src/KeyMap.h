@@ -3,6 +3,100 @@
 #include "libevdev/libevdev.h"
 #include <linux/input-event-codes.h>
 #include <linux/uinput.h>
+#include <poll.h>
+
+#define KEYMAP_RT_PRIORITY_DEFAULT 50
+#define KEYMAP_RT_STACK_PREFAULT (256 * 1024)
+#define KEYMAP_RT_VERIFY_EVENTS 256
+#define KEYMAP_FRAME_MAX 64
+#define KEYMAP_ACCEL_LUT_SIZE 64
+#define KEYMAP_ACCEL_STEP_DEFAULT 10.0f
+#define KEYMAP_ACCEL_MIN_SPEED_DEFAULT 0.1f
+#define KEYMAP_WHEEL_NOTCH 120 // REL_WHEEL_HI_RES units per legacy REL_WHEEL notch
+#define KEYMAP_WHEEL_STEP_DEFAULT 60.0f
+
+#define KEYMAP_REPEAT_DELAY_DEFAULT 250 // ms
+#define KEYMAP_REPEAT_RATE_DEFAULT 30   // Hz
+#define KEYMAP_REPEAT_BURST_MAX 4       // max repeats emitted per wakeup (timer overruns)
+
+#define KEYMAP_INPUT_SIBLINGS_MAX 3 // extra HID interfaces of the keyboard (consumer, system keys)
+
+#define KEYMAP_BUSY_POLL_MAX_US 5000 // busy-poll window limit (below mouse tick)
+#define KEYMAP_BUSY_POLL_RELAX 16    // spin-wait hints between non-blocking fd checks
+
+#if defined(__x86_64__) || defined(__i386__)
+#    define keymap$cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#    define keymap$cpu_relax() __asm__ volatile("yield" ::: "memory")
+#else
+#    define keymap$cpu_relax() __asm__ volatile("" ::: "memory")
+#endif
+
+/// Layer the key was emitted from (per-layer settings)
+typedef enum KeyMapLayer_e
+{
+    KeyMapLayer__direct,
+    KeyMapLayer__mod,
+    KeyMapLayer__mouse,
+    KeyMapLayer__count,
+} KeyMapLayer_e;
+
+/// Event path of KeyMap_handle_key() in pipeline order, the reader stage is libevdev in
+/// KeyMap_handle_events(), stage set is fixed by KeyMap.pipeline_setup() (no per-event dispatch)
+typedef enum KeyMapStage_e
+{
+    KeyMapStage__normalize, // hardware repeat frames drop (in-daemon repeat only)
+    KeyMapStage__layer,     // layer keys state, stuck mod key workaround (if profile has layers)
+    KeyMapStage__action,    // layer map lookup, expanded to output events or mouse actions
+    KeyMapStage__output,    // output frame batching, one write() per input frame
+    KeyMapStage__count,
+} KeyMapStage_e;
+
+// mouse_map pseudo codes for horizontal wheel (vertical: BTN_GEAR_UP / BTN_GEAR_DOWN)
+#define KEYMAP_HWHEEL_LEFT BTN_TRIGGER_HAPPY1
+#define KEYMAP_HWHEEL_RIGHT BTN_TRIGGER_HAPPY2
+
+/// Pointer acceleration curve over `mouse_speedup_ms` (speed fraction 0..1)
+typedef enum KeyMapAccel_e
+{
+    KeyMapAccel__linear,
+    KeyMapAccel__quadratic,
+    KeyMapAccel__exponential,
+    KeyMapAccel__lut, // user supplied points in `accel.user_lut`, linearly resampled
+} KeyMapAccel_e;
+
+#ifdef KEYMAP_ALLOC_TRAP
+/// Debug build allocation trap (see `./cex alloc-check`), armed when event loop is ready
+typedef struct KeyMapAllocTrap_s
+{
+    bool armed;
+    bool abort_on_hit; // abort() on first allocation (get a core dump / debugger stop)
+    u64 n_cex;         // cex allocator calls (mem$, tmem$, arenas)
+    u64 n_libc;        // libc malloc/calloc/realloc/memalign calls (libevdev, stdio, cex heap)
+} KeyMapAllocTrap_s;
+extern KeyMapAllocTrap_s _keymap__alloc_trap;
+void KeyMap__alloc_trap_hit(bool is_cex, usize size);
+#endif
+
+/// Sibling interface of the keyboard (media, power, macro keys on input1, input2, ...), grabbed
+/// with input0 and read raw, its frames are merged into input0 stream by kernel timestamps
+typedef struct KeyMapInputSibling_s
+{
+    int fd;
+    u32 len;                                // buffered events, read at wakeup
+    u32 pos;                                // next buffered event to handle
+    bool is_dropped;                        // SYN_DROPPED: skipping up to SYN_REPORT, then re-sync
+    u8 keys_down[KEY_CNT / 8];              // physical key state of this interface
+    struct input_event buf[KEYMAP_FRAME_MAX];
+} KeyMapInputSibling_s;
+
+/// Named config template (maps, layer keys, mouse settings), switchable at runtime
+typedef struct KeyMapProfile_s
+{
+    char* name;
+    char* device_name; // selected at startup for this keyboard name, NULL - any (fallback)
+    struct KeyMap_c* config;
+} KeyMapProfile_s;
 
 typedef struct KeyMap_c
 {
@@ -10,24 +104,123 @@ typedef struct KeyMap_c
     {
         struct libevdev* dev;
         int fd;
+        u8 keys_down[KEY_CNT / 8]; // physical key state of raw reads (io_uring backend)
+        u32 n_siblings;
+        u32 n_buffered; // sibling events waiting for merge
+        KeyMapInputSibling_s siblings[KEYMAP_INPUT_SIBLINGS_MAX];
     } input;
 
     struct
     {
         int fd;
+        u32 len;
+        struct input_event frame[KEYMAP_FRAME_MAX]; // pending events, sent with one write()
+        u8 keys_down[KEY_CNT / 8];                  // emitted key state of virtual keyboard
     } output;
 
     struct
     {
         struct libevdev_uinput *dev;
+        int fd; // raw uinput fd, events are written directly
         u64 last_press_ts;
         bool up;
         bool down;
         bool left;
         bool right;
+        i8 wheel_v;         // held wheel key: 1 up, -1 down, 0 none
+        i8 wheel_h;         // held wheel key: 1 right, -1 left, 0 none
+        u64 wheel_press_ts; // wheel speed ramp start
+        f32 wheel_rem_v;    // sub-unit hi-res remainders carried between ticks
+        f32 wheel_rem_h;
+        i32 notch_v;        // hi-res units not reported as legacy REL_WHEEL notch yet
+        i32 notch_h;
     } mouse;
 
+    struct
+    {
+        KeyMapAccel_e profile;
+        f32 step;                       // px per tick at full speed, 0 - default
+        f32 wheel_step;                 // hi-res wheel units per tick at full speed, 0 - default
+        f32 min_speed;                  // speed fraction at start, 0 - default
+        f32* user_lut;                  // KeyMapAccel__lut: speed fractions evenly spaced in time
+        u32 user_lut_len;               // number of `user_lut` points (>= 2)
+        f32 lut[KEYMAP_ACCEL_LUT_SIZE]; // speed fraction over time, built at load time
+        f32 rem_x;                      // sub-pixel remainders carried between ticks
+        f32 rem_y;
+    } accel;
+
+    struct
+    {
+        bool enabled;                     // daemon repeats, hardware repeats are dropped
+        u32 delay_ms[KeyMapLayer__count]; // 0 - direct layer value or default
+        u32 rate_hz[KeyMapLayer__count];  // 0 - direct layer value or default
+        int timer_fd;                     // timerfd, armed while repeated key is held
+        u16 code;                         // emitted key code being repeated, 0 - none
+        u16 phys_code;                    // physical key holding the repeat
+        KeyMapLayer_e layer;              // layer of repeated key (delay / rate)
+        bool pending;                     // code changed, timer is updated before next wait
+        bool drop_syn;                    // drop SYN_REPORT of hardware repeat frame
+    } repeat;
+
+    struct
+    {
+        bool enabled;       // SCHED_FIFO + mlockall() + prefaulted stack (requires root)
+        bool pin_cpu;       // pin event loop to `cpu`
+        bool checked;       // heap was checked after KEYMAP_RT_VERIFY_EVENTS
+        bool verified;      // no heap growth detected by the check
+        u32 cpu;            // cpu index for pinning
+        i32 priority;       // SCHED_FIFO priority (1-99), 0 - KEYMAP_RT_PRIORITY_DEFAULT
+        usize heap_inuse;   // malloc in-use bytes snapshot when loop reported ready
+        isize heap_growth;  // malloc in-use bytes change in event loop (allocations after ready)
+        u64 n_events_ready; // stats.n_events at the snapshot (takeover keeps the old count)
+    } realtime;
+
+    struct
+    {
+        bool requested; // SIGHUP received, handle_events() returned for upgrade
+        int fd;         // bridge process: socket to the new binary (see KeyMapHandoff)
+    } handoff;
+
+    struct
+    {
+        char* socket_path;         // control socket (see KeyMapControl), NULL - disabled
+        int listen_fd;
+        int client_fd;             // single pending client slot, replaced by a newer one
+        KeyMapProfile_s* profiles; // profiles available for `profile` command
+        u32 n_profiles;
+        char* profile;             // current profile name
+    } control;
+
+    struct
+    {
+        u32 window_us;     // spin on input after each input wakeup before blocking wait, 0 - off
+        u64 last_input_ns; // CLOCK_MONOTONIC of the last input wakeup
+        u64 n_wakeups;     // input wakeups
+        u64 n_spin_hits;   // input wakeups caught by spinning
+    } busy_poll;
+
+    struct
+    {
+        bool enabled;               // io_uring event loop backend requested (see KeyMapUring)
+        struct KeyMapUring_s* ring; // NULL - poll() backend
+    } uring;
+
+    struct
+    {
+        u32 enabled;                    // (1 << KeyMapStage_e) mask, see pipeline_setup()
+        bool profile;                   // per-stage cycle counters (see --bench-replay)
+        u64 cycles[KeyMapStage__count]; // TSC cycles (x86) or ns spent in stage
+        u64 n_calls[KeyMapStage__count];
+    } pipeline;
+
+    struct
+    {
+        u64 n_events;
+        u64 n_syn_dropped; // evdev buffer overflows (SYN_DROPPED)
+    } stats;
+
     bool debug;
+    bool unified_device; // one uinput node for keyboard and pointer (EV_KEY + BTN_* + EV_REL)
     bool mod_pressed;
     bool mouse_pressed;
     f32 mouse_sensitivity;
@@ -38,6 +231,7 @@ typedef struct KeyMap_c
     u16 direct_map[KEY_CNT];
     u16 mod_map[KEY_CNT];
     u16 mouse_map[KEY_CNT];
+    u16 pressed_map[KEY_CNT]; // physical key -> emitted key code, while held
 } KeyMap_c;
 
 struct __cex_namespace__KeyMap {
@@ -50,10 +244,20 @@ struct __cex_namespace__KeyMap {
     Exception       (*handle_events)(KeyMap_c* self);
     Exception       (*handle_key)(KeyMap_c* self, struct input_event* ev);
     Exception       (*handle_mouse_move)(KeyMap_c* self);
+    Exception       (*input_siblings_attach)(KeyMap_c* self);
+    int             (*input_wait)(KeyMap_c* self, struct pollfd* fds, u32 n_fds, int timeout_ms);
     bool            (*is_qwerty_keyboard)(struct libevdev* dev);
+    Exception       (*keys_release_all)(KeyMap_c* self);
+    Exception       (*mouse_accel_setup)(KeyMap_c* self);
     Exception       (*mouse_click)(KeyMap_c* self, int button, int pressed);
+    Exception       (*mouse_create)(KeyMap_c* self);
     Exception       (*mouse_movement)(KeyMap_c* self, int rel_x, int rel_y);
-    Exception       (*mouse_wheel)(KeyMap_c* self, int vertical);
+    Exception       (*mouse_wheel)(KeyMap_c* self, int vertical, int horizontal);
+    void            (*pipeline_setup)(KeyMap_c* self);
+    Exception       (*profile_apply)(KeyMap_c* self, KeyMapProfile_s* profile);
+    Exception       (*realtime_setup)(KeyMap_c* self);
+    Exception       (*repeat_setup)(KeyMap_c* self);
+    Exception       (*static_config_save)(KeyMap_c* self, char* path);
 
     // clang-format on
 };
@@ -0,0 +1,658 @@
+#include "KeyMapBench.h"
+#include "KeyMap.h"
+#include "KeyMapControl.h"
+#include "KeyMapHandoff.h"
+#include "KeyMapUring.h"
+#include "cex.h"
+#include <fcntl.h>
+#include <linux/input-event-codes.h>
+#include <linux/input.h>
+#include <linux/uinput.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static u64
+bench_now_ns(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) {
+        unreachable();
+        return 0;
+    }
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+static const char*
+bench_stage_unit(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return "TSC cycles";
+#else
+    return "ns";
+#endif
+}
+
+static int
+bench_cmp_u32(const void* a, const void* b)
+{
+    u32 va = *(const u32*)a;
+    u32 vb = *(const u32*)b;
+    return (va > vb) - (va < vb);
+}
+
+static f64
+bench_rusage_sec(void)
+{
+    struct rusage ru = { 0 };
+    if (getrusage(RUSAGE_SELF, &ru) == -1) { return 0; }
+    return (f64)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+           (f64)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+static void __attribute__((noreturn))
+bench_cpu_hog(void)
+{
+    while (true) { __asm__ volatile("" ::: "memory"); }
+}
+
+/// Canned trace: typing + layer usage pattern, with layer key held over 2 mapped keys, each step
+/// is a frame of MSC_SCAN + EV_KEY + SYN_REPORT (event time is left for the caller)
+static void
+bench_trace_frame(u32 step, u16 layer_key, struct input_event frame[3])
+{
+    const struct
+    {
+        u16 code;
+        i32 value;
+    } steps[] = {
+        { KEY_H, 1 },     { KEY_H, 0 }, { KEY_E, 1 },     { KEY_E, 0 },
+        { KEY_L, 1 },     { KEY_L, 0 }, { layer_key, 1 }, { KEY_I, 1 },
+        { KEY_I, 0 },     { KEY_K, 1 }, { KEY_K, 0 },     { layer_key, 0 },
+    };
+    auto s = steps[step % arr$len(steps)];
+    frame[0] = (struct input_event){ .type = EV_MSC, .code = MSC_SCAN, .value = s.code };
+    frame[1] = (struct input_event){ .type = EV_KEY, .code = s.code, .value = s.value };
+    frame[2] = (struct input_event){ .type = EV_SYN, .code = SYN_REPORT, .value = 0 };
+}
+
+/// Child process: emits canned trace frames into pipe on a fixed schedule, event time is
+/// CLOCK_MONOTONIC at write, the same way kernel stamps evdev events.
+static void __attribute__((noreturn))
+bench_producer(int fd, u16 layer_key, u32 n_frames)
+{
+    u64 next_ns = bench_now_ns();
+    for (u32 i = 0; i < n_frames; i++) {
+        next_ns += KEYMAP_BENCH_INTERVAL_US * 1000ULL;
+        struct timespec ts = { .tv_sec = next_ns / 1000000000ULL,
+                               .tv_nsec = next_ns % 1000000000ULL };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+
+        struct input_event frame[3];
+        bench_trace_frame(i, layer_key, frame);
+        u64 now_ns = bench_now_ns();
+        for (u32 j = 0; j < arr$len(frame); j++) {
+            frame[j].input_event_sec = now_ns / 1000000000ULL;
+            frame[j].input_event_usec = (now_ns % 1000000000ULL) / 1000;
+        }
+        if (write(fd, frame, sizeof(frame)) != sizeof(frame)) { _exit(1); }
+    }
+    close(fd);
+    _exit(0);
+}
+
+/// Output devices of in-memory benchmarks are /dev/null, the profile is kept as is (mouse layer
+/// included), so the stages match the static config build of the same profile
+static Exception
+bench_devices_setup(KeyMap_c* keymap)
+{
+    e$except_errno (keymap->output.fd = open("/dev/null", O_WRONLY | O_CLOEXEC)) {
+        return Error.io;
+    }
+    if (keymap->mouse_key_code && !keymap->unified_device) {
+        e$except_errno (keymap->mouse.fd = open("/dev/null", O_WRONLY | O_CLOEXEC)) {
+            return Error.io;
+        }
+    }
+    if (keymap->mouse_key_code) { e$ret(KeyMap.mouse_accel_setup(keymap)); }
+    e$ret(KeyMap.repeat_setup(keymap));
+    KeyMap.pipeline_setup(keymap);
+    return EOK;
+}
+
+Exception
+KeyMapBench_latency(KeyMap_c* keymap, u32 n_frames, u32 n_stress)
+{
+    uassert(keymap->output.fd == 0 && "expected non-initialized keymap");
+    e$assert(n_frames > 0);
+    e$assert(n_stress <= KEYMAP_BENCH_STRESS_MAX);
+
+    Exc result = Error.runtime;
+    int pipe_fds[2] = { -1, -1 };
+    pid_t producer = 0;
+    pid_t hogs[KEYMAP_BENCH_STRESS_MAX] = { 0 };
+    u32* latencies = mem$calloc(mem$, n_frames, sizeof(u32));
+    e$assert(latencies != NULL);
+
+    e$goto(bench_devices_setup(keymap), end);
+    e$except_errno (pipe(pipe_fds)) { goto end; }
+    e$except_errno (fcntl(pipe_fds[0], F_SETFL, O_NONBLOCK)) { goto end; }
+
+    for (u32 i = 0; i < n_stress; i++) {
+        e$except_errno (hogs[i] = fork()) { goto end; }
+        if (hogs[i] == 0) { bench_cpu_hog(); }
+    }
+
+    e$except_errno (producer = fork()) { goto end; }
+    if (producer == 0) {
+        close(pipe_fds[0]);
+        bench_producer(
+            pipe_fds[1],
+            keymap->mod_key_code ? keymap->mod_key_code : KEY_LEFTSHIFT,
+            n_frames
+        );
+    }
+    close(pipe_fds[1]);
+    pipe_fds[1] = -1;
+
+    // NOTE: children are forked before, so only consumer loop gets realtime profile
+    if (keymap->realtime.enabled) { e$goto(KeyMap.realtime_setup(keymap), end); }
+    if (keymap->uring.enabled && KeyMapUring.setup(keymap)) {
+        log$warn("io_uring is not available, using poll() backend\n");
+        keymap->uring.enabled = false;
+    }
+
+    f64 cpu_start = bench_rusage_sec();
+    u64 wall_start = bench_now_ns();
+    u32 n_done = 0;
+    u64 n_waits = 0;
+    u64 n_reads = 0;
+    bool is_drained = true;
+    struct pollfd poll_input_fd = { pipe_fds[0], POLLIN, 0 };
+    struct input_event evbuf[KEYMAP_FRAME_MAX]; // same size as io_uring input buffer
+
+    while (n_done < n_frames) {
+        if (is_drained) {
+            n_waits++;
+            if (KeyMap.input_wait(keymap, &poll_input_fd, 1, -1) < 0 && errno != EINTR) {
+                log$error("wait failed: %s\n", strerror(errno));
+                goto end;
+            }
+        }
+        struct input_event* events = evbuf;
+        isize rc = 0;
+        if (keymap->uring.ring) {
+            // NOTE: io_uring reads the pipe on the ring with the wait enter (same as evdev)
+            rc = KeyMapUring.read(keymap, &events);
+        } else {
+            rc = read(pipe_fds[0], evbuf, sizeof(evbuf));
+            n_reads++;
+        }
+        if (rc == 0) { break; }
+        if (rc < 0) {
+            is_drained = true;
+            if (errno == EAGAIN || errno == EINTR) { continue; }
+            log$error("read failed: %s\n", strerror(errno));
+            goto end;
+        }
+        is_drained = keymap->uring.ring || rc < (isize)sizeof(evbuf);
+
+        u32 n_syn = 0;
+        u64 syn_ns[arr$len(evbuf)];
+        for (u32 i = 0; i < rc / sizeof(evbuf[0]); i++) {
+            struct input_event* ev = &events[i];
+            if (ev->type == EV_SYN) {
+                syn_ns[n_syn++] = (u64)ev->input_event_sec * 1000000000ULL +
+                                  (u64)ev->input_event_usec * 1000ULL;
+            }
+            keymap->stats.n_events++;
+            e$goto(KeyMap.handle_key(keymap, ev), end);
+        }
+        // NOTE: io_uring writes are queued here, they go out with the very next wait enter
+        u64 now_ns = bench_now_ns();
+        for (u32 i = 0; i < n_syn && n_done < n_frames; i++) {
+            u64 lat = now_ns - syn_ns[i];
+            latencies[n_done++] = lat > UINT32_MAX ? UINT32_MAX : (u32)lat;
+        }
+    }
+    f64 wall_sec = (f64)(bench_now_ns() - wall_start) / 1e9;
+    f64 cpu_sec = bench_rusage_sec() - cpu_start;
+
+    e$assert(n_done > 0);
+    qsort(latencies, n_done, sizeof(latencies[0]), bench_cmp_u32);
+#define _bench_pct(p) ((f64)latencies[(usize)((n_done - 1) * (p))] / 1000.0)
+
+    io.printf(
+        "Latency benchmark: frames: %d, interval: %dus, stress: %d, realtime: %s, backend: %s, "
+        "busy-poll: %dus\n",
+        n_done,
+        KEYMAP_BENCH_INTERVAL_US,
+        n_stress,
+        keymap->realtime.enabled ? "yes" : "no",
+        keymap->uring.ring ? "io_uring" : "poll",
+        keymap->busy_poll.window_us
+    );
+    printf(
+        "    p50: %0.1fus p90: %0.1fus p99: %0.1fus p99.9: %0.1fus max: %0.1fus\n",
+        _bench_pct(0.5),
+        _bench_pct(0.9),
+        _bench_pct(0.99),
+        _bench_pct(0.999),
+        _bench_pct(1.0)
+    );
+    printf(
+        "    cpu: %0.3fs / wall: %0.3fs (%0.1f%%)\n",
+        cpu_sec,
+        wall_sec,
+        cpu_sec / wall_sec * 100
+    );
+    // poll: poll() + read() + write() per frame, io_uring: io_uring_enter() (writes, read, wait)
+    u64 n_other = keymap->uring.ring ? keymap->uring.ring->n_enter : n_waits + n_done;
+    printf("    syscalls: %0.2f/frame\n", (f64)(n_reads + n_other) / n_done);
+    if (keymap->busy_poll.window_us) {
+        // NOTE: trace interval is fixed, window must be above it to catch the next frame
+        printf(
+            "    busy-poll: %lu of %lu input wakeups by spinning (%0.1f%%)\n",
+            keymap->busy_poll.n_spin_hits,
+            keymap->busy_poll.n_wakeups,
+            keymap->busy_poll.n_wakeups
+                ? (f64)keymap->busy_poll.n_spin_hits / keymap->busy_poll.n_wakeups * 100
+                : 0.0
+        );
+    }
+#undef _bench_pct
+
+    result = EOK;
+
+end:
+    for (u32 i = 0; i < n_stress; i++) {
+        if (hogs[i] > 0) {
+            kill(hogs[i], SIGKILL);
+            waitpid(hogs[i], NULL, 0);
+        }
+    }
+    if (producer > 0) {
+        kill(producer, SIGKILL);
+        waitpid(producer, NULL, 0);
+    }
+    if (pipe_fds[0] >= 0) { close(pipe_fds[0]); }
+    if (pipe_fds[1] >= 0) { close(pipe_fds[1]); }
+    mem$free(mem$, latencies);
+    return result;
+}
+
+/// Virtual source device for loop benchmark: `phys` ending with /input0 makes it a qwerty input
+/// keyboard, other interfaces of the same phys are its siblings (consumer keys only)
+static Exception
+bench_source_create(char* phys, bool is_qwerty, int* out_fd, char* devnode, usize devnode_size)
+{
+    int fd = -1;
+    e$except_errno (fd = open("/dev/uinput", O_WRONLY | O_CLOEXEC)) {
+        return e$raise(Error.os, "/dev/uinput: %s (requires root)", strerror(errno));
+    }
+    Exc result = Error.io;
+    e$except_errno (ioctl(fd, UI_SET_EVBIT, EV_KEY)) { goto end; }
+    e$except_errno (ioctl(fd, UI_SET_EVBIT, EV_SYN)) { goto end; }
+    e$except_errno (ioctl(fd, UI_SET_EVBIT, EV_MSC)) { goto end; }
+    e$except_errno (ioctl(fd, UI_SET_MSCBIT, MSC_SCAN)) { goto end; }
+    if (is_qwerty) {
+        // NOTE: keyboard keys only, BTN_* would make it a pointer interface
+        for (int key = 1; key < BTN_MISC; key++) {
+            e$except_errno (ioctl(fd, UI_SET_KEYBIT, key)) { goto end; }
+        }
+    } else {
+        e$except_errno (ioctl(fd, UI_SET_KEYBIT, KEY_VOLUMEUP)) { goto end; }
+        e$except_errno (ioctl(fd, UI_SET_KEYBIT, KEY_VOLUMEDOWN)) { goto end; }
+        e$except_errno (ioctl(fd, UI_SET_KEYBIT, KEY_MUTE)) { goto end; }
+    }
+    e$except_errno (ioctl(fd, UI_SET_PHYS, phys)) { goto end; }
+
+    struct uinput_setup usetup = { 0 };
+    usetup.id.bustype = BUS_VIRTUAL;
+    usetup.id.vendor = 0x1234;
+    usetup.id.product = 0x0003;
+    e$goto(
+        result = str.copy(usetup.name, "UberKeyboardMappperBenchSource", sizeof(usetup.name)),
+        end
+    );
+    result = Error.io;
+    e$except_errno (ioctl(fd, UI_DEV_SETUP, &usetup)) { goto end; }
+    e$except_errno (ioctl(fd, UI_DEV_CREATE)) { goto end; }
+
+    char sysname[64] = { 0 };
+    e$except_errno (ioctl(fd, UI_GET_SYSNAME(sizeof(sysname)), sysname)) { goto end; }
+    result = Error.not_found;
+    // NOTE: devtmpfs node may show up with a delay after UI_DEV_CREATE
+    for (u32 attempt = 0; attempt < 100 && result; attempt++) {
+        mem$scope(tmem$, _)
+        {
+            for$each (it, os.fs.find(str.fmt(_, "/sys/class/input/%s/event*", sysname), false, _)) {
+                char* name = strrchr(it, '/') + 1;
+                e$goto(result = str.sprintf(devnode, devnode_size, "/dev/input/%s", name), end);
+                if (access(devnode, R_OK) != 0) { result = Error.not_found; }
+            }
+        }
+        if (result) { usleep(10000); }
+    }
+    if (result) {
+        result = e$raise(Error.not_found, "No event node of bench source device: %s", sysname);
+        goto end;
+    }
+    *out_fd = fd;
+    return EOK;
+
+end:
+    ioctl(fd, UI_DEV_DESTROY);
+    close(fd);
+    return result;
+}
+
+static void
+bench_source_write(int fd, struct input_event* events, u32 n_events)
+{
+    // NOTE: uinput ignores event time, kernel stamps the events
+    if (write(fd, events, sizeof(*events) * n_events) != (isize)(sizeof(*events) * n_events)) {
+        _exit(1);
+    }
+}
+
+static void
+bench_source_key(int fd, u16 code, i32 value)
+{
+    struct input_event frame[] = {
+        { .type = EV_MSC, .code = MSC_SCAN, .value = code },
+        { .type = EV_KEY, .code = code, .value = value },
+        { .type = EV_SYN, .code = SYN_REPORT, .value = 0 },
+    };
+    bench_source_write(fd, frame, arr$len(frame));
+}
+
+/// Sends one control command, the reply is read and dropped
+static void
+bench_control_send(char* socket_path, char* command)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (str.copy(addr.sun_path, socket_path, sizeof(addr.sun_path))) { return; }
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) { return; }
+    struct timeval timeout = { .tv_sec = 2 };
+    char reply[KEYMAP_CONTROL_REPLY_MAX];
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0 &&
+        connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+        send(fd, command, strlen(command), MSG_NOSIGNAL) > 0) {
+        if (recv(fd, reply, sizeof(reply), 0)) {}
+    }
+    close(fd);
+}
+
+/// Child process: types canned trace into source devices, with everything else the daemon does
+/// at runtime mixed in: sibling interface keys, mouse layer (timeout ticks), control commands
+/// and evdev buffer overflow (SYN_DROPPED, the consumer is stopped while the burst is written).
+/// Stops the consumer loop by SIGHUP at the end (upgrade request, returns at the idle point).
+static void __attribute__((noreturn))
+bench_loop_producer(
+    pid_t consumer,
+    int kbd_fd,
+    int sibling_fd,
+    char* socket_path,
+    u16 layer_key,
+    u16 mouse_key,
+    u32 n_frames
+)
+{
+    char* commands[] = { "dump", "sensitivity 1.5", "trace off", "profile", "help" };
+    u32 n_commands = 0;
+
+    for (u32 i = 0; i < n_frames; i++) {
+        struct input_event frame[3];
+        bench_trace_frame(i, layer_key, frame);
+        bench_source_write(kbd_fd, frame, arr$len(frame));
+        usleep(KEYMAP_BENCH_INTERVAL_US / 10);
+
+        if (i % 256 == 128 && sibling_fd >= 0) {
+            bench_source_key(sibling_fd, KEY_VOLUMEUP, 1);
+            bench_source_key(sibling_fd, KEY_VOLUMEUP, 0);
+        }
+        if (i % 1200 == 599 && mouse_key) {
+            // NOTE: the last step of trace cycle (12 frames) releases the layer key
+            bench_source_key(kbd_fd, mouse_key, 1);
+            bench_source_key(kbd_fd, KEY_J, 1);
+            usleep(30000); // mouse move ticks by loop wait timeout
+            bench_source_key(kbd_fd, KEY_J, 0);
+            bench_source_key(kbd_fd, KEY_Y, 1);
+            bench_source_key(kbd_fd, KEY_Y, 0);
+            bench_source_key(kbd_fd, mouse_key, 0);
+        }
+        if (i % 1024 == 512 && socket_path) {
+            bench_control_send(socket_path, commands[n_commands++ % arr$len(commands)]);
+        }
+        if (i % 4096 == 2048) {
+            kill(consumer, SIGSTOP);
+            usleep(10000);
+            for (u32 j = 0; j < 1024; j++) {
+                bench_source_key(kbd_fd, KEY_E, 1);
+                bench_source_key(kbd_fd, KEY_E, 0);
+            }
+            kill(consumer, SIGCONT);
+        }
+    }
+    usleep(100000);
+    kill(consumer, SIGHUP);
+    _exit(0);
+}
+
+Exception
+KeyMapBench_loop(KeyMap_c* keymap, u32 n_frames)
+{
+    uassert(keymap->output.fd == 0 && "expected non-initialized keymap");
+    e$assert(n_frames > 0);
+
+    Exc result = Error.runtime;
+    int kbd_fd = -1;
+    int sibling_fd = -1;
+    pid_t producer = 0;
+    char kbd_node[64] = { 0 };
+    char sibling_node[64] = { 0 };
+    char socket_path[64] = { 0 };
+
+    e$ret(bench_source_create("uberkb-bench/input0", true, &kbd_fd, kbd_node, sizeof(kbd_node)));
+    e$goto(
+        result = bench_source_create(
+            "uberkb-bench/input1",
+            false,
+            &sibling_fd,
+            sibling_node,
+            sizeof(sibling_node)
+        ),
+        end
+    );
+    result = Error.runtime;
+
+    // NOTE: the same input path as KeyMap.create()
+    e$except_errno (keymap->input.fd = open(kbd_node, O_RDONLY | O_NONBLOCK | O_CLOEXEC)) {
+        goto end;
+    }
+    e$except_errno (libevdev_new_from_fd(keymap->input.fd, &keymap->input.dev)) { goto end; }
+    e$except_errno (libevdev_grab(keymap->input.dev, LIBEVDEV_GRAB)) { goto end; }
+    e$goto(KeyMap.input_siblings_attach(keymap), end);
+    e$goto(bench_devices_setup(keymap), end);
+
+    e$goto(
+        str.sprintf(socket_path, sizeof(socket_path), "/tmp/uberkb-bench-%d.sock", getpid()),
+        end
+    );
+    keymap->control.socket_path = socket_path;
+    e$goto(KeyMapControl.setup(keymap), end);
+    e$goto(KeyMapHandoff.setup(0, NULL), end);
+
+    e$except_errno (producer = fork()) { goto end; }
+    if (producer == 0) {
+        bench_loop_producer(
+            getppid(),
+            kbd_fd,
+            sibling_fd,
+            socket_path,
+            keymap->mod_key_code ? keymap->mod_key_code : KEY_LEFTSHIFT,
+            keymap->mouse_key_code,
+            n_frames
+        );
+    }
+    if (keymap->realtime.enabled) { e$goto(KeyMap.realtime_setup(keymap), end); }
+
+#ifdef KEYMAP_ALLOC_TRAP
+    // NOTE: the loop arms the trap when it's ready, count allocations instead of abort()
+    _keymap__alloc_trap = (KeyMapAllocTrap_s){ .abort_on_hit = false };
+#endif
+    u64 t_start = bench_now_ns();
+    e$goto(KeyMap.handle_events(keymap), end);
+    u64 t_elapsed = bench_now_ns() - t_start;
+#ifdef KEYMAP_ALLOC_TRAP
+    _keymap__alloc_trap.armed = false;
+#endif
+    e$assert(keymap->handoff.requested && "expected stop by producer SIGHUP");
+    keymap->handoff.requested = false;
+
+    io.printf(
+        "Loop benchmark: frames: %d, backend: %s, repeat: %s, interfaces: %u\n",
+        n_frames,
+        keymap->uring.enabled ? "io_uring" : "poll",
+        keymap->repeat.enabled ? "yes" : "no",
+        1 + keymap->input.n_siblings
+    );
+    printf(
+        "    events: %lu, syn_dropped: %lu, wall: %0.3fs\n",
+        keymap->stats.n_events,
+        keymap->stats.n_syn_dropped,
+        (f64)t_elapsed / 1e9
+    );
+#ifdef KEYMAP_ALLOC_TRAP
+    io.printf(
+        "    allocations in loop: cex: %ld libc: %ld\n",
+        _keymap__alloc_trap.n_cex,
+        _keymap__alloc_trap.n_libc
+    );
+    if (_keymap__alloc_trap.n_cex || _keymap__alloc_trap.n_libc) {
+        result = e$raise(Error.integrity, "Event loop is expected to be allocation free");
+        goto end;
+    }
+#endif
+    result = EOK;
+
+end:
+    if (producer > 0) {
+        kill(producer, SIGKILL);
+        waitpid(producer, NULL, 0);
+    }
+    KeyMapControl.destroy(keymap);
+    keymap->control.socket_path = NULL;
+    if (sibling_fd >= 0) {
+        ioctl(sibling_fd, UI_DEV_DESTROY);
+        close(sibling_fd);
+    }
+    if (kbd_fd >= 0) {
+        ioctl(kbd_fd, UI_DEV_DESTROY);
+        close(kbd_fd);
+    }
+    return result;
+}
+
+Exception
+KeyMapBench_replay(KeyMap_c* keymap, u32 n_frames)
+{
+    uassert(keymap->output.fd == 0 && "expected non-initialized keymap");
+    e$assert(n_frames > 0);
+
+    Exc result = Error.runtime;
+    u16 layer_key = keymap->mod_key_code ? keymap->mod_key_code : KEY_LEFTSHIFT;
+    usize n_events = (usize)n_frames * 3;
+    struct input_event* trace = mem$calloc(mem$, n_events, sizeof(struct input_event));
+    e$assert(trace != NULL);
+    for (u32 i = 0; i < n_frames; i++) { bench_trace_frame(i, layer_key, &trace[i * 3]); }
+
+    e$goto(bench_devices_setup(keymap), end);
+
+#ifdef KEYMAP_ALLOC_TRAP
+    _keymap__alloc_trap = (KeyMapAllocTrap_s){ .armed = true };
+#endif
+    u64 t_start = bench_now_ns();
+    for (usize i = 0; i < n_events; i++) {
+        // NOTE: handle_key() rewrites events in place, trace must stay intact
+        struct input_event ev = trace[i];
+        keymap->stats.n_events++;
+        e$goto(KeyMap.handle_key(keymap, &ev), end);
+    }
+    u64 t_elapsed = bench_now_ns() - t_start;
+#ifdef KEYMAP_ALLOC_TRAP
+    _keymap__alloc_trap.armed = false;
+#endif
+
+    io.printf("Replay benchmark: frames: %d, events: %zu\n", n_frames, n_events);
+    printf(
+        "    %0.1f ns/event, %0.0f events/s\n",
+        (f64)t_elapsed / n_events,
+        (f64)n_events / ((f64)t_elapsed / 1e9)
+    );
+#ifdef KEYMAP_ALLOC_TRAP
+    io.printf(
+        "    allocations in loop: cex: %ld libc: %ld\n",
+        _keymap__alloc_trap.n_cex,
+        _keymap__alloc_trap.n_libc
+    );
+    if (_keymap__alloc_trap.n_cex || _keymap__alloc_trap.n_libc) {
+        result = e$raise(Error.integrity, "Event loop is expected to be allocation free");
+        goto end;
+    }
+#endif
+
+    // Second pass with per-stage counters, the first one is free of counter overhead
+    keymap->pipeline.profile = true;
+    memset(keymap->pipeline.cycles, 0, sizeof(keymap->pipeline.cycles));
+    memset(keymap->pipeline.n_calls, 0, sizeof(keymap->pipeline.n_calls));
+    for (usize i = 0; i < n_events; i++) {
+        struct input_event ev = trace[i];
+        e$goto(KeyMap.handle_key(keymap, &ev), end);
+    }
+    keymap->pipeline.profile = false;
+
+    const char* stage_names[KeyMapStage__count] = {
+        [KeyMapStage__normalize] = "normalize",
+        [KeyMapStage__layer] = "layer",
+        [KeyMapStage__action] = "action",
+        [KeyMapStage__output] = "output",
+    };
+    io.printf("    stages (%s per event):\n", bench_stage_unit());
+    for (u32 i = 0; i < KeyMapStage__count; i++) {
+        if (!(keymap->pipeline.enabled & (1 << i))) {
+            io.printf("        %-10s disabled\n", stage_names[i]);
+            continue;
+        }
+        printf(
+            "        %-10s %8.1f (%lu calls)\n",
+            stage_names[i],
+            (f64)keymap->pipeline.cycles[i] / n_events,
+            keymap->pipeline.n_calls[i]
+        );
+    }
+
+    result = EOK;
+
+end:
+    mem$free(mem$, trace);
+    return result;
+}
+
+const struct __cex_namespace__KeyMapBench KeyMapBench = {
+    // Autogenerated by CEX
+    // clang-format off
+
+    .latency = KeyMapBench_latency,
+    .loop = KeyMapBench_loop,
+    .replay = KeyMapBench_replay,
+
+    // clang-format on
+};
@@ -0,0 +1,18 @@
+#pragma once
+#include "KeyMap.h"
+#include "cex.h"
+
+#define KEYMAP_BENCH_STRESS_MAX 256
+#define KEYMAP_BENCH_INTERVAL_US 1000
+
+struct __cex_namespace__KeyMapBench {
+    // Autogenerated by CEX
+    // clang-format off
+
+    Exception       (*latency)(KeyMap_c* keymap, u32 n_frames, u32 n_stress);
+    Exception       (*loop)(KeyMap_c* keymap, u32 n_frames);
+    Exception       (*replay)(KeyMap_c* keymap, u32 n_frames);
+
+    // clang-format on
+};
+CEX_NAMESPACE struct __cex_namespace__KeyMapBench KeyMapBench;
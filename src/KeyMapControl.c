@@ -0,0 +1,266 @@
+#include "KeyMapControl.h"
+#include "KeyMap.h"
+#include "cex.h"
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+typedef struct ControlReply_s
+{
+    u32 len;
+    char buf[KEYMAP_CONTROL_REPLY_MAX];
+} ControlReply_s;
+
+static void __attribute__((format(printf, 2, 3)))
+control_printf(ControlReply_s* reply, char* format, ...)
+{
+    if (reply->len >= sizeof(reply->buf) - 1) { return; }
+
+    va_list va;
+    va_start(va, format);
+    int n = vsnprintf(reply->buf + reply->len, sizeof(reply->buf) - reply->len, format, va);
+    va_end(va);
+
+    // NOTE: vsnprintf() returns untruncated length
+    if (n > 0) { reply->len += (u32)n; }
+    if (reply->len > sizeof(reply->buf) - 1) { reply->len = sizeof(reply->buf) - 1; }
+}
+
+static void
+control_dump(KeyMap_c* self, ControlReply_s* reply)
+{
+    control_printf(reply, "profile: %s\n", self->control.profile ? self->control.profile : "");
+    control_printf(reply, "layers: mod=%d mouse=%d\n", self->mod_pressed, self->mouse_pressed);
+    control_printf(reply, "keys down:");
+    for (u32 code = 0; code < KEY_CNT; code++) {
+        if (self->output.keys_down[code / 8] & (1 << (code % 8))) {
+            const char* name = libevdev_event_code_get_name(EV_KEY, code);
+            control_printf(reply, " %s", name ? name : "?");
+        }
+    }
+    control_printf(reply, "\n");
+    control_printf(
+        reply,
+        "mouse: sensitivity=%0.2f speedup_ms=%lu accel=%d unified=%d\n",
+        self->mouse_sensitivity,
+        self->mouse_speedup_ms,
+        self->accel.profile,
+        self->unified_device
+    );
+    control_printf(
+        reply,
+        "repeat: enabled=%d delay_ms=%u rate_hz=%u\n",
+        self->repeat.enabled,
+        self->repeat.delay_ms[KeyMapLayer__direct],
+        self->repeat.rate_hz[KeyMapLayer__direct]
+    );
+    control_printf(
+        reply,
+        "realtime: enabled=%d checked=%d verified=%d heap_growth=%ld\n",
+        self->realtime.enabled,
+        self->realtime.checked,
+        self->realtime.verified,
+        self->realtime.heap_growth
+    );
+    control_printf(reply, "input: interfaces=%u\n", 1 + self->input.n_siblings);
+    control_printf(reply, "trace: %d\n", self->debug);
+    control_printf(
+        reply,
+        "stats: events=%lu syn_dropped=%lu\n",
+        self->stats.n_events,
+        self->stats.n_syn_dropped
+    );
+}
+
+/// Executes text command, errors are reported to the client as `error: <text>` reply
+static Exception
+control_execute(KeyMap_c* self, char* cmd, ControlReply_s* reply)
+{
+    char* arg = strchr(cmd, ' ');
+    if (arg) {
+        *arg++ = '\0';
+        while (*arg == ' ') { arg++; }
+        if (*arg == '\0') { arg = NULL; }
+    }
+
+    if (str.eq(cmd, "profile")) {
+        if (arg == NULL) {
+            control_printf(reply, "current: %s\navailable:", self->control.profile);
+            for (u32 i = 0; i < self->control.n_profiles; i++) {
+                control_printf(reply, " %s", self->control.profiles[i].name);
+            }
+            control_printf(reply, "\n");
+            return EOK;
+        }
+        for (u32 i = 0; i < self->control.n_profiles; i++) {
+            if (str.eq(arg, self->control.profiles[i].name)) {
+                e$ret(KeyMap.profile_apply(self, &self->control.profiles[i]));
+                control_printf(reply, "profile: %s\n", self->control.profile);
+                return EOK;
+            }
+        }
+        control_printf(reply, "error: unknown profile: %s\n", arg);
+        return Error.not_found;
+    } else if (str.eq(cmd, "sensitivity")) {
+        f32 value = 0;
+        if (arg == NULL || str.convert.to_f32(arg, &value) || value <= 0.1f || value >= 10.0f) {
+            control_printf(reply, "error: sensitivity expected in (0.1;10)\n");
+            return Error.argument;
+        }
+        // NOTE: accel LUT is speed fraction, sensitivity is applied on every tick
+        self->mouse_sensitivity = value;
+        control_printf(reply, "sensitivity: %0.2f\n", self->mouse_sensitivity);
+    } else if (str.eq(cmd, "trace")) {
+        if (arg == NULL || !(str.eq(arg, "on") || str.eq(arg, "off"))) {
+            control_printf(reply, "error: expected trace on|off\n");
+            return Error.argument;
+        }
+        self->debug = str.eq(arg, "on");
+        control_printf(reply, "trace: %d\n", self->debug);
+    } else if (str.eq(cmd, "dump")) {
+        control_dump(self, reply);
+    } else if (str.eq(cmd, "reset")) {
+        e$ret(KeyMap.keys_release_all(self));
+    } else if (str.eq(cmd, "help")) {
+        control_printf(
+            reply,
+            "profile [name]      - list / switch profile (releases all keys)\n"
+            "sensitivity <value> - set mouse sensitivity (0.1;10)\n"
+            "trace on|off        - print every input event\n"
+            "dump                - print daemon state\n"
+            "reset               - release all keys and buttons (stuck keys)\n"
+        );
+    } else {
+        control_printf(reply, "error: unknown command: %s (try: help)\n", cmd);
+        return Error.argument;
+    }
+    return EOK;
+}
+
+/// Creates non-blocking control socket (root only), no-op if control.socket_path is empty
+Exception
+KeyMapControl_setup(KeyMap_c* self)
+{
+    uassert(self->control.listen_fd == 0 && "already initialized");
+    if (self->control.socket_path == NULL || self->control.socket_path[0] == '\0') { return EOK; }
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    e$ret(str.copy(addr.sun_path, self->control.socket_path, sizeof(addr.sun_path)));
+
+    int fd = -1;
+    e$except_errno (fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) {
+        return Error.os;
+    }
+    // NOTE: stale socket of previous run (or the old binary after upgrade)
+    unlink(self->control.socket_path);
+
+    mode_t old_umask = umask(0077);
+    int rc = bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+    umask(old_umask);
+    if (rc < 0 || listen(fd, 4) < 0) {
+        close(fd);
+        return e$raise(
+            Error.os,
+            "Control socket %s: %s",
+            self->control.socket_path,
+            strerror(errno)
+        );
+    }
+    self->control.listen_fd = fd;
+    log$info("Control socket: %s\n", self->control.socket_path);
+    return EOK;
+}
+
+/// Handles at most one connection and one command per call, all socket calls are non-blocking,
+/// a slow client is dropped instead of stalling the event loop
+Exception
+KeyMapControl_serve(KeyMap_c* self)
+{
+    int fd = accept4(self->control.listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd >= 0) {
+        if (self->control.client_fd > 0) { close(self->control.client_fd); }
+        self->control.client_fd = fd;
+    }
+    if (self->control.client_fd <= 0) { return EOK; }
+
+    char cmd[KEYMAP_CONTROL_MSG_MAX];
+    ssize_t n = recv(self->control.client_fd, cmd, sizeof(cmd) - 1, MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) { return EOK; }
+    if (n <= 0) {
+        close(self->control.client_fd);
+        self->control.client_fd = 0;
+        return EOK;
+    }
+    cmd[n] = '\0';
+    while (n > 0 && (cmd[n - 1] == '\n' || cmd[n - 1] == ' ')) { cmd[--n] = '\0'; }
+
+    ControlReply_s reply = { 0 };
+    Exc err = control_execute(self, cmd, &reply);
+    if (err && reply.len == 0) {
+        control_printf(&reply, "error: %s\n", err);
+    } else if (reply.len == 0) {
+        control_printf(&reply, "ok\n");
+    }
+    // NOTE: SOCK_SEQPACKET, reply is sent as a whole or dropped
+    send(self->control.client_fd, reply.buf, reply.len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    close(self->control.client_fd);
+    self->control.client_fd = 0;
+    return EOK;
+}
+
+void
+KeyMapControl_destroy(KeyMap_c* self)
+{
+    if (self->control.client_fd > 0) {
+        close(self->control.client_fd);
+        self->control.client_fd = 0;
+    }
+    if (self->control.listen_fd > 0) {
+        close(self->control.listen_fd);
+        unlink(self->control.socket_path);
+        self->control.listen_fd = 0;
+    }
+}
+
+/// Sends command to running daemon and prints the reply
+Exception
+KeyMapControl_client(char* socket_path, char* command)
+{
+    Exc result = Error.io;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    e$ret(str.copy(addr.sun_path, socket_path, sizeof(addr.sun_path)));
+
+    int fd = -1;
+    e$except_errno (fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0)) { return Error.os; }
+    struct timeval timeout = { .tv_sec = 2 };
+    e$except_errno (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout))) {
+        goto end;
+    }
+    e$except_errno (connect(fd, (struct sockaddr*)&addr, sizeof(addr))) { goto end; }
+    e$except_errno (send(fd, command, strlen(command), MSG_NOSIGNAL)) { goto end; }
+
+    char reply[KEYMAP_CONTROL_REPLY_MAX + 1];
+    ssize_t n = 0;
+    e$except_errno (n = recv(fd, reply, sizeof(reply) - 1, 0)) { goto end; }
+    reply[n] = '\0';
+    io.printf("%s", reply);
+    result = str.starts_with(reply, "error:") ? Error.runtime : EOK;
+
+end:
+    close(fd);
+    return result;
+}
+
+const struct __cex_namespace__KeyMapControl KeyMapControl = {
+    // Autogenerated by CEX
+    // clang-format off
+
+    .client = KeyMapControl_client,
+    .destroy = KeyMapControl_destroy,
+    .serve = KeyMapControl_serve,
+    .setup = KeyMapControl_setup,
+
+    // clang-format on
+};
@@ -0,0 +1,20 @@
+#pragma once
+#include "KeyMap.h"
+#include "cex.h"
+
+#define KEYMAP_CONTROL_PATH_DEFAULT "/run/uberkb.sock"
+#define KEYMAP_CONTROL_MSG_MAX 256    // command size limit (one SOCK_SEQPACKET message)
+#define KEYMAP_CONTROL_REPLY_MAX 2048 // reply size limit, longer replies are truncated
+
+struct __cex_namespace__KeyMapControl {
+    // Autogenerated by CEX
+    // clang-format off
+
+    Exception       (*client)(char* socket_path, char* command);
+    void            (*destroy)(KeyMap_c* self);
+    Exception       (*serve)(KeyMap_c* self);
+    Exception       (*setup)(KeyMap_c* self);
+
+    // clang-format on
+};
+CEX_NAMESPACE struct __cex_namespace__KeyMapControl KeyMapControl;
@@ -0,0 +1,357 @@
+#include "KeyMapHandoff.h"
+#include "KeyMap.h"
+#include "cex.h"
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define KEYMAP_HANDOFF_ARGV_MAX 64
+
+static volatile sig_atomic_t handoff_signaled = 0;
+static int handoff_argc = 0;
+static char** handoff_argv = NULL;
+
+static void
+handoff_on_sighup(int sig)
+{
+    (void)sig;
+    handoff_signaled = 1;
+}
+
+static u64
+handoff_now_ns(void)
+{
+    struct timespec ts;
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) == -1) {
+        unreachable();
+        return 0;
+    }
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+/// Installs SIGHUP upgrade trigger, argv is reused for exec() of the new binary
+Exception
+KeyMapHandoff_setup(int argc, char** argv)
+{
+    handoff_argc = argc;
+    handoff_argv = argv;
+
+    struct sigaction sa = { .sa_handler = handoff_on_sighup };
+    sigemptyset(&sa.sa_mask);
+    // NOTE: no SA_RESTART, blocking poll() gets EINTR and the loop stops at the next idle point
+    e$except_errno (sigaction(SIGHUP, &sa, NULL)) { return Error.os; }
+    return EOK;
+}
+
+/// SIGHUP received (upgrade requested)
+bool
+KeyMapHandoff_is_requested(void)
+{
+    return handoff_signaled != 0;
+}
+
+/// Forks a bridge process which keeps serving the devices, and exec()s the new binary in place
+/// (keeps PID for systemd). Returns EOK in the bridge, error in the old process if exec() failed.
+Exception
+KeyMapHandoff_upgrade(KeyMap_c* self)
+{
+    uassert(self->input.fd > 0 && "not initialized");
+    uassert(self->handoff.fd == 0 && "already a bridge");
+    handoff_signaled = 0;
+
+    char exe[PATH_MAX];
+    ssize_t exe_len = 0;
+    e$except_errno (exe_len = readlink("/proc/self/exe", exe, sizeof(exe) - 1)) {
+        return Error.os;
+    }
+    exe[exe_len] = '\0';
+    // NOTE: `cex install --upgrade` replaces the file, the old inode is reported as deleted
+    if (str.ends_with(exe, " (deleted)")) { exe[exe_len - sizeof(" (deleted)") + 1] = '\0'; }
+    e$except_errno (access(exe, X_OK)) {
+        return e$raise(Error.not_found, "New binary is not executable: %s", exe);
+    }
+
+    char* argv[KEYMAP_HANDOFF_ARGV_MAX] = { 0 };
+    char sock_arg[16];
+    int sv[2] = { 0 };
+    u32 n_args = 0;
+
+    argv[n_args++] = exe;
+    argv[n_args++] = "--takeover";
+    argv[n_args++] = sock_arg;
+    for (int i = 1; i < handoff_argc; i++) {
+        if (str.eq(handoff_argv[i], "--takeover")) {
+            i++; // previous upgrade, skip old socket number
+            continue;
+        }
+        if (str.starts_with(handoff_argv[i], "--takeover=")) { continue; }
+        if (n_args >= arr$len(argv) - 1) { return e$raise(Error.overflow, "Too many args"); }
+        argv[n_args++] = handoff_argv[i];
+    }
+
+    e$except_errno (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv)) {
+        return Error.os;
+    }
+    e$ret(str.sprintf(sock_arg, sizeof(sock_arg), "%d", sv[0]));
+
+    log$info("Upgrade requested, handing off to: %s\n", exe);
+    fflush(stdout);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(sv[0]);
+        close(sv[1]);
+        return e$raise(Error.os, "fork() failed: %s", strerror(errno));
+    }
+    if (pid == 0) {
+        // Bridge: keeps the event loop running until new binary asks for the devices
+        close(sv[0]);
+        self->handoff.fd = sv[1];
+        return EOK;
+    }
+
+    close(sv[1]);
+    e$except_errno (fcntl(sv[0], F_SETFD, 0)) { goto fail; }
+    execv(exe, argv);
+    log$error("execv(%s) failed: %s\n", exe, strerror(errno));
+    fcntl(sv[0], F_SETFD, FD_CLOEXEC);
+
+fail:
+    // NOTE: the bridge might have processed some events, state is stale but devices are intact
+    kill(pid, SIGKILL);
+    waitpid(pid, NULL, 0);
+    close(sv[0]);
+    return Error.os;
+}
+
+/// Bridge side: handles a message from the new binary, must be called at idle frame boundary
+Exception
+KeyMapHandoff_serve(KeyMap_c* self)
+{
+    uassert(self->handoff.fd > 0 && "not a bridge");
+    uassert(self->output.len == 0 && "expected to be called at frame boundary");
+    uassert(self->input.n_buffered == 0 && "expected to be called at frame boundary");
+
+    u32 msg = 0;
+    ssize_t n = recv(self->handoff.fd, &msg, sizeof(msg), MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) { return EOK; }
+    if (n != sizeof(msg) || msg != KEYMAP_HANDOFF_MAGIC) {
+        log$error("New binary exited before takeover, bridge keeps serving\n");
+        close(self->handoff.fd);
+        self->handoff.fd = 0;
+        return EOK;
+    }
+
+    KeyMapHandoffSnapshot_s snap = {
+        .magic = KEYMAP_HANDOFF_MAGIC,
+        .version = KEYMAP_HANDOFF_VERSION,
+        .n_fds = ((self->mouse.fd > 0) ? 3 : 2) + self->input.n_siblings,
+        .n_siblings = self->input.n_siblings,
+        .mouse_last_press_ts = self->mouse.last_press_ts,
+        .unified_device = self->unified_device,
+        .mouse_sensitivity = self->mouse_sensitivity,
+        .mod_pressed = self->mod_pressed,
+        .mouse_pressed = self->mouse_pressed,
+        .mouse_up = self->mouse.up,
+        .mouse_down = self->mouse.down,
+        .mouse_left = self->mouse.left,
+        .mouse_right = self->mouse.right,
+        .wheel_v = self->mouse.wheel_v,
+        .wheel_h = self->mouse.wheel_h,
+        .last_key_mod = self->last_key_mod,
+        .repeat_code = self->repeat.code,
+        .repeat_phys_code = self->repeat.phys_code,
+        .repeat_layer = self->repeat.layer,
+        .n_events = self->stats.n_events,
+        .n_syn_dropped = self->stats.n_syn_dropped,
+    };
+    if (self->control.profile) {
+        if (str.copy(snap.profile, self->control.profile, sizeof(snap.profile))) {
+            snap.profile[0] = '\0'; // too long, the new binary keeps its startup profile
+        }
+    }
+    memcpy(snap.keys_down, self->output.keys_down, sizeof(snap.keys_down));
+    memcpy(snap.pressed_map, self->pressed_map, sizeof(snap.pressed_map));
+
+    int fds[KEYMAP_HANDOFF_FDS_MAX] = { self->input.fd, self->output.fd, self->mouse.fd };
+    for (u32 i = 0; i < self->input.n_siblings; i++) {
+        fds[snap.n_fds - snap.n_siblings + i] = self->input.siblings[i].fd;
+    }
+    char cbuf[CMSG_SPACE(sizeof(fds))] = { 0 };
+    struct iovec iov = { .iov_base = &snap, .iov_len = sizeof(snap) };
+    struct msghdr mh = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = cbuf,
+        .msg_controllen = CMSG_SPACE(sizeof(int) * snap.n_fds),
+    };
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&mh);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * snap.n_fds);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * snap.n_fds);
+
+    // NOTE: from this point the bridge never reads input again
+    snap.handoff_ns = handoff_now_ns();
+    if (sendmsg(self->handoff.fd, &mh, MSG_NOSIGNAL) != sizeof(snap)) {
+        log$error("Handoff sendmsg() failed: %s, bridge keeps serving\n", strerror(errno));
+        close(self->handoff.fd);
+        self->handoff.fd = 0;
+        return EOK;
+    }
+
+    // NOTE: devices are owned by the new binary now, no ungrab / UI_DEV_DESTROY here!
+    fflush(stdout);
+    _exit(0);
+}
+
+/// New binary side: receives grabbed input and virtual device fds with state from old daemon
+Exception
+KeyMapHandoff_takeover(KeyMap_c* self, int sock_fd)
+{
+    uassert(self->input.fd == 0 && "already initialized or non ZII");
+    uassert(sock_fd > 0);
+
+    Exc result = Error.io;
+    int fds[KEYMAP_HANDOFF_FDS_MAX];
+    for (u32 i = 0; i < arr$len(fds); i++) { fds[i] = -1; }
+
+    // NOTE: the bridge is our child after exec(), let kernel reap it
+    signal(SIGCHLD, SIG_IGN);
+
+    // Everything slow goes before "ready", the bridge serves input until then
+    if (self->realtime.enabled) { e$goto(result = KeyMap.realtime_setup(self), end); }
+    if (self->mouse_key_code) { e$goto(result = KeyMap.mouse_accel_setup(self), end); }
+    e$goto(result = KeyMap.repeat_setup(self), end);
+    KeyMap.pipeline_setup(self);
+
+    u32 msg = KEYMAP_HANDOFF_MAGIC;
+    e$except_errno (send(sock_fd, &msg, sizeof(msg), MSG_NOSIGNAL)) { goto end; }
+
+    KeyMapHandoffSnapshot_s snap = { 0 };
+    char cbuf[CMSG_SPACE(sizeof(fds))] = { 0 };
+    struct iovec iov = { .iov_base = &snap, .iov_len = sizeof(snap) };
+    struct msghdr mh = {
+        .msg_iov = &iov,
+        .msg_iovlen = 1,
+        .msg_control = cbuf,
+        .msg_controllen = sizeof(cbuf),
+    };
+    ssize_t n = 0;
+    do {
+        n = recvmsg(sock_fd, &mh, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&mh);
+    if (cmsg && cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+        memcpy(fds, CMSG_DATA(cmsg), cmsg->cmsg_len - CMSG_LEN(0));
+    }
+    if (n != sizeof(snap) || snap.magic != KEYMAP_HANDOFF_MAGIC ||
+        snap.version != KEYMAP_HANDOFF_VERSION || snap.n_fds < 2 + snap.n_siblings ||
+        snap.n_fds > arr$len(fds) || snap.n_siblings > KEYMAP_INPUT_SIBLINGS_MAX || fds[0] < 0 ||
+        fds[1] < 0) {
+        result = e$raise(Error.integrity, "Bad handoff snapshot (size: %zd)", n);
+        goto end;
+    }
+
+    // Profile switched at runtime (control socket) survives the upgrade
+    snap.profile[sizeof(snap.profile) - 1] = '\0';
+    for (u32 i = 0; i < self->control.n_profiles; i++) {
+        KeyMapProfile_s* profile = &self->control.profiles[i];
+        if (str.eq(profile->name, snap.profile) && profile->name != self->control.profile) {
+            e$goto(result = KeyMap.profile_apply(self, profile), end);
+            if (self->mouse_key_code) { e$goto(result = KeyMap.mouse_accel_setup(self), end); }
+        }
+    }
+
+    u32 n_devices = snap.n_fds - snap.n_siblings;
+    self->input.fd = fds[0];
+    self->output.fd = fds[1];
+    self->mouse.fd = (n_devices > 2) ? fds[2] : 0;
+    for (u32 i = 0; i < snap.n_siblings; i++) {
+        KeyMapInputSibling_s* sib = &self->input.siblings[self->input.n_siblings++];
+        sib->fd = fds[n_devices + i];
+        fds[n_devices + i] = -1;
+        // NOTE: the bridge stopped at frame boundary, kernel key state is the current one
+        if (ioctl(sib->fd, EVIOCGKEY(sizeof(sib->keys_down)), sib->keys_down) < 0) {
+            memset(sib->keys_down, 0, sizeof(sib->keys_down));
+        }
+    }
+    fds[0] = fds[1] = fds[2] = -1;
+
+    // NOTE: grab belongs to the open file description, it survives the fd passing
+    e$except_errno (libevdev_new_from_fd(self->input.fd, &self->input.dev)) { goto end; }
+
+    self->unified_device = snap.unified_device;
+    if (self->mouse_key_code && !self->unified_device && self->mouse.fd == 0) {
+        // NOTE: old daemon ran without mouse layer (no mouse fd passed), but the new config (or
+        // the snapshot profile) has one, mouse layer keys would write to nowhere
+        if (KeyMap.mouse_create(self)) {
+#ifdef KEYMAP_STATIC_CONFIG
+            result = e$raise(Error.runtime, "Static config mouse layer requires virtual mouse");
+            goto end;
+#else
+            log$error("Virtual mouse is not available, mouse layer is disabled\n");
+            self->mouse_key_code = 0;
+            KeyMap.pipeline_setup(self);
+#endif
+        }
+    }
+    if (snap.mouse_sensitivity > 0) { self->mouse_sensitivity = snap.mouse_sensitivity; }
+    self->mod_pressed = snap.mod_pressed;
+    self->mouse_pressed = snap.mouse_pressed;
+    self->mouse.up = snap.mouse_up;
+    self->mouse.down = snap.mouse_down;
+    self->mouse.left = snap.mouse_left;
+    self->mouse.right = snap.mouse_right;
+    self->mouse.wheel_v = snap.wheel_v;
+    self->mouse.wheel_h = snap.wheel_h;
+    self->mouse.wheel_press_ts = handoff_now_ns() / 1000000; // held wheel restarts the ramp
+    self->mouse.last_press_ts = snap.mouse_last_press_ts;
+    self->last_key_mod = snap.last_key_mod;
+    self->stats.n_events = snap.n_events;
+    self->stats.n_syn_dropped = snap.n_syn_dropped;
+    memcpy(self->output.keys_down, snap.keys_down, sizeof(snap.keys_down));
+    memcpy(self->pressed_map, snap.pressed_map, sizeof(snap.pressed_map));
+
+    u16 code = snap.repeat_code;
+    if (self->repeat.enabled && code && code < KEY_CNT && snap.repeat_layer < KeyMapLayer__count &&
+        (self->output.keys_down[code / 8] & (1 << (code % 8)))) {
+        // NOTE: held key keeps repeating, the timer is armed before the first wait (delay again)
+        self->repeat.code = code;
+        self->repeat.phys_code = snap.repeat_phys_code;
+        self->repeat.layer = snap.repeat_layer;
+        self->repeat.pending = true;
+    }
+
+    u64 gap_ns = handoff_now_ns() - snap.handoff_ns;
+    log$info(
+        "Takeover complete: input gap %0.1fus, events handled: %lu\n",
+        gap_ns / 1000.0,
+        self->stats.n_events
+    );
+    result = EOK;
+
+end:
+    for (u32 i = 0; i < arr$len(fds); i++) {
+        if (fds[i] >= 0) { close(fds[i]); }
+    }
+    close(sock_fd);
+    return result;
+}
+
+const struct __cex_namespace__KeyMapHandoff KeyMapHandoff = {
+    // Autogenerated by CEX
+    // clang-format off
+
+    .is_requested = KeyMapHandoff_is_requested,
+    .serve = KeyMapHandoff_serve,
+    .setup = KeyMapHandoff_setup,
+    .takeover = KeyMapHandoff_takeover,
+    .upgrade = KeyMapHandoff_upgrade,
+
+    // clang-format on
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include "KeyMap.h"
+#include "cex.h"
+
+#define KEYMAP_HANDOFF_MAGIC 0x55424B48 /* UBKH */
+#define KEYMAP_HANDOFF_VERSION 3
+#define KEYMAP_HANDOFF_FDS_MAX (3 + KEYMAP_INPUT_SIBLINGS_MAX)
+
+/// State snapshot passed from running daemon to the new binary along with device fds
+typedef struct KeyMapHandoffSnapshot_s
+{
+    u32 magic;
+    u32 version;
+    u32 n_fds;      // input, output (+ mouse) + sibling interfaces passed via SCM_RIGHTS
+    u32 n_siblings; // last fds are sibling input interfaces (grabbed)
+    u64 handoff_ns; // CLOCK_MONOTONIC when old process stopped reading input
+    u64 mouse_last_press_ts;
+    bool unified_device; // old daemon devices layout wins over new binary options
+    bool mod_pressed;
+    bool mouse_pressed;
+    bool mouse_up;
+    bool mouse_down;
+    bool mouse_left;
+    bool mouse_right;
+    i8 wheel_v;
+    i8 wheel_h;
+    u16 last_key_mod;
+    u16 repeat_code;      // held key repeated by old daemon (0 - none), re-armed after takeover
+    u16 repeat_phys_code;
+    u32 repeat_layer;
+    f32 mouse_sensitivity;
+    char profile[32];
+    u64 n_events;
+    u64 n_syn_dropped;
+    u8 keys_down[KEY_CNT / 8];
+    u16 pressed_map[KEY_CNT];
+} KeyMapHandoffSnapshot_s;
+
+struct __cex_namespace__KeyMapHandoff {
+    // Autogenerated by CEX
+    // clang-format off
+
+    bool            (*is_requested)(void);
+    Exception       (*serve)(KeyMap_c* self);
+    Exception       (*setup)(int argc, char** argv);
+    Exception       (*takeover)(KeyMap_c* self, int sock_fd);
+    Exception       (*upgrade)(KeyMap_c* self);
+
+    // clang-format on
+};
+CEX_NAMESPACE struct __cex_namespace__KeyMapHandoff KeyMapHandoff;
@@ -0,0 +1,495 @@
+#include "KeyMapUring.h"
+#include "KeyMap.h"
+#include "cex.h"
+#include <errno.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+typedef enum UringOp_e
+{
+    UringOp__poll = 1,
+    UringOp__poll_remove,
+    UringOp__timeout,
+    UringOp__write,
+    UringOp__input_poll,
+    UringOp__input_read,
+} UringOp_e;
+
+// SQE user_data: operation, slot/buffer index, poll slot generation
+#define uring$data(op, idx, gen) ((u64)(op) | (u64)(idx) << 8 | (u64)(gen) << 32)
+
+static int
+uring_enter(KeyMapUring_s* r, u32 to_submit, u32 min_complete, u32 flags)
+{
+    r->n_enter++;
+    return (int)syscall(
+        __NR_io_uring_enter,
+        r->fd,
+        to_submit,
+        min_complete,
+        flags,
+        NULL,
+        _NSIG / 8
+    );
+}
+
+static u64
+uring_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ULL + (u64)ts.tv_nsec;
+}
+
+/// Publishes queued SQEs and enters the kernel once, waits for min_complete CQEs if > 0
+static int
+uring_submit(KeyMapUring_s* r, u32 min_complete)
+{
+    // NOTE: SQEs not consumed by a previous (failed) enter are still counted
+    u32 to_submit = r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    __atomic_store_n(r->sq_tail, r->sq_local_tail, __ATOMIC_RELEASE);
+    r->last_write = NULL;
+    if (to_submit == 0 && min_complete == 0) { return 0; }
+    return uring_enter(r, to_submit, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0);
+}
+
+static Exception
+uring_sqe_get(KeyMapUring_s* r, struct io_uring_sqe** out_sqe)
+{
+    u32 head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    if (unlikely(r->sq_local_tail - head >= r->sq_entries)) {
+        e$except_errno (uring_submit(r, 0)) { return Error.io; }
+        head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+        e$assert(r->sq_local_tail - head < r->sq_entries && "io_uring SQ is full");
+    }
+    struct io_uring_sqe* sqe = &r->sqes[r->sq_local_tail & r->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_local_tail++;
+    *out_sqe = sqe;
+    return EOK;
+}
+
+/// Drains CQ: releases write buffers, collects poll revents, input reads and timeout expiration
+static Exception
+uring_reap(KeyMapUring_s* r)
+{
+    Exc result = EOK;
+    u32 head = *r->cq_head;
+    u32 tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; head++) {
+        struct io_uring_cqe* cqe = &r->cqes[head & r->cq_mask];
+        u32 idx = (cqe->user_data >> 8) & 0xFFFFFF;
+        u32 gen = cqe->user_data >> 32;
+
+        switch ((UringOp_e)(cqe->user_data & 0xFF)) {
+            case UringOp__write:
+                r->write_free[r->n_write_free++] = idx;
+                r->n_writes_inflight--;
+                if (cqe->res < 0) {
+                    result = e$raise(Error.io, "io_uring write(): %s", strerror(-cqe->res));
+                } else if ((u32)cqe->res != r->write_len[idx]) {
+                    result = e$raise(Error.io, "io_uring write(): short write %d", cqe->res);
+                }
+                break;
+
+            case UringOp__poll: {
+                if (r->slots[idx].gen != gen) { break; } // removed (fd changed)
+                r->slots[idx].armed = false;
+                if (cqe->res == -ECANCELED) { break; }
+                r->slots[idx].revents |= (cqe->res < 0) ? POLLERR : (u16)cqe->res;
+                break;
+            }
+
+            case UringOp__input_poll:
+                // NOTE: readiness is reported by the linked read, a failed poll cancels it
+                if (cqe->res < 0 && cqe->res != -ECANCELED) { r->slots[0].revents |= POLLERR; }
+                break;
+
+            case UringOp__input_read:
+                r->input.armed = false;
+                if (cqe->res == -ECANCELED || cqe->res == -EAGAIN) { break; }
+                r->input.ready = true;
+                r->input.res = cqe->res;
+                r->slots[0].revents |= (cqe->res < 0)    ? POLLERR
+                                       : (cqe->res == 0) ? POLLHUP
+                                                         : POLLIN;
+                break;
+
+            case UringOp__timeout:
+                r->timeout_armed = false;
+                if (cqe->res == -ETIME) { r->timed_out = true; }
+                break;
+
+            case UringOp__poll_remove:
+                break;
+        }
+    }
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    return result;
+}
+
+static Exception
+uring_poll_arm(KeyMapUring_s* r, u32 idx, short events)
+{
+    struct io_uring_sqe* sqe = NULL;
+    e$ret(uring_sqe_get(r, &sqe));
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = r->slots[idx].fd;
+    sqe->poll32_events = (u16)events;
+    sqe->user_data = uring$data(UringOp__poll, idx, r->slots[idx].gen);
+    r->slots[idx].armed = true;
+    return EOK;
+}
+
+/// Input fd read on the ring: POLL_ADD linked to READ, one io_uring_enter() per wakeup submits
+/// it and returns with the data (evdev / pipe fds are O_NONBLOCK, a bare read gets -EAGAIN)
+static Exception
+uring_input_arm(KeyMapUring_s* r)
+{
+    // NOTE: linked pair must go with the same submit
+    if (r->sq_local_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) + 2 > r->sq_entries) {
+        e$except_errno (uring_submit(r, 0)) { return Error.io; }
+    }
+    struct io_uring_sqe* sqe = NULL;
+    e$ret(uring_sqe_get(r, &sqe));
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = r->slots[0].fd;
+    sqe->poll32_events = POLLIN;
+    sqe->flags = IOSQE_IO_LINK;
+    sqe->user_data = uring$data(UringOp__input_poll, 0, 0);
+
+    e$ret(uring_sqe_get(r, &sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = r->slots[0].fd;
+    sqe->addr = (u64)(usize)r->input.buf;
+    sqe->len = sizeof(r->input.buf);
+    sqe->off = (u64)-1; // current position, evdev and pipes are streams
+    sqe->user_data = uring$data(UringOp__input_read, 0, 0);
+    r->input.armed = true;
+    return EOK;
+}
+
+static Exception
+uring_poll_remove(KeyMapUring_s* r, u32 idx)
+{
+    struct io_uring_sqe* sqe = NULL;
+    e$ret(uring_sqe_get(r, &sqe));
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = uring$data(UringOp__poll, idx, r->slots[idx].gen);
+    sqe->user_data = uring$data(UringOp__poll_remove, idx, r->slots[idx].gen);
+    r->slots[idx].armed = false;
+    return EOK;
+}
+
+/// Creates io_uring instance, fails on kernels without required ops (caller falls back to poll)
+Exception
+KeyMapUring_setup(KeyMap_c* self)
+{
+    uassert(self->uring.ring == NULL && "already initialized");
+
+    Exc result = Error.os;
+    struct io_uring_params params = { 0 };
+    // NOTE: mmap() instead of allocator, the struct is big and loop must stay allocation free
+    KeyMapUring_s* r = mmap(
+        NULL,
+        sizeof(KeyMapUring_s),
+        PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS,
+        -1,
+        0
+    );
+    if (r == MAP_FAILED) { return e$raise(Error.memory, "mmap(): %s", strerror(errno)); }
+    r->fd = -1;
+
+    e$except_errno (r->fd = (int)syscall(__NR_io_uring_setup, KEYMAP_URING_ENTRIES, &params)) {
+        goto fail;
+    }
+    u32 required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS;
+    if ((params.features & required) != required) {
+        result = e$raise(Error.os, "io_uring features: %x (Linux 5.6+ required)", params.features);
+        goto fail;
+    }
+
+    struct
+    {
+        struct io_uring_probe probe;
+        struct io_uring_probe_op ops[256];
+    } probe = { 0 };
+    e$except_errno (syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PROBE, &probe, 256)) {
+        goto fail;
+    }
+    u8 ops[] = {
+        IORING_OP_POLL_ADD, IORING_OP_POLL_REMOVE, IORING_OP_TIMEOUT,
+        IORING_OP_READ,     IORING_OP_WRITE,
+    };
+    for (u32 i = 0; i < arr$len(ops); i++) {
+        if (ops[i] > probe.probe.last_op || !(probe.ops[ops[i]].flags & IO_URING_OP_SUPPORTED)) {
+            result = e$raise(Error.os, "io_uring op is not supported: %d", ops[i]);
+            goto fail;
+        }
+    }
+
+    r->ring_size = params.sq_off.array + params.sq_entries * sizeof(u32);
+    usize cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (cq_size > r->ring_size) { r->ring_size = cq_size; }
+    r->ring_ptr = mmap(
+        NULL,
+        r->ring_size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        r->fd,
+        IORING_OFF_SQ_RING
+    );
+    if (r->ring_ptr == MAP_FAILED) {
+        r->ring_ptr = NULL;
+        result = e$raise(Error.os, "io_uring ring mmap(): %s", strerror(errno));
+        goto fail;
+    }
+    r->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(
+        NULL,
+        r->sqes_size,
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE,
+        r->fd,
+        IORING_OFF_SQES
+    );
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        result = e$raise(Error.os, "io_uring sqes mmap(): %s", strerror(errno));
+        goto fail;
+    }
+
+    u8* ring = r->ring_ptr;
+    r->sq_head = (u32*)(ring + params.sq_off.head);
+    r->sq_tail = (u32*)(ring + params.sq_off.tail);
+    r->sq_mask = *(u32*)(ring + params.sq_off.ring_mask);
+    r->sq_entries = *(u32*)(ring + params.sq_off.ring_entries);
+    r->sq_local_tail = *r->sq_tail;
+    u32* sq_array = (u32*)(ring + params.sq_off.array);
+    for (u32 i = 0; i < r->sq_entries; i++) { sq_array[i] = i; }
+    r->cq_head = (u32*)(ring + params.cq_off.head);
+    r->cq_tail = (u32*)(ring + params.cq_off.tail);
+    r->cq_mask = *(u32*)(ring + params.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(ring + params.cq_off.cqes);
+
+    for (u32 i = 0; i < arr$len(r->slots); i++) { r->slots[i].fd = -1; }
+    for (u32 i = 0; i < arr$len(r->write_free); i++) { r->write_free[i] = i; }
+    r->n_write_free = arr$len(r->write_free);
+
+    self->uring.ring = r;
+    log$info("io_uring backend: %d SQ entries, features: %x\n", r->sq_entries, params.features);
+    return EOK;
+
+fail:
+    if (r->sqes) { munmap(r->sqes, r->sqes_size); }
+    if (r->ring_ptr) { munmap(r->ring_ptr, r->ring_size); }
+    if (r->fd >= 0) { close(r->fd); }
+    munmap(r, sizeof(KeyMapUring_s));
+    return result;
+}
+
+/// Queues output frame write (buffer is copied), linked to the previous queued write to keep
+/// order, submitted by the next wait() / submit()
+Exception
+KeyMapUring_write(KeyMap_c* self, int fd, void* buf, usize size)
+{
+    KeyMapUring_s* r = self->uring.ring;
+    uassert(r != NULL && "not initialized");
+    e$assert(size <= sizeof(r->write_buf[0]) && "output frame is too big");
+
+    while (unlikely(r->n_write_free == 0)) {
+        // NOTE: poll / timeout completions reaped here are kept for the next wait()
+        e$except_errno (uring_submit(r, 1)) {
+            if (errno != EINTR) { return Error.io; }
+        }
+        e$ret(uring_reap(r));
+    }
+
+    struct io_uring_sqe* sqe = NULL;
+    e$ret(uring_sqe_get(r, &sqe));
+    u32 idx = r->write_free[--r->n_write_free];
+    memcpy(r->write_buf[idx], buf, size);
+    r->write_len[idx] = size;
+
+    sqe->opcode = IORING_OP_WRITE;
+    sqe->fd = fd;
+    sqe->addr = (u64)(usize)r->write_buf[idx];
+    sqe->len = size;
+    sqe->off = (u64)-1; // current position (IORING_FEAT_RW_CUR_POS), uinput is a stream
+    sqe->user_data = uring$data(UringOp__write, idx, 0);
+    if (r->last_write) { r->last_write->flags |= IOSQE_IO_LINK; }
+    r->last_write = sqe;
+    r->n_writes_inflight++;
+    return EOK;
+}
+
+/// Submits queued writes without waiting
+Exception
+KeyMapUring_submit(KeyMap_c* self)
+{
+    KeyMapUring_s* r = self->uring.ring;
+    uassert(r != NULL && "not initialized");
+    e$except_errno (uring_submit(r, 0)) { return Error.io; }
+    return EOK;
+}
+
+static bool
+uring_has_events(KeyMapUring_s* r, u32 n_fds, int timeout_ms)
+{
+    if (r->timed_out && timeout_ms >= 0) { return true; }
+    for (u32 i = 0; i < n_fds; i++) {
+        if (r->slots[i].revents) { return true; }
+    }
+    return false;
+}
+
+/// poll() replacement: queued writes, poll and timeout SQEs go with one io_uring_enter().
+/// fds[0] (input) is read on the ring, POLLIN means KeyMapUring.read() has the data, other fds
+/// are level-triggered polls.
+/// Until spin_until_ns (CLOCK_MONOTONIC, 0 - off) CQ ring is watched without syscalls.
+/// Returns like poll(), -1 + EINTR also on wakeups without events (re-check idle point).
+int
+KeyMapUring_wait(KeyMap_c* self, struct pollfd* fds, u32 n_fds, int timeout_ms, u64 spin_until_ns)
+{
+    KeyMapUring_s* r = self->uring.ring;
+    uassert(r != NULL && "not initialized");
+    uassert(n_fds <= arr$len(r->slots));
+
+    for (u32 i = 0; i < n_fds; i++) {
+        if (r->slots[i].fd != fds[i].fd) {
+            uassert((i > 0 || !r->input.armed) && "input fd is fixed while read is in flight");
+            if (r->slots[i].armed && uring_poll_remove(r, i)) { goto fail; }
+            r->slots[i].gen++;
+            r->slots[i].fd = fds[i].fd;
+            r->slots[i].revents = 0;
+        }
+        if (i == 0) {
+            if (r->input.ready) {
+                r->slots[0].revents |= POLLIN; // not taken by the caller yet
+            } else if (r->slots[0].fd >= 0 && !r->input.armed) {
+                if (uring_input_arm(r)) { goto fail; }
+            }
+            continue;
+        }
+        if (!r->slots[i].revents && r->slots[i].fd >= 0 && !r->slots[i].armed) {
+            if (uring_poll_arm(r, i, fds[i].events)) { goto fail; }
+        }
+    }
+    if (timeout_ms >= 0 && !r->timeout_armed && !r->timed_out) {
+        struct io_uring_sqe* sqe = NULL;
+        if (uring_sqe_get(r, &sqe)) { goto fail; }
+        r->timeout_ts = (struct __kernel_timespec){
+            .tv_sec = timeout_ms / 1000,
+            .tv_nsec = (timeout_ms % 1000) * 1000000LL,
+        };
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->fd = -1;
+        sqe->addr = (u64)(usize)&r->timeout_ts;
+        sqe->len = 1;
+        sqe->user_data = uring$data(UringOp__timeout, 0, 0);
+        r->timeout_armed = true;
+    }
+
+    bool has_events = uring_has_events(r, n_fds, timeout_ms);
+    if (!has_events && spin_until_ns) {
+        // Busy-poll: writes and polls go to the kernel, completions are polled in shared memory
+        if (uring_submit(r, 0) < 0) { return -1; }
+        u64 now = uring_now_ns();
+        while (now < spin_until_ns) {
+            if (__atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE) != *r->cq_head) {
+                if (uring_reap(r)) { goto fail; }
+                if ((has_events = uring_has_events(r, n_fds, timeout_ms))) { break; }
+            }
+            for (u32 i = 0; i < KEYMAP_BUSY_POLL_RELAX; i++) { keymap$cpu_relax(); }
+            now = uring_now_ns();
+        }
+    }
+
+    // NOTE: write CQEs are counted by the kernel, the wait must outlast them
+    if (uring_submit(r, has_events ? 0 : r->n_writes_inflight + 1) < 0) { return -1; }
+    if (uring_reap(r)) { goto fail; }
+
+    int n_ready = 0;
+    for (u32 i = 0; i < n_fds; i++) {
+        short revents = (short)r->slots[i].revents;
+        fds[i].revents = revents & (fds[i].events | POLLERR | POLLHUP | POLLNVAL);
+        r->slots[i].revents = 0;
+        if (fds[i].revents) { n_ready++; }
+    }
+    bool timed_out = r->timed_out && timeout_ms >= 0;
+    r->timed_out = false;
+    if (n_ready > 0) { return n_ready; }
+    if (timed_out) { return 0; }
+    errno = EINTR;
+    return -1;
+
+fail:
+    errno = EIO;
+    return -1;
+}
+
+/// Takes input read completed by wait() (fds[0] POLLIN), returns like read(): bytes (0 - EOF),
+/// -1 + errno, EAGAIN if there is nothing. Events point to ring memory valid until the next wait()
+isize
+KeyMapUring_read(KeyMap_c* self, struct input_event** out_events)
+{
+    KeyMapUring_s* r = self->uring.ring;
+    uassert(r != NULL && "not initialized");
+
+    *out_events = r->input.buf;
+    if (!r->input.ready) {
+        errno = EAGAIN;
+        return -1;
+    }
+    r->input.ready = false;
+    if (r->input.res < 0) {
+        errno = -r->input.res;
+        return -1;
+    }
+    return r->input.res;
+}
+
+/// Completes queued writes (exit, upgrade) and releases the ring, pending polls are cancelled
+void
+KeyMapUring_destroy(KeyMap_c* self)
+{
+    KeyMapUring_s* r = self->uring.ring;
+    if (r == NULL) { return; }
+
+    struct io_uring_sqe* sqe = NULL;
+    if (r->input.armed && !uring_sqe_get(r, &sqe)) {
+        // NOTE: the read targets ring memory, it must be cancelled (poll removal) before munmap()
+        sqe->opcode = IORING_OP_POLL_REMOVE;
+        sqe->fd = -1;
+        sqe->addr = uring$data(UringOp__input_poll, 0, 0);
+        sqe->user_data = uring$data(UringOp__poll_remove, 0, 0);
+    }
+    while (r->n_writes_inflight > 0 || r->input.armed) {
+        if (uring_submit(r, 1) < 0 && errno != EINTR) { break; }
+        if (uring_reap(r)) { break; }
+    }
+    munmap(r->sqes, r->sqes_size);
+    munmap(r->ring_ptr, r->ring_size);
+    close(r->fd);
+    munmap(r, sizeof(KeyMapUring_s));
+    self->uring.ring = NULL;
+}
+
+const struct __cex_namespace__KeyMapUring KeyMapUring = {
+    // Autogenerated by CEX
+    // clang-format off
+
+    .destroy = KeyMapUring_destroy,
+    .setup = KeyMapUring_setup,
+    .read = KeyMapUring_read,
+    .submit = KeyMapUring_submit,
+    .wait = KeyMapUring_wait,
+    .write = KeyMapUring_write,
+
+    // clang-format on
+};
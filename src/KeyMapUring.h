@@ -0,0 +1,74 @@
+#pragma once
+#include "KeyMap.h"
+#include "cex.h"
+#include <linux/io_uring.h>
+#include <poll.h>
+
+#define KEYMAP_URING_ENTRIES 64   // SQ size (CQ is twice as big)
+#define KEYMAP_URING_POLL_MAX 8   // fds watched by KeyMapUring.wait()
+#define KEYMAP_URING_WRITE_MAX 32 // output frames in flight
+
+/// io_uring event loop backend state (raw syscalls, mmap()ed, no allocations after setup)
+typedef struct KeyMapUring_s
+{
+    int fd;
+    void* ring_ptr; // SQ and CQ rings (IORING_FEAT_SINGLE_MMAP)
+    usize ring_size;
+    struct io_uring_sqe* sqes;
+    usize sqes_size;
+
+    u32* sq_head;
+    u32* sq_tail;
+    u32 sq_mask;
+    u32 sq_entries;
+    u32 sq_local_tail; // queued SQEs, published to sq_tail at io_uring_enter()
+    u32* cq_head;
+    u32* cq_tail;
+    u32 cq_mask;
+    struct io_uring_cqe* cqes;
+
+    struct
+    {
+        int fd;
+        u32 gen; // bumped on fd change, completions of removed polls are ignored
+        bool armed;
+        u16 revents;
+    } slots[KEYMAP_URING_POLL_MAX];
+
+    struct
+    {
+        bool armed; // linked POLL_ADD -> READ of slot 0 fd in flight
+        bool ready; // completed read, not taken by KeyMapUring.read() yet
+        i32 res;    // bytes read or -errno
+        struct input_event buf[KEYMAP_FRAME_MAX]; // read by kernel, valid until the next wait()
+    } input;
+
+    bool timeout_armed;
+    bool timed_out;
+    struct __kernel_timespec timeout_ts; // read by kernel at submission
+
+    struct io_uring_sqe* last_write; // queued write SQE, linked to the next one (keeps order)
+    u32 n_writes_inflight;
+    u32 n_write_free;
+    u32 write_free[KEYMAP_URING_WRITE_MAX];
+    u32 write_len[KEYMAP_URING_WRITE_MAX];
+    struct input_event write_buf[KEYMAP_URING_WRITE_MAX][KEYMAP_FRAME_MAX];
+
+    u64 n_enter; // io_uring_enter() calls
+} KeyMapUring_s;
+
+struct __cex_namespace__KeyMapUring {
+    // Autogenerated by CEX
+    // clang-format off
+
+    void            (*destroy)(KeyMap_c* self);
+    isize           (*read)(KeyMap_c* self, struct input_event** out_events);
+    Exception       (*setup)(KeyMap_c* self);
+    Exception       (*submit)(KeyMap_c* self);
+    int             (*wait)(KeyMap_c* self, struct pollfd* fds, u32 n_fds, int timeout_ms,
+                            u64 spin_until_ns);
+    Exception       (*write)(KeyMap_c* self, int fd, void* buf, usize size);
+
+    // clang-format on
+};
+CEX_NAMESPACE struct __cex_namespace__KeyMapUring KeyMapUring;
@@ -1,118 +1,312 @@
+// NOTE: unity build root, sched_setaffinity() / CPU_SET() require GNU extensions
+#define _GNU_SOURCE
+#ifdef KEYMAP_ALLOC_TRAP
+#    include <stdbool.h>
+#    include <stddef.h>
+// NOTE: counting/trapping cex allocator calls after event loop is ready (debug build only)
+void KeyMap__alloc_trap_hit(bool is_cex, size_t size);
+#    define __cex__alloc_hook(allocator, size) KeyMap__alloc_trap_hit(true, (size))
+#endif
 #define CEX_IMPLEMENTATION
 #include <stdbool.h>
 #include "KeyMap.c"
 #include "KeyMap.h"
+#include "KeyMapBench.c"
+#include "KeyMapBench.h"
+#include "KeyMapControl.c"
+#include "KeyMapControl.h"
+#include "KeyMapHandoff.c"
+#include "KeyMapHandoff.h"
+#include "KeyMapUring.c"
+#include "KeyMapUring.h"
 #include "cex.h"
 #include <linux/input-event-codes.h>
 
+// CUT/COPY/PASTE for UHK
+static KeyMap_c profile_uhk = {
+    // .debug = true,
+    .direct_map = {
+        [KEY_F13] = KEY_CUT,
+        [KEY_F14] = KEY_COPY,
+        [KEY_F15] = KEY_PASTE,
+    },
+    .mouse_key_code = KEY_LEFTMETA,
+    .mouse_sensitivity = 1.0,
+    .mouse_speedup_ms = 700,
+    .mouse_map = {
+        // Buttons
+        [KEY_SPACE] = BTN_LEFT,
+        [KEY_N] = BTN_RIGHT,
+        // Wheel
+        [KEY_Y] = BTN_GEAR_UP,
+        [KEY_H] = BTN_GEAR_DOWN,
+        [KEY_U] = KEYMAP_HWHEEL_LEFT,
+        [KEY_O] = KEYMAP_HWHEEL_RIGHT,
+        // Cursor
+        [KEY_J] = KEY_LEFT,
+        [KEY_L] = KEY_RIGHT,
+        [KEY_I] = KEY_UP,
+        [KEY_K] = KEY_DOWN,
+    },
+
+    // // For testing only
+    // .mod_key_code = KEY_LEFTALT,
+    // .mod_map = {
+    //     [KEY_I] = KEY_UP, 
+    //     [KEY_K] = KEY_DOWN, 
+    //     [KEY_J] = KEY_LEFT, 
+    //     [KEY_L] = KEY_RIGHT, 
+    // },
+};
+
+// Default mapping all other generic keyboards
+static KeyMap_c profile_generic = {
+    // .debug = true,
+    .mod_key_code = KEY_LEFTALT,
+    .mod_map = {
+        [KEY_I] = KEY_UP, 
+        [KEY_K] = KEY_DOWN, 
+        [KEY_J] = KEY_LEFT, 
+        [KEY_L] = KEY_RIGHT, 
+        [KEY_SPACE] = KEY_BACKSPACE,
+        [KEY_N] = KEY_DELETE,
+        [KEY_U] = KEY_HOME,
+        [KEY_O] = KEY_END,
+        [KEY_Y] = KEY_PAGEUP,
+        [KEY_H] = KEY_PAGEDOWN,
+        [KEY_F] = KEY_SCROLLLOCK,
+        [KEY_X] = KEY_CUT,
+        [KEY_C] = KEY_COPY,
+        [KEY_V] = KEY_PASTE,
+        // Make mod keys work inside alt-mode
+        [KEY_LEFTCTRL] = KEY_LEFTCTRL,
+        [KEY_LEFTMETA] = KEY_LEFTMETA,
+        [KEY_LEFTSHIFT] = KEY_LEFTSHIFT,
+        [KEY_LEFTALT] = 0, // disabled, it's a modkey!
+        [KEY_COMPOSE] = KEY_COMPOSE,
+        [KEY_RIGHTALT] = KEY_RIGHTALT,
+        [KEY_RIGHTCTRL] = KEY_RIGHTCTRL,
+        [KEY_RIGHTSHIFT] = KEY_RIGHTSHIFT,
+        [KEY_RIGHTMETA] = KEY_RIGHTMETA,
+    },
+    .direct_map = {
+        [KEY_CAPSLOCK] = KEY_ESC, 
+    },
+    .mouse_key_code = KEY_LEFTMETA,
+    .mouse_sensitivity = 1.0,
+    .mouse_speedup_ms = 700,
+    .mouse_map = {
+        // Buttons
+        [KEY_SPACE] = BTN_LEFT,
+        [KEY_N] = BTN_RIGHT,
+        // Wheel
+        [KEY_Y] = BTN_GEAR_UP,
+        [KEY_H] = BTN_GEAR_DOWN,
+        [KEY_U] = KEYMAP_HWHEEL_LEFT,
+        [KEY_O] = KEYMAP_HWHEEL_RIGHT,
+        // Cursor
+        [KEY_J] = KEY_LEFT,
+        [KEY_L] = KEY_RIGHT,
+        [KEY_I] = KEY_UP,
+        [KEY_K] = KEY_DOWN,
+    },
+};
+
+// NOTE: first matching device_name wins, profile without device_name is a fallback
+static KeyMapProfile_s profiles[] = {
+    {
+        .name = "uhk",
+        .device_name = "Ultimate Gadget Laboratories UHK 60 v1",
+        .config = &profile_uhk,
+    },
+    { .name = "generic", .device_name = NULL, .config = &profile_generic },
+};
+
 int
 main(int argc, char** argv)
 {
     int result = 1;
 
     KeyMap_c keymap = { 0 };
-    char* file = argv[1];
-    if (argc < 2) {
-        fprintf(stderr, "usage: uberkb /dev/input/eventN or 'My Keyboard Name'\n");
+
+    bool rt = false;
+    bool uring = false;
+    u32 busy_poll = 0;
+    i32 rt_priority = 0;
+    i32 rt_cpu = -1;
+    u32 bench_latency = 0;
+    u32 bench_replay = 0;
+    u32 bench_loop = 0;
+    u32 stress = 0;
+    i32 takeover = 0;
+    char* control_socket = KEYMAP_CONTROL_PATH_DEFAULT;
+    char* ctl = NULL;
+    bool unified = false;
+    char* accel = "linear";
+    char* accel_lut = NULL;
+    f32 accel_step = KEYMAP_ACCEL_STEP_DEFAULT;
+    f32 wheel_step = KEYMAP_WHEEL_STEP_DEFAULT;
+    f32 accel_lut_points[KEYMAP_ACCEL_LUT_SIZE] = { 0 };
+    bool repeat = false;
+    u32 repeat_delay = KEYMAP_REPEAT_DELAY_DEFAULT;
+    u32 repeat_rate = KEYMAP_REPEAT_RATE_DEFAULT;
+    u32 repeat_mod_delay = 0;
+    u32 repeat_mod_rate = 0;
+    char* gen_static = NULL;
+
+    argparse_c args = {
+        .program_name = "uberkb",
+        .usage = "[options] /dev/input/eventN or 'My Keyboard Name'",
+        argparse$opt_list(
+            argparse$opt_help(),
+            argparse$opt(&unified, 'u', "unified", "single virtual device for keyboard and mouse"),
+            argparse$opt_group("Pointer acceleration"),
+            argparse$opt(&accel, '\0', "accel", "curve: linear, quadratic, exponential, lut"),
+            argparse$opt(&accel_step, '\0', "accel-step", "px per tick at full speed"),
+            argparse$opt(&accel_lut, '\0', "accel-lut", "lut curve points, e.g. 0.1,0.2,0.6,1"),
+            argparse$opt(&wheel_step, '\0', "wheel-step", "wheel units (120 per notch) per tick"),
+            argparse$opt_group("Key repeat"),
+            argparse$opt(&repeat, '\0', "repeat", "daemon repeats, drop hardware ones"),
+            argparse$opt(&repeat_delay, '\0', "repeat-delay", "repeat delay ms"),
+            argparse$opt(&repeat_rate, '\0', "repeat-rate", "repeat rate Hz"),
+            argparse$opt(&repeat_mod_delay, '\0', "repeat-mod-delay", "mod layer delay ms"),
+            argparse$opt(&repeat_mod_rate, '\0', "repeat-mod-rate", "mod layer rate Hz"),
+            argparse$opt_group("Event loop"),
+            argparse$opt(&uring, '\0', "uring", "io_uring backend (falls back to poll)"),
+            argparse$opt(&busy_poll, '\0', "busy-poll", "spin us after input before blocking"),
+            argparse$opt_group("Realtime profile"),
+            argparse$opt(&rt, 'r', "rt", "SCHED_FIFO + mlockall() event loop (requires root)"),
+            argparse$opt(&rt_priority, '\0', "rt-priority", "SCHED_FIFO priority 1-99"),
+            argparse$opt(&rt_cpu, '\0', "rt-cpu", "pin event loop to CPU index"),
+            argparse$opt_group("Benchmarks"),
+            argparse$opt(&bench_latency, '\0', "bench-latency", "N key frames latency benchmark"),
+            argparse$opt(&bench_replay, '\0', "bench-replay", "N key frames in-memory ns/event"),
+            argparse$opt(&bench_loop, '\0', "bench-loop", "N key frames via event loop (root)"),
+            argparse$opt(&stress, '\0', "stress", "number of CPU hogs during benchmark"),
+            argparse$opt(&gen_static, '\0', "gen-static", "write profile maps as C header"),
+            argparse$opt_group("Control"),
+            argparse$opt(&control_socket, '\0', "control-socket", "control socket ('' - off)"),
+            argparse$opt(&ctl, 'c', "ctl", "send command to running daemon (try: help)"),
+            argparse$opt_group("Upgrade"),
+            argparse$opt(&takeover, '\0', "takeover", "internal: adopt devices via handoff socket"),
+        ),
+    };
+    if (argparse.parse(&args, argc, argv)) { return 1; }
+
+    if (ctl != NULL) {
+        e$goto(KeyMapControl.client(control_socket, ctl), end);
+        result = 0;
+        goto end;
+    }
+
+    char* file = argparse.next(&args);
+    if (file == NULL && bench_latency == 0 && bench_replay == 0 && bench_loop == 0 &&
+        gen_static == NULL) {
+        argparse.usage(&args);
         keymap.debug = true;
         if(KeyMap.find_mapped_keyboard(&keymap, "")){};
         goto end;
     }
+    if (file == NULL) { file = ""; }
 
-    if (str.eq(file, "Ultimate Gadget Laboratories UHK 60 v1")) {
-        log$info("Using special settings for UHK\n");
-        // CUT/COPY/PASTE for UHK
-        keymap = (KeyMap_c)  {
-            // .debug = true,
-            .direct_map = {
-                [KEY_F13] = KEY_CUT,
-                [KEY_F14] = KEY_COPY,
-                [KEY_F15] = KEY_PASTE,
-            },
-            .mouse_key_code = KEY_LEFTMETA,
-            .mouse_sensitivity = 1.0,
-            .mouse_speedup_ms = 700,
-            .mouse_map = {
-                // Buttons
-                [KEY_SPACE] = BTN_LEFT,
-                [KEY_N] = BTN_RIGHT,
-                // Wheel
-                [KEY_Y] = BTN_GEAR_UP,
-                [KEY_H] = BTN_GEAR_DOWN,
-                // Cursor
-                [KEY_J] = KEY_LEFT,
-                [KEY_L] = KEY_RIGHT,
-                [KEY_I] = KEY_UP,
-                [KEY_K] = KEY_DOWN,
-            },
-
-            // // For testing only
-            // .mod_key_code = KEY_LEFTALT,
-            // .mod_map = {
-            //     [KEY_I] = KEY_UP, 
-            //     [KEY_K] = KEY_DOWN, 
-            //     [KEY_J] = KEY_LEFT, 
-            //     [KEY_L] = KEY_RIGHT, 
-            // },
-        };
+    KeyMapProfile_s* profile = &profiles[arr$len(profiles) - 1];
+    for (u32 i = 0; i < arr$len(profiles); i++) {
+#ifdef KEYMAP_STATIC_CONFIG
+        // NOTE: maps are compiled in, the device name doesn't select profile
+        if (str.eq(profiles[i].name, KEYMAP_STATIC_PROFILE)) {
+#else
+        if (profiles[i].device_name == NULL || str.eq(file, profiles[i].device_name)) {
+#endif
+            profile = &profiles[i];
+            break;
+        }
+    }
+    log$info("Using profile: %s\n", profile->name);
+    e$goto(KeyMap.profile_apply(&keymap, profile), end);
+    if (gen_static != NULL) {
+        e$goto(KeyMap.static_config_save(&keymap, gen_static), end);
+        result = 0;
+        goto end;
+    }
+    keymap.control.profiles = profiles;
+    keymap.control.n_profiles = arr$len(profiles);
+
+    keymap.unified_device = unified;
+    keymap.accel.step = accel_step;
+    keymap.accel.wheel_step = wheel_step;
+    if (str.eq(accel, "linear")) {
+        keymap.accel.profile = KeyMapAccel__linear;
+    } else if (str.eq(accel, "quadratic")) {
+        keymap.accel.profile = KeyMapAccel__quadratic;
+    } else if (str.eq(accel, "exponential")) {
+        keymap.accel.profile = KeyMapAccel__exponential;
+    } else if (str.eq(accel, "lut")) {
+        keymap.accel.profile = KeyMapAccel__lut;
+        keymap.accel.user_lut = accel_lut_points;
+        for$iter(str_s, it, str.slice.iter_split(str.sstr(accel_lut), ",", &it.iterator)) {
+            if (keymap.accel.user_lut_len == arr$len(accel_lut_points)) { break; }
+            e$goto(str.convert.to_f32s(it.val, &accel_lut_points[keymap.accel.user_lut_len]), end);
+            keymap.accel.user_lut_len++;
+        }
     } else {
-        // Default mapping all other generic keyboards
-        keymap = (KeyMap_c)  {
-            // .debug = true,
-            .mod_key_code = KEY_LEFTALT,
-            .mod_map = {
-                [KEY_I] = KEY_UP, 
-                [KEY_K] = KEY_DOWN, 
-                [KEY_J] = KEY_LEFT, 
-                [KEY_L] = KEY_RIGHT, 
-                [KEY_SPACE] = KEY_BACKSPACE,
-                [KEY_N] = KEY_DELETE,
-                [KEY_U] = KEY_HOME,
-                [KEY_O] = KEY_END,
-                [KEY_Y] = KEY_PAGEUP,
-                [KEY_H] = KEY_PAGEDOWN,
-                [KEY_F] = KEY_SCROLLLOCK,
-                [KEY_X] = KEY_CUT,
-                [KEY_C] = KEY_COPY,
-                [KEY_V] = KEY_PASTE,
-                // Make mod keys work inside alt-mode
-                [KEY_LEFTCTRL] = KEY_LEFTCTRL,
-                [KEY_LEFTMETA] = KEY_LEFTMETA,
-                [KEY_LEFTSHIFT] = KEY_LEFTSHIFT,
-                [KEY_LEFTALT] = 0, // disabled, it's a modkey!
-                [KEY_COMPOSE] = KEY_COMPOSE,
-                [KEY_RIGHTALT] = KEY_RIGHTALT,
-                [KEY_RIGHTCTRL] = KEY_RIGHTCTRL,
-                [KEY_RIGHTSHIFT] = KEY_RIGHTSHIFT,
-                [KEY_RIGHTMETA] = KEY_RIGHTMETA,
-            },
-            .direct_map = {
-                [KEY_CAPSLOCK] = KEY_ESC, 
-            },
-            .mouse_key_code = KEY_LEFTMETA,
-            .mouse_sensitivity = 1.0,
-            .mouse_speedup_ms = 700,
-            .mouse_map = {
-                // Buttons
-                [KEY_SPACE] = BTN_LEFT,
-                [KEY_N] = BTN_RIGHT,
-                // Wheel
-                [KEY_Y] = BTN_GEAR_UP,
-                [KEY_H] = BTN_GEAR_DOWN,
-                // Cursor
-                [KEY_J] = KEY_LEFT,
-                [KEY_L] = KEY_RIGHT,
-                [KEY_I] = KEY_UP,
-                [KEY_K] = KEY_DOWN,
-            },
-        };
+        log$error("Unknown --accel curve: %s\n", accel);
+        goto end;
+    }
+    keymap.repeat = (typeof(keymap.repeat)){
+        .enabled = repeat,
+        .delay_ms = { [KeyMapLayer__direct] = repeat_delay, [KeyMapLayer__mod] = repeat_mod_delay },
+        .rate_hz = { [KeyMapLayer__direct] = repeat_rate, [KeyMapLayer__mod] = repeat_mod_rate },
+    };
+    keymap.uring.enabled = uring;
+    if (busy_poll > KEYMAP_BUSY_POLL_MAX_US) {
+        log$error("--busy-poll must be <= %d us\n", KEYMAP_BUSY_POLL_MAX_US);
+        goto end;
+    }
+    keymap.busy_poll.window_us = busy_poll;
+    keymap.realtime = (typeof(keymap.realtime)){
+        .enabled = rt,
+        .priority = rt_priority,
+        .pin_cpu = rt_cpu >= 0,
+        .cpu = rt_cpu >= 0 ? (u32)rt_cpu : 0,
+    };
+
+    if (bench_latency > 0) {
+        e$goto(KeyMapBench.latency(&keymap, bench_latency, stress), end);
+        result = 0;
+        goto end;
+    }
+    if (bench_replay > 0) {
+        e$goto(KeyMapBench.replay(&keymap, bench_replay), end);
+        result = 0;
+        goto end;
+    }
+    if (bench_loop > 0) {
+        e$goto(KeyMapBench.loop(&keymap, bench_loop), end);
+        result = 0;
+        goto end;
     }
 
-    e$goto(KeyMap.create(&keymap, file), end);
-    e$goto(KeyMap.handle_events(&keymap), end);
+    // NOTE: SIGHUP (systemctl reload) hands devices off to the new binary without ungrab
+    e$goto(KeyMapHandoff.setup(argc, argv), end);
+    if (takeover > 0) {
+        e$goto(KeyMapHandoff.takeover(&keymap, takeover), end);
+    } else {
+        e$goto(KeyMap.create(&keymap, file), end);
+    }
+
+    keymap.control.socket_path = control_socket;
+    if (KeyMapControl.setup(&keymap)) { log$warn("Running without control socket\n"); }
+
+    while (true) {
+        e$goto(KeyMap.handle_events(&keymap), end);
+        if (!keymap.handoff.requested) { break; }
+        keymap.handoff.requested = false;
+        if (KeyMapHandoff.upgrade(&keymap)) { log$error("Upgrade failed, keep running\n"); }
+    }
 
     result = 0;
 end:
+    KeyMapControl.destroy(&keymap);
     KeyMap.destroy(&keymap);
     return result;
 }
@@ -0,0 +1,165 @@
+#define CEX_IMPLEMENTATION
+#define CEX_TEST
+#include "cex.h"
+
+#define WALK_DIR "build/test_os_fs_walk"
+
+struct walk_ctx_s
+{
+    pthread_mutex_t lock;
+    arr$(char*) paths; // "<kind> <path>" entries, sorted after the walk
+};
+
+static Exception
+walk_collect(char* path, os_fs_stat_s ftype, void* user_ctx)
+{
+    struct walk_ctx_s* ctx = user_ctx;
+    char kind = ftype.is_symlink ? 'l' : ftype.is_directory ? 'd' : ftype.is_file ? 'f' : 'o';
+    char* entry = str.fmt(mem$, "%c%c %s", kind, ftype.is_directory ? '/' : ' ', path);
+    if (entry == NULL) { return Error.memory; }
+
+    pthread_mutex_lock(&ctx->lock);
+    arr$push(ctx->paths, entry);
+    pthread_mutex_unlock(&ctx->lock);
+    return EOK;
+}
+
+static void
+walk_ctx_free(struct walk_ctx_s* ctx)
+{
+    for$each (it, ctx->paths) { mem$free(mem$, it); }
+    arr$free(ctx->paths);
+}
+
+/// Walks WALK_DIR (serial or on `n_threads`), returns sorted entries
+static Exception
+walk(struct walk_ctx_s* ctx, u32 n_threads)
+{
+    *ctx = (struct walk_ctx_s){ .lock = PTHREAD_MUTEX_INITIALIZER };
+    ctx->paths = arr$new(ctx->paths, mem$);
+    if (n_threads == 0) {
+        e$ret(os.fs.dir_walk(WALK_DIR, true, walk_collect, ctx));
+    } else {
+        e$ret(os.fs.dir_walk_mt(WALK_DIR, n_threads, walk_collect, ctx));
+    }
+    arr$sort(ctx->paths, str.qscmp);
+    return EOK;
+}
+
+test$setup_case()
+{
+    if (os.path.exists(WALK_DIR)) { e$ret(os.fs.remove_tree(WALK_DIR)); }
+    mem$scope(tmem$, _)
+    {
+        for (u32 i = 0; i < 4; i++) {
+            for (u32 j = 0; j < 3; j++) {
+                char* dir = str.fmt(_, WALK_DIR "/d%d/sub%d", i, j);
+                e$ret(os.fs.mkpath(str.fmt(_, "%s/", dir)));
+                e$ret(io.file.save(str.fmt(_, "%s/file.c", dir), "x"));
+                e$ret(io.file.save(str.fmt(_, "%s/file.h", dir), "y"));
+            }
+            e$ret(io.file.save(str.fmt(_, WALK_DIR "/d%d/top.txt", i), "z"));
+        }
+    }
+    return EOK;
+}
+
+test$teardown_case()
+{
+    _cex_os__fs__dir_walk_dt_unknown = false;
+    if (os.path.exists(WALK_DIR)) { e$ret(os.fs.remove_tree(WALK_DIR)); }
+    return EOK;
+}
+
+test$case(test_walk_entries)
+{
+    struct walk_ctx_s ctx;
+    tassert_eq(walk(&ctx, 0), EOK);
+    // 4 x (d + top.txt + 3 x (sub + 2 files))
+    tassert_eq(arr$len(ctx.paths), 4 * (2 + 3 * 3));
+    tassert_eq(ctx.paths[0], "d/ " WALK_DIR "/d0");
+    tassert_eq(ctx.paths[arr$len(ctx.paths) - 1], "f  " WALK_DIR "/d3/top.txt");
+    walk_ctx_free(&ctx);
+    return EOK;
+}
+
+test$case(test_walk_symlink_to_dir)
+{
+    tassert_eq(symlink("d0", WALK_DIR "/link_d0"), 0);
+
+    struct walk_ctx_s ctx;
+    tassert_eq(walk(&ctx, 0), EOK);
+    // NOTE: symlink is reported (stat()-ed target is a directory), but not followed
+    tassert_eq(arr$len(ctx.paths), 4 * (2 + 3 * 3) + 1);
+    u32 n_links = 0;
+    for$each (it, ctx.paths) {
+        if (str.ends_with(it, "/link_d0")) {
+            tassert_eq(it, "l/ " WALK_DIR "/link_d0");
+            n_links++;
+        }
+        tassert(!str.find(it, "link_d0/"));
+    }
+    tassert_eq(n_links, 1);
+    walk_ctx_free(&ctx);
+    return EOK;
+}
+
+test$case(test_walk_dt_unknown_same_entries)
+{
+    tassert_eq(symlink("d1/top.txt", WALK_DIR "/link_top"), 0);
+
+    struct walk_ctx_s ctx;
+    tassert_eq(walk(&ctx, 0), EOK);
+
+    // NOTE: d_type is not supported by every filesystem, entries are stat()-ed then
+    _cex_os__fs__dir_walk_dt_unknown = true;
+    struct walk_ctx_s ctx_unknown;
+    tassert_eq(walk(&ctx_unknown, 0), EOK);
+    _cex_os__fs__dir_walk_dt_unknown = false;
+
+    tassert_eq(arr$len(ctx_unknown.paths), arr$len(ctx.paths));
+    for (u32 i = 0; i < arr$len(ctx.paths); i++) {
+        tassert_eq(ctx_unknown.paths[i], ctx.paths[i]);
+    }
+    walk_ctx_free(&ctx);
+    walk_ctx_free(&ctx_unknown);
+    return EOK;
+}
+
+test$case(test_walk_path_overflow)
+{
+    // NOTE: "././.../" prefix makes a valid path close to PATH_MAX, entries don't fit
+    mem$scope(tmem$, _)
+    {
+        sbuf_c path = sbuf.create(PATH_MAX, _);
+        while (sbuf.len(&path) < PATH_MAX - 30) { tassert_eq(sbuf.append(&path, "./"), EOK); }
+        tassert_eq(sbuf.append(&path, WALK_DIR), EOK);
+        tassert(os.path.exists(path));
+
+        struct walk_ctx_s ctx = { .lock = PTHREAD_MUTEX_INITIALIZER };
+        ctx.paths = arr$new(ctx.paths, mem$);
+        tassert_eq(os.fs.dir_walk(path, true, walk_collect, &ctx), Error.overflow);
+        walk_ctx_free(&ctx);
+    }
+    return EOK;
+}
+
+test$case(test_walk_mt_same_as_serial)
+{
+    struct walk_ctx_s ctx;
+    tassert_eq(walk(&ctx, 0), EOK);
+
+    for (u32 n_threads = 2; n_threads <= 4; n_threads++) {
+        struct walk_ctx_s ctx_mt;
+        tassert_eq(walk(&ctx_mt, n_threads), EOK);
+        tassert_eq(arr$len(ctx_mt.paths), arr$len(ctx.paths));
+        for (u32 i = 0; i < arr$len(ctx.paths); i++) {
+            tassert_eq(ctx_mt.paths[i], ctx.paths[i]);
+        }
+        walk_ctx_free(&ctx_mt);
+    }
+    walk_ctx_free(&ctx);
+    return EOK;
+}
+
+test$main();
@@ -0,0 +1,99 @@
+#define CEX_IMPLEMENTATION
+#define CEX_TEST
+#include "cex.h"
+
+test$case(test_match_basic)
+{
+    tassert(str.match("main.c", "*.[ch]"));
+    tassert(str.match("KeyMap.h", "KeyMap*.[ch]"));
+    tassert(!str.match("main.o", "*.[ch]"));
+    tassert(str.match("README.md", "(README|LICENSE)*"));
+    tassert(!str.match("NOTES.md", "(README|LICENSE)*"));
+    tassert(str.match("abc", "a?c"));
+    tassert(!str.match("", "*"));
+    return EOK;
+}
+
+test$case(test_match_semantics_vs_interpreter)
+{
+    // NOTE: the old backtracking interpreter got these wrong, compiled matcher fixed them
+    tassert_eq(str.match("a", "a*?"), false); // `?` needs one more char (was true)
+    tassert_eq(str.match("a", "[a]*"), true);
+    tassert_eq(str.match("aa", "[aa+][ab]"), true);
+    tassert_eq(str.match("abc", "(a|ab)c"), true);
+    tassert_eq(str.match("ab", "a*?"), true);
+    return EOK;
+}
+
+test$case(test_match_cache_many_patterns)
+{
+    // more patterns than cache entries, results must match freshly compiled patterns
+    char* patterns[] = { "*.c", "*.h", "README*", "*.[ch]", "(a|b)*", "x?z" };
+    char* strings[] = { "f.c", "f.h", "README", "g.h", "bcd", "xyz" };
+    for (u32 round = 0; round < 3; round++) {
+        for (u32 i = 0; i < arr$len(patterns); i++) {
+            str_pattern_c pat;
+            tassert_eq(str.pattern.compile(&pat, patterns[i]), EOK);
+            for (u32 j = 0; j < arr$len(strings); j++) {
+                tassert_eq(str.match(strings[j], patterns[i]), str.pattern.match(&pat, strings[j]));
+            }
+        }
+    }
+    tassert(str.match("g.h", "*.[ch]"));
+    tassert(!str.match("README", "*.[ch]"));
+    return EOK;
+}
+
+test$case(test_match_cache_pattern_buffer_reuse)
+{
+    char buf[16] = "*.c";
+    tassert(str.match("f.c", buf));
+    memcpy(buf, "*.h", 4); // same pointer, new pattern
+    tassert(!str.match("f.c", buf));
+    tassert(str.match("f.h", buf));
+    return EOK;
+}
+
+test$case(test_match_long_pattern)
+{
+    // not cached (longer than cache key), compiled on every call
+    char* p = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa*";
+    tassert(strlen(p) >= 64);
+    tassert(str.match("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab", p));
+    tassert(!str.match("aaaab", p));
+    return EOK;
+}
+
+test$case(test_pattern_compile)
+{
+    str_pattern_c pat;
+    tassert_eq(str.pattern.compile(&pat, "*.[ch]"), EOK);
+    tassert(str.pattern.match(&pat, "x.c"));
+    tassert(!str.pattern.match(&pat, "x.o"));
+    tassert(str.pattern.matchs(&pat, str.sstr("y.h")));
+    return EOK;
+}
+
+test$case(test_find_big_pattern)
+{
+    // 9 classes: too big for compiled matcher, os.fs.find() falls back to interpreter
+    char* pattern = "[t][e][s][t][_][s][t][r][_]match.c";
+    str_pattern_c pat;
+    tassert_eq(str.pattern.compile(&pat, pattern), Error.overflow);
+    tassert(str.match("test_str_match.c", pattern));
+
+    mem$scope(tmem$, _)
+    {
+        arr$(char*) files = os.fs.find("tests/[t][e][s][t][_][s][t][r][_]match.c", false, _);
+        tassert(files != NULL);
+        tassert_eq(arr$len(files), 1);
+        tassert_eq(files[0], "tests/test_str_match.c");
+
+        files = os.fs.find("tests/[t][e][s][t][_][s][t][r][_]match.h", false, _);
+        tassert(files != NULL);
+        tassert_eq(arr$len(files), 0);
+    }
+    return EOK;
+}
+
+test$main();